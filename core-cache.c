@@ -257,6 +257,15 @@ static int stress_add_cpu_cache_detail(stress_cpu_cache_t *cache, const char *in
     }
   }
   
+  /* CPU list is in ascending order, the first CPU identifies the cache */
+  (void)stress_mk_filename(path, sizeof(path), index_path, "shared_cpu_list");
+  
+  if ((stress_get_string_from_file(path, tmp, sizeof(tmp)) < 0) ||
+      (sscanf(tmp, "%" SCNd32, &cache->shared_cpu) != 1))
+  {
+    cache->shared_cpu = -1;
+  }
+  
   ret = EXIT_SUCCESS;
 out:
   return ret;
@@ -441,6 +450,7 @@ static int stress_get_cpu_cache_auxval(stress_cpu_t *cpu)
     
     cpu->caches[index].type = cache_auxval_info[i].type;
     cpu->caches[index].level = cache_auxval_info[i].level;
+    cpu->caches[index].shared_cpu = -1;
     
     switch (cache_auxval_info[i].size_type)
     {
@@ -527,6 +537,7 @@ static int stress_get_cpu_cache_sparc64(
     
     cpu->caches[idx].type = cache_info[i].type;
     cpu->caches[idx].level = cache_info[i].level;
+    cpu->caches[idx].shared_cpu = -1;
     
     switch (cache_info[i].size_type)
     {
@@ -0,0 +1,853 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+/*
+ *  stress_set_cgroup_cpu_max()
+ *  set the cpu.max of the per stressor cgroups, max or a quota
+ *  in microseconds with an optional /period in microseconds
+ */
+int stress_set_cgroup_cpu_max(const char *const opt)
+{
+  uint64_t quota = 0, period = 100000;
+  char *end;
+  
+  if (strncmp(opt, "max", 3))
+  {
+    quota = (uint64_t)strtoull(opt, &end, 10);
+    
+    if ((end == opt) || (quota < 1000))
+    {
+      goto err;
+    }
+  }
+  else
+  {
+    end = (char *)opt + 3;
+  }
+  
+  if (*end == '/')
+  {
+    const char *str = end + 1;
+    
+    period = (uint64_t)strtoull(str, &end, 10);
+    
+    if ((end == str) || (period < 1000) || (period > 1000000))
+    {
+      goto err;
+    }
+  }
+  
+  if (*end)
+  {
+    goto err;
+  }
+  
+  return stress_set_setting_global("cgroup-cpu-max", TYPE_ID_STR, (void *)opt);
+  
+err:
+  (void)fprintf(stderr, "cgroup-cpu-max '%s' not valid, use max or a quota "
+                "of at least 1000 usecs with an optional /period of 1000 "
+                "to 1000000 usecs\n", opt);
+  return -1;
+}
+
+/*
+ *  stress_set_cgroup_memory_max()
+ *  set the memory.max of the per stressor cgroups
+ */
+int stress_set_cgroup_memory_max(const char *const opt)
+{
+  const uint64_t memory_max = stress_get_uint64_byte(opt);
+  
+  return stress_set_setting_global("cgroup-memory-max", TYPE_ID_UINT64, &memory_max);
+}
+
+/*
+ *  stress_set_cgroup_io_max()
+ *  set the io.max of the per stressor cgroups, in the kernel
+ *  format, e.g. "8:0 rbps=1048576 wiops=100"
+ */
+int stress_set_cgroup_io_max(const char *const opt)
+{
+  unsigned int maj, min;
+  
+  if ((sscanf(opt, "%u:%u", &maj, &min) != 2) || !strchr(opt, '='))
+  {
+    (void)fprintf(stderr, "cgroup-io-max '%s' not valid, use MAJ:MIN followed "
+                  "by rbps=, wbps=, riops= or wiops= limits\n", opt);
+    return -1;
+  }
+  
+  return stress_set_setting_global("cgroup-io-max", TYPE_ID_STR, (void *)opt);
+}
+
+#if defined(__linux__)
+
+/*
+ *  Each stressor gets a cgroup v2 child of a stress-ng-<pid> cgroup
+ *  created under the cgroup stress-ng is running in. The cgroups
+ *  are created and the limits applied before the instances are
+ *  forked, the instances move themselves into the cgroup of their
+ *  stressor as they start so that all the processes they fork are
+ *  accounted to it too. The stressor cgroups are re-created for
+ *  each --repeat run so their accounting covers just that run.
+ */
+typedef struct
+{
+  const stress_stressor_t *ss;  /* stressor of the cgroup */
+  char path[PATH_MAX];    /* cgroup directory */
+  int procs_fd;     /* cgroup.procs, to move instances in */
+  bool used;      /* a run has been accounted to it */
+  bool harvested;     /* stats have been harvested */
+  stress_cgroup_stats_t stats;  /* harvested cgroup stats */
+} stress_cgroup_t;
+
+typedef struct
+{
+  char path[PATH_MAX];    /* stress-ng-<pid> cgroup */
+  pid_t pid;      /* process that created the cgroups */
+  stress_cgroup_t *cgroups; /* per stressor cgroups */
+  size_t n_cgroups;   /* number of per stressor cgroups */
+} stress_cgroups_t;
+
+static stress_cgroups_t cgroups;
+
+/*
+ *  stress_cgroup_mount()
+ *  find where cgroup v2 is mounted, returns -1 if not mounted
+ */
+static int stress_cgroup_mount(char *path, const size_t path_len)
+{
+  FILE *fp;
+  char buf[4096];
+  int ret = -1;
+  
+  fp = fopen("/proc/self/mountinfo", "r");
+  
+  if (!fp)
+  {
+    return -1;
+  }
+  
+  while (fgets(buf, sizeof(buf), fp))
+  {
+    char mnt[PATH_MAX];
+    
+    /* mount point is field 5, the file system type follows " - " */
+    if (!strstr(buf, " - cgroup2 "))
+    {
+      continue;
+    }
+    
+    if (sscanf(buf, "%*s %*s %*s %*s %4095s", mnt) == 1)
+    {
+      (void)shim_strlcpy(path, mnt, path_len);
+      ret = 0;
+      break;
+    }
+  }
+  
+  (void)fclose(fp);
+  return ret;
+}
+
+/*
+ *  stress_cgroup_self()
+ *  find the cgroup v2 path of stress-ng, returns -1 if not known
+ */
+static int stress_cgroup_self(char *path, const size_t path_len)
+{
+  FILE *fp;
+  char buf[4096];
+  int ret = -1;
+  
+  fp = fopen("/proc/self/cgroup", "r");
+  
+  if (!fp)
+  {
+    return -1;
+  }
+  
+  while (fgets(buf, sizeof(buf), fp))
+  {
+    if (!strncmp(buf, "0::", 3))
+    {
+      char *ptr = strchr(buf, '\n');
+      
+      if (ptr)
+      {
+        *ptr = '\0';
+      }
+      
+      (void)shim_strlcpy(path, buf + 3, path_len);
+      ret = 0;
+      break;
+    }
+  }
+  
+  (void)fclose(fp);
+  return ret;
+}
+
+/*
+ *  stress_cgroup_write()
+ *  write a string to a cgroup control file, returns -errno
+ *  on failure
+ */
+static int stress_cgroup_write(const char *path, const char *file, const char *str)
+{
+  char filename[PATH_MAX];
+  int fd, ret = 0;
+  
+  if (snprintf(filename, sizeof(filename), "%s/%s", path, file) >= (int)sizeof(filename))
+  {
+    return -ENAMETOOLONG;
+  }
+  
+  fd = open(filename, O_WRONLY);
+  
+  if (fd < 0)
+  {
+    return -errno;
+  }
+  
+  if (write(fd, str, strlen(str)) < 0)
+  {
+    ret = -errno;
+  }
+  
+  (void)close(fd);
+  return ret;
+}
+
+/*
+ *  stress_cgroup_read()
+ *  read a cgroup control file, returns -1 on failure
+ */
+static ssize_t stress_cgroup_read(const char *path, const char *file, char *buf, const size_t buf_len)
+{
+  char filename[PATH_MAX];
+  
+  if (snprintf(filename, sizeof(filename), "%s/%s", path, file) >= (int)sizeof(filename))
+  {
+    return -1;
+  }
+  
+  return system_read(filename, buf, buf_len - 1);
+}
+
+/*
+ *  stress_cgroup_controllers()
+ *  enable the cpu, memory and io controllers for the children
+ *  of a cgroup, controllers that are not available are skipped
+ */
+static void stress_cgroup_controllers(const char *path)
+{
+  static const char *const controllers[] = { "cpu", "memory", "io" };
+  char buf[512];
+  size_t i;
+  
+  if (stress_cgroup_read(path, "cgroup.controllers", buf, sizeof(buf)) < 0)
+  {
+    return;
+  }
+  
+  for (i = 0; i < SIZEOF_ARRAY(controllers); i++)
+  {
+    char enable[16];
+    const char *ptr = strstr(buf, controllers[i]);
+    const size_t len = strlen(controllers[i]);
+    int ret;
+    
+    /* must be a whole word in the controllers list */
+    if (!ptr || ((ptr != buf) && (ptr[-1] != ' ')) ||
+        ((ptr[len] != ' ') && (ptr[len] != '\n') && (ptr[len] != '\0')))
+    {
+      continue;
+    }
+    
+    (void)snprintf(enable, sizeof(enable), "+%s", controllers[i]);
+    ret = stress_cgroup_write(path, "cgroup.subtree_control", enable);
+    
+    if (ret < 0)
+    {
+      pr_dbg("cgroup: cannot enable %s controller in %s, errno=%d (%s)\n",
+             controllers[i], path, -ret, strerror(-ret));
+    }
+  }
+}
+
+/*
+ *  stress_cgroup_limit()
+ *  write a limit to a cgroup control file, the file only
+ *  exists when the controller is enabled for the cgroup
+ */
+static void stress_cgroup_limit(const char *path, const char *file, const char *limit)
+{
+  const int ret = stress_cgroup_write(path, file, limit);
+  
+  if (ret == -ENOENT)
+  {
+    pr_inf("cgroup: cannot set %s of %s, the controller is not enabled\n",
+           file, path);
+  }
+  else if (ret < 0)
+  {
+    pr_inf("cgroup: cannot set %s of %s, errno=%d (%s)\n",
+           file, path, -ret, strerror(-ret));
+  }
+}
+
+/*
+ *  stress_cgroup_limits()
+ *  apply the command line limits to a per stressor cgroup
+ */
+static void stress_cgroup_limits(const char *path)
+{
+  char *cpu_max = NULL, *io_max = NULL, buf[64];
+  uint64_t memory_max = 0;
+  
+  (void)stress_get_setting("cgroup-cpu-max", &cpu_max);
+  (void)stress_get_setting("cgroup-memory-max", &memory_max);
+  (void)stress_get_setting("cgroup-io-max", &io_max);
+  
+  if (cpu_max)
+  {
+    char *ptr;
+    
+    /* kernel format is "quota period" */
+    (void)shim_strlcpy(buf, cpu_max, sizeof(buf));
+    ptr = strchr(buf, '/');
+    
+    if (ptr)
+    {
+      *ptr = ' ';
+    }
+    
+    stress_cgroup_limit(path, "cpu.max", buf);
+  }
+  
+  if (memory_max)
+  {
+    (void)snprintf(buf, sizeof(buf), "%" PRIu64, memory_max);
+    stress_cgroup_limit(path, "memory.max", buf);
+  }
+  
+  if (io_max)
+  {
+    stress_cgroup_limit(path, "io.max", io_max);
+  }
+}
+
+/*
+ *  stress_cgroup_create()
+ *  create a per stressor cgroup, open its cgroup.procs and
+ *  apply the limits, returns -1 if it cannot be created
+ */
+static int stress_cgroup_create(stress_cgroup_t *cg)
+{
+  char filename[PATH_MAX];
+  
+  cg->procs_fd = -1;
+  
+  if ((mkdir(cg->path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) < 0) &&
+      (errno != EEXIST))
+  {
+    pr_inf("cgroup: cannot create %s, errno=%d (%s)\n",
+           cg->path, errno, strerror(errno));
+    return -1;
+  }
+  
+  if (snprintf(filename, sizeof(filename), "%s/cgroup.procs", cg->path) < (int)sizeof(filename))
+  {
+    cg->procs_fd = open(filename, O_WRONLY);
+  }
+  
+  stress_cgroup_limits(cg->path);
+  return 0;
+}
+
+/*
+ *  stress_cgroup_remove()
+ *  kill any processes left in a cgroup and remove it, the
+ *  kill is asynchronous so retry the rmdir for a short while,
+ *  returns -errno on failure
+ */
+static int stress_cgroup_remove(const char *path)
+{
+  int i;
+  
+  (void)stress_cgroup_write(path, "cgroup.kill", "1");
+  
+  for (i = 0; i < 100; i++)
+  {
+    if (rmdir(path) == 0)
+    {
+      return 0;
+    }
+    
+    if (errno != EBUSY)
+    {
+      break;
+    }
+    
+    (void)shim_usleep(10000);
+  }
+  
+  return -errno;
+}
+
+/*
+ *  stress_cgroup_init()
+ *  create a cgroup for each stressor and apply any limits,
+ *  --cgroup-per-stressor is disabled if cgroup v2 is not usable
+ */
+int stress_cgroup_init(stress_stressor_t *stressors_list)
+{
+  char mnt[PATH_MAX], self[PATH_MAX];
+  stress_stressor_t *ss;
+  size_t n = 0;
+  
+  (void)memset(&cgroups, 0, sizeof(cgroups));
+  
+  if (!(g_opt_flags & OPT_FLAGS_CGROUP))
+  {
+    return 0;
+  }
+  
+  if ((stress_cgroup_mount(mnt, sizeof(mnt)) < 0) ||
+      (stress_cgroup_self(self, sizeof(self)) < 0))
+  {
+    pr_inf("cgroup: cgroup v2 is not available, disabling --cgroup-per-stressor\n");
+    g_opt_flags &= ~OPT_FLAGS_CGROUP;
+    return 0;
+  }
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    n++;
+  }
+  
+  cgroups.cgroups = calloc(n, sizeof(*cgroups.cgroups));
+  
+  if (!cgroups.cgroups)
+  {
+    pr_err("cannot allocate %zu cgroups\n", n);
+    return -1;
+  }
+  
+  if (snprintf(cgroups.path, sizeof(cgroups.path), "%s%s",
+               mnt, strcmp(self, "/") ? self : "") >= (int)sizeof(cgroups.path))
+  {
+    errno = ENAMETOOLONG;
+    goto err;
+  }
+  
+  (void)snprintf(self, sizeof(self), "/stress-ng-%d", (int)getpid());
+  
+  if ((shim_strlcat(cgroups.path, self, sizeof(cgroups.path)) >= sizeof(cgroups.path)) ||
+      (mkdir(cgroups.path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) < 0))
+  {
+err:
+    pr_inf("cgroup: cannot create %s, errno=%d (%s), disabling "
+           "--cgroup-per-stressor\n", cgroups.path, errno, strerror(errno));
+    free(cgroups.cgroups);
+    (void)memset(&cgroups, 0, sizeof(cgroups));
+    g_opt_flags &= ~OPT_FLAGS_CGROUP;
+    return 0;
+  }
+  
+  cgroups.pid = getpid();
+  
+  /*
+   *  Only the controllers delegated to the cgroup stress-ng is
+   *  running in can be enabled, the parent cgroup is left alone.
+   *  The stress-ng-<pid> cgroup has no processes of its own so
+   *  it can enable them for the per stressor cgroups, otherwise
+   *  just the core cpu.stat accounting is available
+   */
+  stress_cgroup_controllers(cgroups.path);
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    stress_cgroup_t *cg = &cgroups.cgroups[cgroups.n_cgroups];
+    
+    cg->ss = ss;
+    cg->procs_fd = -1;
+    
+    if (snprintf(cg->path, sizeof(cg->path), "%s/%s", cgroups.path,
+                 stress_munge_underscore(ss->stressor->name)) >= (int)sizeof(cg->path))
+    {
+      continue;
+    }
+    
+    if (stress_cgroup_create(cg) < 0)
+    {
+      continue;
+    }
+    
+    cgroups.n_cgroups++;
+  }
+  
+  pr_inf("cgroup: %zu stressor cgroup%s in %s\n", cgroups.n_cgroups,
+         cgroups.n_cgroups == 1 ? "" : "s", cgroups.path);
+  return 0;
+}
+
+/*
+ *  stress_cgroup_find()
+ *  find the cgroup of a stressor
+ */
+static stress_cgroup_t *stress_cgroup_find(const stress_stressor_t *ss)
+{
+  size_t i;
+  
+  for (i = 0; i < cgroups.n_cgroups; i++)
+  {
+    if (cgroups.cgroups[i].ss == ss)
+    {
+      return &cgroups.cgroups[i];
+    }
+  }
+  
+  return NULL;
+}
+
+/*
+ *  stress_cgroup_reset()
+ *  re-create the cgroups of the stressors about to be run if
+ *  an earlier --repeat run was accounted to them, so that the
+ *  harvested accounting covers the same run as the bogo-ops
+ */
+void stress_cgroup_reset(const stress_stressor_t *stressors_list)
+{
+  const stress_stressor_t *ss;
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    stress_cgroup_t *cg = stress_cgroup_find(ss);
+    int ret;
+    
+    if (!cg)
+    {
+      continue;
+    }
+    
+    if (cg->used)
+    {
+      if (cg->procs_fd >= 0)
+      {
+        (void)close(cg->procs_fd);
+        cg->procs_fd = -1;
+      }
+      
+      ret = stress_cgroup_remove(cg->path);
+      
+      if (ret < 0)
+      {
+        pr_dbg("cgroup: cannot remove %s, errno=%d (%s)\n",
+               cg->path, -ret, strerror(-ret));
+      }
+      
+      (void)stress_cgroup_create(cg);
+    }
+    
+    cg->used = true;
+    cg->harvested = false;
+  }
+}
+
+/*
+ *  stress_cgroup_enter()
+ *  move the calling stressor instance into the cgroup of
+ *  its stressor
+ */
+void stress_cgroup_enter(const stress_stressor_t *ss)
+{
+  const stress_cgroup_t *cg = stress_cgroup_find(ss);
+  char pid[32];
+  
+  if (!cg || (cg->procs_fd < 0))
+  {
+    return;
+  }
+  
+  (void)snprintf(pid, sizeof(pid), "%d", (int)getpid());
+  
+  if (write(cg->procs_fd, pid, strlen(pid)) < 0)
+  {
+    pr_dbg("cgroup: cannot move pid %s into %s, errno=%d (%s)\n",
+           pid, cg->path, errno, strerror(errno));
+  }
+}
+
+/*
+ *  stress_cgroup_keyed()
+ *  parse "key value" lines of a cgroup stat file
+ */
+static void stress_cgroup_keyed(
+  const char *buf,
+  const char *const *keys,
+  uint64_t *const *values,
+  const size_t n)
+{
+  const char *ptr;
+  
+  for (ptr = buf; ptr && *ptr; )
+  {
+    size_t i;
+    
+    for (i = 0; i < n; i++)
+    {
+      const size_t len = strlen(keys[i]);
+      
+      if (!strncmp(ptr, keys[i], len) && (ptr[len] == ' '))
+      {
+        *values[i] = (uint64_t)strtoull(ptr + len + 1, NULL, 10);
+        break;
+      }
+    }
+    
+    ptr = strchr(ptr, '\n');
+    
+    if (ptr)
+    {
+      ptr++;
+    }
+  }
+}
+
+/*
+ *  stress_cgroup_io()
+ *  sum the io.stat counters of all the devices
+ */
+static void stress_cgroup_io(const char *buf, stress_cgroup_stats_t *stats)
+{
+  static const char *const keys[] = { "rbytes=", "wbytes=", "rios=", "wios=" };
+  uint64_t *const values[] =
+  {
+    &stats->io_rbytes, &stats->io_wbytes, &stats->io_rios, &stats->io_wios,
+  };
+  const char *ptr;
+  
+  for (ptr = buf; ptr && *ptr; ptr++)
+  {
+    size_t i;
+    
+    if ((ptr != buf) && (ptr[-1] != ' '))
+    {
+      continue;
+    }
+    
+    for (i = 0; i < SIZEOF_ARRAY(keys); i++)
+    {
+      const size_t len = strlen(keys[i]);
+      
+      if (!strncmp(ptr, keys[i], len))
+      {
+        *values[i] += (uint64_t)strtoull(ptr + len, NULL, 10);
+        break;
+      }
+    }
+  }
+}
+
+/*
+ *  stress_cgroup_harvest()
+ *  read the accounting of each stressor cgroup once all the
+ *  instances have exited
+ */
+void stress_cgroup_harvest(void)
+{
+  static const char *const cpu_keys[] =
+  {
+    "usage_usec", "user_usec", "system_usec", "nr_throttled", "throttled_usec",
+  };
+  static const char *const memory_keys[] =
+  {
+    "anon", "file", "pgfault", "pgmajfault",
+  };
+  size_t i;
+  
+  for (i = 0; i < cgroups.n_cgroups; i++)
+  {
+    stress_cgroup_t *cg = &cgroups.cgroups[i];
+    stress_cgroup_stats_t *stats = &cg->stats;
+    uint64_t *const cpu_values[] =
+    {
+      &stats->cpu_usage_usec, &stats->cpu_user_usec, &stats->cpu_system_usec,
+      &stats->cpu_nr_throttled, &stats->cpu_throttled_usec,
+    };
+    uint64_t *const memory_values[] =
+    {
+      &stats->memory_anon, &stats->memory_file,
+      &stats->memory_pgfault, &stats->memory_pgmajfault,
+    };
+    char buf[8192];
+    
+    (void)memset(stats, 0, sizeof(*stats));
+    
+    if (stress_cgroup_read(cg->path, "cpu.stat", buf, sizeof(buf)) > 0)
+    {
+      stress_cgroup_keyed(buf, cpu_keys, cpu_values, SIZEOF_ARRAY(cpu_keys));
+      cg->harvested = true;
+    }
+    
+    if (stress_cgroup_read(cg->path, "memory.stat", buf, sizeof(buf)) > 0)
+    {
+      stress_cgroup_keyed(buf, memory_keys, memory_values, SIZEOF_ARRAY(memory_keys));
+      stats->memory = true;
+    }
+    
+    if (stress_cgroup_read(cg->path, "memory.peak", buf, sizeof(buf)) > 0)
+    {
+      stats->memory_peak = (uint64_t)strtoull(buf, NULL, 10);
+      stats->memory_peak_ok = true;
+    }
+    
+    if (stress_cgroup_read(cg->path, "io.stat", buf, sizeof(buf)) >= 0)
+    {
+      stress_cgroup_io(buf, stats);
+      stats->io = true;
+    }
+  }
+}
+
+/*
+ *  stress_cgroup_stats()
+ *  get the harvested cgroup accounting of a stressor,
+ *  returns false if there is none
+ */
+bool stress_cgroup_stats(const stress_stressor_t *ss, stress_cgroup_stats_t *stats)
+{
+  const stress_cgroup_t *cg = stress_cgroup_find(ss);
+  
+  if (!cg || !cg->harvested)
+  {
+    return false;
+  }
+  
+  (void)memcpy(stats, &cg->stats, sizeof(*stats));
+  return true;
+}
+
+/*
+ *  stress_cgroup_cleanup()
+ *  kill anything left in the per stressor cgroups and remove
+ *  them, also called from the terminating signal handler so
+ *  only the process that created the cgroups removes them
+ */
+void stress_cgroup_cleanup(void)
+{
+  size_t i;
+  int ret;
+  
+  if (!cgroups.cgroups || (getpid() != cgroups.pid))
+  {
+    return;
+  }
+  
+  for (i = 0; i < cgroups.n_cgroups; i++)
+  {
+    stress_cgroup_t *cg = &cgroups.cgroups[i];
+    
+    if (cg->procs_fd >= 0)
+    {
+      (void)close(cg->procs_fd);
+      cg->procs_fd = -1;
+    }
+    
+    ret = stress_cgroup_remove(cg->path);
+    
+    if (ret < 0)
+    {
+      pr_dbg("cgroup: cannot remove %s, errno=%d (%s)\n",
+             cg->path, -ret, strerror(-ret));
+    }
+  }
+  
+  cgroups.n_cgroups = 0;
+  
+  if (rmdir(cgroups.path) < 0)
+  {
+    pr_dbg("cgroup: cannot remove %s, errno=%d (%s)\n",
+           cgroups.path, errno, strerror(errno));
+  }
+}
+
+/*
+ *  stress_cgroup_free()
+ *  remove the per stressor cgroups
+ */
+void stress_cgroup_free(void)
+{
+  stress_cgroup_cleanup();
+  free(cgroups.cgroups);
+  (void)memset(&cgroups, 0, sizeof(cgroups));
+}
+#else
+int stress_cgroup_init(stress_stressor_t *stressors_list)
+{
+  (void)stressors_list;
+  
+  if (g_opt_flags & OPT_FLAGS_CGROUP)
+  {
+    pr_inf("cgroup: cgroups are not available on this system\n");
+    g_opt_flags &= ~OPT_FLAGS_CGROUP;
+  }
+  
+  return 0;
+}
+
+void stress_cgroup_reset(const stress_stressor_t *stressors_list)
+{
+  (void)stressors_list;
+}
+
+void stress_cgroup_enter(const stress_stressor_t *ss)
+{
+  (void)ss;
+}
+
+void stress_cgroup_harvest(void)
+{
+}
+
+bool stress_cgroup_stats(const stress_stressor_t *ss, stress_cgroup_stats_t *stats)
+{
+  (void)ss;
+  (void)stats;
+  return false;
+}
+
+void stress_cgroup_cleanup(void)
+{
+}
+
+void stress_cgroup_free(void)
+{
+}
+#endif
@@ -0,0 +1,480 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define STRESS_COMPARE_THRESHOLD  (500)   /* default 5% in 0.01% units */
+#define STRESS_COMPARE_MAX    (100000)  /* 1000% in 0.01% units */
+
+/*
+ *  The YAML of the current run and of the baseline are both
+ *  read back in with the same simple parser; only the numeric
+ *  per stressor values of the metrics and perfstats sections
+ *  are kept. The bogo-op rate and latency percentiles are
+ *  checked for regressions, the perf counter rates are only
+ *  reported when they change by more than the threshold as
+ *  whether more is better depends on the counter.
+ */
+typedef struct
+{
+  char section[32];   /* top level YAML section */
+  char stressor[64];    /* stressor name */
+  char key[64];     /* metric name */
+  double value;     /* metric value */
+} stress_compare_value_t;
+
+typedef struct
+{
+  stress_compare_value_t *values; /* parsed values */
+  size_t n;     /* number of values */
+  size_t max;     /* allocated values */
+} stress_compare_yaml_t;
+
+typedef struct
+{
+  const char *key;    /* metric to compare */
+  const char *ci_key;   /* 95% CI half width of metric, may be NULL */
+  const char *label;    /* short name for the log */
+  bool higher_is_better;    /* direction of a regression */
+} stress_compare_metric_t;
+
+typedef struct
+{
+  char *filename;     /* baseline YAML file, NULL = off */
+  uint32_t threshold;   /* regression threshold, 0.01% units */
+} stress_compare_t;
+
+static stress_compare_t compare;
+
+static const stress_compare_metric_t compare_metrics[] =
+{
+  { "repeat-bogo-ops-per-second-mean", "repeat-bogo-ops-per-second-ci95", "bogo-ops/s", true },
+  { "rate-window-mean",   "rate-window-ci95", "bogo-ops/s", true },
+  { "bogo-ops-per-second-real-time", NULL,  "bogo-ops/s", true },
+  { "latency-p50-ns",   NULL,       "lat-p50 ns", false },
+  { "latency-p90-ns",   NULL,       "lat-p90 ns", false },
+  { "latency-p99-ns",   NULL,       "lat-p99 ns", false },
+  { "latency-p999-ns",    NULL,       "lat-p99.9 ns", false },
+};
+
+/*
+ *  stress_set_compare_threshold()
+ *  set the percentage change that is flagged as a
+ *  regression, 0.01 to 1000%
+ */
+int stress_set_compare_threshold(const char *const opt)
+{
+  char *end;
+  double pct;
+  uint32_t threshold;
+  
+  errno = 0;
+  pct = strtod(opt, &end);
+  
+  if ((errno != 0) || (end == opt) || ((*end != '\0') && strcmp(end, "%")))
+  {
+    (void)fprintf(stderr, "Invalid compare threshold percentage '%s'\n", opt);
+    _exit(EXIT_FAILURE);
+  }
+  
+  threshold = (uint32_t)((pct * 100.0) + 0.5);
+  
+  if ((pct <= 0.0) || (threshold < 1) || (threshold > STRESS_COMPARE_MAX))
+  {
+    (void)fprintf(stderr, "compare-threshold must be in the range 0.01%% to 1000%%\n");
+    _exit(EXIT_FAILURE);
+  }
+  
+  return stress_set_setting_global("compare-threshold", TYPE_ID_UINT32, &threshold);
+}
+
+/*
+ *  stress_compare_init()
+ *  fetch the baseline comparison settings
+ */
+void stress_compare_init(void)
+{
+  compare.filename = NULL;
+  compare.threshold = STRESS_COMPARE_THRESHOLD;
+  (void)stress_get_setting("compare", &compare.filename);
+  (void)stress_get_setting("compare-threshold", &compare.threshold);
+}
+
+/*
+ *  stress_compare_enabled()
+ *  true if a --compare baseline has been given
+ */
+bool stress_compare_enabled(void)
+{
+  return compare.filename != NULL;
+}
+
+/*
+ *  stress_compare_add()
+ *  add a parsed value, returns -1 if out of memory
+ */
+static int stress_compare_add(
+  stress_compare_yaml_t *yaml,
+  const char *section,
+  const char *stressor,
+  const char *key,
+  const double value)
+{
+  stress_compare_value_t *v;
+  
+  if (yaml->n >= yaml->max)
+  {
+    const size_t max = yaml->max ? yaml->max * 2 : 64;
+    stress_compare_value_t *values;
+    
+    values = realloc(yaml->values, max * sizeof(*values));
+    
+    if (!values)
+    {
+      return -1;
+    }
+    
+    yaml->values = values;
+    yaml->max = max;
+  }
+  
+  v = &yaml->values[yaml->n++];
+  (void)shim_strlcpy(v->section, section, sizeof(v->section));
+  (void)shim_strlcpy(v->stressor, stressor, sizeof(v->stressor));
+  (void)shim_strlcpy(v->key, key, sizeof(v->key));
+  v->value = value;
+  return 0;
+}
+
+/*
+ *  stress_compare_parse()
+ *  read the numeric per stressor values of a stress-ng
+ *  YAML file, lines of any length are read whole so long
+ *  lines are not split into bogus records, returns -1 if
+ *  out of memory
+ */
+static int stress_compare_parse(FILE *fp, stress_compare_yaml_t *yaml)
+{
+  char *buf = NULL;
+  size_t buf_len = 0;
+  char section[32] = "";
+  char stressor[64] = "";
+  int rc = 0;
+  
+  while (getline(&buf, &buf_len, fp) != -1)
+  {
+    char key[64];
+    double value;
+    
+    if (isalpha((int)buf[0]))
+    {
+      char *colon = strchr(buf, ':');
+      
+      if (colon)
+      {
+        *colon = '\0';
+        (void)shim_strlcpy(section, buf, sizeof(section));
+      }
+      
+      *stressor = '\0';
+      continue;
+    }
+    
+    if (sscanf(buf, "    - stressor: %63s", stressor) == 1)
+    {
+      continue;
+    }
+    
+    if (!*stressor || strncmp(buf, "      ", 6))
+    {
+      continue;
+    }
+    
+    if (sscanf(buf + 6, "%63[^:]: %lf", key, &value) != 2)
+    {
+      continue;
+    }
+    
+    if (stress_compare_add(yaml, section, stressor, key, value) < 0)
+    {
+      rc = -1;
+      break;
+    }
+  }
+  
+  free(buf);
+  return rc;
+}
+
+/*
+ *  stress_compare_find()
+ *  find a parsed value, returns false if not found
+ */
+static bool stress_compare_find(
+  const stress_compare_yaml_t *yaml,
+  const char *section,
+  const char *stressor,
+  const char *key,
+  double *value)
+{
+  size_t i;
+  
+  if (!key)
+  {
+    return false;
+  }
+  
+  for (i = 0; i < yaml->n; i++)
+  {
+    const stress_compare_value_t *v = &yaml->values[i];
+    
+    if (!strcmp(v->key, key) &&
+        !strcmp(v->stressor, stressor) &&
+        !strcmp(v->section, section))
+    {
+      *value = v->value;
+      return true;
+    }
+  }
+  
+  return false;
+}
+
+/*
+ *  stress_compare_delta()
+ *  percentage change of a value from its baseline
+ */
+static inline double stress_compare_delta(const double base, const double cur)
+{
+  return 100.0 * (cur - base) / base;
+}
+
+/*
+ *  stress_compare_stressor()
+ *  compare the metrics of a stressor against the baseline,
+ *  returns the number of regressions found
+ */
+static uint32_t stress_compare_stressor(
+  FILE *yaml,
+  const stress_compare_yaml_t *base,
+  const stress_compare_yaml_t *cur,
+  const char *stressor,
+  const double threshold)
+{
+  size_t i;
+  uint32_t regressions = 0;
+  bool rate_done = false;
+  
+  pr_yaml(yaml, "    - stressor: %s\n", stressor);
+  
+  for (i = 0; i < SIZEOF_ARRAY(compare_metrics); i++)
+  {
+    const stress_compare_metric_t *m = &compare_metrics[i];
+    double b, c, b_ci = 0.0, c_ci = 0.0, delta, band;
+    bool regressed, has_b, has_c;
+    
+    /* the repeat or window mean replaces the single run rate */
+    if (m->higher_is_better && rate_done)
+    {
+      continue;
+    }
+    
+    has_b = stress_compare_find(base, "metrics", stressor, m->key, &b);
+    has_c = stress_compare_find(cur, "metrics", stressor, m->key, &c);
+    
+    /*
+     *  A rate summary in just one of the runs cannot be compared,
+     *  say so rather than quietly falling back to the next rate
+     */
+    if (m->higher_is_better && (has_b != has_c))
+    {
+      pr_inf("compare: %-13s %s only in the %s, comparing single run rates instead\n",
+             stressor, m->key, has_b ? "baseline" : "current run");
+      continue;
+    }
+    
+    if (!has_b || !has_c || (b <= 0.0))
+    {
+      continue;
+    }
+    
+    if (m->higher_is_better)
+    {
+      rate_done = true;
+    }
+    
+    /*
+     *  Changes within the combined 95% confidence intervals
+     *  of both runs are noise, so widen the band to cover them
+     */
+    (void)stress_compare_find(base, "metrics", stressor, m->ci_key, &b_ci);
+    (void)stress_compare_find(cur, "metrics", stressor, m->ci_key, &c_ci);
+    band = STRESS_MAXIMUM(threshold, 100.0 * (b_ci + c_ci) / b);
+    delta = stress_compare_delta(b, c);
+    regressed = m->higher_is_better ? (delta < -band) : (delta > band);
+    
+    if (regressed)
+    {
+      regressions++;
+    }
+    
+    pr_inf("compare: %-13s %-14s %14.2f %14.2f %+8.2f%%%s\n",
+           stressor, m->label, b, c, delta,
+           regressed ? " REGRESSION" : "");
+    pr_yaml(yaml, "      %s-delta-percent: %f\n", m->key, delta);
+    pr_yaml(yaml, "      %s-noise-band-percent: %f\n", m->key, band);
+  }
+  
+  for (i = 0; i < cur->n; i++)
+  {
+    const stress_compare_value_t *v = &cur->values[i];
+    const size_t len = strlen(v->key);
+    double b, delta;
+    
+    if (strcmp(v->section, "perfstats") ||
+        strcmp(v->stressor, stressor) ||
+        (len < 11) ||
+        strcmp(v->key + len - 11, "_per_second"))
+    {
+      continue;
+    }
+    
+    if (!stress_compare_find(base, "perfstats", stressor, v->key, &b) ||
+        (b <= 0.0))
+    {
+      continue;
+    }
+    
+    delta = stress_compare_delta(b, v->value);
+    pr_yaml(yaml, "      %s-delta-percent: %f\n", v->key, delta);
+    
+    if (fabs(delta) > threshold)
+    {
+      pr_inf("compare: %-13s %-14.14s %14.2f %14.2f %+8.2f%% changed (%s)\n",
+             stressor, "perf", b, v->value, delta, v->key);
+    }
+  }
+  
+  pr_yaml(yaml, "      regressions: %" PRIu32 "\n", regressions);
+  return regressions;
+}
+
+/*
+ *  stress_compare()
+ *  compare the YAML results of this run against the --compare
+ *  baseline YAML file, yaml must be open for reading and writing.
+ *  The comparison is appended to the YAML. Returns true if
+ *  any regression was found.
+ */
+bool stress_compare(FILE *yaml)
+{
+  const char *filename = compare.filename;
+  const double threshold = (double)compare.threshold / 100.0;
+  uint32_t regressions = 0;
+  stress_compare_yaml_t base, cur;
+  FILE *fp;
+  size_t i;
+  
+  if (!filename)
+  {
+    return false;
+  }
+  
+  if (!yaml)
+  {
+    pr_err("compare: cannot read back the metrics of this run\n");
+    return false;
+  }
+  
+  fp = fopen(filename, "r");
+  
+  if (!fp)
+  {
+    pr_err("compare: cannot open baseline %s, errno=%d (%s)\n",
+           filename, errno, strerror(errno));
+    return false;
+  }
+  
+  (void)memset(&base, 0, sizeof(base));
+  (void)memset(&cur, 0, sizeof(cur));
+  (void)fflush(yaml);
+  rewind(yaml);
+  
+  if ((stress_compare_parse(fp, &base) < 0) ||
+      (stress_compare_parse(yaml, &cur) < 0))
+  {
+    pr_err("compare: out of memory parsing YAML\n");
+    goto tidy;
+  }
+  
+  (void)fseek(yaml, 0, SEEK_END);
+  pr_inf("compare: against baseline %s, threshold %.2f%%\n",
+         filename, threshold);
+  pr_inf("compare: %-13s %-14s %14s %14s %9s\n",
+         "stressor", "metric", "baseline", "current", "delta");
+  pr_yaml(yaml, "compare-info:\n");
+  pr_yaml(yaml, "      baseline: %s\n", filename);
+  pr_yaml(yaml, "      threshold-percent: %f\n", threshold);
+  pr_yaml(yaml, "\n");
+  pr_yaml(yaml, "compare:\n");
+  
+  for (i = 0; i < cur.n; i++)
+  {
+    const stress_compare_value_t *v = &cur.values[i];
+    double b;
+    
+    /* each stressor has one bogo-ops entry in the metrics */
+    if (strcmp(v->section, "metrics") || strcmp(v->key, "bogo-ops"))
+    {
+      continue;
+    }
+    
+    if (!stress_compare_find(&base, "metrics", v->stressor, "bogo-ops", &b))
+    {
+      pr_inf("compare: %-13s not in baseline\n", v->stressor);
+      continue;
+    }
+    
+    regressions += stress_compare_stressor(yaml, &base, &cur,
+                                           v->stressor, threshold);
+  }
+  
+  pr_yaml(yaml, "\n");
+  
+  if (regressions)
+  {
+    pr_inf("compare: %" PRIu32 " regression%s beyond the noise band\n",
+           regressions, regressions == 1 ? "" : "s");
+  }
+  else
+  {
+    pr_inf("compare: no regressions\n");
+  }
+  
+tidy:
+  free(base.values);
+  free(cur.values);
+  (void)fclose(fp);
+  return regressions > 0;
+}
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define STRESS_WINDOW_TIME  (0.5)   /* rate window length, secs */
+#define STRESS_CONVERGE_MAX (10000)   /* 100% in 0.01% units */
+
+/*
+ *  Warm-up and convergence are handled by the parent while it
+ *  waits for the stressors. At the end of the warm-up period the
+ *  bogo-op counters of all the instances are snapshotted so that
+ *  the metrics only cover the measured period. The aggregate rate
+ *  of each stressor is measured over STRESS_WINDOW_TIME windows;
+ *  these give a confidence interval of the rate and, with
+ *  --converge, the run is ended once the coefficient of variation
+ *  of the last STRESS_WINDOW_RECENT windows of every stressor
+ *  drops below the given percentage.
+ */
+typedef struct
+{
+  stress_stressor_t *stressors; /* stressors in the current run */
+  uint64_t warmup;    /* warm-up time, secs */
+  uint32_t converge;    /* CV threshold, 0.01% units, 0 = off */
+  double time_start;    /* time the current run started */
+  double time_next;   /* time next window ends */
+  double time_last;   /* time last window ended */
+  bool warm;      /* true once warm-up has ended */
+  bool stopped;     /* true once stressors were told to stop */
+} stress_converge_t;
+
+static stress_converge_t converge;
+
+/*
+ *  stress_set_warmup()
+ *  set warm-up time, in seconds or with a time suffix
+ */
+int stress_set_warmup(const char *const opt)
+{
+  const uint64_t warmup = stress_get_uint64_time(opt);
+  
+  stress_check_range("warmup", warmup, 1, 3600);
+  return stress_set_setting_global("warmup", TYPE_ID_UINT64, &warmup);
+}
+
+/*
+ *  stress_set_converge()
+ *  set the coefficient of variation percentage that
+ *  ends a run, 0.01 to 100%
+ */
+int stress_set_converge(const char *const opt)
+{
+  char *end;
+  double pct;
+  uint32_t cv;
+  
+  errno = 0;
+  pct = strtod(opt, &end);
+  
+  if ((errno != 0) || (end == opt) || ((*end != '\0') && strcmp(end, "%")))
+  {
+    (void)fprintf(stderr, "Invalid converge percentage '%s'\n", opt);
+    _exit(EXIT_FAILURE);
+  }
+  
+  cv = (uint32_t)((pct * 100.0) + 0.5);
+  
+  if ((pct <= 0.0) || (cv < 1) || (cv > STRESS_CONVERGE_MAX))
+  {
+    (void)fprintf(stderr, "converge must be in the range 0.01%% to 100%%\n");
+    _exit(EXIT_FAILURE);
+  }
+  
+  return stress_set_setting_global("converge", TYPE_ID_UINT32, &cv);
+}
+
+/*
+ *  stress_converge_init()
+ *  fetch the warm-up and convergence settings, a warm-up
+ *  that lasts the whole run would exclude every instance
+ *  from the metrics so it is rejected
+ */
+int stress_converge_init(void)
+{
+  (void)memset(&converge, 0, sizeof(converge));
+  (void)stress_get_setting("warmup", &converge.warmup);
+  (void)stress_get_setting("converge", &converge.converge);
+  
+  if (converge.warmup && g_opt_timeout && (converge.warmup >= g_opt_timeout))
+  {
+    pr_err("warmup: %" PRIu64 " second warm-up is not shorter than the "
+           "%" PRIu64 " second timeout, no metrics would be measured\n",
+           converge.warmup, g_opt_timeout);
+    return -1;
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_converge_enabled()
+ *  true if warm-up or convergence is being used
+ */
+bool stress_converge_enabled(void)
+{
+  return converge.warmup || converge.converge;
+}
+
+/*
+ *  stress_converge_in_warmup()
+ *  true if a --warmup is being used and the instance
+ *  finished before the end of warm-up, so it has no
+ *  steady state run to measure
+ */
+bool stress_converge_in_warmup(const stress_stats_t *stats)
+{
+  if (!converge.warmup)
+  {
+    return false;
+  }
+  
+  return (stats->warmup_time <= 0.0) || (stats->finish <= stats->warmup_time);
+}
+
+/*
+ *  stress_converge_begin()
+ *  start measuring the stressors of a new run
+ */
+void stress_converge_begin(stress_stressor_t *stressors_list)
+{
+  stress_stressor_t *ss;
+  
+  if (!stress_converge_enabled())
+  {
+    return;
+  }
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    (void)memset(&ss->window, 0, sizeof(ss->window));
+  }
+  
+  converge.stressors = stressors_list;
+  converge.time_start = stress_time_now();
+  converge.time_last = converge.time_start;
+  converge.time_next = converge.time_start + STRESS_WINDOW_TIME;
+  converge.warm = (converge.warmup == 0);
+  converge.stopped = false;
+}
+
+/*
+ *  stress_converge_counter()
+ *  sum of the bogo-op counters of all the instances of a stressor
+ */
+static uint64_t stress_converge_counter(const stress_stressor_t *ss)
+{
+  int32_t j;
+  uint64_t counter = 0;
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    counter += ss->stats[j]->ci.counter;
+  }
+  
+  return counter;
+}
+
+/*
+ *  stress_converge_warmup()
+ *  snapshot the instance counters at the end of warm-up
+ */
+static void stress_converge_warmup(const double now)
+{
+  stress_stressor_t *ss;
+  
+  for (ss = converge.stressors; ss; ss = ss->next)
+  {
+    int32_t j;
+    
+    for (j = 0; j < ss->started_instances; j++)
+    {
+      stress_stats_t *stats = ss->stats[j];
+      
+      stats->warmup_counter = stats->ci.counter;
+      stats->warmup_time = now;
+    }
+    
+    ss->window.counter = stress_converge_counter(ss);
+  }
+  
+  pr_dbg("warm-up of %" PRIu64 " second%s completed\n",
+         converge.warmup, converge.warmup == 1 ? "" : "s");
+}
+
+/*
+ *  stress_converge_cv()
+ *  coefficient of variation of the recent window rates
+ *  as a percentage, returns -1.0 if not enough windows
+ */
+static double stress_converge_cv(const stress_window_t *window)
+{
+  uint32_t i;
+  double mean = 0.0, var = 0.0;
+  
+  if (window->recent_n < STRESS_WINDOW_RECENT)
+  {
+    return -1.0;
+  }
+  
+  for (i = 0; i < STRESS_WINDOW_RECENT; i++)
+  {
+    mean += window->recent[i];
+  }
+  
+  mean /= (double)STRESS_WINDOW_RECENT;
+  
+  if (mean <= 0.0)
+  {
+    return -1.0;
+  }
+  
+  for (i = 0; i < STRESS_WINDOW_RECENT; i++)
+  {
+    const double d = window->recent[i] - mean;
+    
+    var += d * d;
+  }
+  
+  var /= (double)(STRESS_WINDOW_RECENT - 1);
+  return 100.0 * sqrt(var) / mean;
+}
+
+/*
+ *  stress_converge_stop()
+ *  tell all the stressors to stop, as if they had timed out
+ */
+static void stress_converge_stop(void)
+{
+  stress_stressor_t *ss;
+  
+  for (ss = converge.stressors; ss; ss = ss->next)
+  {
+    int32_t j;
+    
+    for (j = 0; j < ss->started_instances; j++)
+    {
+      if (ss->pids[j])
+      {
+        (void)kill(ss->pids[j], SIGALRM);
+      }
+    }
+  }
+  
+  converge.stopped = true;
+}
+
+/*
+ *  stress_converge_poll()
+ *  handle end of warm-up and measure a rate window
+ *  if one is due
+ */
+void stress_converge_poll(void)
+{
+  stress_stressor_t *ss;
+  double now, dt;
+  bool all_converged = true;
+  
+  if (!converge.stressors || converge.stopped)
+  {
+    return;
+  }
+  
+  now = stress_time_now();
+  
+  if (!converge.warm)
+  {
+    if (now < converge.time_start + (double)converge.warmup)
+    {
+      return;
+    }
+    
+    stress_converge_warmup(now);
+    converge.warm = true;
+    converge.time_last = now;
+    converge.time_next = now + STRESS_WINDOW_TIME;
+    return;
+  }
+  
+  if (now < converge.time_next)
+  {
+    return;
+  }
+  
+  dt = now - converge.time_last;
+  
+  for (ss = converge.stressors; ss; ss = ss->next)
+  {
+    stress_window_t *window = &ss->window;
+    const uint64_t counter = stress_converge_counter(ss);
+    const double rate = (counter > window->counter) ?
+                        (double)(counter - window->counter) / dt : 0.0;
+    double delta, cv;
+    
+    window->counter = counter;
+    
+    /* Welford's running mean and variance */
+    window->n++;
+    delta = rate - window->mean;
+    window->mean += delta / (double)window->n;
+    window->m2 += delta * (rate - window->mean);
+    
+    (void)memmove(&window->recent[1], &window->recent[0],
+                  sizeof(window->recent) - sizeof(window->recent[0]));
+    window->recent[0] = rate;
+    
+    if (window->recent_n < STRESS_WINDOW_RECENT)
+    {
+      window->recent_n++;
+    }
+    
+    cv = stress_converge_cv(window);
+    
+    if ((cv >= 0.0) && (cv * 100.0 < (double)converge.converge))
+    {
+      if (window->converged == 0.0)
+      {
+        window->converged = now - converge.time_start;
+      }
+    }
+    else
+    {
+      window->converged = 0.0;
+      all_converged = false;
+    }
+  }
+  
+  converge.time_last = now;
+  
+  do
+  {
+    converge.time_next += STRESS_WINDOW_TIME;
+  }
+  while (converge.time_next <= now);
+  
+  if (converge.converge && all_converged)
+  {
+    pr_inf("bogo-op rates converged after %.2f secs, stopping\n",
+           now - converge.time_start);
+    stress_converge_stop();
+  }
+}
+
+/*
+ *  stress_converge_ci()
+ *  mean window rate of a stressor and the half width of
+ *  its 95% confidence interval, returns false if there
+ *  are not enough windows
+ */
+bool stress_converge_ci(const stress_stressor_t *ss, double *mean, double *ci)
+{
+  const stress_window_t *window = &ss->window;
+  
+  if (!stress_converge_enabled() || (window->n < 2))
+  {
+    return false;
+  }
+  
+  *mean = window->mean;
+  *ci = stress_student_t95(window->n - 1) * sqrt(window->m2 / (double)(window->n - 1)) / sqrt((double)window->n);
+  return true;
+}
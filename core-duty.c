@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define STRESS_DUTY_PERIOD  (0.05)  /* stressor run + pause period, secs */
+#define STRESS_DUTY_TICK  (0.25)  /* controller update interval, secs */
+#define STRESS_DUTY_MIN   (0.01)  /* smallest duty cycle */
+#define STRESS_DUTY_GAIN  (0.5)   /* fraction of correction applied per tick */
+#define STRESS_DUTY_IDLE_TICKS  (4)   /* ticks with no progress before opening up */
+#define STRESS_DUTY_WINDOW  (4)   /* ticks the throughput is measured over */
+
+/*
+ *  The --target-load and --target-throughput controller runs in
+ *  the parent while it waits for the stressors. Every tick it
+ *  measures the system CPU utilisation (from /proc/stat) or the
+ *  aggregate bogo-op rate and scales the shared duty cycle towards
+ *  the target. Stressors honour the duty cycle in keep_stressing()
+ *  by pausing once they have run for their fraction of a
+ *  STRESS_DUTY_PERIOD. Bogo ops are bursty, so the throughput is
+ *  measured over the last STRESS_DUTY_WINDOW ticks.
+ */
+typedef struct
+{
+  stress_stressor_t *stressors; /* stressors being controlled */
+  uint32_t target_load;   /* target CPU load, % */
+  uint64_t target_throughput; /* target bogo ops per second */
+  double time_next;   /* time next control tick is due */
+  double time_last;   /* time of last control tick */
+  uint64_t busy_ticks;    /* CPU busy ticks at last tick */
+  uint64_t total_ticks;   /* CPU total ticks at last tick */
+  uint64_t counter;   /* bogo ops total at last tick */
+  uint64_t window_counter[STRESS_DUTY_WINDOW]; /* bogo ops totals of recent ticks */
+  double window_time[STRESS_DUTY_WINDOW]; /* times of recent ticks */
+  uint32_t window_index;    /* oldest tick in the window */
+  double measured_sum;    /* sum of measurements */
+  double duty_sum;    /* sum of duty cycles */
+  uint64_t ticks;     /* number of control ticks */
+  uint32_t idle_ticks;    /* consecutive ticks measuring nothing */
+} stress_duty_t;
+
+static stress_duty_t duty;
+
+/*
+ *  stress_set_target_load()
+ *  set target CPU load, 1..100%
+ */
+int stress_set_target_load(const char *const opt)
+{
+  uint32_t target_load;
+  
+  target_load = stress_get_uint32(opt);
+  stress_check_range("target-load", (uint64_t)target_load, 1, 100);
+  return stress_set_setting_global("target-load", TYPE_ID_UINT32, &target_load);
+}
+
+/*
+ *  stress_set_target_throughput()
+ *  set target aggregate bogo ops per second
+ */
+int stress_set_target_throughput(const char *const opt)
+{
+  uint64_t target_throughput;
+  
+  target_throughput = stress_get_uint64(opt);
+  stress_check_range("target-throughput", target_throughput, 1, UINT64_MAX);
+  return stress_set_setting_global("target-throughput", TYPE_ID_UINT64, &target_throughput);
+}
+
+/*
+ *  stress_duty_counter()
+ *  sum of the bogo-op counters of all the stressor instances
+ */
+static uint64_t stress_duty_counter(void)
+{
+  stress_stressor_t *ss;
+  uint64_t counter = 0;
+  
+  for (ss = duty.stressors; ss; ss = ss->next)
+  {
+    int32_t j;
+    
+    for (j = 0; j < ss->num_instances; j++)
+    {
+      counter += ss->stats[j]->ci.counter;
+    }
+  }
+  
+  return counter;
+}
+
+/*
+ *  stress_duty_window_reset()
+ *  restart the throughput window from zero bogo ops at time now
+ */
+static void stress_duty_window_reset(const double now)
+{
+  uint32_t i;
+  
+  for (i = 0; i < STRESS_DUTY_WINDOW; i++)
+  {
+    duty.window_counter[i] = 0;
+    duty.window_time[i] = now;
+  }
+  
+  duty.window_index = 0;
+}
+
+/*
+ *  stress_duty_init()
+ *  set up the duty cycle controller, returns -1 if
+ *  the target options are not usable
+ */
+int stress_duty_init(stress_stressor_t *stressors_list)
+{
+  (void)memset(&duty, 0, sizeof(duty));
+  g_shared->duty.cycle = 1.0;
+  (void)stress_get_setting("target-load", &duty.target_load);
+  (void)stress_get_setting("target-throughput", &duty.target_throughput);
+  
+  if (!duty.target_load && !duty.target_throughput)
+  {
+    return 0;
+  }
+  
+  if (duty.target_load && duty.target_throughput)
+  {
+    pr_err("cannot use --target-load and --target-throughput together\n");
+    return -1;
+  }
+  
+  if (duty.target_load)
+  {
+    stress_vmstat_cpu_ticks(&duty.busy_ticks, &duty.total_ticks);
+    
+    if (!duty.total_ticks)
+    {
+      pr_err("--target-load cannot determine CPU utilisation on this system\n");
+      return -1;
+    }
+  }
+  
+  duty.stressors = stressors_list;
+  duty.time_last = stress_time_now();
+  duty.time_next = duty.time_last + STRESS_DUTY_TICK;
+  stress_duty_window_reset(duty.time_last);
+  g_opt_flags |= OPT_FLAGS_DUTY;
+  
+  return 0;
+}
+
+/*
+ *  stress_duty_enabled()
+ *  true if the duty cycle controller is active
+ */
+bool stress_duty_enabled(void)
+{
+  return !!(g_opt_flags & OPT_FLAGS_DUTY);
+}
+
+/*
+ *  stress_duty_poll()
+ *  update the shared duty cycle if a control tick is due
+ */
+void stress_duty_poll(void)
+{
+  double now, measured, target, cycle;
+  
+  if (!(g_opt_flags & OPT_FLAGS_DUTY))
+  {
+    return;
+  }
+  
+  now = stress_time_now();
+  
+  if (now < duty.time_next)
+  {
+    return;
+  }
+  
+  if (duty.target_load)
+  {
+    uint64_t busy, total;
+    
+    stress_vmstat_cpu_ticks(&busy, &total);
+    
+    if (total <= duty.total_ticks)
+    {
+      /* no ticks elapsed yet, try again next time */
+      return;
+    }
+    
+    measured = 100.0 * (double)(busy - duty.busy_ticks) /
+               (double)(total - duty.total_ticks);
+    target = (double)duty.target_load;
+    duty.busy_ticks = busy;
+    duty.total_ticks = total;
+  }
+  else
+  {
+    const uint64_t counter = stress_duty_counter();
+    const uint32_t oldest = duty.window_index;
+    
+    /* counters are zero'd at the start of each stressor run */
+    if (counter < duty.counter)
+    {
+      stress_duty_window_reset(duty.time_last);
+    }
+    
+    measured = (double)(counter - duty.window_counter[oldest]) /
+               (now - duty.window_time[oldest]);
+    target = (double)duty.target_throughput;
+    duty.counter = counter;
+    duty.window_counter[oldest] = counter;
+    duty.window_time[oldest] = now;
+    duty.window_index = (oldest + 1) % STRESS_DUTY_WINDOW;
+  }
+  
+  /*
+   *  Load and throughput scale roughly linearly with the
+   *  duty cycle, so move a fraction of the way towards the
+   *  duty cycle that would have given the target
+   */
+  cycle = g_shared->duty.cycle;
+  
+  if (measured > 0.0)
+  {
+    cycle += STRESS_DUTY_GAIN * ((cycle * target / measured) - cycle);
+    duty.idle_ticks = 0;
+  }
+  else if (++duty.idle_ticks >= STRESS_DUTY_IDLE_TICKS)
+  {
+    /*
+     *  A single empty tick can just be slow bogo ops, only
+     *  open up the duty cycle if nothing is measured for a while
+     */
+    cycle *= 2.0;
+    duty.idle_ticks = 0;
+  }
+  
+  if (cycle > 1.0)
+  {
+    cycle = 1.0;
+  }
+  else if (cycle < STRESS_DUTY_MIN)
+  {
+    cycle = STRESS_DUTY_MIN;
+  }
+  
+  g_shared->duty.cycle = cycle;
+  duty.measured_sum += measured;
+  duty.duty_sum += cycle;
+  duty.ticks++;
+  duty.time_last = now;
+  
+  do
+  {
+    duty.time_next += STRESS_DUTY_TICK;
+  }
+  while (duty.time_next <= now);
+  
+  pr_dbg("duty: measured %.2f, target %.2f, duty cycle %.3f\n",
+         measured, target, cycle);
+}
+
+/*
+ *  stress_duty_cycle()
+ *  the run fraction of an instance, the controller duty cycle
+ *  scaled by the instance's load profile duty cycle
+ */
+static inline double stress_duty_cycle(const stress_args_t *args)
+{
+  return args->duty ? g_shared->duty.cycle * *args->duty : g_shared->duty.cycle;
+}
+
+/*
+ *  stress_duty_pause()
+ *  called by keep_stressing() when the duty cycle controller or
+ *  a load profile is active, once the stressor has run for its
+ *  share of the current period it sleeps in proportion to the
+ *  time it has been running, so stressors with long bogo ops are
+ *  throttled correctly too. Instances with a duty cycle below
+ *  STRESS_DUTY_MIN are parked until it rises again
+ */
+void stress_duty_pause(const stress_args_t *args)
+{
+  static THREAD_LOCAL double run_start;
+  const double cycle = stress_duty_cycle(args);
+  double now, run;
+  
+  if (cycle >= 1.0)
+  {
+    /* start a new period when next throttled */
+    run_start = 0.0;
+    return;
+  }
+  
+  if (cycle < STRESS_DUTY_MIN)
+  {
+    while (keep_stressing_flag() && (stress_duty_cycle(args) < STRESS_DUTY_MIN))
+    {
+      (void)shim_nanosleep_uint64(10000000ULL);
+    }
+    
+    run_start = stress_time_now();
+    return;
+  }
+  
+  now = stress_time_now();
+  
+  if (run_start <= 0.0)
+  {
+    run_start = now;
+    return;
+  }
+  
+  run = now - run_start;
+  
+  if (run < (cycle * STRESS_DUTY_PERIOD))
+  {
+    return;
+  }
+  
+  if (keep_stressing_flag())
+  {
+    const double pause = run * (1.0 - cycle) / cycle;
+    
+    (void)shim_nanosleep_uint64((uint64_t)(pause * STRESS_NANOSECOND));
+  }
+  
+  run_start = stress_time_now();
+}
+
+/*
+ *  stress_duty_report()
+ *  report the average measured load or throughput
+ */
+void stress_duty_report(FILE *yaml)
+{
+  double measured, cycle;
+  
+  if (!(g_opt_flags & OPT_FLAGS_DUTY) || !duty.ticks)
+  {
+    return;
+  }
+  
+  measured = duty.measured_sum / (double)duty.ticks;
+  cycle = duty.duty_sum / (double)duty.ticks;
+  
+  if (duty.target_load)
+  {
+    pr_inf("target load %" PRIu32 "%%, average measured load %.2f%%, "
+           "average duty cycle %.3f\n",
+           duty.target_load, measured, cycle);
+  }
+  else
+  {
+    pr_inf("target throughput %" PRIu64 " bogo ops/s, average measured "
+           "throughput %.2f bogo ops/s, average duty cycle %.3f\n",
+           duty.target_throughput, measured, cycle);
+  }
+  
+  pr_yaml(yaml, "target:\n");
+  
+  if (duty.target_load)
+  {
+    pr_yaml(yaml, "      target-load: %" PRIu32 "\n", duty.target_load);
+  }
+  else
+  {
+    pr_yaml(yaml, "      target-throughput: %" PRIu64 "\n", duty.target_throughput);
+  }
+  
+  pr_yaml(yaml, "      measured: %f\n", measured);
+  pr_yaml(yaml, "      duty-cycle: %f\n", cycle);
+  pr_yaml(yaml, "\n");
+}
@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define STRESS_FAIRNESS_INTERVAL  (0.1) /* CPU sample interval, secs */
+
+/*
+ *  With --metrics-instances the parent samples the CPU each
+ *  running instance is on from /proc/<tid>/stat while it waits
+ *  for the stressors, so the CPU history is only as fine as the
+ *  sample interval and moves between samples are not seen. The
+ *  instances record the CPUs they start and finish on themselves.
+ */
+typedef struct
+{
+  stress_stressor_t *stressors; /* stressors being sampled */
+  double time_next;   /* time next sample is due */
+} stress_fairness_sampler_t;
+
+static stress_fairness_sampler_t fairness_sampler;
+
+/*
+ *  stress_fairness_init()
+ *  start sampling the CPUs of the instances if
+ *  --metrics-instances is enabled
+ */
+void stress_fairness_init(stress_stressor_t *stressors_list)
+{
+  (void)memset(&fairness_sampler, 0, sizeof(fairness_sampler));
+  
+  if (!(g_opt_flags & OPT_FLAGS_METRICS_INSTANCES))
+  {
+    return;
+  }
+  
+#if defined(__linux__)
+  fairness_sampler.stressors = stressors_list;
+  fairness_sampler.time_next = stress_time_now();
+#else
+  (void)stressors_list;
+  pr_inf("metrics-instances: CPU placement history is not available on this system\n");
+#endif
+}
+
+/*
+ *  stress_fairness_enabled()
+ *  true if the CPUs of the instances are being sampled
+ */
+bool stress_fairness_enabled(void)
+{
+  return fairness_sampler.stressors != NULL;
+}
+
+/*
+ *  stress_fairness_start()
+ *  note the thread and CPU of the calling instance as it starts
+ */
+void stress_fairness_start(stress_stats_t *stats)
+{
+  stats->cpus.cpu_start = (int32_t)stress_get_cpu();
+  stats->cpus.cpu_finish = stats->cpus.cpu_start;
+  stats->cpus.tid = (pid_t)shim_gettid();
+}
+
+/*
+ *  stress_fairness_finish()
+ *  note the CPU of the calling instance as it finishes
+ */
+void stress_fairness_finish(stress_stats_t *stats)
+{
+  stats->cpus.cpu_finish = (int32_t)stress_get_cpu();
+}
+
+/*
+ *  stress_fairness_cpu()
+ *  get the CPU a thread last ran on, field 39 of its
+ *  /proc stat, returns -1 if it is not known
+ */
+static int32_t stress_fairness_cpu(const pid_t tid)
+{
+#if defined(__linux__)
+  char path[64], buf[1024];
+  const char *ptr;
+  int field;
+  
+  (void)snprintf(path, sizeof(path), "/proc/%d/stat", (int)tid);
+  
+  if (system_read(path, buf, sizeof(buf) - 1) <= 0)
+  {
+    return -1;
+  }
+  
+  /* the command name may contain spaces, fields restart after it */
+  ptr = strrchr(buf, ')');
+  
+  if (!ptr)
+  {
+    return -1;
+  }
+  
+  for (field = 2; field < 39; field++)
+  {
+    ptr = strchr(ptr + 1, ' ');
+    
+    if (!ptr)
+    {
+      return -1;
+    }
+  }
+  
+  return (int32_t)atoi(ptr + 1);
+#else
+  (void)tid;
+  
+  return -1;
+#endif
+}
+
+/*
+ *  stress_fairness_record()
+ *  add a CPU sample to the CPU history of an instance, the
+ *  history keeps the first STRESS_CPU_HISTORY_MAX CPU changes
+ */
+static void stress_fairness_record(stress_cpu_history_t *cpus, const int32_t cpu)
+{
+  cpus->samples++;
+  
+  if (cpus->n_history && (cpus->history[cpus->n_history - 1].cpu == cpu))
+  {
+    cpus->history[cpus->n_history - 1].samples++;
+    return;
+  }
+  
+  if (cpus->n_history)
+  {
+    cpus->changes++;
+  }
+  
+  if (cpus->n_history < STRESS_CPU_HISTORY_MAX)
+  {
+    cpus->history[cpus->n_history].cpu = cpu;
+    cpus->history[cpus->n_history].samples = 1;
+    cpus->n_history++;
+  }
+}
+
+/*
+ *  stress_fairness_poll()
+ *  sample the CPUs the running instances are on
+ */
+void stress_fairness_poll(void)
+{
+  stress_stressor_t *ss;
+  double now;
+  
+  if (!fairness_sampler.stressors)
+  {
+    return;
+  }
+  
+  now = stress_time_now();
+  
+  if (now < fairness_sampler.time_next)
+  {
+    return;
+  }
+  
+  fairness_sampler.time_next = now + STRESS_FAIRNESS_INTERVAL;
+  
+  for (ss = fairness_sampler.stressors; ss; ss = ss->next)
+  {
+    int32_t j;
+    
+    for (j = 0; j < ss->started_instances; j++)
+    {
+      stress_stats_t *const stats = ss->stats[j];
+      int32_t cpu;
+      
+      /* finish is only moved on from start once the instance is done */
+      if (!stats->cpus.tid || (stats->finish != stats->start) || (stats->exited > 0.0))
+      {
+        continue;
+      }
+      
+      cpu = stress_fairness_cpu(stats->cpus.tid);
+      
+      if (cpu >= 0)
+      {
+        stress_fairness_record(&stats->cpus, cpu);
+      }
+    }
+  }
+}
+
+/*
+ *  stress_fairness_rate()
+ *  the bogo-op rate of an instance, any --warmup period
+ *  is excluded
+ */
+static double stress_fairness_rate(const stress_stats_t *stats)
+{
+  double start = stats->start;
+  uint64_t counter = stats->ci.counter;
+  
+  if (stats->warmup_time > 0.0)
+  {
+    start = stats->warmup_time;
+    counter -= stats->warmup_counter;
+  }
+  
+  return (stats->finish > start) ? (double)counter / (stats->finish - start) : 0.0;
+}
+
+/*
+ *  stress_fairness_stats()
+ *  get the spread of the instance bogo-op rates of a stressor
+ *  and Jain's fairness index (sum x)^2 / (n * sum x^2), which is
+ *  1.0 when all the instances run at the same rate down to 1/n
+ *  when one instance does all the work. Returns false if there
+ *  are less than two instances or no bogo-ops
+ */
+bool stress_fairness_stats(const stress_stressor_t *ss, stress_fairness_t *fairness)
+{
+  double sum = 0.0, sum_sq = 0.0, var, n = 0.0;
+  int32_t j;
+  
+  (void)memset(fairness, 0, sizeof(*fairness));
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    double rate;
+    
+    /* instances that finished during warm-up have no rate */
+    if (stress_converge_in_warmup(ss->stats[j]))
+    {
+      continue;
+    }
+    
+    rate = stress_fairness_rate(ss->stats[j]);
+    fairness->min = (n == 0.0) ? rate : STRESS_MINIMUM(fairness->min, rate);
+    fairness->max = (n == 0.0) ? rate : STRESS_MAXIMUM(fairness->max, rate);
+    sum += rate;
+    sum_sq += rate * rate;
+    n += 1.0;
+  }
+  
+  if ((n < 2.0) || (sum_sq <= 0.0))
+  {
+    return false;
+  }
+  
+  fairness->mean = sum / n;
+  var = (sum_sq - (sum * sum) / n) / (n - 1.0);
+  fairness->stddev = (var > 0.0) ? sqrt(var) : 0.0;
+  fairness->jain = (sum * sum) / (n * sum_sq);
+  
+  return true;
+}
+
+/*
+ *  stress_fairness_history()
+ *  format the CPU history of an instance as CPU(samples)
+ *  in the order the CPUs were seen
+ */
+static void stress_fairness_history(
+  const stress_cpu_history_t *cpus,
+  char *buf,
+  const size_t buf_len)
+{
+  uint32_t i;
+  
+  *buf = '\0';
+  
+  for (i = 0; i < cpus->n_history; i++)
+  {
+    char str[32];
+    
+    (void)snprintf(str, sizeof(str), "%s%" PRId32 "(%" PRIu32 ")",
+                   i ? " " : "", cpus->history[i].cpu, cpus->history[i].samples);
+    (void)shim_strlcat(buf, str, buf_len);
+  }
+  
+  if (cpus->n_history < cpus->changes + 1)
+  {
+    (void)shim_strlcat(buf, " ...", buf_len);
+  }
+}
+
+/*
+ *  stress_fairness_report()
+ *  report the rate and CPU placement of each instance
+ *  of a stressor for --metrics-instances
+ */
+void stress_fairness_report(const stress_stressor_t *ss)
+{
+  const char *munged = stress_munge_underscore(ss->stressor->name);
+  int32_t j;
+  
+  if (!(g_opt_flags & OPT_FLAGS_METRICS_INSTANCES))
+  {
+    return;
+  }
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    const stress_stats_t *const stats = ss->stats[j];
+    char history[STRESS_CPU_HISTORY_MAX * 24];
+    
+    stress_fairness_history(&stats->cpus, history, sizeof(history));
+    pr_inf("%-13s instance %" PRId32 ": %.2f bogo ops/s%s, CPU %" PRId32
+           " to %" PRId32 ", %" PRIu32 " CPU changes in %" PRIu32 " samples%s%s\n",
+           munged, j, stress_fairness_rate(stats),
+           stress_converge_in_warmup(stats) ? " (finished during warm-up)" : "",
+           stats->cpus.cpu_start, stats->cpus.cpu_finish,
+           stats->cpus.changes, stats->cpus.samples,
+           *history ? ": " : "", history);
+  }
+}
+
+/*
+ *  stress_fairness_dump()
+ *  dump the per instance table of a stressor to the YAML
+ *  metrics for --metrics-instances
+ */
+void stress_fairness_dump(FILE *yaml, const stress_stressor_t *ss)
+{
+  int32_t j;
+  
+  if (!(g_opt_flags & OPT_FLAGS_METRICS_INSTANCES))
+  {
+    return;
+  }
+  
+  pr_yaml(yaml, "      instances:\n");
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    const stress_stats_t *const stats = ss->stats[j];
+    uint32_t i;
+    
+    pr_yaml(yaml, "        - instance: %" PRId32 "\n", j);
+    pr_yaml(yaml, "          tid: %d\n", (int)stats->cpus.tid);
+    pr_yaml(yaml, "          bogo-ops: %" PRIu64 "\n", stats->ci.counter);
+    pr_yaml(yaml, "          bogo-ops-per-second: %f\n", stress_fairness_rate(stats));
+    pr_yaml(yaml, "          warmup-excluded: %s\n",
+            stress_converge_in_warmup(stats) ? "true" : "false");
+    pr_yaml(yaml, "          cpu-start: %" PRId32 "\n", stats->cpus.cpu_start);
+    pr_yaml(yaml, "          cpu-finish: %" PRId32 "\n", stats->cpus.cpu_finish);
+    pr_yaml(yaml, "          cpu-samples: %" PRIu32 "\n", stats->cpus.samples);
+    pr_yaml(yaml, "          cpu-changes: %" PRIu32 "\n", stats->cpus.changes);
+    
+    if (!stats->cpus.n_history)
+    {
+      continue;
+    }
+    
+    pr_yaml(yaml, "          cpu-history:\n");
+    
+    for (i = 0; i < stats->cpus.n_history; i++)
+    {
+      pr_yaml(yaml, "            - cpu: %" PRId32 "\n", stats->cpus.history[i].cpu);
+      pr_yaml(yaml, "              samples: %" PRIu32 "\n", stats->cpus.history[i].samples);
+    }
+  }
+}
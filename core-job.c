@@ -246,6 +246,20 @@ int stress_parse_jobfile(
         continue;
       }
       
+      /* Check for job load profile */
+      rc = stress_profile_parse(new_argc, new_argv);
+      
+      if (rc < 0)
+      {
+        ret = -1;
+        stress_parse_error(lineno, txt);
+        goto err;
+      }
+      else if (rc == 1)
+      {
+        continue;
+      }
+      
       /* prepend -- to command to make them into stress-ng options */
       (void)snprintf(tmp, len, "--%s", new_argv[1]);
       new_argv[1] = tmp;
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+/*
+ *  stress_latency_msb()
+ *  index of most significant set bit of a non-zero value
+ */
+static inline uint32_t stress_latency_msb(uint64_t val)
+{
+  uint32_t msb = 0;
+  
+  if (val >> 32)
+  {
+    val >>= 32;
+    msb += 32;
+  }
+  
+  if (val >> 16)
+  {
+    val >>= 16;
+    msb += 16;
+  }
+  
+  if (val >> 8)
+  {
+    val >>= 8;
+    msb += 8;
+  }
+  
+  if (val >> 4)
+  {
+    val >>= 4;
+    msb += 4;
+  }
+  
+  if (val >> 2)
+  {
+    val >>= 2;
+    msb += 2;
+  }
+  
+  if (val >> 1)
+  {
+    msb += 1;
+  }
+  
+  return msb;
+}
+
+/*
+ *  stress_latency_index()
+ *  map a latency in ns to a histogram bucket index
+ */
+static inline size_t stress_latency_index(const uint64_t ns)
+{
+  uint32_t shift;
+  size_t idx;
+  
+  if (ns < STRESS_LATENCY_SUB_BUCKETS)
+  {
+    return (size_t)ns;
+  }
+  
+  shift = stress_latency_msb(ns) - STRESS_LATENCY_SUB_BITS;
+  idx = ((size_t)shift * STRESS_LATENCY_SUB_BUCKETS) + (size_t)(ns >> shift);
+  
+  return (idx < STRESS_LATENCY_BUCKETS) ? idx : STRESS_LATENCY_BUCKETS - 1;
+}
+
+/*
+ *  stress_latency_bucket_max()
+ *  largest latency in ns that maps to a histogram bucket
+ */
+static inline uint64_t stress_latency_bucket_max(const size_t idx)
+{
+  uint32_t shift;
+  
+  if (idx < STRESS_LATENCY_SUB_BUCKETS)
+  {
+    return (uint64_t)idx;
+  }
+  
+  shift = (uint32_t)(idx / STRESS_LATENCY_SUB_BUCKETS) - 1;
+  
+  return (((uint64_t)(idx - (shift * STRESS_LATENCY_SUB_BUCKETS)) + 1) << shift) - 1;
+}
+
+/*
+ *  stress_latency_record()
+ *  add a latency in nanoseconds to a histogram
+ */
+void stress_latency_record(stress_latency_t *latency, const uint64_t ns)
+{
+  latency->buckets[stress_latency_index(ns)]++;
+  latency->count++;
+  
+  if (ns > latency->max)
+  {
+    latency->max = ns;
+  }
+}
+
+/*
+ *  stress_latency_merge()
+ *  accumulate histogram src into histogram dst
+ */
+void stress_latency_merge(stress_latency_t *dst, const stress_latency_t *src)
+{
+  size_t i;
+  
+  for (i = 0; i < STRESS_LATENCY_BUCKETS; i++)
+  {
+    dst->buckets[i] += src->buckets[i];
+  }
+  
+  dst->count += src->count;
+  
+  if (src->max > dst->max)
+  {
+    dst->max = src->max;
+  }
+}
+
+/*
+ *  stress_latency_percentile()
+ *  return the latency in ns at a given percentile (0..100),
+ *  this is the highest value equivalent to the bucket the
+ *  percentile falls into, clamped to the maximum seen
+ */
+uint64_t stress_latency_percentile(
+  const stress_latency_t *latency,
+  const double percentile)
+{
+  uint64_t threshold, total = 0;
+  size_t i;
+  
+  if (latency->count == 0)
+  {
+    return 0;
+  }
+  
+  /* nearest rank, the smallest sample at or above the percentile */
+  threshold = (uint64_t)ceil(((double)latency->count * percentile) / 100.0);
+  
+  if (threshold < 1)
+  {
+    threshold = 1;
+  }
+  
+  if (threshold > latency->count)
+  {
+    threshold = latency->count;
+  }
+  
+  for (i = 0; i < STRESS_LATENCY_BUCKETS; i++)
+  {
+    total += latency->buckets[i];
+    
+    if (total >= threshold)
+    {
+      const uint64_t ns = stress_latency_bucket_max(i);
+      
+      return (ns < latency->max) ? ns : latency->max;
+    }
+  }
+  
+  return latency->max;
+}
+
+/*
+ *  stress_set_ops_rate()
+ *  set --ops-rate, the number of bogo ops per second each
+ *  instance issues on a fixed schedule, an optional "/s"
+ *  suffix is allowed. This implies --latency
+ */
+int stress_set_ops_rate(const char *const opt)
+{
+  char buf[64];
+  char *ptr;
+  uint64_t ops_rate;
+  
+  (void)shim_strlcpy(buf, opt, sizeof(buf));
+  ptr = strstr(buf, "/s");
+  
+  if (ptr && (ptr[2] == '\0'))
+  {
+    *ptr = '\0';
+  }
+  
+  ops_rate = stress_get_uint64(buf);
+  stress_check_range("ops-rate", ops_rate, 1, STRESS_NANOSECOND);
+  g_opt_flags |= OPT_FLAGS_LATENCY;
+  return stress_set_setting_global("ops-rate", TYPE_ID_UINT64, &ops_rate);
+}
+
+/*
+ *  stress_pace_wait()
+ *  called by keep_stressing() with --ops-rate, wait until the
+ *  intended start time of the next bogo op. If the stressor is
+ *  running behind the schedule the op is started immediately and
+ *  its latency is still measured from its intended start time.
+ *  The schedule advances as ops are counted, so stressors that
+ *  call keep_stressing() more than once per op only wait once
+ */
+void stress_pace_wait(const stress_args_t *args)
+{
+  const uint64_t intended = args->pace->start_ns +
+                            (args->pace->ops * args->pace->interval_ns);
+  const uint64_t now = stress_time_now_ns();
+  
+  if ((intended > now) && keep_stressing_flag())
+  {
+    (void)shim_nanosleep_uint64(intended - now);
+  }
+}
@@ -24,9 +24,53 @@
  */
 #include "stress-ng.h"
 
+#define PR_RING_RECORDS   (64)    /* records per instance ring */
+#define PR_RING_TEXT_SIZE (496)   /* longest message text in a record */
+
+/*
+ *  Each stressor instance appends its messages to its own ring in
+ *  shared memory instead of taking a flock on stdout for every
+ *  message. An instance is the only writer of its ring and the
+ *  parent the only reader, so the head and tail indexes just need
+ *  memory barriers. The parent drains the rings as it waits for the
+ *  stressors and writes the records out in time order. Messages are
+ *  written directly with the lock when the ring is full, when they
+ *  are too long for a record or when they come from a process the
+ *  instance forked.
+ */
+typedef struct
+{
+  double time;      /* time message was logged */
+  uint32_t len;     /* length of text */
+  char text[PR_RING_TEXT_SIZE]; /* message, not nul terminated */
+} pr_ring_record_t;
+
+typedef struct
+{
+  volatile uint64_t head;   /* records written, by the instance */
+  volatile uint64_t overflow; /* messages written directly, ring full */
+  volatile pid_t pid;   /* instance writing to the ring */
+  uint8_t pad[64 - (2 * sizeof(uint64_t)) - sizeof(pid_t)];
+  volatile uint64_t tail;   /* records drained, by the parent */
+  uint64_t drain_head;    /* head read by the drain, by the parent */
+  uint8_t pad_tail[64 - (2 * sizeof(uint64_t))];
+  pr_ring_record_t records[PR_RING_RECORDS];
+} pr_ring_t;
+
+typedef struct
+{
+  double time;      /* time message was logged */
+  const pr_ring_record_t *record; /* record to write out */
+} pr_ring_entry_t;
+
 static uint16_t abort_fails;  /* count of failures */
 static bool abort_msg_emitted;
 static FILE *log_file = NULL;
+static pr_ring_t *pr_rings = MAP_FAILED;  /* per instance rings */
+static size_t pr_rings_n;     /* number of rings */
+static size_t pr_rings_len;     /* size of ring mapping */
+static pr_ring_entry_t *pr_ring_entries;  /* records being drained */
+static THREAD_LOCAL pr_ring_t *pr_ring_self;  /* ring of this instance */
 
 /*
  *  pr_lock()
@@ -97,6 +141,223 @@ void pr_unlock(bool *lock)
 #endif
 }
 
+/*
+ *  pr_ring_init()
+ *  map a log ring for each stressor instance, messages are
+ *  written directly if the rings cannot be mapped
+ */
+void pr_ring_init(const int32_t instances)
+{
+  if (instances <= 0)
+  {
+    return;
+  }
+  
+  pr_rings_n = (size_t)instances;
+  pr_rings_len = pr_rings_n * sizeof(*pr_rings);
+  pr_ring_entries = calloc(pr_rings_n * PR_RING_RECORDS, sizeof(*pr_ring_entries));
+  
+  if (!pr_ring_entries)
+  {
+    pr_dbg("log: cannot allocate log ring entries, logging directly\n");
+    return;
+  }
+  
+  /* untouched pages of idle rings are never allocated */
+  pr_rings = (pr_ring_t *)mmap(NULL, pr_rings_len, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_ANON, -1, 0);
+  
+  if (pr_rings == MAP_FAILED)
+  {
+    pr_dbg("log: cannot mmap log rings, errno=%d (%s), logging directly\n",
+           errno, strerror(errno));
+    free(pr_ring_entries);
+    pr_ring_entries = NULL;
+  }
+}
+
+/*
+ *  pr_ring_enabled()
+ *  true if the instances log to the rings
+ */
+bool pr_ring_enabled(void)
+{
+  return pr_rings != MAP_FAILED;
+}
+
+/*
+ *  pr_ring_attach()
+ *  make the calling stressor instance log to ring n
+ */
+void pr_ring_attach(const size_t n)
+{
+  if ((pr_rings == MAP_FAILED) || (n >= pr_rings_n))
+  {
+    return;
+  }
+  
+  pr_ring_self = &pr_rings[n];
+  pr_ring_self->pid = getpid();
+}
+
+/*
+ *  pr_ring_put()
+ *  append a message to the ring of this instance,
+ *  returns false if it has to be written directly
+ */
+static bool pr_ring_put(const char *text, const size_t len)
+{
+  pr_ring_t *ring = pr_ring_self;
+  pr_ring_record_t *record;
+  uint64_t head;
+  
+  /* processes forked by the instance inherit the pointer */
+  if (!ring || (ring->pid != getpid()) || (len > PR_RING_TEXT_SIZE))
+  {
+    return false;
+  }
+  
+  head = ring->head;
+  
+  if (head - ring->tail >= PR_RING_RECORDS)
+  {
+    ring->overflow++;
+    return false;
+  }
+  
+  record = &ring->records[head % PR_RING_RECORDS];
+  record->time = stress_time_now();
+  record->len = (uint32_t)len;
+  (void)memcpy(record->text, text, len);
+  /* record must be complete before the parent can see it */
+  shim_mb();
+  ring->head = head + 1;
+  return true;
+}
+
+/*
+ *  pr_ring_cmp()
+ *  order ring records by time
+ */
+static int pr_ring_cmp(const void *p1, const void *p2)
+{
+  const pr_ring_entry_t *e1 = (const pr_ring_entry_t *)p1;
+  const pr_ring_entry_t *e2 = (const pr_ring_entry_t *)p2;
+  
+  if (e1->time < e2->time)
+  {
+    return -1;
+  }
+  
+  return e1->time > e2->time;
+}
+
+/*
+ *  pr_ring_drain()
+ *  write out the messages in all the rings in time order,
+ *  called by the parent
+ */
+void pr_ring_drain(void)
+{
+  size_t i, n = 0;
+  
+  if (pr_rings == MAP_FAILED)
+  {
+    return;
+  }
+  
+  for (i = 0; i < pr_rings_n; i++)
+  {
+    pr_ring_t *ring = &pr_rings[i];
+    const uint64_t head = ring->head;
+    uint64_t tail;
+    
+    /* only the records up to this head are drained */
+    ring->drain_head = head;
+    
+    /* read the records only after the head that covers them */
+    shim_mb();
+    
+    for (tail = ring->tail; tail < head; tail++)
+    {
+      const pr_ring_record_t *record = &ring->records[tail % PR_RING_RECORDS];
+      
+      pr_ring_entries[n].time = record->time;
+      pr_ring_entries[n].record = record;
+      n++;
+    }
+  }
+  
+  if (!n)
+  {
+    return;
+  }
+  
+  qsort(pr_ring_entries, n, sizeof(*pr_ring_entries), pr_ring_cmp);
+  
+  for (i = 0; i < n; i++)
+  {
+    const pr_ring_record_t *record = pr_ring_entries[i].record;
+    
+    (void)fwrite(record->text, 1, record->len, stderr);
+    
+    if (log_file)
+    {
+      (void)fwrite(record->text, 1, record->len, log_file);
+    }
+  }
+  
+  (void)fflush(stderr);
+  
+  if (log_file)
+  {
+    (void)fflush(log_file);
+  }
+  
+  /* records must be written out before they can be reused */
+  shim_mb();
+  
+  for (i = 0; i < pr_rings_n; i++)
+  {
+    pr_rings[i].tail = pr_rings[i].drain_head;
+  }
+}
+
+/*
+ *  pr_ring_free()
+ *  drain and unmap the rings, report messages that had to
+ *  be written directly because a ring was full
+ */
+void pr_ring_free(void)
+{
+  uint64_t overflow = 0;
+  size_t i;
+  
+  if (pr_rings == MAP_FAILED)
+  {
+    return;
+  }
+  
+  pr_ring_drain();
+  
+  for (i = 0; i < pr_rings_n; i++)
+  {
+    overflow += pr_rings[i].overflow;
+  }
+  
+  (void)munmap((void *)pr_rings, pr_rings_len);
+  pr_rings = MAP_FAILED;
+  free(pr_ring_entries);
+  pr_ring_entries = NULL;
+  
+  if (overflow)
+  {
+    pr_inf("log: %" PRIu64 " message%s overflowed the instance log rings "
+           "and %s written out of order\n", overflow,
+           overflow == 1 ? "" : "s", overflow == 1 ? "was" : "were");
+  }
+}
+
 /*
  *  pr_fail_check()
  *  set rc to EXIT_FAILURE if we detected a pr_fail
@@ -223,14 +484,10 @@ static int pr_msg_lockable(
   
   if ((flag & PR_FAIL) || (g_opt_flags & flag))
   {
-    char buf[4096];
+    char buf[4096], line[4096 + 64];
     const char *type = "";
     bool lock = false;
-    
-    if (!locked)
-    {
-      pr_lock(&lock);
-    }
+    size_t len;
     
     if (flag & PR_ERROR)
     {
@@ -254,32 +511,41 @@ static int pr_msg_lockable(
     
     if (g_opt_flags & OPT_FLAGS_LOG_BRIEF)
     {
-      size_t n = (size_t)vsnprintf(buf, sizeof(buf), fmt, ap);
-      
-      if (log_file)
-      {
-        (void)fwrite(buf, 1, n, log_file);
-        (void)fflush(log_file);
-      }
-      
-      (void)fwrite(buf, 1, n, fp);
+      ret = vsnprintf(line, sizeof(line), fmt, ap);
+      (void)shim_strlcpy(buf, line, sizeof(buf));
     }
     else
     {
       size_t n = (size_t)snprintf(buf, sizeof(buf), "%s%s [%d] ",
                                   ts, type, (int)getpid());
       ret = vsnprintf(buf + n, sizeof(buf) - n, fmt, ap);
-      (void)fprintf(fp, "%s: %s", g_app_name, buf);
+      (void)snprintf(line, sizeof(line), "%s: %s", g_app_name, buf);
+    }
+    
+    len = strlen(line);
+    
+    if (!pr_ring_put(line, len))
+    {
+      if (!locked)
+      {
+        pr_lock(&lock);
+      }
+      
+      (void)fwrite(line, 1, len, fp);
+      (void)fflush(fp);
       
       if (log_file)
       {
-        (void)fprintf(log_file, "%s: %s", g_app_name, buf);
+        (void)fwrite(line, 1, len, log_file);
         (void)fflush(log_file);
       }
+      
+      if (!locked)
+      {
+        pr_unlock(&lock);
+      }
     }
     
-    (void)fflush(fp);
-    
     if (flag & PR_FAIL)
     {
       abort_fails++;
@@ -307,11 +573,6 @@ static int pr_msg_lockable(
       syslog(LOG_INFO, "%s", buf);
     }
     
-    if (!locked)
-    {
-      pr_unlock(&lock);
-    }
-    
 #endif
   }
   
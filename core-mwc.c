@@ -24,13 +24,13 @@
  */
 #include "stress-ng.h"
 
-static stress_mwc_t mwc =
+static THREAD_LOCAL stress_mwc_t mwc =
 {
   STRESS_MWC_SEED_W,
   STRESS_MWC_SEED_Z
 };
 
-static uint8_t mwc_n1, mwc_n8, mwc_n16;
+static THREAD_LOCAL uint8_t mwc_n1, mwc_n8, mwc_n16;
 
 static inline void mwc_flush(void)
 {
@@ -184,7 +184,7 @@ HOT OPTIMIZE3 uint64_t stress_mwc64(void)
  */
 HOT OPTIMIZE3 uint16_t stress_mwc16(void)
 {
-  static uint32_t mwc_saved;
+  static THREAD_LOCAL uint32_t mwc_saved;
   
   if (LIKELY(mwc_n16))
   {
@@ -206,7 +206,7 @@ HOT OPTIMIZE3 uint16_t stress_mwc16(void)
  */
 HOT OPTIMIZE3 uint8_t stress_mwc8(void)
 {
-  static uint32_t mwc_saved;
+  static THREAD_LOCAL uint32_t mwc_saved;
   
   if (LIKELY(mwc_n8))
   {
@@ -228,7 +228,7 @@ HOT OPTIMIZE3 uint8_t stress_mwc8(void)
  */
 HOT OPTIMIZE3 uint8_t stress_mwc1(void)
 {
-  static uint32_t mwc_saved;
+  static THREAD_LOCAL uint32_t mwc_saved;
   
   if (LIKELY(mwc_n1))
   {
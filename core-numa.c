@@ -0,0 +1,505 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#if !defined(MPOL_PREFERRED)
+  #define MPOL_PREFERRED    (1)
+#endif
+#if !defined(MPOL_BIND)
+  #define MPOL_BIND   (2)
+#endif
+#if !defined(MPOL_INTERLEAVE)
+  #define MPOL_INTERLEAVE   (3)
+#endif
+#if !defined(MPOL_LOCAL)
+  #define MPOL_LOCAL    (4)
+#endif
+#if !defined(MPOL_MF_MOVE)
+  #define MPOL_MF_MOVE    (1 << 1)
+#endif
+#if !defined(MPOL_MF_MOVE_ALL)
+  #define MPOL_MF_MOVE_ALL  (1 << 2)
+#endif
+
+#define STRESS_NUMA_MAX_NODES   (1024)    /* max nodes in a node mask */
+#define STRESS_NUMA_LONG_BITS   (sizeof(unsigned long) * 8)
+#define STRESS_NUMA_MASK_LONGS    (STRESS_NUMA_MAX_NODES / STRESS_NUMA_LONG_BITS)
+#define STRESS_NUMA_SAMPLE_PAGES  (256)   /* max pages queried per buffer */
+
+typedef enum
+{
+  NUMA_POLICY_NONE = 0,   /* no policy, first touch */
+  NUMA_POLICY_LOCAL,    /* node of the CPU doing the allocation */
+  NUMA_POLICY_INTERLEAVE,   /* interleaved over the allowed nodes */
+  NUMA_POLICY_NODE,   /* bound to one node */
+} stress_numa_policy_t;
+
+typedef struct
+{
+  stress_numa_policy_t policy;  /* --numa-policy */
+  int32_t node;     /* node for node=N */
+  bool available;     /* buffer residency can be sampled */
+  unsigned long nodemask[STRESS_NUMA_MASK_LONGS]; /* nodes to interleave or bind to */
+} stress_numa_t;
+
+static stress_numa_t numa;
+
+/*
+ *  stress_set_numa_policy()
+ *  set the NUMA policy of the shared stats and stressor
+ *  buffers, local, interleave or node=N
+ */
+int stress_set_numa_policy(const char *const opt)
+{
+  int32_t policy, node = -1;
+  
+  if (!strcmp(opt, "local"))
+  {
+    policy = NUMA_POLICY_LOCAL;
+  }
+  else if (!strcmp(opt, "interleave"))
+  {
+    policy = NUMA_POLICY_INTERLEAVE;
+  }
+  else if ((sscanf(opt, "node=%" SCNd32, &node) == 1) &&
+           (node >= 0) && (node < STRESS_NUMA_MAX_NODES))
+  {
+    policy = NUMA_POLICY_NODE;
+  }
+  else
+  {
+    (void)fprintf(stderr, "numa-policy option '%s' not known, options are: "
+                  "local interleave node=N\n", opt);
+    return -1;
+  }
+  
+  stress_set_setting_global("numa-node", TYPE_ID_INT32, &node);
+  return stress_set_setting_global("numa-policy", TYPE_ID_INT32, &policy);
+}
+
+/*
+ *  stress_numa_policy_enabled()
+ *  true if a NUMA policy is being applied
+ */
+bool stress_numa_policy_enabled(void)
+{
+  return numa.policy != NUMA_POLICY_NONE;
+}
+
+/*
+ *  stress_numa_available()
+ *  true if the NUMA residency of stressor buffers can be
+ *  sampled, with or without a NUMA policy
+ */
+bool stress_numa_available(void)
+{
+  return numa.available;
+}
+
+#if defined(__linux__) && \
+    defined(__NR_mbind) && \
+    defined(__NR_move_pages)
+
+/*
+ *  stress_numa_mems_allowed()
+ *  fill the node mask with the nodes this process may allocate
+ *  memory on, from the hex Mems_allowed mask in /proc/self/status
+ */
+static int stress_numa_mems_allowed(unsigned long *nodemask)
+{
+  FILE *fp;
+  char buf[4096], *str = NULL, *ptr;
+  size_t node = 0;
+  
+  fp = fopen("/proc/self/status", "r");
+  
+  if (!fp)
+  {
+    return -1;
+  }
+  
+  while (fgets(buf, sizeof(buf), fp))
+  {
+    if (!strncmp(buf, "Mems_allowed:", 13))
+    {
+      str = buf + 13;
+      break;
+    }
+  }
+  
+  (void)fclose(fp);
+  
+  if (!str)
+  {
+    return -1;
+  }
+  
+  /* least significant nodes are last */
+  for (ptr = str + strlen(str) - 1; (ptr >= str) && (node < STRESS_NUMA_MAX_NODES); ptr--)
+  {
+    int i, val;
+    
+    if (!isxdigit((int)*ptr))
+    {
+      continue;
+    }
+    
+    val = isdigit((int)*ptr) ? *ptr - '0' : tolower((int)*ptr) - 'a' + 10;
+    
+    for (i = 0; i < 4; i++, node++)
+    {
+      if (val & (1 << i))
+      {
+        nodemask[node / STRESS_NUMA_LONG_BITS] |= 1UL << (node % STRESS_NUMA_LONG_BITS);
+      }
+    }
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_numa_policy_init()
+ *  set up the node mask for the NUMA policy, before the
+ *  shared stats are mapped
+ */
+int stress_numa_policy_init(void)
+{
+  int32_t policy = NUMA_POLICY_NONE;
+  char path[PATH_MAX];
+  struct stat statbuf;
+  
+  (void)stress_get_setting("numa-policy", &policy);
+  (void)stress_get_setting("numa-node", &numa.node);
+  (void)memset(numa.nodemask, 0, sizeof(numa.nodemask));
+  numa.available = (stat("/sys/devices/system/node/node0", &statbuf) == 0);
+  
+  switch (policy)
+  {
+    case NUMA_POLICY_LOCAL:
+      pr_inf("numa-policy: local\n");
+      break;
+    
+    case NUMA_POLICY_INTERLEAVE:
+      if (stress_numa_mems_allowed(numa.nodemask) < 0)
+      {
+        pr_inf("numa-policy: cannot read allowed memory nodes, "
+               "disabling --numa-policy\n");
+        return 0;
+      }
+    
+      pr_inf("numa-policy: interleave\n");
+      break;
+    
+    case NUMA_POLICY_NODE:
+      (void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%" PRId32, numa.node);
+    
+      if (stat(path, &statbuf) < 0)
+      {
+        pr_err("numa-policy: node %" PRId32 " does not exist\n", numa.node);
+        return -1;
+      }
+    
+      numa.nodemask[numa.node / STRESS_NUMA_LONG_BITS] |= 1UL << (numa.node % STRESS_NUMA_LONG_BITS);
+      pr_inf("numa-policy: bind to node %" PRId32 "\n", numa.node);
+      break;
+    
+    default:
+      return 0;
+  }
+  
+  numa.policy = (stress_numa_policy_t)policy;
+  return 0;
+}
+
+/*
+ *  stress_numa_mbind()
+ *  apply the NUMA policy to a range of memory
+ */
+static void stress_numa_mbind(void *addr, const size_t len)
+{
+  switch (numa.policy)
+  {
+    case NUMA_POLICY_LOCAL:
+      if (shim_mbind(addr, (unsigned long)len, MPOL_LOCAL, NULL, 0, 0) < 0)
+      {
+        /* pre Linux 3.8, preferred with no nodes is local */
+        (void)shim_mbind(addr, (unsigned long)len, MPOL_PREFERRED, NULL, 0, 0);
+      }
+    
+      break;
+    
+    case NUMA_POLICY_INTERLEAVE:
+      (void)shim_mbind(addr, (unsigned long)len, MPOL_INTERLEAVE,
+                       numa.nodemask, STRESS_NUMA_MAX_NODES, 0);
+      break;
+    
+    case NUMA_POLICY_NODE:
+      (void)shim_mbind(addr, (unsigned long)len, MPOL_BIND,
+                       numa.nodemask, STRESS_NUMA_MAX_NODES, 0);
+      break;
+    
+    default:
+      break;
+  }
+}
+
+/*
+ *  stress_numa_mmap()
+ *  mmap a stressor working buffer with the NUMA policy applied;
+ *  MAP_POPULATE would fault the pages in before the policy is
+ *  set, so the buffer is populated after the mbind instead
+ */
+void *stress_numa_mmap(
+  void *addr,
+  const size_t length,
+  const int prot,
+  const int flags,
+  const int fd,
+  const off_t offset)
+{
+  const size_t page_size = stress_get_pagesize();
+  bool populate = false;
+  int map_flags = flags;
+  void *ptr;
+  
+  if (numa.policy == NUMA_POLICY_NONE)
+  {
+    return mmap(addr, length, prot, flags, fd, offset);
+  }
+  
+#if defined(MAP_POPULATE)
+  populate = !!(map_flags & MAP_POPULATE);
+  map_flags &= ~MAP_POPULATE;
+#endif
+  ptr = mmap(addr, length, prot, map_flags, fd, offset);
+  
+  if (ptr == MAP_FAILED)
+  {
+    return ptr;
+  }
+  
+  stress_numa_mbind(ptr, length);
+  
+  if (populate)
+  {
+    if ((prot & PROT_WRITE) && (map_flags & MAP_ANONYMOUS))
+    {
+      volatile uint8_t *page;
+      
+      /* anonymous memory is zero, so writing zero is harmless */
+      for (page = (uint8_t *)ptr; page < (uint8_t *)ptr + length; page += page_size)
+      {
+        *page = 0;
+      }
+    }
+    else
+    {
+      (void)shim_madvise(ptr, length, MADV_WILLNEED);
+    }
+  }
+  
+  return ptr;
+}
+
+/*
+ *  stress_numa_residency()
+ *  query which nodes a sample of the buffer's pages are on and
+ *  count them as local or remote to the node the instance is
+ *  running on
+ */
+void stress_numa_residency(const stress_args_t *args, void *addr, const size_t length)
+{
+  const size_t page_size = stress_get_pagesize();
+  const size_t n_pages = length / page_size;
+  void *pages[STRESS_NUMA_SAMPLE_PAGES];
+  int status[STRESS_NUMA_SAMPLE_PAGES];
+  size_t i, n, stride;
+  unsigned int cpu, node;
+  
+  if (!args->numa || !n_pages || (addr == MAP_FAILED))
+  {
+    return;
+  }
+  
+  if (shim_getcpu(&cpu, &node, NULL) < 0)
+  {
+    return;
+  }
+  
+  n = STRESS_MINIMUM(n_pages, (size_t)STRESS_NUMA_SAMPLE_PAGES);
+  stride = n_pages / n;
+  
+  for (i = 0; i < n; i++)
+  {
+    pages[i] = (uint8_t *)addr + (i * stride * page_size);
+    status[i] = -1;
+  }
+  
+  if (shim_move_pages(0, (unsigned long)n, pages, NULL, status, 0) < 0)
+  {
+    return;
+  }
+  
+  for (i = 0; i < n; i++)
+  {
+    /* negative status, page not present */
+    if (status[i] < 0)
+    {
+      continue;
+    }
+    
+    if ((unsigned int)status[i] == node)
+    {
+      args->numa->local++;
+    }
+    else
+    {
+      args->numa->remote++;
+    }
+  }
+}
+
+/*
+ *  stress_numa_munmap()
+ *  record the node residency of a stressor working buffer
+ *  and unmap it
+ */
+int stress_numa_munmap(const stress_args_t *args, void *addr, const size_t length)
+{
+  stress_numa_residency(args, addr, length);
+  return munmap(addr, length);
+}
+
+/*
+ *  stress_numa_shared()
+ *  apply the interleave or node policy to the shared stats
+ *  before they are first touched, with the local policy the
+ *  instances move their own stats with stress_numa_stats_local
+ */
+void stress_numa_shared(void *addr, const size_t length)
+{
+  if ((numa.policy == NUMA_POLICY_INTERLEAVE) ||
+      (numa.policy == NUMA_POLICY_NODE))
+  {
+    stress_numa_mbind(addr, length);
+  }
+}
+
+/*
+ *  stress_numa_stats_local()
+ *  move the pages that only hold the stats of this instance
+ *  to the node the instance is running on, pages shared with
+ *  the stats of other instances are left where they are
+ */
+void stress_numa_stats_local(void *addr, const size_t length)
+{
+  const uintptr_t page_size = (uintptr_t)stress_get_pagesize();
+  const uintptr_t begin = ((uintptr_t)addr + page_size - 1) & ~(page_size - 1);
+  const uintptr_t end = ((uintptr_t)addr + length) & ~(page_size - 1);
+  void *pages[64];
+  int nodes[64], status[64];
+  unsigned int cpu, node;
+  size_t i, n = 0;
+  uintptr_t page;
+  
+  if ((numa.policy != NUMA_POLICY_LOCAL) || (end <= begin))
+  {
+    return;
+  }
+  
+  if (shim_getcpu(&cpu, &node, NULL) < 0)
+  {
+    return;
+  }
+  
+  for (page = begin; (page < end) && (n < SIZEOF_ARRAY(pages)); page += page_size, n++)
+  {
+    pages[n] = (void *)page;
+    nodes[n] = (int)node;
+  }
+  
+  for (i = 0; i < n; i++)
+  {
+    status[i] = -1;
+  }
+  
+  /* the pages are shared with the parent, so try to move all */
+  if (shim_move_pages(0, (unsigned long)n, pages, nodes, status, MPOL_MF_MOVE_ALL) < 0)
+  {
+    (void)shim_move_pages(0, (unsigned long)n, pages, nodes, status, MPOL_MF_MOVE);
+  }
+}
+#else
+int stress_numa_policy_init(void)
+{
+  int32_t policy = NUMA_POLICY_NONE;
+  
+  (void)stress_get_setting("numa-policy", &policy);
+  
+  if (policy != NUMA_POLICY_NONE)
+  {
+    pr_inf("numa-policy: NUMA memory policies are not available on this system\n");
+  }
+  
+  return 0;
+}
+
+void *stress_numa_mmap(
+  void *addr,
+  const size_t length,
+  const int prot,
+  const int flags,
+  const int fd,
+  const off_t offset)
+{
+  return mmap(addr, length, prot, flags, fd, offset);
+}
+
+void stress_numa_residency(const stress_args_t *args, void *addr, const size_t length)
+{
+  (void)args;
+  (void)addr;
+  (void)length;
+}
+
+int stress_numa_munmap(const stress_args_t *args, void *addr, const size_t length)
+{
+  (void)args;
+  return munmap(addr, length);
+}
+
+void stress_numa_shared(void *addr, const size_t length)
+{
+  (void)addr;
+  (void)length;
+}
+
+void stress_numa_stats_local(void *addr, const size_t length)
+{
+  (void)addr;
+  (void)length;
+}
+#endif
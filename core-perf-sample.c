@@ -0,0 +1,1212 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#if defined(HAVE_ELF_H)
+#include <elf.h>
+#endif
+
+#define STRESS_PERF_SAMPLE_TOP_MAX  (100)   /* max --perf-sample N */
+#define STRESS_PERF_SAMPLE_FREQ   (997)   /* samples per second */
+#define STRESS_PERF_SAMPLE_PAGES  (64)    /* ring buffer data pages */
+#define STRESS_PERF_SAMPLE_IPS    (8192)    /* distinct IPs per stressor */
+#define STRESS_PERF_SAMPLE_PROBES (32)    /* IP hash probe limit */
+
+/*
+ *  stress_set_perf_sample()
+ *  set the number of hottest symbols to report per stressor
+ */
+int stress_set_perf_sample(const char *const opt)
+{
+  const uint32_t perf_sample = stress_get_uint32(opt);
+  
+  stress_check_range("perf-sample", (uint64_t)perf_sample, 1, STRESS_PERF_SAMPLE_TOP_MAX);
+  return stress_set_setting_global("perf-sample", TYPE_ID_UINT32, &perf_sample);
+}
+
+#if defined(STRESS_PERF_STATS) && \
+    defined(HAVE_LINUX_PERF_EVENT_H)
+
+/*
+ *  The parent opens a sampling perf event on each stressor
+ *  instance as it is started and drains the instruction
+ *  pointers out of the event ring buffers while it waits for
+ *  the stressors to finish. Sampled IPs are counted per
+ *  stressor and only resolved to symbols once the run is over,
+ *  so the wait loop just has to hash them.
+ */
+
+/* a sampled instruction pointer */
+typedef struct
+{
+  uint64_t ip;      /* instruction pointer, 0 = unused */
+  uint64_t count;     /* number of samples */
+  bool kernel;      /* true = kernel space IP */
+} stress_perf_ip_t;
+
+/* per instance sampling event */
+typedef struct
+{
+  int fd;       /* perf event fd, -1 = not open */
+  void *ring;     /* mmap'd perf ring buffer */
+  bool tried;     /* an open was attempted this run */
+} stress_perf_ring_t;
+
+/* per stressor sampled IPs */
+typedef struct
+{
+  const stress_stressor_t *ss;  /* stressor being sampled */
+  stress_perf_ring_t *rings;  /* sampling events, one per instance */
+  int32_t n_rings;    /* number of sampling events */
+  stress_perf_ip_t *ips;    /* hash table of sampled IPs */
+  uint64_t samples;   /* total samples */
+  uint64_t other;     /* samples that did not fit in the hash table */
+  uint64_t lost;      /* samples lost by the kernel */
+} stress_perf_sampled_t;
+
+/* a resolvable symbol */
+typedef struct
+{
+  uintptr_t addr;     /* start address */
+  uintptr_t size;     /* size, 0 = up to the next symbol */
+  const char *name;   /* symbol name */
+} stress_perf_sym_t;
+
+/* a resolvable mapping */
+typedef struct
+{
+  uintptr_t begin;    /* start of mapping */
+  uintptr_t end;      /* end of mapping */
+  char *name;     /* mapped object base name */
+  bool exe;     /* true = mapping of stress-ng */
+} stress_perf_map_t;
+
+/* symbol tables used to resolve sampled IPs */
+typedef struct
+{
+  stress_perf_sym_t *ksyms; /* kernel symbols, sorted by address */
+  size_t n_ksyms;     /* number of kernel symbols */
+  stress_perf_sym_t *usyms; /* stress-ng symbols, sorted by address */
+  size_t n_usyms;     /* number of stress-ng symbols */
+  stress_perf_map_t *maps;  /* mappings, in address order */
+  size_t n_maps;      /* number of mappings */
+  char **knames;      /* kernel symbol names */
+  void *exe;      /* mmap'd stress-ng executable */
+  size_t exe_size;    /* size of mmap'd executable */
+} stress_perf_symtab_t;
+
+/* a sampled symbol, for aggregating IPs */
+typedef struct
+{
+  const char *name;   /* symbol name, NULL if unknown */
+  const char *module;   /* object containing the symbol */
+  uint64_t count;     /* number of samples */
+} stress_perf_hot_t;
+
+/* sampling event attempts, most useful first */
+typedef struct
+{
+  const uint32_t type;    /* perf event type */
+  const uint64_t config;    /* perf event config */
+  const char *name;   /* human readable event name */
+} stress_perf_sample_event_t;
+
+static const stress_perf_sample_event_t perf_sample_events[] =
+{
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK,  "cpu-clock" },
+};
+
+static stress_perf_sampled_t *perf_sampled;
+static size_t n_perf_sampled;
+static uint32_t perf_sample_top;
+static const char *perf_sample_event_name;
+
+/*
+ *  stress_perf_sample_enabled()
+ *  true if hot symbols are being sampled
+ */
+bool stress_perf_sample_enabled(void)
+{
+  return perf_sampled != NULL;
+}
+
+/*
+ *  stress_perf_sample_init()
+ *  allocate the per stressor sampling state
+ */
+int stress_perf_sample_init(stress_stressor_t *stressors_list)
+{
+  stress_stressor_t *ss;
+  size_t i;
+  
+  (void)stress_get_setting("perf-sample", &perf_sample_top);
+  
+  if (!perf_sample_top)
+  {
+    return 0;
+  }
+  
+  for (n_perf_sampled = 0, ss = stressors_list; ss; ss = ss->next)
+  {
+    n_perf_sampled++;
+  }
+  
+  perf_sampled = calloc(n_perf_sampled, sizeof(*perf_sampled));
+  
+  if (!perf_sampled)
+  {
+    pr_err("cannot allocate perf sampling state\n");
+    return -1;
+  }
+  
+  for (i = 0, ss = stressors_list; ss; ss = ss->next, i++)
+  {
+    stress_perf_sampled_t *ps = &perf_sampled[i];
+    int32_t j;
+    
+    ps->ss = ss;
+    ps->n_rings = ss->num_instances;
+    ps->rings = calloc((size_t)ps->n_rings, sizeof(*ps->rings));
+    ps->ips = calloc(STRESS_PERF_SAMPLE_IPS, sizeof(*ps->ips));
+    
+    if (!ps->rings || !ps->ips)
+    {
+      pr_err("cannot allocate perf sampling state\n");
+      return -1;
+    }
+    
+    for (j = 0; j < ps->n_rings; j++)
+    {
+      ps->rings[j].fd = -1;
+    }
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_perf_sample_open()
+ *  open a sampling perf event on pid, trying hardware
+ *  cycles before falling back to the cpu clock and to user
+ *  space only if the kernel cannot be sampled. Per task events
+ *  cannot be both inherited and mmap'd, so only the instance
+ *  process or thread itself is sampled and not any children
+ *  it forks
+ */
+static int stress_perf_sample_open(const pid_t pid, const char **name)
+{
+  size_t i;
+  int saved_errno = 0;
+  
+  for (i = 0; i < SIZEOF_ARRAY(perf_sample_events); i++)
+  {
+    int attempt;
+    
+    for (attempt = 0; attempt < 2; attempt++)
+    {
+      struct perf_event_attr attr;
+      int fd;
+      
+      (void)memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = perf_sample_events[i].type;
+      attr.config = perf_sample_events[i].config;
+      attr.freq = 1;
+      attr.sample_freq = STRESS_PERF_SAMPLE_FREQ;
+      attr.sample_type = PERF_SAMPLE_IP;
+      attr.exclude_hv = 1;
+      attr.exclude_kernel = attempt;
+      fd = (int)syscall(__NR_perf_event_open, &attr, pid, -1, -1, 0);
+      
+      if (fd >= 0)
+      {
+        *name = perf_sample_events[i].name;
+        return fd;
+      }
+      
+      saved_errno = errno;
+    }
+  }
+  
+  errno = saved_errno;
+  return -1;
+}
+
+/*
+ *  stress_perf_sample_ring()
+ *  open and map a sampling event on the instance running as
+ *  task pid, this is a process or a pthread instance's tid
+ */
+static void stress_perf_sample_ring(stress_perf_ring_t *ring, const pid_t pid)
+{
+  static bool warned;
+  const size_t len = (STRESS_PERF_SAMPLE_PAGES + 1) * stress_get_pagesize();
+  const char *name = NULL;
+  
+  if ((ring->fd >= 0) || ring->tried)
+  {
+    return;
+  }
+  
+  ring->tried = true;
+  ring->fd = stress_perf_sample_open(pid, &name);
+  
+  if (ring->fd < 0)
+  {
+    if (!warned)
+    {
+      pr_inf("perf-sample: cannot open a sampling perf event, errno=%d (%s)\n",
+             errno, strerror(errno));
+      warned = true;
+    }
+    
+    return;
+  }
+  
+  ring->ring = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+  
+  if (ring->ring == MAP_FAILED)
+  {
+    if (!warned)
+    {
+      pr_inf("perf-sample: cannot mmap perf ring buffer, errno=%d (%s)\n",
+             errno, strerror(errno));
+      warned = true;
+    }
+    
+    (void)close(ring->fd);
+    ring->fd = -1;
+    ring->ring = NULL;
+    return;
+  }
+  
+#if defined(MADV_DONTFORK)
+  /* stressors started later do not need a copy of the ring */
+  (void)madvise(ring->ring, len, MADV_DONTFORK);
+#endif
+  perf_sample_event_name = name;
+}
+
+/*
+ *  stress_perf_sample_attach()
+ *  start sampling instance of stressor ss running as pid,
+ *  pthread instances share the pid of their container so
+ *  they are attached by tid once they start, see
+ *  stress_perf_sample_threads()
+ */
+void stress_perf_sample_attach(const stress_stressor_t *ss, const int32_t instance, const pid_t pid)
+{
+  size_t i;
+  
+  if (ss->pthread_mode)
+  {
+    return;
+  }
+  
+  for (i = 0; i < n_perf_sampled; i++)
+  {
+    if (perf_sampled[i].ss == ss)
+    {
+      break;
+    }
+  }
+  
+  if ((i == n_perf_sampled) || (instance < 0) || (instance >= perf_sampled[i].n_rings))
+  {
+    return;
+  }
+  
+  stress_perf_sample_ring(&perf_sampled[i].rings[instance], pid);
+}
+
+/*
+ *  stress_perf_sample_threads()
+ *  attach to the pthread instances of a stressor that have
+ *  started and published their tid since the last poll
+ */
+static void stress_perf_sample_threads(stress_perf_sampled_t *ps)
+{
+  const stress_stressor_t *ss = ps->ss;
+  int32_t j;
+  
+  if (!ss->pthread_mode)
+  {
+    return;
+  }
+  
+  for (j = 0; (j < ps->n_rings) && (j < ss->num_instances); j++)
+  {
+    const stress_stats_t *stats = ss->stats[j];
+    
+    /* only attach to threads that are still running */
+    if (stats->cpus.tid && (stats->finish == stats->start))
+    {
+      stress_perf_sample_ring(&ps->rings[j], stats->cpus.tid);
+    }
+  }
+}
+
+/*
+ *  stress_perf_sample_count()
+ *  count a sample of ip in the stressor's IP hash table
+ */
+static void stress_perf_sample_count(stress_perf_sampled_t *ps, const uint64_t ip, const bool kernel)
+{
+  size_t h = (size_t)((ip * 0x9e3779b97f4a7c15ULL) >> 32);
+  int probe;
+  
+  ps->samples++;
+  
+  for (probe = 0; probe < STRESS_PERF_SAMPLE_PROBES; probe++, h++)
+  {
+    stress_perf_ip_t *pip = &ps->ips[h & (STRESS_PERF_SAMPLE_IPS - 1)];
+    
+    if ((pip->ip == ip) && (pip->kernel == kernel))
+    {
+      pip->count++;
+      return;
+    }
+    
+    if (!pip->count)
+    {
+      pip->ip = ip;
+      pip->kernel = kernel;
+      pip->count = 1;
+      return;
+    }
+  }
+  
+  ps->other++;
+}
+
+/*
+ *  stress_perf_ring_copy()
+ *  copy len bytes at offset out of the ring buffer data
+ *  area, dealing with records that wrap around the end
+ */
+static void stress_perf_ring_copy(
+  const uint8_t *data,
+  const size_t size,
+  const uint64_t offset,
+  void *dst,
+  const size_t len)
+{
+  const size_t start = (size_t)(offset % size);
+  const size_t n = ((start + len) > size) ? size - start : len;
+  
+  (void)memcpy(dst, data + start, n);
+  
+  if (n < len)
+  {
+    (void)memcpy((uint8_t *)dst + n, data, len - n);
+  }
+}
+
+/*
+ *  stress_perf_sample_drain()
+ *  consume all the records in an instance's ring buffer
+ */
+static void stress_perf_sample_drain(stress_perf_sampled_t *ps, stress_perf_ring_t *ring)
+{
+  struct perf_event_mmap_page *meta = (struct perf_event_mmap_page *)ring->ring;
+  const size_t page_size = stress_get_pagesize();
+  const size_t size = STRESS_PERF_SAMPLE_PAGES * page_size;
+  const uint8_t *data = (const uint8_t *)ring->ring + page_size;
+  uint64_t head, tail;
+  
+  head = meta->data_head;
+  shim_mfence();
+  tail = meta->data_tail;
+  
+  while (tail < head)
+  {
+    struct perf_event_header hdr;
+    uint64_t val[2];
+    
+    stress_perf_ring_copy(data, size, tail, &hdr, sizeof(hdr));
+    
+    if (hdr.size < sizeof(hdr))
+    {
+      tail = head;
+      break;
+    }
+    
+    switch (hdr.type)
+    {
+      case PERF_RECORD_SAMPLE:
+        stress_perf_ring_copy(data, size, tail + sizeof(hdr), val, sizeof(val[0]));
+        stress_perf_sample_count(ps, val[0],
+                                 (hdr.misc & PERF_RECORD_MISC_CPUMODE_MASK) == PERF_RECORD_MISC_KERNEL);
+        break;
+      
+      case PERF_RECORD_LOST:
+        /* u64 id, u64 lost */
+        stress_perf_ring_copy(data, size, tail + sizeof(hdr), val, sizeof(val));
+        ps->lost += val[1];
+        break;
+      
+      default:
+        break;
+    }
+    
+    tail += hdr.size;
+  }
+  
+  shim_mfence();
+  meta->data_tail = tail;
+}
+
+/*
+ *  stress_perf_sample_poll()
+ *  drain the sampled IPs out of all the ring buffers
+ */
+void stress_perf_sample_poll(void)
+{
+  size_t i;
+  
+  for (i = 0; i < n_perf_sampled; i++)
+  {
+    stress_perf_sampled_t *ps = &perf_sampled[i];
+    int32_t j;
+    
+    stress_perf_sample_threads(ps);
+    
+    for (j = 0; j < ps->n_rings; j++)
+    {
+      if (ps->rings[j].fd >= 0)
+      {
+        stress_perf_sample_drain(ps, &ps->rings[j]);
+      }
+    }
+  }
+}
+
+/*
+ *  stress_perf_sample_detach()
+ *  drain and close all the sampling events at the end of a run,
+ *  sampled IPs are kept so repeated runs accumulate
+ */
+void stress_perf_sample_detach(void)
+{
+  const size_t len = (STRESS_PERF_SAMPLE_PAGES + 1) * stress_get_pagesize();
+  size_t i;
+  
+  stress_perf_sample_poll();
+  
+  for (i = 0; i < n_perf_sampled; i++)
+  {
+    stress_perf_sampled_t *ps = &perf_sampled[i];
+    int32_t j;
+    
+    for (j = 0; j < ps->n_rings; j++)
+    {
+      stress_perf_ring_t *ring = &ps->rings[j];
+      
+      ring->tried = false;
+      
+      if (ring->fd >= 0)
+      {
+        (void)munmap(ring->ring, len);
+        (void)close(ring->fd);
+        ring->fd = -1;
+        ring->ring = NULL;
+      }
+    }
+  }
+}
+
+/*
+ *  stress_perf_sym_cmp()
+ *  sort symbols by address
+ */
+static int stress_perf_sym_cmp(const void *p1, const void *p2)
+{
+  const stress_perf_sym_t *s1 = (const stress_perf_sym_t *)p1;
+  const stress_perf_sym_t *s2 = (const stress_perf_sym_t *)p2;
+  
+  if (s1->addr < s2->addr)
+  {
+    return -1;
+  }
+  
+  return s1->addr > s2->addr;
+}
+
+/*
+ *  stress_perf_sym_find()
+ *  find the symbol containing addr, or NULL if there is none
+ */
+static const stress_perf_sym_t *stress_perf_sym_find(
+  const stress_perf_sym_t *syms,
+  const size_t n,
+  const uintptr_t addr)
+{
+  size_t lo = 0, hi = n;
+  const stress_perf_sym_t *sym;
+  
+  /* find the last symbol starting at or before addr */
+  while (lo < hi)
+  {
+    const size_t mid = lo + (hi - lo) / 2;
+    
+    if (syms[mid].addr <= addr)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  
+  if (!lo)
+  {
+    return NULL;
+  }
+  
+  sym = &syms[lo - 1];
+  
+  if (sym->size && (addr >= sym->addr + sym->size))
+  {
+    return NULL;
+  }
+  
+  return sym;
+}
+
+/*
+ *  stress_perf_symtab_kernel()
+ *  load the kernel text symbols, these are all zero if
+ *  kernel pointers are restricted and are then ignored
+ */
+static void stress_perf_symtab_kernel(stress_perf_symtab_t *st)
+{
+  FILE *fp;
+  char buf[256];
+  size_t n_max = 0;
+  
+  fp = fopen("/proc/kallsyms", "r");
+  
+  if (!fp)
+  {
+    return;
+  }
+  
+  while (fgets(buf, sizeof(buf), fp))
+  {
+    unsigned long long addr;
+    char type, name[128];
+    
+    if (sscanf(buf, "%llx %c %127s", &addr, &type, name) != 3)
+    {
+      continue;
+    }
+    
+    if (((type != 't') && (type != 'T')) || !addr)
+    {
+      continue;
+    }
+    
+    if (st->n_ksyms == n_max)
+    {
+      const size_t n_new = n_max ? n_max * 2 : 16384;
+      stress_perf_sym_t *ksyms;
+      char **knames;
+      
+      ksyms = realloc(st->ksyms, n_new * sizeof(*ksyms));
+      
+      if (!ksyms)
+      {
+        break;
+      }
+      
+      st->ksyms = ksyms;
+      knames = realloc(st->knames, n_new * sizeof(*knames));
+      
+      if (!knames)
+      {
+        break;
+      }
+      
+      st->knames = knames;
+      n_max = n_new;
+    }
+    
+    st->knames[st->n_ksyms] = strdup(name);
+    
+    if (!st->knames[st->n_ksyms])
+    {
+      break;
+    }
+    
+    st->ksyms[st->n_ksyms].addr = (uintptr_t)addr;
+    st->ksyms[st->n_ksyms].size = 0;
+    st->ksyms[st->n_ksyms].name = st->knames[st->n_ksyms];
+    st->n_ksyms++;
+  }
+  
+  (void)fclose(fp);
+  
+  if (st->n_ksyms)
+  {
+    qsort(st->ksyms, st->n_ksyms, sizeof(*st->ksyms), stress_perf_sym_cmp);
+  }
+}
+
+/*
+ *  stress_perf_symtab_maps()
+ *  load the executable mappings of stress-ng, the parent and
+ *  the stressors share the same layout as they are forked
+ */
+static void stress_perf_symtab_maps(stress_perf_symtab_t *st, const char *exe, uintptr_t *exe_begin)
+{
+  FILE *fp;
+  char buf[4096 + 128];
+  size_t n_max = 0;
+  
+  *exe_begin = 0;
+  fp = fopen("/proc/self/maps", "r");
+  
+  if (!fp)
+  {
+    return;
+  }
+  
+  while (fgets(buf, sizeof(buf), fp))
+  {
+    unsigned long long begin, end, offset;
+    char perms[8], path[4096];
+    const char *base;
+    
+    if (sscanf(buf, "%llx-%llx %7s %llx %*s %*s %4095[^\n]",
+               &begin, &end, perms, &offset, path) != 5)
+    {
+      continue;
+    }
+    
+    if (exe && !offset && !strcmp(path, exe) && !*exe_begin)
+    {
+      *exe_begin = (uintptr_t)begin;
+    }
+    
+    if (perms[2] != 'x')
+    {
+      continue;
+    }
+    
+    if (st->n_maps == n_max)
+    {
+      const size_t n_new = n_max ? n_max * 2 : 64;
+      stress_perf_map_t *maps;
+      
+      maps = realloc(st->maps, n_new * sizeof(*maps));
+      
+      if (!maps)
+      {
+        break;
+      }
+      
+      st->maps = maps;
+      n_max = n_new;
+    }
+    
+    base = strrchr(path, '/');
+    st->maps[st->n_maps].name = strdup(base ? base + 1 : path);
+    
+    if (!st->maps[st->n_maps].name)
+    {
+      break;
+    }
+    
+    st->maps[st->n_maps].begin = (uintptr_t)begin;
+    st->maps[st->n_maps].end = (uintptr_t)end;
+    st->maps[st->n_maps].exe = exe && !strcmp(path, exe);
+    st->n_maps++;
+  }
+  
+  (void)fclose(fp);
+}
+
+#if defined(HAVE_ELF_H)
+
+#if UINTPTR_MAX == 0xffffffffUL
+#define STRESS_ELF_CLASS  ELFCLASS32
+#define STRESS_ELF_ST_TYPE(i) ELF32_ST_TYPE(i)
+typedef Elf32_Ehdr stress_elf_ehdr_t;
+typedef Elf32_Phdr stress_elf_phdr_t;
+typedef Elf32_Shdr stress_elf_shdr_t;
+typedef Elf32_Sym stress_elf_sym_t;
+#else
+#define STRESS_ELF_CLASS  ELFCLASS64
+#define STRESS_ELF_ST_TYPE(i) ELF64_ST_TYPE(i)
+typedef Elf64_Ehdr stress_elf_ehdr_t;
+typedef Elf64_Phdr stress_elf_phdr_t;
+typedef Elf64_Shdr stress_elf_shdr_t;
+typedef Elf64_Sym stress_elf_sym_t;
+#endif
+
+/*
+ *  stress_perf_symtab_exe()
+ *  load the function symbols of the stress-ng executable,
+ *  from the full symbol table or, if stripped, the dynamic
+ *  symbol table; exe_begin is where the start of the file is
+ *  mapped, used to relocate position independent executables
+ */
+static void stress_perf_symtab_exe(stress_perf_symtab_t *st, const uintptr_t exe_begin)
+{
+  const stress_elf_ehdr_t *ehdr;
+  const stress_elf_shdr_t *shdr, *symtab = NULL;
+  const stress_elf_sym_t *sym;
+  const char *strtab;
+  uintptr_t bias = 0;
+  struct stat statbuf;
+  size_t i, n;
+  int fd;
+  
+  fd = open("/proc/self/exe", O_RDONLY);
+  
+  if (fd < 0)
+  {
+    return;
+  }
+  
+  if ((fstat(fd, &statbuf) < 0) || (statbuf.st_size < (off_t)sizeof(*ehdr)))
+  {
+    (void)close(fd);
+    return;
+  }
+  
+  st->exe = mmap(NULL, (size_t)statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  (void)close(fd);
+  
+  if (st->exe == MAP_FAILED)
+  {
+    st->exe = NULL;
+    return;
+  }
+  
+  st->exe_size = (size_t)statbuf.st_size;
+  ehdr = (const stress_elf_ehdr_t *)st->exe;
+  
+  if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) ||
+      (ehdr->e_ident[EI_CLASS] != STRESS_ELF_CLASS) ||
+      (ehdr->e_shoff + (size_t)ehdr->e_shnum * sizeof(*shdr) > st->exe_size) ||
+      (ehdr->e_phoff + (size_t)ehdr->e_phnum * sizeof(stress_elf_phdr_t) > st->exe_size))
+  {
+    return;
+  }
+  
+  /* load bias, from where the first loadable segment is mapped */
+  for (i = 0; i < ehdr->e_phnum; i++)
+  {
+    const stress_elf_phdr_t *phdr = (const stress_elf_phdr_t *)
+                                    ((const uint8_t *)st->exe + ehdr->e_phoff) + i;
+    
+    if ((phdr->p_type == PT_LOAD) && !phdr->p_offset)
+    {
+      if (exe_begin)
+      {
+        bias = exe_begin - (uintptr_t)phdr->p_vaddr;
+      }
+      
+      break;
+    }
+  }
+  
+  shdr = (const stress_elf_shdr_t *)((const uint8_t *)st->exe + ehdr->e_shoff);
+  
+  for (i = 0; i < ehdr->e_shnum; i++)
+  {
+    if (shdr[i].sh_type == SHT_SYMTAB)
+    {
+      symtab = &shdr[i];
+      break;
+    }
+    
+    if (shdr[i].sh_type == SHT_DYNSYM)
+    {
+      symtab = &shdr[i];
+    }
+  }
+  
+  if (!symtab || (symtab->sh_link >= ehdr->e_shnum) ||
+      (symtab->sh_offset + symtab->sh_size > st->exe_size) ||
+      (shdr[symtab->sh_link].sh_offset + shdr[symtab->sh_link].sh_size > st->exe_size))
+  {
+    return;
+  }
+  
+  sym = (const stress_elf_sym_t *)((const uint8_t *)st->exe + symtab->sh_offset);
+  strtab = (const char *)st->exe + shdr[symtab->sh_link].sh_offset;
+  n = (size_t)(symtab->sh_size / sizeof(*sym));
+  st->usyms = calloc(n, sizeof(*st->usyms));
+  
+  if (!st->usyms)
+  {
+    return;
+  }
+  
+  for (i = 0; i < n; i++)
+  {
+    if ((STRESS_ELF_ST_TYPE(sym[i].st_info) != STT_FUNC) || !sym[i].st_value ||
+        (sym[i].st_name >= shdr[symtab->sh_link].sh_size))
+    {
+      continue;
+    }
+    
+    st->usyms[st->n_usyms].addr = (uintptr_t)sym[i].st_value + bias;
+    st->usyms[st->n_usyms].size = (uintptr_t)sym[i].st_size;
+    st->usyms[st->n_usyms].name = strtab + sym[i].st_name;
+    st->n_usyms++;
+  }
+  
+  if (st->n_usyms)
+  {
+    qsort(st->usyms, st->n_usyms, sizeof(*st->usyms), stress_perf_sym_cmp);
+  }
+}
+#else
+static void stress_perf_symtab_exe(stress_perf_symtab_t *st, const uintptr_t exe_begin)
+{
+  (void)st;
+  (void)exe_begin;
+}
+#endif
+
+/*
+ *  stress_perf_symtab_load()
+ *  load the symbol tables used to resolve sampled IPs
+ */
+static void stress_perf_symtab_load(stress_perf_symtab_t *st)
+{
+  char exe[PATH_MAX];
+  ssize_t len;
+  uintptr_t exe_begin;
+  
+  (void)memset(st, 0, sizeof(*st));
+  len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+  
+  if (len > 0)
+  {
+    exe[len] = '\0';
+  }
+  
+  stress_perf_symtab_kernel(st);
+  stress_perf_symtab_maps(st, (len > 0) ? exe : NULL, &exe_begin);
+  stress_perf_symtab_exe(st, exe_begin);
+}
+
+/*
+ *  stress_perf_symtab_free()
+ *  free the symbol tables
+ */
+static void stress_perf_symtab_free(stress_perf_symtab_t *st)
+{
+  size_t i;
+  
+  for (i = 0; i < st->n_ksyms; i++)
+  {
+    free(st->knames[i]);
+  }
+  
+  for (i = 0; i < st->n_maps; i++)
+  {
+    free(st->maps[i].name);
+  }
+  
+  free(st->knames);
+  free(st->ksyms);
+  free(st->usyms);
+  free(st->maps);
+  
+  if (st->exe)
+  {
+    (void)munmap(st->exe, st->exe_size);
+  }
+  
+  (void)memset(st, 0, sizeof(*st));
+}
+
+/*
+ *  stress_perf_resolve()
+ *  resolve a sampled IP to a symbol and the object it is in
+ */
+static void stress_perf_resolve(
+  const stress_perf_symtab_t *st,
+  const stress_perf_ip_t *pip,
+  stress_perf_hot_t *hot)
+{
+  const uintptr_t ip = (uintptr_t)pip->ip;
+  const stress_perf_sym_t *sym;
+  size_t i;
+  
+  hot->name = NULL;
+  hot->module = "unknown";
+  hot->count = pip->count;
+  
+  if (pip->kernel)
+  {
+    sym = stress_perf_sym_find(st->ksyms, st->n_ksyms, ip);
+    hot->name = sym ? sym->name : NULL;
+    hot->module = "kernel";
+    return;
+  }
+  
+  for (i = 0; i < st->n_maps; i++)
+  {
+    if ((ip >= st->maps[i].begin) && (ip < st->maps[i].end))
+    {
+      hot->module = st->maps[i].name;
+      
+      /* only stress-ng symbols are loaded */
+      if (st->maps[i].exe)
+      {
+        sym = stress_perf_sym_find(st->usyms, st->n_usyms, ip);
+        hot->name = sym ? sym->name : NULL;
+      }
+      
+      break;
+    }
+  }
+}
+
+/*
+ *  stress_perf_hot_sym_cmp()
+ *  sort sampled symbols so the same symbols are adjacent
+ */
+static int stress_perf_hot_sym_cmp(const void *p1, const void *p2)
+{
+  const stress_perf_hot_t *h1 = (const stress_perf_hot_t *)p1;
+  const stress_perf_hot_t *h2 = (const stress_perf_hot_t *)p2;
+  
+  if (h1->module != h2->module)
+  {
+    return ((uintptr_t)h1->module < (uintptr_t)h2->module) ? -1 : 1;
+  }
+  
+  if (h1->name != h2->name)
+  {
+    return ((uintptr_t)h1->name < (uintptr_t)h2->name) ? -1 : 1;
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_perf_hot_count_cmp()
+ *  sort sampled symbols, hottest first
+ */
+static int stress_perf_hot_count_cmp(const void *p1, const void *p2)
+{
+  const stress_perf_hot_t *h1 = (const stress_perf_hot_t *)p1;
+  const stress_perf_hot_t *h2 = (const stress_perf_hot_t *)p2;
+  
+  if (h1->count > h2->count)
+  {
+    return -1;
+  }
+  
+  return h1->count < h2->count;
+}
+
+/*
+ *  stress_perf_sample_dump()
+ *  report the hottest symbols of each stressor
+ */
+void stress_perf_sample_dump(FILE *yaml)
+{
+  stress_perf_symtab_t st;
+  stress_perf_hot_t *hot;
+  bool header = false;
+  size_t i;
+  
+  if (!perf_sampled)
+  {
+    return;
+  }
+  
+  hot = calloc(STRESS_PERF_SAMPLE_IPS + 1, sizeof(*hot));
+  
+  if (!hot)
+  {
+    pr_err("cannot allocate perf sample symbols\n");
+    return;
+  }
+  
+  stress_perf_symtab_load(&st);
+  
+  for (i = 0; i < n_perf_sampled; i++)
+  {
+    const stress_perf_sampled_t *ps = &perf_sampled[i];
+    size_t j, n = 0, n_hot;
+    char *munged;
+    
+    if (!ps->samples)
+    {
+      continue;
+    }
+    
+    for (j = 0; j < STRESS_PERF_SAMPLE_IPS; j++)
+    {
+      if (ps->ips[j].count)
+      {
+        stress_perf_resolve(&st, &ps->ips[j], &hot[n++]);
+      }
+    }
+    
+    /* merge IPs in the same symbol */
+    qsort(hot, n, sizeof(*hot), stress_perf_hot_sym_cmp);
+    
+    for (n_hot = 0, j = 0; j < n; j++)
+    {
+      if (n_hot && !stress_perf_hot_sym_cmp(&hot[n_hot - 1], &hot[j]))
+      {
+        hot[n_hot - 1].count += hot[j].count;
+      }
+      else
+      {
+        hot[n_hot++] = hot[j];
+      }
+    }
+    
+    if (ps->other)
+    {
+      hot[n_hot].name = NULL;
+      hot[n_hot].module = "other";
+      hot[n_hot].count = ps->other;
+      n_hot++;
+    }
+    
+    qsort(hot, n_hot, sizeof(*hot), stress_perf_hot_count_cmp);
+    
+    if (n_hot > (size_t)perf_sample_top)
+    {
+      n_hot = (size_t)perf_sample_top;
+    }
+    
+    if (!header)
+    {
+      pr_yaml(yaml, "perfsamples:\n");
+      header = true;
+    }
+    
+    munged = stress_munge_underscore(ps->ss->stressor->name);
+    pr_inf("%s: %" PRIu64 " %s samples, %" PRIu64 " lost, top %zu symbols:\n",
+           munged, ps->samples, perf_sample_event_name, ps->lost, n_hot);
+    pr_yaml(yaml, "    - stressor: %s\n", munged);
+    pr_yaml(yaml, "      event: %s\n", perf_sample_event_name);
+    pr_yaml(yaml, "      samples: %" PRIu64 "\n", ps->samples);
+    pr_yaml(yaml, "      lost: %" PRIu64 "\n", ps->lost);
+    pr_yaml(yaml, "      top-symbols:\n");
+    
+    for (j = 0; j < n_hot; j++)
+    {
+      const double percent = 100.0 * (double)hot[j].count / (double)ps->samples;
+      
+      pr_inf("%8.2f%% %-40s [%s]\n", percent,
+             hot[j].name ? hot[j].name : "?", hot[j].module);
+      pr_yaml(yaml, "        - symbol: %s\n", hot[j].name ? hot[j].name : "'?'");
+      pr_yaml(yaml, "          module: %s\n", hot[j].module);
+      pr_yaml(yaml, "          percent: %.2f\n", percent);
+    }
+    
+    pr_yaml(yaml, "\n");
+  }
+  
+  stress_perf_symtab_free(&st);
+  free(hot);
+}
+
+/*
+ *  stress_perf_sample_free()
+ *  free the per stressor sampling state
+ */
+void stress_perf_sample_free(void)
+{
+  size_t i;
+  
+  if (!perf_sampled)
+  {
+    return;
+  }
+  
+  stress_perf_sample_detach();
+  
+  for (i = 0; i < n_perf_sampled; i++)
+  {
+    free(perf_sampled[i].rings);
+    free(perf_sampled[i].ips);
+  }
+  
+  free(perf_sampled);
+  perf_sampled = NULL;
+  n_perf_sampled = 0;
+}
+#else
+bool stress_perf_sample_enabled(void)
+{
+  return false;
+}
+
+int stress_perf_sample_init(stress_stressor_t *stressors_list)
+{
+  uint32_t perf_sample = 0;
+  
+  (void)stressors_list;
+  (void)stress_get_setting("perf-sample", &perf_sample);
+  
+  if (perf_sample)
+  {
+    pr_inf("perf-sample: perf sampling is not available on this system\n");
+  }
+  
+  return 0;
+}
+
+void stress_perf_sample_attach(const stress_stressor_t *ss, const int32_t instance, const pid_t pid)
+{
+  (void)ss;
+  (void)instance;
+  (void)pid;
+}
+
+void stress_perf_sample_poll(void)
+{
+}
+
+void stress_perf_sample_detach(void)
+{
+}
+
+void stress_perf_sample_dump(FILE *yaml)
+{
+  (void)yaml;
+}
+
+void stress_perf_sample_free(void)
+{
+}
+#endif
@@ -47,9 +47,19 @@ typedef struct
   unsigned long config; /* perf type specific config */
   const char *path;   /* perf trace point path (only for trace points) */
   const char *label;    /* human readable name for perf type */
+  const bool grouped;   /* true = in same group as previous event */
 } stress_perf_info_t;
 
-/* perf data */
+/* perf group read data, PERF_FORMAT_GROUP read format */
+typedef struct
+{
+  uint64_t nr;      /* number of counters in group */
+  uint64_t time_enabled;    /* perf time enabled */
+  uint64_t time_running;    /* perf time running */
+  uint64_t counter[STRESS_PERF_MAX];  /* counters, leader first */
+} stress_perf_group_data_t;
+
+/* perf data, single counter read format */
 typedef struct
 {
   uint64_t counter;   /* perf counter */
@@ -57,6 +67,17 @@ typedef struct
   uint64_t time_running;    /* perf time running */
 } stress_perf_data_t;
 
+/* metrics derived from the perf counters */
+typedef struct
+{
+  const char *label;    /* human readable name */
+  const char *yaml_label;   /* yaml name */
+  const char *numerator[2]; /* counters summed, NULL = bogo ops */
+  const char *denominator;  /* counter to divide by */
+  const double scale;   /* scaling of the ratio */
+  const char *units;    /* units of the metric */
+} stress_perf_derived_t;
+
 typedef struct
 {
   const double  threshold;
@@ -66,23 +87,33 @@ typedef struct
 
 /* Tracepoint */
 #define PERF_INFO_TP(path, label) \
-  { PERF_TYPE_TRACEPOINT, UNRESOLVED, path, label }
+  { PERF_TYPE_TRACEPOINT, UNRESOLVED, path, label, false }
 
 /* Hardware */
 #define PERF_INFO_HW(config, label) \
-  { PERF_TYPE_HARDWARE, PERF_COUNT_ ## config, NULL, label }
+  { PERF_TYPE_HARDWARE, PERF_COUNT_ ## config, NULL, label, false }
+
+/* Hardware, grouped with the previous event */
+#define PERF_INFO_HW_G(config, label) \
+  { PERF_TYPE_HARDWARE, PERF_COUNT_ ## config, NULL, label, true }
 
 /* Software */
 #define PERF_INFO_SW(config, label) \
-  { PERF_TYPE_SOFTWARE, PERF_COUNT_ ## config, NULL, label }
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_ ## config, NULL, label, false }
+
+/* Software, grouped with the previous event */
+#define PERF_INFO_SW_G(config, label) \
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_ ## config, NULL, label, true }
 
-/* Hardware Cache */
+/* Hardware Cache, misses are grouped with their accesses */
 #define PERF_INFO_HW_C(cache_id, op_id, result_id, label) \
   { PERF_TYPE_HW_CACHE,           \
     (PERF_COUNT_HW_CACHE_ ## cache_id) |      \
     ((PERF_COUNT_HW_CACHE_OP_ ## op_id) << 8) |   \
     ((PERF_COUNT_HW_CACHE_RESULT_ ## result_id) << 16), \
-    NULL, label }
+    NULL, label,            \
+    (PERF_COUNT_HW_CACHE_RESULT_ ## result_id) ==   \
+    PERF_COUNT_HW_CACHE_RESULT_MISS }
 
 #define STRESS_PERF_DEFINED(x) _SNG_PERF_COUNT_ ## x
 
@@ -114,32 +145,32 @@ static stress_perf_info_t perf_info[STRESS_PERF_MAX] =
   PERF_INFO_HW(HW_CPU_CYCLES,   "CPU Cycles"),
 #endif
 #if STRESS_PERF_DEFINED(HW_INSTRUCTIONS)
-  PERF_INFO_HW(HW_INSTRUCTIONS,   "Instructions"),
+  PERF_INFO_HW_G(HW_INSTRUCTIONS,   "Instructions"),
 #endif
 #if STRESS_PERF_DEFINED(HW_BRANCH_INSTRUCTIONS)
   PERF_INFO_HW(HW_BRANCH_INSTRUCTIONS,  "Branch Instructions"),
 #endif
 #if STRESS_PERF_DEFINED(HW_BRANCH_MISSES)
-  PERF_INFO_HW(HW_BRANCH_MISSES,    "Branch Misses"),
+  PERF_INFO_HW_G(HW_BRANCH_MISSES,    "Branch Misses"),
 #endif
 #if STRESS_PERF_DEFINED(HW_STALLED_CYCLES_FRONTEND)
   PERF_INFO_HW(HW_STALLED_CYCLES_FRONTEND, "Stalled Cycles Frontend"),
 #endif
 #if STRESS_PERF_DEFINED(HW_STALLED_CYCLES_BACKEND)
-  PERF_INFO_HW(HW_STALLED_CYCLES_BACKEND, "Stalled Cycles Backend"),
+  PERF_INFO_HW_G(HW_STALLED_CYCLES_BACKEND, "Stalled Cycles Backend"),
 #endif
 #if STRESS_PERF_DEFINED(HW_BUS_CYCLES)
   PERF_INFO_HW(HW_BUS_CYCLES,   "Bus Cycles"),
 #endif
 #if STRESS_PERF_DEFINED(HW_REF_CPU_CYCLES)
-  PERF_INFO_HW(HW_REF_CPU_CYCLES,   "Total Cycles"),
+  PERF_INFO_HW_G(HW_REF_CPU_CYCLES,   "Total Cycles"),
 #endif
   
 #if STRESS_PERF_DEFINED(HW_CACHE_REFERENCES)
   PERF_INFO_HW(HW_CACHE_REFERENCES, "Cache References"),
 #endif
 #if STRESS_PERF_DEFINED(HW_CACHE_MISSES)
-  PERF_INFO_HW(HW_CACHE_MISSES,   "Cache Misses"),
+  PERF_INFO_HW_G(HW_CACHE_MISSES,   "Cache Misses"),
 #endif
   
   /*
@@ -215,28 +246,28 @@ static stress_perf_info_t perf_info[STRESS_PERF_MAX] =
   PERF_INFO_SW(SW_CPU_CLOCK,    "CPU Clock"),
 #endif
 #if STRESS_PERF_DEFINED(SW_TASK_CLOCK)
-  PERF_INFO_SW(SW_TASK_CLOCK,   "Task Clock"),
+  PERF_INFO_SW_G(SW_TASK_CLOCK,   "Task Clock"),
 #endif
 #if STRESS_PERF_DEFINED(SW_PAGE_FAULTS)
-  PERF_INFO_SW(SW_PAGE_FAULTS,    "Page Faults Total"),
+  PERF_INFO_SW_G(SW_PAGE_FAULTS,    "Page Faults Total"),
 #endif
 #if STRESS_PERF_DEFINED(SW_PAGE_FAULTS_MIN)
-  PERF_INFO_SW(SW_PAGE_FAULTS_MIN,  "Page Faults Minor"),
+  PERF_INFO_SW_G(SW_PAGE_FAULTS_MIN,  "Page Faults Minor"),
 #endif
 #if STRESS_PERF_DEFINED(SW_PAGE_FAULTS_MAJ)
-  PERF_INFO_SW(SW_PAGE_FAULTS_MAJ,  "Page Faults Major"),
+  PERF_INFO_SW_G(SW_PAGE_FAULTS_MAJ,  "Page Faults Major"),
 #endif
 #if STRESS_PERF_DEFINED(SW_CONTEXT_SWITCHES)
-  PERF_INFO_SW(SW_CONTEXT_SWITCHES, "Context Switches"),
+  PERF_INFO_SW_G(SW_CONTEXT_SWITCHES, "Context Switches"),
 #endif
 #if STRESS_PERF_DEFINED(SW_CPU_MIGRATIONS)
-  PERF_INFO_SW(SW_CPU_MIGRATIONS, "CPU Migrations"),
+  PERF_INFO_SW_G(SW_CPU_MIGRATIONS, "CPU Migrations"),
 #endif
 #if STRESS_PERF_DEFINED(SW_ALIGNMENT_FAULTS)
-  PERF_INFO_SW(SW_ALIGNMENT_FAULTS, "Alignment Faults"),
+  PERF_INFO_SW_G(SW_ALIGNMENT_FAULTS, "Alignment Faults"),
 #endif
 #if STRESS_PERF_DEFINED(SW_EMULATION_FAULTS)
-  PERF_INFO_SW(SW_EMULATION_FAULTS, "Emulation Faults"),
+  PERF_INFO_SW_G(SW_EMULATION_FAULTS, "Emulation Faults"),
 #endif
   
   /*
@@ -299,7 +330,27 @@ static stress_perf_info_t perf_info[STRESS_PERF_MAX] =
   
   PERF_INFO_TP("thermal/thermal_zone_trip", "Thermal Zone Trip"),
   
-  { 0, 0, NULL, NULL }
+  { 0, 0, NULL, NULL, false }
+};
+
+/*
+ *  Metrics derived from the perf counter totals of a stressor,
+ *  these are only reported if all the counters are available
+ */
+static const stress_perf_derived_t perf_derived[] =
+{
+  { "IPC",      "ipc",
+    { "Instructions", NULL }, "CPU Cycles",   1.0,  "instr. per cycle" },
+  { "Cache Miss Rate",    "cache_miss_rate",
+    { "Cache Misses", NULL }, "Cache References", 100.0,  "%" },
+  { "LLC Miss Rate",    "llc_miss_rate",
+    { "Cache LL Read Miss", NULL }, "Cache LL Read",  100.0,  "%" },
+  { "Branch Miss Rate",   "branch_miss_rate",
+    { "Branch Misses", NULL },  "Branch Instructions",  100.0,  "%" },
+  { "DTLB MPKI",      "dtlb_mpki",
+    { "Cache DTLB Read Miss", "Cache DTLB Write Miss" }, "Instructions", 1000.0, "misses per 1000 instr." },
+  { "Bogo Ops per Kilo-Instr",  "bogo_ops_per_kilo_instruction",
+    { NULL, NULL },   "Instructions",   1000.0, "bogo ops per 1000 instr." },
 };
 
 static inline void stress_perf_type_tracepoint_resolve_config(stress_perf_info_t *pi)
@@ -399,13 +450,42 @@ static char *stress_perf_yaml_label(char *dst, const char *src, const size_t n)
   return dst;
 }
 
+/*
+ *  stress_perf_event_open()
+ *  open a perf event for the calling process and its children,
+ *  in the group of group_fd or as a new group leader if
+ *  group_fd is -1
+ */
+static int stress_perf_event_open(
+  const stress_perf_info_t *pi,
+  const uint64_t read_format,
+  const int group_fd)
+{
+  struct perf_event_attr attr;
+  
+  (void)memset(&attr, 0, sizeof(attr));
+  attr.type = pi->type;
+  attr.config = pi->config;
+  attr.disabled = (group_fd < 0);
+  attr.inherit = 1;
+  attr.read_format = read_format;
+  attr.size = sizeof(attr);
+  return stress_sys_perf_event_open(&attr, 0, -1, group_fd, 0);
+}
+
 /*
  *  stress_perf_open()
- *  open perf, get leader and perf fd's
+ *  open perf, get leader and perf fd's. Related counters are
+ *  opened as a group so they are scheduled onto the PMU and
+ *  read together; if grouping is refused the counter is
+ *  opened on its own.
  */
 int stress_perf_open(stress_perf_t *sp)
 {
   size_t i;
+  int leader = -1;
+  const uint64_t read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
   
   if (!sp)
   {
@@ -423,30 +503,59 @@ int stress_perf_open(stress_perf_t *sp)
   for (i = 0; i < STRESS_PERF_MAX; i++)
   {
     sp->perf_stat[i].fd = -1;
+    sp->perf_stat[i].leader = -1;
     sp->perf_stat[i].counter = 0;
   }
   
   for (i = 0; i < STRESS_PERF_MAX && perf_info[i].label; i++)
   {
-    if (perf_info[i].config != UNRESOLVED)
-    {
-      struct perf_event_attr attr;
-      (void)memset(&attr, 0, sizeof(attr));
-      attr.type = perf_info[i].type;
-      attr.config = perf_info[i].config;
-      attr.disabled = 1;
-      attr.inherit = 1;
-      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
-                         PERF_FORMAT_TOTAL_TIME_RUNNING;
-      attr.size = sizeof(attr);
-      sp->perf_stat[i].fd =
-        stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+    int fd = -1;
+    
+    if (!perf_info[i].grouped)
+    {
+      leader = -1;
+    }
         
-      if (sp->perf_stat[i].fd > -1)
+    if (perf_info[i].config == UNRESOLVED)
+    {
+      continue;
+    }
+    
+    if (leader >= 0)
+    {
+      fd = stress_perf_event_open(&perf_info[i], read_format | PERF_FORMAT_GROUP,
+                                  sp->perf_stat[leader].fd);
+                                  
+      if (fd > -1)
       {
-        sp->perf_opened++;
+        sp->perf_stat[i].leader = leader;
       }
     }
+    
+    if (fd < 0)
+    {
+      fd = stress_perf_event_open(&perf_info[i], read_format | PERF_FORMAT_GROUP, -1);
+      
+      if (fd > -1)
+      {
+        leader = (int)i;
+        sp->perf_stat[i].leader = leader;
+      }
+    }
+    
+    /* Older kernels do not allow group reads of inherited counters */
+    if (fd < 0)
+    {
+      fd = stress_perf_event_open(&perf_info[i], read_format, -1);
+      leader = -1;
+    }
+    
+    sp->perf_stat[i].fd = fd;
+    
+    if (fd > -1)
+    {
+      sp->perf_opened++;
+    }
   }
   
   if (!sp->perf_opened)
@@ -483,9 +592,21 @@ int stress_perf_open(stress_perf_t *sp)
   return 0;
 }
 
+/*
+ *  stress_perf_is_member()
+ *  true if counter i is a group member rather than a
+ *  group leader or a counter on its own
+ */
+static inline bool stress_perf_is_member(const stress_perf_t *sp, const size_t i)
+{
+  const int leader = sp->perf_stat[i].leader;
+  
+  return (leader > -1) && ((size_t)leader != i);
+}
+
 /*
  *  stress_perf_enable()
- *  enable perf counters
+ *  enable perf counters, a group is enabled via its leader
  */
 int stress_perf_enable(stress_perf_t *sp)
 {
@@ -505,7 +626,7 @@ int stress_perf_enable(stress_perf_t *sp)
   {
     int fd = sp->perf_stat[i].fd;
     
-    if (fd > -1)
+    if ((fd > -1) && !stress_perf_is_member(sp, i))
     {
       if (ioctl(fd, PERF_EVENT_IOC_RESET,
                 PERF_IOC_FLAG_GROUP) < 0)
@@ -529,7 +650,7 @@ int stress_perf_enable(stress_perf_t *sp)
 
 /*
  *  stress_perf_disable()
- *  disable perf counters
+ *  disable perf counters, a group is disabled via its leader
  */
 int stress_perf_disable(stress_perf_t *sp)
 {
@@ -549,7 +670,7 @@ int stress_perf_disable(stress_perf_t *sp)
   {
     int fd = sp->perf_stat[i].fd;
     
-    if (fd > -1)
+    if ((fd > -1) && !stress_perf_is_member(sp, i))
     {
       if (ioctl(fd, PERF_EVENT_IOC_DISABLE,
                 PERF_IOC_FLAG_GROUP) < 0)
@@ -563,70 +684,136 @@ int stress_perf_disable(stress_perf_t *sp)
   return 0;
 }
 
+/*
+ *  stress_perf_scale()
+ *  scale a counter to cover the whole time it was enabled
+ *  when it has been multiplexed with other counters
+ */
+static uint64_t stress_perf_scale(
+  const uint64_t counter,
+  const uint64_t time_enabled,
+  const uint64_t time_running)
+{
+  double scale;
+  
+  /* Ensure we don't get division by zero */
+  if (time_running == 0)
+  {
+    scale = (time_enabled == 0) ? 1.0 : 0.0;
+  }
+  else
+  {
+    scale = (double)time_enabled / (double)time_running;
+  }
+  
+  return (uint64_t)((double)counter * scale);
+}
+
+/*
+ *  stress_perf_read_group()
+ *  read all the counters of the group led by counter i
+ *  in one go, the counters are in the order they were
+ *  added to the group, leader first
+ */
+static void stress_perf_read_group(stress_perf_t *sp, const size_t i)
+{
+  stress_perf_group_data_t data;
+  ssize_t ret;
+  size_t j, n = 0;
+  
+  (void)memset(&data, 0, sizeof(data));
+  ret = read(sp->perf_stat[i].fd, &data, sizeof(data));
+  
+  if (ret < (ssize_t)(3 * sizeof(uint64_t)))
+  {
+    return;
+  }
+  
+  for (j = i; j < STRESS_PERF_MAX && perf_info[j].label; j++)
+  {
+    if ((sp->perf_stat[j].leader != (int)i) || (sp->perf_stat[j].fd < 0))
+    {
+      continue;
+    }
+    
+    if ((n >= data.nr) ||
+        ((ssize_t)((3 + n + 1) * sizeof(uint64_t)) > ret))
+    {
+      break;
+    }
+    
+    sp->perf_stat[j].counter = stress_perf_scale(data.counter[n],
+                               data.time_enabled, data.time_running);
+    n++;
+  }
+}
+
+/*
+ *  stress_perf_read()
+ *  read a counter that is not in a group
+ */
+static void stress_perf_read(stress_perf_t *sp, const size_t i)
+{
+  stress_perf_data_t data;
+  ssize_t ret;
+  
+  (void)memset(&data, 0, sizeof(data));
+  ret = read(sp->perf_stat[i].fd, &data, sizeof(data));
+  
+  if (ret == sizeof(data))
+  {
+    sp->perf_stat[i].counter = stress_perf_scale(data.counter,
+                               data.time_enabled, data.time_running);
+  }
+}
+
 /*
  *  stress_perf_close()
  *  read counters and close
  */
 int stress_perf_close(stress_perf_t *sp)
 {
-  size_t i = 0;
-  stress_perf_data_t data;
-  ssize_t ret;
-  double scale;
+  size_t i;
   
   if (!sp)
   {
     return -1;
   }
   
+  for (i = 0; i < STRESS_PERF_MAX; i++)
+  {
+    sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+  }
+  
   if (!sp->perf_opened)
   {
-    goto out_ok;
+    return 0;
   }
   
   for (i = 0; i < STRESS_PERF_MAX && perf_info[i].label; i++)
   {
-    int fd = sp->perf_stat[i].fd;
-    
-    if (fd < 0)
+    if (sp->perf_stat[i].fd < 0)
     {
-      sp->perf_stat[i].counter = STRESS_PERF_INVALID;
       continue;
     }
     
-    (void)memset(&data, 0, sizeof(data));
-    ret = read(fd, &data, sizeof(data));
-    
-    if (ret != sizeof(data))
+    if (sp->perf_stat[i].leader == (int)i)
     {
-      sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+      stress_perf_read_group(sp, i);
     }
-    else
+    else if (sp->perf_stat[i].leader < 0)
     {
-      /* Ensure we don't get division by zero */
-      if (data.time_running == 0)
-      {
-        scale = (data.time_enabled == 0) ? 1.0 : 0.0;
-      }
-      else
-      {
-        scale = (double)data.time_enabled /
-                (double)data.time_running;
-      }
-      
-      sp->perf_stat[i].counter = (uint64_t)
-                                 ((double)data.counter * scale);
+      stress_perf_read(sp, i);
     }
-    
-    (void)close(fd);
-    sp->perf_stat[i].fd = -1;
   }
   
-out_ok:
-
-  for (; i < STRESS_PERF_MAX; i++)
+  for (i = 0; i < STRESS_PERF_MAX && perf_info[i].label; i++)
   {
-    sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+    if (sp->perf_stat[i].fd > -1)
+    {
+      (void)close(sp->perf_stat[i].fd);
+      sp->perf_stat[i].fd = -1;
+    }
   }
   
   return 0;
@@ -671,6 +858,210 @@ static const char *stress_perf_stat_scale(const uint64_t counter, const double d
   return buffer;
 }
 
+/*
+ *  stress_perf_stat_total()
+ *  sum perf counter p across all the instances of a stressor and
+ *  get its yaml style label, total is STRESS_PERF_INVALID if the
+ *  counter is not available. Returns false if p is past the last
+ *  perf counter.
+ */
+bool stress_perf_stat_total(
+  const stress_stressor_t *ss,
+  const int p,
+  char *label,
+  const size_t label_len,
+  uint64_t *total)
+{
+  int32_t j;
+  
+  if ((p < 0) || (p >= STRESS_PERF_MAX) || !perf_info[p].label)
+  {
+    return false;
+  }
+  
+  (void)memset(label, 0, label_len);
+  (void)stress_perf_yaml_label(label, perf_info[p].label, label_len);
+  *total = 0;
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    const stress_perf_t *sp = &ss->stats[j]->sp;
+    uint64_t counter;
+    
+    if (!stress_perf_stat_succeeded(sp))
+    {
+      continue;
+    }
+    
+    counter = sp->perf_stat[p].counter;
+    
+    if (counter == STRESS_PERF_INVALID)
+    {
+      *total = STRESS_PERF_INVALID;
+      break;
+    }
+    
+    *total += counter;
+  }
+  
+  return true;
+}
+
+/*
+ *  stress_perf_total_by_label()
+ *  find the total of a named perf counter, returns
+ *  false if the counter is not available
+ */
+static bool stress_perf_total_by_label(
+  const uint64_t *counter_totals,
+  const char *label,
+  double *total)
+{
+  int p;
+  
+  for (p = 0; p < STRESS_PERF_MAX && perf_info[p].label; p++)
+  {
+    if (!strcmp(perf_info[p].label, label))
+    {
+      if (counter_totals[p] == STRESS_PERF_INVALID)
+      {
+        return false;
+      }
+      
+      *total = (double)counter_totals[p];
+      return true;
+    }
+  }
+  
+  return false;
+}
+
+/*
+ *  stress_perf_bogo_ops_measured()
+ *  sum the bogo ops and a named perf counter of the instances
+ *  of a stressor over the same period, any --warmup period is
+ *  excluded. The counter during warm-up is not known, so like
+ *  the CPU times it is scaled by the measured fraction of the
+ *  instance run time. Returns false if the counter is not
+ *  available
+ */
+static bool stress_perf_bogo_ops_measured(
+  const stress_stressor_t *ss,
+  const char *label,
+  double *bogo_ops,
+  double *total)
+{
+  int p;
+  int32_t j;
+  
+  for (p = 0; p < STRESS_PERF_MAX && perf_info[p].label; p++)
+  {
+    if (!strcmp(perf_info[p].label, label))
+    {
+      break;
+    }
+  }
+  
+  if ((p >= STRESS_PERF_MAX) || !perf_info[p].label)
+  {
+    return false;
+  }
+  
+  *bogo_ops = 0.0;
+  *total = 0.0;
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    const stress_stats_t *stats = ss->stats[j];
+    const uint64_t counter = stats->sp.perf_stat[p].counter;
+    
+    if (!stress_perf_stat_succeeded(&stats->sp) ||
+        stress_converge_in_warmup(stats))
+    {
+      continue;
+    }
+    
+    if (counter == STRESS_PERF_INVALID)
+    {
+      return false;
+    }
+    
+    if ((stats->warmup_time > 0.0) && (stats->finish > stats->start))
+    {
+      const double run = stats->finish - stats->start;
+      const double measured = (stats->finish > stats->warmup_time) ?
+                              stats->finish - stats->warmup_time : 0.0;
+      
+      *bogo_ops += (double)(stats->ci.counter - stats->warmup_counter);
+      *total += (double)counter * measured / run;
+    }
+    else
+    {
+      *bogo_ops += (double)stats->ci.counter;
+      *total += (double)counter;
+    }
+  }
+  
+  return true;
+}
+
+/*
+ *  stress_perf_derived_dump()
+ *  dump the metrics derived from the perf counter
+ *  totals of a stressor
+ */
+static void stress_perf_derived_dump(
+  FILE *yaml,
+  const stress_stressor_t *ss,
+  const uint64_t *counter_totals)
+{
+  size_t i;
+  
+  for (i = 0; i < SIZEOF_ARRAY(perf_derived); i++)
+  {
+    const stress_perf_derived_t *d = &perf_derived[i];
+    double numerator = 0.0, denominator, value;
+    size_t k;
+    bool ok = true;
+    
+    if (!stress_perf_total_by_label(counter_totals, d->denominator, &denominator) ||
+        (denominator <= 0.0))
+    {
+      continue;
+    }
+    
+    /* bogo ops only cover the time after any warm-up */
+    if (!d->numerator[0] &&
+        (!stress_perf_bogo_ops_measured(ss, d->denominator, &numerator, &denominator) ||
+         (denominator <= 0.0)))
+    {
+      continue;
+    }
+    
+    for (k = 0; k < SIZEOF_ARRAY(d->numerator) && d->numerator[k]; k++)
+    {
+      double total;
+      
+      if (!stress_perf_total_by_label(counter_totals, d->numerator[k], &total))
+      {
+        ok = false;
+        break;
+      }
+      
+      numerator += total;
+    }
+    
+    if (!ok)
+    {
+      continue;
+    }
+    
+    value = d->scale * numerator / denominator;
+    pr_inf("%26.3f %-24s (%s)\n", value, d->label, d->units);
+    pr_yaml(yaml, "      %s: %f\n", d->yaml_label, value);
+  }
+}
+
 void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const double duration)
 {
   bool no_perf_stats = true;
@@ -684,54 +1075,17 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
   {
     int p;
     uint64_t counter_totals[STRESS_PERF_MAX];
-    uint64_t total_cpu_cycles = 0;
-    uint64_t total_cache_refs = 0;
-    uint64_t total_branches = 0;
+    char yaml_labels[STRESS_PERF_MAX][128];
     bool got_data = false;
     char *munged;
-    (void)memset(counter_totals, 0, sizeof(counter_totals));
     
     /* Sum totals across all instances of the stressor */
-    for (p = 0; p < STRESS_PERF_MAX && perf_info[p].label; p++)
+    for (p = 0; stress_perf_stat_total(ss, p, yaml_labels[p],
+                                       sizeof(yaml_labels[p]), &counter_totals[p]); p++)
     {
-      int32_t j;
-      stress_perf_t *sp = &ss->stats[0]->sp;
-      
-      if (!stress_perf_stat_succeeded(sp))
+      if (counter_totals[p] != STRESS_PERF_INVALID)
       {
-        continue;
-      }
-      
-      for (j = 0; j < ss->started_instances; j++)
-      {
-        const uint64_t counter = sp->perf_stat[p].counter;
-        
-        if (counter == STRESS_PERF_INVALID)
-        {
-          counter_totals[p] = STRESS_PERF_INVALID;
-          break;
-        }
-        
-        counter_totals[p] += counter;
-        got_data |= (counter > 0);
-      }
-      
-      if (perf_info[p].type == PERF_TYPE_HARDWARE)
-      {
-        unsigned long config = perf_info[p].config;
-        
-        if (config == PERF_COUNT_HW_CPU_CYCLES)
-        {
-          total_cpu_cycles = counter_totals[p];
-        }
-        else if (config == PERF_COUNT_HW_CACHE_REFERENCES)
-        {
-          total_cache_refs = counter_totals[p];
-        }
-        else if (config == PERF_COUNT_HW_BRANCH_INSTRUCTIONS)
-        {
-          total_branches = counter_totals[p];
-        }
+        got_data |= (counter_totals[p] > 0);
       }
     }
     
@@ -750,46 +1104,19 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
       const char *l = perf_info[p].label;
       uint64_t ct = counter_totals[p];
       
-      if (l && (ct != STRESS_PERF_INVALID))
+      if (ct != STRESS_PERF_INVALID)
       {
-        char extra[32];
-        char yaml_label[128];
-        *extra = '\0';
         no_perf_stats = false;
-        
-        if (perf_info[p].type == PERF_TYPE_HARDWARE)
-        {
-          unsigned long config = perf_info[p].config;
-          
-          if ((config == PERF_COUNT_HW_INSTRUCTIONS) &&
-              (total_cpu_cycles > 0))
-            (void)snprintf(extra, sizeof(extra),
-                           " (%.3f instr. per cycle)",
-                           (double)ct / (double)total_cpu_cycles);
-          else if ((config == PERF_COUNT_HW_CACHE_MISSES) &&
-                   (total_cache_refs > 0))
-            (void)snprintf(extra, sizeof(extra),
-                           " (%5.2f%%)",
-                           100.0 * (double)ct / (double)total_cache_refs);
-          else if ((config == PERF_COUNT_HW_BRANCH_MISSES) &&
-                   (total_branches > 0))
-            (void)snprintf(extra, sizeof(extra),
-                           " (%5.2f%%)",
-                           100.0 * (double)ct / (double)total_branches);
-        }
-        
-        pr_inf("%'26" PRIu64 " %-24s %s%s\n",
-               ct, l, stress_perf_stat_scale(ct, duration),
-               extra);
-        *yaml_label = '\0';
-        stress_perf_yaml_label(yaml_label, l, sizeof(yaml_label));
+        pr_inf("%'26" PRIu64 " %-24s %s\n",
+               ct, l, stress_perf_stat_scale(ct, duration));
         pr_yaml(yaml, "      %s_total: %" PRIu64
-                "\n", yaml_label, ct);
+                "\n", yaml_labels[p], ct);
         pr_yaml(yaml, "      %s_per_second: %f\n",
-                yaml_label, (double)ct / duration);
+                yaml_labels[p], (double)ct / duration);
       }
     }
     
+    stress_perf_derived_dump(yaml, ss, counter_totals);
     pr_yaml(yaml, "\n");
   }
   
@@ -0,0 +1,556 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define SYS_CPU_PREFIX    "/sys/devices/system/cpu"
+
+typedef enum
+{
+  PLACEMENT_NONE = 0,   /* no placement, default */
+  PLACEMENT_SPREAD,   /* one CPU each, far apart first */
+  PLACEMENT_COMPACT,    /* one CPU each, close together first */
+  PLACEMENT_PER_LLC,    /* CPUs sharing a last level cache */
+  PLACEMENT_PER_CORE,   /* SMT siblings of a core */
+  PLACEMENT_PER_NUMA,   /* CPUs of a NUMA node */
+} stress_placement_policy_t;
+
+typedef struct
+{
+  const char *name;   /* --placement name */
+  const stress_placement_policy_t policy; /* placement policy */
+} stress_placement_info_t;
+
+static const stress_placement_info_t placement_info[] =
+{
+  { "spread",   PLACEMENT_SPREAD },
+  { "compact",    PLACEMENT_COMPACT },
+  { "per-llc",    PLACEMENT_PER_LLC },
+  { "per-core",   PLACEMENT_PER_CORE },
+  { "per-numa",   PLACEMENT_PER_NUMA },
+};
+
+/*
+ *  stress_set_placement()
+ *  set the instance placement policy
+ */
+int stress_set_placement(const char *const opt)
+{
+  size_t i;
+  
+  for (i = 0; i < SIZEOF_ARRAY(placement_info); i++)
+  {
+    if (!strcmp(placement_info[i].name, opt))
+    {
+      const int32_t policy = (int32_t)placement_info[i].policy;
+      
+      return stress_set_setting_global("placement", TYPE_ID_INT32, &policy);
+    }
+  }
+  
+  (void)fprintf(stderr, "placement option '%s' not known, options are:", opt);
+  
+  for (i = 0; i < SIZEOF_ARRAY(placement_info); i++)
+  {
+    (void)fprintf(stderr, " %s", placement_info[i].name);
+  }
+  
+  (void)fprintf(stderr, "\n");
+  return -1;
+}
+
+#if defined(__linux__) && \
+    defined(HAVE_AFFINITY)
+
+/*
+ *  Placement orders the CPUs the stressors may run on by their
+ *  topology and splits them into CPU sets, a single CPU for the
+ *  spread and compact policies or all the CPUs of a core, last
+ *  level cache or NUMA node for the per- policies. Instances are
+ *  assigned CPU sets round-robin in the order they are started,
+ *  so the same command line always gives the same placement.
+ */
+
+/* topology of a CPU */
+typedef struct
+{
+  int32_t cpu;      /* CPU number */
+  int32_t node;     /* NUMA node */
+  int32_t package;    /* physical package id */
+  int32_t die;      /* die id in package */
+  int32_t core;     /* core id in package */
+  int32_t llc;      /* lowest CPU sharing the last level cache */
+  uint32_t spread[4];   /* spread order, SMT, core, LLC, package */
+} stress_placement_cpu_t;
+
+typedef struct
+{
+  stress_placement_policy_t policy; /* placement policy */
+  cpu_set_t *sets;    /* CPU sets, assigned round-robin */
+  size_t n_sets;      /* number of CPU sets */
+} stress_placement_t;
+
+static stress_placement_t placement;
+
+/*
+ *  stress_placement_enabled()
+ *  true if instances are being placed
+ */
+bool stress_placement_enabled(void)
+{
+  return placement.n_sets > 0;
+}
+
+/*
+ *  stress_placement_read_id()
+ *  read a topology id of a CPU, -1 if not available
+ */
+static int32_t stress_placement_read_id(const int32_t cpu, const char *name)
+{
+  char path[PATH_MAX], buf[32];
+  int32_t id;
+  
+  (void)snprintf(path, sizeof(path), SYS_CPU_PREFIX "/cpu%" PRId32 "/topology/%s", cpu, name);
+  
+  if (system_read(path, buf, sizeof(buf) - 1) <= 0)
+  {
+    return -1;
+  }
+  
+  if (sscanf(buf, "%" SCNd32, &id) != 1)
+  {
+    return -1;
+  }
+  
+  return id;
+}
+
+/*
+ *  stress_placement_read_node()
+ *  find the NUMA node of a CPU, 0 if not NUMA
+ */
+static int32_t stress_placement_read_node(const int32_t cpu)
+{
+  char path[PATH_MAX];
+  DIR *dir;
+  struct dirent *d;
+  int32_t node = 0;
+  
+  (void)snprintf(path, sizeof(path), SYS_CPU_PREFIX "/cpu%" PRId32, cpu);
+  dir = opendir(path);
+  
+  if (!dir)
+  {
+    return 0;
+  }
+  
+  while ((d = readdir(dir)) != NULL)
+  {
+    if (!strncmp(d->d_name, "node", 4) &&
+        (sscanf(d->d_name + 4, "%" SCNd32, &node) == 1))
+    {
+      break;
+    }
+  }
+  
+  (void)closedir(dir);
+  return node;
+}
+
+/*
+ *  stress_placement_read_llc()
+ *  find the lowest CPU sharing the last level cache with
+ *  cpu, using the cache index data, -1 if not known
+ */
+static int32_t stress_placement_read_llc(const stress_cpus_t *cpus, const int32_t cpu)
+{
+  uint32_t i, j;
+  
+  if (!cpus)
+  {
+    return -1;
+  }
+  
+  for (i = 0; i < cpus->count; i++)
+  {
+    const stress_cpu_t *c = &cpus->cpus[i];
+    const stress_cpu_cache_t *llc = NULL;
+    
+    if (c->num != (uint32_t)cpu)
+    {
+      continue;
+    }
+    
+    for (j = 0; j < c->cache_count; j++)
+    {
+      const stress_cpu_cache_t *cache = &c->caches[j];
+      
+      if ((cache->type == CACHE_TYPE_INSTRUCTION) || (cache->shared_cpu < 0))
+      {
+        continue;
+      }
+      
+      if (!llc || (cache->level > llc->level))
+      {
+        llc = cache;
+      }
+    }
+    
+    return llc ? llc->shared_cpu : -1;
+  }
+  
+  return -1;
+}
+
+/*
+ *  stress_placement_compact_cmp()
+ *  order CPUs so that CPUs close in the topology are adjacent
+ */
+static int stress_placement_compact_cmp(const void *p1, const void *p2)
+{
+  const stress_placement_cpu_t *c1 = (const stress_placement_cpu_t *)p1;
+  const stress_placement_cpu_t *c2 = (const stress_placement_cpu_t *)p2;
+  
+  if (c1->node != c2->node)
+  {
+    return (c1->node < c2->node) ? -1 : 1;
+  }
+  
+  if (c1->package != c2->package)
+  {
+    return (c1->package < c2->package) ? -1 : 1;
+  }
+  
+  if (c1->die != c2->die)
+  {
+    return (c1->die < c2->die) ? -1 : 1;
+  }
+  
+  if (c1->llc != c2->llc)
+  {
+    return (c1->llc < c2->llc) ? -1 : 1;
+  }
+  
+  if (c1->core != c2->core)
+  {
+    return (c1->core < c2->core) ? -1 : 1;
+  }
+  
+  return (c1->cpu > c2->cpu) - (c1->cpu < c2->cpu);
+}
+
+/*
+ *  stress_placement_spread_cmp()
+ *  order CPUs so that adjacent CPUs are in different packages,
+ *  then different last level caches, then different cores and
+ *  SMT siblings are used last
+ */
+static int stress_placement_spread_cmp(const void *p1, const void *p2)
+{
+  const stress_placement_cpu_t *c1 = (const stress_placement_cpu_t *)p1;
+  const stress_placement_cpu_t *c2 = (const stress_placement_cpu_t *)p2;
+  size_t i;
+  
+  for (i = 0; i < SIZEOF_ARRAY(c1->spread); i++)
+  {
+    if (c1->spread[i] != c2->spread[i])
+    {
+      return (c1->spread[i] < c2->spread[i]) ? -1 : 1;
+    }
+  }
+  
+  return (c1->cpu > c2->cpu) - (c1->cpu < c2->cpu);
+}
+
+/*
+ *  stress_placement_spread_rank()
+ *  rank each CPU in compact order by its SMT sibling, core in
+ *  the LLC, LLC in the package and package number
+ */
+static void stress_placement_spread_rank(stress_placement_cpu_t *cpus, const size_t n)
+{
+  uint32_t pkg = 0, llc = 0, core = 0, smt = 0;
+  size_t i;
+  
+  for (i = 0; i < n; i++)
+  {
+    if (i)
+    {
+      const stress_placement_cpu_t *prev = &cpus[i - 1];
+      
+      if ((cpus[i].node != prev->node) || (cpus[i].package != prev->package))
+      {
+        pkg++;
+        llc = core = smt = 0;
+      }
+      else if ((cpus[i].die != prev->die) || (cpus[i].llc != prev->llc))
+      {
+        llc++;
+        core = smt = 0;
+      }
+      else if (cpus[i].core != prev->core)
+      {
+        core++;
+        smt = 0;
+      }
+      else
+      {
+        smt++;
+      }
+    }
+    
+    cpus[i].spread[0] = smt;
+    cpus[i].spread[1] = core;
+    cpus[i].spread[2] = llc;
+    cpus[i].spread[3] = pkg;
+  }
+}
+
+/*
+ *  stress_placement_same()
+ *  true if CPUs c1 and c2 belong in the same CPU set
+ */
+static bool stress_placement_same(
+  const stress_placement_policy_t policy,
+  const stress_placement_cpu_t *c1,
+  const stress_placement_cpu_t *c2)
+{
+  switch (policy)
+  {
+    case PLACEMENT_PER_LLC:
+      return (c1->llc == c2->llc) && (c1->package == c2->package);
+    
+    case PLACEMENT_PER_CORE:
+      return (c1->core == c2->core) && (c1->die == c2->die) &&
+             (c1->package == c2->package);
+    
+    case PLACEMENT_PER_NUMA:
+      return c1->node == c2->node;
+    
+    default:
+      return c1->cpu == c2->cpu;
+  }
+}
+
+/*
+ *  stress_placement_init()
+ *  read the topology of the CPUs stress-ng may run on and
+ *  split them into CPU sets for the placement policy
+ */
+int stress_placement_init(void)
+{
+  int32_t policy = PLACEMENT_NONE;
+  cpu_set_t mask;
+  stress_placement_cpu_t *cpus, **firsts;
+  stress_cpus_t *cpu_caches;
+  const int32_t max_cpus = stress_get_processors_configured();
+  size_t i, j, n = 0;
+  
+  (void)stress_get_setting("placement", &policy);
+  
+  if (policy == PLACEMENT_NONE)
+  {
+    return 0;
+  }
+  
+  placement.policy = (stress_placement_policy_t)policy;
+  
+  if (sched_getaffinity(0, sizeof(mask), &mask) < 0)
+  {
+    pr_inf("placement: cannot get CPU affinity, errno=%d (%s), "
+           "disabling --placement\n", errno, strerror(errno));
+    return 0;
+  }
+  
+  cpus = calloc((size_t)max_cpus, sizeof(*cpus));
+  firsts = calloc((size_t)max_cpus, sizeof(*firsts));
+  placement.sets = calloc((size_t)max_cpus, sizeof(*placement.sets));
+  
+  if (!cpus || !firsts || !placement.sets)
+  {
+    pr_err("cannot allocate placement CPU sets\n");
+    free(placement.sets);
+    free(firsts);
+    free(cpus);
+    placement.sets = NULL;
+    return -1;
+  }
+  
+  cpu_caches = stress_get_all_cpu_cache_details();
+  
+  /* CPUs that are online and allowed, e.g. by --taskset */
+  for (i = 0; (i < (size_t)max_cpus) && (i < CPU_SETSIZE); i++)
+  {
+    stress_placement_cpu_t *c = &cpus[n];
+    
+    if (!CPU_ISSET((int)i, &mask))
+    {
+      continue;
+    }
+    
+    c->cpu = (int32_t)i;
+    c->node = stress_placement_read_node(c->cpu);
+    c->package = stress_placement_read_id(c->cpu, "physical_package_id");
+    c->die = stress_placement_read_id(c->cpu, "die_id");
+    c->core = stress_placement_read_id(c->cpu, "core_id");
+    c->llc = stress_placement_read_llc(cpu_caches, c->cpu);
+    
+    if (c->core < 0)
+    {
+      c->core = c->cpu;
+    }
+    
+    if (c->llc < 0)
+    {
+      c->llc = c->package;
+    }
+    
+    n++;
+  }
+  
+  stress_free_cpu_caches(cpu_caches);
+  qsort(cpus, n, sizeof(*cpus), stress_placement_compact_cmp);
+  stress_placement_spread_rank(cpus, n);
+  
+  if (placement.policy != PLACEMENT_COMPACT)
+  {
+    qsort(cpus, n, sizeof(*cpus), stress_placement_spread_cmp);
+  }
+  
+  /* CPU sets are created in the order of their first CPU */
+  for (i = 0; i < n; i++)
+  {
+    for (j = 0; j < placement.n_sets; j++)
+    {
+      if (stress_placement_same(placement.policy, firsts[j], &cpus[i]))
+      {
+        break;
+      }
+    }
+    
+    if (j == placement.n_sets)
+    {
+      firsts[j] = &cpus[i];
+      CPU_ZERO(&placement.sets[j]);
+      placement.n_sets++;
+    }
+    
+    CPU_SET(cpus[i].cpu, &placement.sets[j]);
+  }
+  
+  for (j = 0; j < placement.n_sets; j++)
+  {
+    char buf[256];
+    size_t len = 0;
+    
+    for (i = 0; (i < (size_t)max_cpus) && (i < CPU_SETSIZE) && (len < sizeof(buf) - 16); i++)
+    {
+      if (CPU_ISSET((int)i, &placement.sets[j]))
+      {
+        len += (size_t)snprintf(buf + len, sizeof(buf) - len, "%s%zu", len ? "," : "", i);
+      }
+    }
+    
+    pr_dbg("placement: CPU set %zu: CPUs %s\n", j, len ? buf : "none");
+  }
+  
+  for (i = 0; i < SIZEOF_ARRAY(placement_info); i++)
+  {
+    if (placement_info[i].policy == placement.policy)
+    {
+      pr_inf("placement: %s, %zu CPU set%s over %zu CPU%s\n",
+             placement_info[i].name,
+             placement.n_sets, placement.n_sets == 1 ? "" : "s",
+             n, n == 1 ? "" : "s");
+    }
+  }
+  
+  free(firsts);
+  free(cpus);
+  return 0;
+}
+
+/*
+ *  stress_placement_apply()
+ *  pin the calling stressor instance to the CPU set for the
+ *  slot'th instance to be started, on Linux this only pins
+ *  the calling thread so pthread instances are each placed
+ */
+void stress_placement_apply(const int32_t slot)
+{
+  const cpu_set_t *set;
+  
+  if (!placement.n_sets || (slot < 0))
+  {
+    return;
+  }
+  
+  set = &placement.sets[(size_t)slot % placement.n_sets];
+  
+  if (sched_setaffinity(0, sizeof(*set), set) < 0)
+  {
+    pr_dbg("placement: cannot set CPU affinity, errno=%d (%s)\n",
+           errno, strerror(errno));
+  }
+}
+
+/*
+ *  stress_placement_free()
+ *  free the placement CPU sets
+ */
+void stress_placement_free(void)
+{
+  free(placement.sets);
+  placement.sets = NULL;
+  placement.n_sets = 0;
+}
+#else
+bool stress_placement_enabled(void)
+{
+  return false;
+}
+
+int stress_placement_init(void)
+{
+  int32_t policy = 0;
+  
+  (void)stress_get_setting("placement", &policy);
+  
+  if (policy)
+  {
+    pr_inf("placement: CPU topology placement is not available on this system\n");
+  }
+  
+  return 0;
+}
+
+void stress_placement_apply(const int32_t slot)
+{
+  (void)slot;
+}
+
+void stress_placement_free(void)
+{
+}
+#endif
@@ -0,0 +1,728 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define STRESS_PROFILE_MAX_PHASES (64)    /* phases per stressor */
+#define STRESS_PROFILE_MAX_STEPS  (16)    /* levels of a step phase */
+
+/*
+ *  Job file "profile" directives give a stressor a schedule of
+ *  phases, each of which varies the load level over time. The
+ *  parent evaluates the schedule while it waits for the stressors
+ *  and writes a per instance duty cycle into the shared stats,
+ *  which stress_duty_pause() honours in keep_stressing(). A load
+ *  level sets the duty cycle of all the instances, an instances
+ *  level runs the first N instances and parks the rest.
+ */
+typedef enum
+{
+  PROFILE_HOLD = 0,   /* constant level */
+  PROFILE_RAMP,     /* linear ramp between two levels */
+  PROFILE_STEP,     /* equal length steps through levels */
+  PROFILE_SQUARE,     /* square wave, high then low */
+  PROFILE_SINE,     /* sine wave, starting at low */
+  PROFILE_BURST,      /* base level with periodic bursts */
+} stress_profile_shape_t;
+
+typedef enum
+{
+  PROFILE_LOAD = 0,   /* duty cycle of all instances, % */
+  PROFILE_INSTANCES,    /* number of running instances */
+} stress_profile_target_t;
+
+typedef struct
+{
+  stress_profile_shape_t shape; /* how the level varies */
+  stress_profile_target_t target; /* what the level controls */
+  double values[STRESS_PROFILE_MAX_STEPS];/* levels, depends on shape */
+  size_t n_values;    /* number of levels */
+  double period;      /* square, sine and burst period, secs */
+  double length;      /* burst length, secs */
+  double duration;    /* phase duration, secs */
+  double start;     /* start time from profile start, secs */
+  double time;      /* time spent in the phase, secs */
+  uint64_t ops;     /* bogo ops during the phase */
+  uint64_t busy_ticks;    /* system CPU busy ticks during the phase */
+  uint64_t total_ticks;   /* system CPU ticks during the phase */
+  double level_sum;   /* sum of levels applied */
+  uint64_t level_n;   /* number of levels applied */
+} stress_profile_phase_t;
+
+typedef struct stress_profile
+{
+  struct stress_profile *next;  /* next stressor profile */
+  char name[64];      /* stressor name, munged */
+  stress_stressor_t *ss;    /* stressor being profiled */
+  stress_profile_phase_t phases[STRESS_PROFILE_MAX_PHASES];
+  size_t n_phases;    /* number of phases */
+  double duration;    /* duration of all phases, secs */
+  bool running;     /* profile is being run */
+  double origin;      /* time the current run started */
+  size_t phase;     /* current phase */
+  double phase_time;    /* time the current phase started */
+  uint64_t phase_ops;   /* bogo ops when the phase started */
+  uint64_t phase_busy;    /* busy ticks when the phase started */
+  uint64_t phase_total;   /* total ticks when the phase started */
+  double last_time;   /* time of last poll */
+  uint64_t last_ops;    /* bogo ops at last poll */
+  uint64_t last_busy;   /* busy ticks at last poll */
+  uint64_t last_total;    /* total ticks at last poll */
+} stress_profile_t;
+
+static const char *const profile_shapes[] =
+{
+  "hold", "ramp", "step", "square", "sine", "burst",
+};
+
+static const char *const profile_targets[] =
+{
+  "load", "instances",
+};
+
+static stress_profile_t *profiles;
+
+/*
+ *  stress_profile_value()
+ *  parse a level, returns -1 if it is not a valid number
+ */
+static int stress_profile_value(const char *str, double *value)
+{
+  char *end;
+  
+  *value = strtod(str, &end);
+  
+  if ((end == str) || *end || (*value < 0.0))
+  {
+    (void)fprintf(stderr, "profile level '%s' is not valid\n", str);
+    return -1;
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_profile_time()
+ *  parse a time in seconds with an optional s, m or h
+ *  suffix, returns -1 if it is not a valid time
+ */
+static int stress_profile_time(const char *str, double *secs)
+{
+  char *end;
+  
+  *secs = strtod(str, &end);
+  
+  if (end == str)
+  {
+    goto err;
+  }
+  
+  if (*end == 'h')
+  {
+    *secs *= 3600.0;
+    end++;
+  }
+  else if (*end == 'm')
+  {
+    *secs *= 60.0;
+    end++;
+  }
+  else if (*end == 's')
+  {
+    end++;
+  }
+  
+  if (*end || (*secs <= 0.0))
+  {
+    goto err;
+  }
+  
+  return 0;
+  
+err:
+  (void)fprintf(stderr, "profile time '%s' is not valid\n", str);
+  return -1;
+}
+
+/*
+ *  stress_profile_parse()
+ *  parse a job file profile directive:
+ *    profile stressor shape target levels.. [period [length]] duration
+ *  returns 0 if it is not a profile directive, 1 if it has been
+ *  added to the stressor's profile and -1 on error
+ */
+int stress_profile_parse(const int argc, char **argv)
+{
+  stress_profile_t *profile;
+  stress_profile_phase_t *phase;
+  size_t i, n_values, n_times;
+  int shape, target;
+  
+  if ((argc < 2) || strcmp(argv[1], "profile"))
+  {
+    return 0;
+  }
+  
+  if (argc < 6)
+  {
+    (void)fprintf(stderr, "profile needs a stressor, shape, target, "
+                  "levels and duration\n");
+    return -1;
+  }
+  
+  for (shape = 0; shape < (int)SIZEOF_ARRAY(profile_shapes); shape++)
+  {
+    if (!strcmp(argv[3], profile_shapes[shape]))
+    {
+      break;
+    }
+  }
+  
+  for (target = 0; target < (int)SIZEOF_ARRAY(profile_targets); target++)
+  {
+    if (!strcmp(argv[4], profile_targets[target]))
+    {
+      break;
+    }
+  }
+  
+  if (shape == (int)SIZEOF_ARRAY(profile_shapes))
+  {
+    (void)fprintf(stderr, "profile shape '%s' not known, shapes are: "
+                  "hold ramp step square sine burst\n", argv[3]);
+    return -1;
+  }
+  
+  if (target == (int)SIZEOF_ARRAY(profile_targets))
+  {
+    (void)fprintf(stderr, "profile target '%s' not known, targets are: "
+                  "load instances\n", argv[4]);
+    return -1;
+  }
+  
+  /* levels, then the period, burst length and duration times */
+  switch (shape)
+  {
+    case PROFILE_HOLD:
+      n_values = 1;
+      n_times = 1;
+      break;
+    
+    case PROFILE_RAMP:
+      n_values = 2;
+      n_times = 1;
+      break;
+    
+    case PROFILE_STEP:
+      n_values = (size_t)argc - 6;
+      n_times = 1;
+      break;
+    
+    case PROFILE_BURST:
+      n_values = 2;
+      n_times = 3;
+      break;
+    
+    default:
+      n_values = 2;
+      n_times = 2;
+      break;
+  }
+  
+  if ((n_values < 1) || (n_values > STRESS_PROFILE_MAX_STEPS) ||
+      ((size_t)argc != 5 + n_values + n_times))
+  {
+    (void)fprintf(stderr, "profile %s has the wrong number of "
+                  "levels and times\n", argv[3]);
+    return -1;
+  }
+  
+  for (profile = profiles; profile; profile = profile->next)
+  {
+    if (!strcmp(profile->name, stress_munge_underscore(argv[2])))
+    {
+      break;
+    }
+  }
+  
+  if (!profile)
+  {
+    profile = calloc(1, sizeof(*profile));
+    
+    if (!profile)
+    {
+      (void)fprintf(stderr, "cannot allocate profile\n");
+      return -1;
+    }
+    
+    (void)shim_strlcpy(profile->name, stress_munge_underscore(argv[2]),
+                       sizeof(profile->name));
+    profile->next = profiles;
+    profiles = profile;
+  }
+  
+  if (profile->n_phases >= STRESS_PROFILE_MAX_PHASES)
+  {
+    (void)fprintf(stderr, "profile of %s has more than %d phases\n",
+                  profile->name, STRESS_PROFILE_MAX_PHASES);
+    return -1;
+  }
+  
+  phase = &profile->phases[profile->n_phases];
+  (void)memset(phase, 0, sizeof(*phase));
+  phase->shape = (stress_profile_shape_t)shape;
+  phase->target = (stress_profile_target_t)target;
+  phase->n_values = n_values;
+  
+  for (i = 0; i < n_values; i++)
+  {
+    if (stress_profile_value(argv[5 + i], &phase->values[i]) < 0)
+    {
+      return -1;
+    }
+    
+    if ((target == PROFILE_LOAD) && (phase->values[i] > 100.0))
+    {
+      (void)fprintf(stderr, "profile load level %s is more than 100%%\n",
+                    argv[5 + i]);
+      return -1;
+    }
+  }
+  
+  if (n_times > 1)
+  {
+    if (stress_profile_time(argv[5 + n_values], &phase->period) < 0)
+    {
+      return -1;
+    }
+  }
+  
+  if (n_times > 2)
+  {
+    if (stress_profile_time(argv[6 + n_values], &phase->length) < 0)
+    {
+      return -1;
+    }
+    
+    if (phase->length > phase->period)
+    {
+      (void)fprintf(stderr, "profile burst length is longer than its period\n");
+      return -1;
+    }
+  }
+  
+  if (stress_profile_time(argv[argc - 1], &phase->duration) < 0)
+  {
+    return -1;
+  }
+  
+  phase->start = profile->duration;
+  profile->duration += phase->duration;
+  profile->n_phases++;
+  return 1;
+}
+
+/*
+ *  stress_profile_init()
+ *  match the profiles to the stressors being run, returns -1
+ *  if a profile is for a stressor that is not being run
+ */
+int stress_profile_init(stress_stressor_t *stressors_list)
+{
+  stress_profile_t *profile;
+  
+  for (profile = profiles; profile; profile = profile->next)
+  {
+    stress_stressor_t *ss;
+    
+    for (ss = stressors_list; ss; ss = ss->next)
+    {
+      if (!strcmp(profile->name, stress_munge_underscore(ss->stressor->name)))
+      {
+        break;
+      }
+    }
+    
+    if (!ss)
+    {
+      pr_err("profile: stressor %s has a profile but is not being run\n",
+             profile->name);
+      return -1;
+    }
+    
+    profile->ss = ss;
+    
+    if (g_opt_timeout && (profile->duration > (double)g_opt_timeout))
+    {
+      pr_inf("profile: %s profile lasts %.2f secs, longer than the "
+             "%" PRIu64 " secs timeout\n", profile->name,
+             profile->duration, g_opt_timeout);
+    }
+    
+    pr_dbg("profile: %s has %zu phase%s over %.2f secs\n", profile->name,
+           profile->n_phases, profile->n_phases == 1 ? "" : "s",
+           profile->duration);
+    g_opt_flags |= OPT_FLAGS_PROFILE;
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_profile_enabled()
+ *  true if any stressor has a load profile
+ */
+bool stress_profile_enabled(void)
+{
+  return !!(g_opt_flags & OPT_FLAGS_PROFILE);
+}
+
+/*
+ *  stress_profile_find()
+ *  find the profile of a stressor
+ */
+static stress_profile_t *stress_profile_find(const stress_stressor_t *ss)
+{
+  stress_profile_t *profile;
+  
+  for (profile = profiles; profile; profile = profile->next)
+  {
+    if (profile->ss == ss)
+    {
+      return profile;
+    }
+  }
+  
+  return NULL;
+}
+
+/*
+ *  stress_profile_duty()
+ *  the duty cycle an instance should honour, NULL if
+ *  the stressor does not have a profile
+ */
+volatile double *stress_profile_duty(const stress_stressor_t *ss, stress_stats_t *stats)
+{
+  return stress_profile_find(ss) ? &stats->duty : NULL;
+}
+
+/*
+ *  stress_profile_level()
+ *  the level of a phase t seconds into it
+ */
+static double stress_profile_level(const stress_profile_phase_t *phase, const double t)
+{
+  const double *v = phase->values;
+  size_t step;
+  
+  switch (phase->shape)
+  {
+    case PROFILE_RAMP:
+      return v[0] + (v[1] - v[0]) * STRESS_MINIMUM(t / phase->duration, 1.0);
+    
+    case PROFILE_STEP:
+      step = (size_t)(t * (double)phase->n_values / phase->duration);
+      return v[STRESS_MINIMUM(step, phase->n_values - 1)];
+    
+    case PROFILE_SQUARE:
+      return (fmod(t, phase->period) < phase->period / 2.0) ? v[1] : v[0];
+    
+    case PROFILE_SINE:
+      return v[0] + (v[1] - v[0]) * (1.0 - cos(2.0 * M_PI * t / phase->period)) / 2.0;
+    
+    case PROFILE_BURST:
+      return (fmod(t, phase->period) < phase->length) ? v[1] : v[0];
+    
+    default:
+      return v[0];
+  }
+}
+
+/*
+ *  stress_profile_apply()
+ *  set the duty cycle of each instance for a level
+ */
+static void stress_profile_apply(
+  const stress_profile_t *profile,
+  const stress_profile_phase_t *phase,
+  const double level)
+{
+  const stress_stressor_t *ss = profile->ss;
+  int32_t j;
+  
+  for (j = 0; j < ss->num_instances; j++)
+  {
+    double duty;
+    
+    if (phase->target == PROFILE_LOAD)
+    {
+      duty = level / 100.0;
+    }
+    else
+    {
+      /* the instance after the last whole one runs part time */
+      duty = level - (double)j;
+      duty = (duty > 1.0) ? 1.0 : ((duty < 0.0) ? 0.0 : duty);
+    }
+    
+    ss->stats[j]->duty = duty;
+  }
+}
+
+/*
+ *  stress_profile_counter()
+ *  sum of the bogo-op counters of the instances of a stressor
+ */
+static uint64_t stress_profile_counter(const stress_stressor_t *ss)
+{
+  uint64_t counter = 0;
+  int32_t j;
+  
+  for (j = 0; j < ss->num_instances; j++)
+  {
+    counter += ss->stats[j]->ci.counter;
+  }
+  
+  return counter;
+}
+
+/*
+ *  stress_profile_snapshot()
+ *  take the time, bogo ops and CPU ticks of a profile
+ */
+static void stress_profile_snapshot(stress_profile_t *profile, const double now)
+{
+  profile->last_time = now;
+  profile->last_ops = stress_profile_counter(profile->ss);
+  stress_vmstat_cpu_ticks(&profile->last_busy, &profile->last_total);
+}
+
+/*
+ *  stress_profile_close()
+ *  add the last snapshot to the metrics of the current phase
+ */
+static void stress_profile_close(stress_profile_t *profile)
+{
+  stress_profile_phase_t *phase = &profile->phases[profile->phase];
+  
+  phase->time += profile->last_time - profile->phase_time;
+  phase->ops += profile->last_ops - profile->phase_ops;
+  phase->busy_ticks += profile->last_busy - profile->phase_busy;
+  phase->total_ticks += profile->last_total - profile->phase_total;
+}
+
+/*
+ *  stress_profile_open()
+ *  start the metrics of a phase from the last snapshot
+ */
+static void stress_profile_open(stress_profile_t *profile, const size_t phase)
+{
+  profile->phase = phase;
+  profile->phase_time = profile->last_time;
+  profile->phase_ops = profile->last_ops;
+  profile->phase_busy = profile->last_busy;
+  profile->phase_total = profile->last_total;
+}
+
+/*
+ *  stress_profile_update()
+ *  move on to the phase that is due and apply its level, the
+ *  level at the end of the last phase is held until the
+ *  stressor finishes
+ */
+static void stress_profile_update(stress_profile_t *profile, const double now)
+{
+  const double t = now - profile->origin;
+  stress_profile_phase_t *phase;
+  size_t i = profile->phase;
+  double level;
+  
+  while ((i < profile->n_phases - 1) &&
+         (t >= profile->phases[i].start + profile->phases[i].duration))
+  {
+    i++;
+  }
+  
+  stress_profile_snapshot(profile, now);
+  
+  if (i != profile->phase)
+  {
+    stress_profile_close(profile);
+    stress_profile_open(profile, i);
+  }
+  
+  phase = &profile->phases[i];
+  level = stress_profile_level(phase, t - phase->start);
+  stress_profile_apply(profile, phase, level);
+  phase->level_sum += level;
+  phase->level_n++;
+}
+
+/*
+ *  stress_profile_start()
+ *  start the profiles of the stressors about to be run, called
+ *  before their instances are forked
+ */
+void stress_profile_start(stress_stressor_t *stressors_list)
+{
+  stress_profile_t *profile;
+  const double now = stress_time_now();
+  
+  if (!(g_opt_flags & OPT_FLAGS_PROFILE))
+  {
+    return;
+  }
+  
+  for (profile = profiles; profile; profile = profile->next)
+  {
+    stress_stressor_t *ss;
+    
+    /* stressors run sequentially or repeated finish here */
+    if (profile->running)
+    {
+      stress_profile_close(profile);
+      profile->running = false;
+    }
+    
+    for (ss = stressors_list; ss; ss = ss->next)
+    {
+      if (ss == profile->ss)
+      {
+        break;
+      }
+    }
+    
+    if (!ss)
+    {
+      continue;
+    }
+    
+    profile->running = true;
+    profile->origin = now;
+    stress_profile_snapshot(profile, now);
+    /* the counters are zeroed as the instances start */
+    profile->last_ops = 0;
+    stress_profile_open(profile, 0);
+    stress_profile_update(profile, now);
+  }
+}
+
+/*
+ *  stress_profile_poll()
+ *  apply the current levels of the running profiles
+ */
+void stress_profile_poll(void)
+{
+  stress_profile_t *profile;
+  double now;
+  
+  if (!(g_opt_flags & OPT_FLAGS_PROFILE))
+  {
+    return;
+  }
+  
+  now = stress_time_now();
+  
+  for (profile = profiles; profile; profile = profile->next)
+  {
+    if (profile->running)
+    {
+      stress_profile_update(profile, now);
+    }
+  }
+}
+
+/*
+ *  stress_profile_report()
+ *  report the bogo-op rate and system CPU load of each
+ *  phase of each profile
+ */
+void stress_profile_report(FILE *yaml)
+{
+  stress_profile_t *profile;
+  
+  if (!(g_opt_flags & OPT_FLAGS_PROFILE))
+  {
+    return;
+  }
+  
+  pr_yaml(yaml, "profile:\n");
+  
+  for (profile = profiles; profile; profile = profile->next)
+  {
+    size_t i;
+    
+    if (profile->running)
+    {
+      stress_profile_close(profile);
+      profile->running = false;
+    }
+    
+    for (i = 0; i < profile->n_phases; i++)
+    {
+      const stress_profile_phase_t *phase = &profile->phases[i];
+      const double rate = (phase->time > 0.0) ? (double)phase->ops / phase->time : 0.0;
+      const double level = phase->level_n ? phase->level_sum / (double)phase->level_n : 0.0;
+      const double load = phase->total_ticks ?
+                          100.0 * (double)phase->busy_ticks / (double)phase->total_ticks : 0.0;
+      
+      if (phase->time <= 0.0)
+      {
+        pr_inf("profile: %s phase %zu %s %s not run\n", profile->name,
+               i + 1, profile_shapes[phase->shape], profile_targets[phase->target]);
+        continue;
+      }
+      
+      pr_inf("profile: %s phase %zu %s %s, %.2f secs, average %s %.2f, "
+             "%.2f bogo ops/s, system CPU load %.2f%%\n", profile->name,
+             i + 1, profile_shapes[phase->shape], profile_targets[phase->target],
+             phase->time, profile_targets[phase->target], level, rate, load);
+      pr_yaml(yaml, "    - stressor: %s\n", profile->name);
+      pr_yaml(yaml, "      phase: %zu\n", i + 1);
+      pr_yaml(yaml, "      shape: %s\n", profile_shapes[phase->shape]);
+      pr_yaml(yaml, "      target: %s\n", profile_targets[phase->target]);
+      pr_yaml(yaml, "      duration: %f\n", phase->time);
+      pr_yaml(yaml, "      average-level: %f\n", level);
+      pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", phase->ops);
+      pr_yaml(yaml, "      bogo-ops-per-second: %f\n", rate);
+      pr_yaml(yaml, "      cpu-load-percent: %f\n", load);
+      pr_yaml(yaml, "\n");
+    }
+  }
+}
+
+/*
+ *  stress_profile_free()
+ *  free the profiles
+ */
+void stress_profile_free(void)
+{
+  while (profiles)
+  {
+    stress_profile_t *next = profiles->next;
+    
+    free(profiles);
+    profiles = next;
+  }
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define STRESS_REPEAT_MAX (1000)  /* most --repeat runs */
+
+/*
+ *  stress_set_repeat()
+ *  set number of times to repeat the run
+ */
+int stress_set_repeat(const char *const opt)
+{
+  const uint32_t repeat = stress_get_uint32(opt);
+  
+  stress_check_range("repeat", (uint64_t)repeat, 1, STRESS_REPEAT_MAX);
+  return stress_set_setting_global("repeat", TYPE_ID_UINT32, &repeat);
+}
+
+/*
+ *  stress_repeat_count()
+ *  number of times the run is to be repeated, 1 if
+ *  --repeat is not used; cached on first use as the
+ *  per stressor settings are not visible after the run
+ */
+uint32_t stress_repeat_count(void)
+{
+  static uint32_t repeat;
+  
+  if (!repeat)
+  {
+    repeat = 1;
+    (void)stress_get_setting("repeat", &repeat);
+  }
+  
+  return repeat;
+}
+
+/*
+ *  stress_repeat_init()
+ *  allocate per stressor rate arrays for --repeat,
+ *  returns -1 if out of memory
+ */
+int stress_repeat_init(stress_stressor_t *stressors_list)
+{
+  stress_stressor_t *ss;
+  const uint32_t repeat = stress_repeat_count();
+  
+  if (repeat < 2)
+  {
+    return 0;
+  }
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    ss->repeat_n = 0;
+    ss->repeat_rates = calloc((size_t)repeat, sizeof(*ss->repeat_rates));
+    
+    if (!ss->repeat_rates)
+    {
+      pr_err("cannot allocate %" PRIu32 " repeat rates\n", repeat);
+      return -1;
+    }
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_repeat_record()
+ *  record the bogo-op rate of a stressor for one run
+ */
+void stress_repeat_record(stress_stressor_t *ss, const double rate)
+{
+  if (ss->repeat_rates && (ss->repeat_n < stress_repeat_count()))
+  {
+    ss->repeat_rates[ss->repeat_n++] = rate;
+  }
+}
+
+/*
+ *  stress_student_t95()
+ *  two sided 95% critical value of Student's t distribution
+ *  for df degrees of freedom, the normal value is used for
+ *  large df
+ */
+double stress_student_t95(const uint64_t df)
+{
+  static const double t95[] =
+  {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+    2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+    2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+    2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+  };
+  
+  if (df < 1)
+  {
+    return 0.0;
+  }
+  
+  if (df <= SIZEOF_ARRAY(t95))
+  {
+    return t95[df - 1];
+  }
+  
+  return 1.96;
+}
+
+/*
+ *  stress_repeat_cmp()
+ *  qsort comparison of bogo-op rates
+ */
+static int stress_repeat_cmp(const void *p1, const void *p2)
+{
+  const double r1 = *(const double *)p1;
+  const double r2 = *(const double *)p2;
+  
+  return (r1 > r2) - (r1 < r2);
+}
+
+/*
+ *  stress_repeat_quantile()
+ *  linearly interpolated quantile q of n sorted values
+ */
+static double stress_repeat_quantile(const double *sorted, const uint32_t n, const double q)
+{
+  const double pos = q * (double)(n - 1);
+  const uint32_t i = (uint32_t)pos;
+  
+  if (i + 1 >= n)
+  {
+    return sorted[n - 1];
+  }
+  
+  return sorted[i] + ((pos - (double)i) * (sorted[i + 1] - sorted[i]));
+}
+
+/*
+ *  stress_repeat_summary()
+ *  summarise the bogo-op rates of a stressor over all the
+ *  runs, with --repeat-reject runs outside of the Tukey fences
+ *  (1.5 times the interquartile range beyond the quartiles) are
+ *  rejected. Returns false if there are fewer than 2 runs
+ */
+bool stress_repeat_summary(const stress_stressor_t *ss, stress_repeat_summary_t *summary)
+{
+  double *sorted;
+  double lo, hi, var = 0.0;
+  uint32_t i, n = 0;
+  
+  (void)memset(summary, 0, sizeof(*summary));
+  
+  if (!ss->repeat_rates || (ss->repeat_n < 2))
+  {
+    return false;
+  }
+  
+  sorted = calloc((size_t)ss->repeat_n, sizeof(*sorted));
+  
+  if (!sorted)
+  {
+    return false;
+  }
+  
+  (void)memcpy(sorted, ss->repeat_rates, ss->repeat_n * sizeof(*sorted));
+  qsort(sorted, ss->repeat_n, sizeof(*sorted), stress_repeat_cmp);
+  lo = sorted[0];
+  hi = sorted[ss->repeat_n - 1];
+  
+  if ((g_opt_flags & OPT_FLAGS_REPEAT_REJECT) && (ss->repeat_n >= 4))
+  {
+    const double q1 = stress_repeat_quantile(sorted, ss->repeat_n, 0.25);
+    const double q3 = stress_repeat_quantile(sorted, ss->repeat_n, 0.75);
+    
+    lo = q1 - (1.5 * (q3 - q1));
+    hi = q3 + (1.5 * (q3 - q1));
+  }
+  
+  summary->min = hi;
+  summary->max = lo;
+  
+  for (i = 0; i < ss->repeat_n; i++)
+  {
+    const double rate = sorted[i];
+    
+    if ((rate < lo) || (rate > hi))
+    {
+      summary->rejected++;
+      continue;
+    }
+    
+    summary->mean += rate;
+    summary->min = (rate < summary->min) ? rate : summary->min;
+    summary->max = (rate > summary->max) ? rate : summary->max;
+    n++;
+  }
+  
+  summary->runs = n;
+  summary->mean = n ? summary->mean / (double)n : 0.0;
+  
+  for (i = 0; i < ss->repeat_n; i++)
+  {
+    const double rate = sorted[i];
+    
+    if ((rate >= lo) && (rate <= hi))
+    {
+      var += (rate - summary->mean) * (rate - summary->mean);
+    }
+  }
+  
+  free(sorted);
+  
+  if (n >= 2)
+  {
+    summary->stddev = sqrt(var / (double)(n - 1));
+    summary->ci = stress_student_t95(n - 1) * summary->stddev / sqrt((double)n);
+  }
+  
+  return true;
+}
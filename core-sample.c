@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define STRESS_SAMPLES_MAX  (4096)  /* samples kept in the ring */
+#define STRESS_SAMPLE_MIN_NS  (1000000ULL)  /* 1 millisecond */
+#define STRESS_SAMPLE_MAX_NS  (3600ULL * STRESS_NANOSECOND)
+
+/*
+ *  Bogo-op rate samples are taken by the parent while it waits
+ *  for the stressors to complete, the stressors are not involved
+ *  at all; the parent just reads the bogo-op counters in the
+ *  shared stats. Rates are kept in a preallocated ring of
+ *  STRESS_SAMPLES_MAX samples, the oldest samples get overwritten
+ *  on very long runs.
+ */
+typedef struct
+{
+  stress_stressor_t *stressors; /* all the stressors being sampled */
+  size_t n_stressors;   /* number of stressors sampled */
+  uint64_t interval_ns;   /* sample interval, 0 = disabled */
+  double interval;    /* sample interval in seconds */
+  double time_start;    /* time sampling started */
+  double time_next;   /* time next sample is due */
+  double time_last;   /* time of the last sample */
+  size_t head;      /* next sample slot in the ring */
+  size_t count;     /* number of samples in the ring */
+  uint64_t dropped;   /* samples overwritten in the ring */
+  uint64_t *counters;   /* counter totals at last sample */
+  double *times;      /* ring of sample times */
+  double *rates;      /* ring of rates, n_stressors per sample */
+} stress_sampler_t;
+
+static stress_sampler_t sampler;
+
+/*
+ *  stress_set_sample_interval()
+ *  set sample interval, units of ns, us, ms or s,
+ *  no units are seconds
+ */
+int stress_set_sample_interval(const char *const opt)
+{
+  static const struct
+  {
+    const char *suffix;
+    uint64_t scale;
+  } units[] =
+  {
+    { "ns", 1ULL },
+    { "us", 1000ULL },
+    { "ms", 1000000ULL },
+    { "s",  STRESS_NANOSECOND },
+    { "",   STRESS_NANOSECOND },
+  };
+  char *end;
+  size_t i;
+  double val;
+  uint64_t interval_ns;
+  
+  errno = 0;
+  val = strtod(opt, &end);
+  
+  if ((errno != 0) || (end == opt) || (val <= 0.0))
+  {
+    (void)fprintf(stderr, "Invalid sample-interval '%s'\n", opt);
+    _exit(EXIT_FAILURE);
+  }
+  
+  for (i = 0; i < SIZEOF_ARRAY(units); i++)
+  {
+    if (!strcmp(end, units[i].suffix))
+    {
+      break;
+    }
+  }
+  
+  if (i >= SIZEOF_ARRAY(units))
+  {
+    (void)fprintf(stderr, "Invalid sample-interval units '%s', "
+                  "use one of ns, us, ms or s\n", end);
+    _exit(EXIT_FAILURE);
+  }
+  
+  interval_ns = (uint64_t)(val * (double)units[i].scale);
+  
+  if ((interval_ns < STRESS_SAMPLE_MIN_NS) ||
+      (interval_ns > STRESS_SAMPLE_MAX_NS))
+  {
+    (void)fprintf(stderr, "sample-interval must be in the range 1ms to 3600s.\n");
+    _exit(EXIT_FAILURE);
+  }
+  
+  return stress_set_setting_global("sample-interval", TYPE_ID_UINT64, &interval_ns);
+}
+
+/*
+ *  stress_sample_init()
+ *  allocate sample ring for the given list of stressors,
+ *  returns -1 if it cannot be allocated
+ */
+int stress_sample_init(stress_stressor_t *stressors_list)
+{
+  stress_stressor_t *ss;
+  
+  (void)memset(&sampler, 0, sizeof(sampler));
+  (void)stress_get_setting("sample-interval", &sampler.interval_ns);
+  
+  if (!sampler.interval_ns)
+  {
+    return 0;
+  }
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    sampler.n_stressors++;
+  }
+  
+  if (!sampler.n_stressors)
+  {
+    sampler.interval_ns = 0;
+    return 0;
+  }
+  
+  sampler.counters = calloc(sampler.n_stressors, sizeof(*sampler.counters));
+  sampler.times = calloc(STRESS_SAMPLES_MAX, sizeof(*sampler.times));
+  sampler.rates = calloc(STRESS_SAMPLES_MAX * sampler.n_stressors,
+                         sizeof(*sampler.rates));
+                         
+  if (!sampler.counters || !sampler.times || !sampler.rates)
+  {
+    pr_err("cannot allocate %d sample buffers\n", STRESS_SAMPLES_MAX);
+    stress_sample_free();
+    return -1;
+  }
+  
+  sampler.stressors = stressors_list;
+  sampler.interval = (double)sampler.interval_ns / STRESS_NANOSECOND;
+  sampler.time_start = stress_time_now();
+  sampler.time_last = sampler.time_start;
+  sampler.time_next = sampler.time_start + sampler.interval;
+  
+  return 0;
+}
+
+/*
+ *  stress_sample_free()
+ *  free sample ring
+ */
+void stress_sample_free(void)
+{
+  free(sampler.rates);
+  free(sampler.times);
+  free(sampler.counters);
+  (void)memset(&sampler, 0, sizeof(sampler));
+}
+
+/*
+ *  stress_sample_enabled()
+ *  true if sampling is enabled
+ */
+bool stress_sample_enabled(void)
+{
+  return sampler.interval_ns > 0;
+}
+
+/*
+ *  stress_sample_take()
+ *  snapshot all the bogo-op counters and add the
+ *  rates since the previous sample into the ring
+ */
+static void stress_sample_take(const double now)
+{
+  stress_stressor_t *ss;
+  size_t i;
+  double *rates = sampler.rates + (sampler.head * sampler.n_stressors);
+  const double dt = now - sampler.time_last;
+  
+  for (i = 0, ss = sampler.stressors; ss && (i < sampler.n_stressors); ss = ss->next, i++)
+  {
+    int32_t j;
+    uint64_t counter = 0, delta;
+    
+    for (j = 0; j < ss->num_instances; j++)
+    {
+      counter += ss->stats[j]->ci.counter;
+    }
+    
+    /* counters are zero'd at the start of each stressor run */
+    delta = (counter >= sampler.counters[i]) ?
+            counter - sampler.counters[i] : counter;
+    rates[i] = (dt > 0.0) ? (double)delta / dt : 0.0;
+    sampler.counters[i] = counter;
+  }
+  
+  sampler.times[sampler.head] = now - g_shared->time_epoch;
+  sampler.head = (sampler.head + 1) % STRESS_SAMPLES_MAX;
+  
+  if (sampler.count < STRESS_SAMPLES_MAX)
+  {
+    sampler.count++;
+  }
+  else
+  {
+    sampler.dropped++;
+  }
+  
+  sampler.time_last = now;
+}
+
+/*
+ *  stress_sample_poll()
+ *  take a sample if one is due
+ */
+void stress_sample_poll(void)
+{
+  double now;
+  
+  if (!sampler.interval_ns)
+  {
+    return;
+  }
+  
+  now = stress_time_now();
+  
+  if (now < sampler.time_next)
+  {
+    return;
+  }
+  
+  stress_sample_take(now);
+  
+  /* Skip missed samples rather than bunching them up */
+  do
+  {
+    sampler.time_next += sampler.interval;
+  }
+  while (sampler.time_next <= now);
+}
+
+/*
+ *  stress_sample_tick()
+ *  sample bogo-op rates, run the duty cycle controller and load
+ *  profiles, measure warm-up and convergence windows, stream
+ *  telemetry, drain perf samples and log rings. Called from the
+ *  loop that reaps the stressors, returns the seconds until the
+ *  next call is due or -1.0 if nothing needs to be polled
+ */
+double stress_sample_tick(void)
+{
+  double delay;
+  
+  if (!sampler.interval_ns && !stress_duty_enabled() &&
+      !stress_profile_enabled() && !pr_ring_enabled() &&
+      !stress_converge_enabled() && !stress_telemetry_enabled() &&
+      !stress_perf_sample_enabled() && !stress_fairness_enabled())
+  {
+    return -1.0;
+  }
+  
+  stress_sample_poll();
+  stress_duty_poll();
+  stress_profile_poll();
+  pr_ring_drain();
+  stress_converge_poll();
+  stress_telemetry_poll();
+  stress_perf_sample_poll();
+  stress_fairness_poll();
+  /* the other pollers have their own ticks, poll at least every 100ms */
+  delay = sampler.interval_ns ? sampler.time_next - stress_time_now() : 0.1;
+  return (delay > 0.1) ? 0.1 : ((delay < 0.0) ? 0.0 : delay);
+}
+
+/*
+ *  stress_sample_final()
+ *  take the final partial interval sample once all the
+ *  stressors have been reaped
+ */
+void stress_sample_final(void)
+{
+  if (sampler.interval_ns && (stress_time_now() > sampler.time_last))
+  {
+    stress_sample_take(stress_time_now());
+  }
+}
+
+/*
+ *  stress_sample_dump()
+ *  dump bogo-op rate time series to the YAML file
+ *  and optionally to a CSV file
+ */
+void stress_sample_dump(FILE *yaml)
+{
+  stress_stressor_t *ss;
+  size_t i, n;
+  const size_t first = (sampler.head + STRESS_SAMPLES_MAX - sampler.count) % STRESS_SAMPLES_MAX;
+  char *csv_filename = NULL;
+  
+  if (!sampler.interval_ns || !sampler.count)
+  {
+    return;
+  }
+  
+  if (sampler.dropped)
+  {
+    pr_inf("sampler: %" PRIu64 " oldest samples dropped, only the last %d are reported\n",
+           sampler.dropped, STRESS_SAMPLES_MAX);
+  }
+  
+  pr_yaml(yaml, "samples:\n");
+  
+  for (i = 0, ss = sampler.stressors; ss && (i < sampler.n_stressors); ss = ss->next, i++)
+  {
+    pr_yaml(yaml, "    - stressor: %s\n", stress_munge_underscore(ss->stressor->name));
+    pr_yaml(yaml, "      interval: %f\n", sampler.interval);
+    pr_yaml(yaml, "      dropped: %" PRIu64 "\n", sampler.dropped);
+    pr_yaml(yaml, "      time-series:\n");
+    
+    for (n = 0; n < sampler.count; n++)
+    {
+      const size_t slot = (first + n) % STRESS_SAMPLES_MAX;
+      pr_yaml(yaml, "        - time: %f\n", sampler.times[slot]);
+      pr_yaml(yaml, "          bogo-ops-per-second: %f\n",
+              sampler.rates[(slot * sampler.n_stressors) + i]);
+    }
+  }
+  
+  pr_yaml(yaml, "\n");
+  (void)stress_get_setting("sample-csv", &csv_filename);
+  
+  if (csv_filename)
+  {
+    FILE *csv = fopen(csv_filename, "w");
+    
+    if (!csv)
+    {
+      pr_err("cannot open sample CSV file %s, errno=%d (%s)\n",
+             csv_filename, errno, strerror(errno));
+      return;
+    }
+    
+    (void)fprintf(csv, "time");
+    
+    for (i = 0, ss = sampler.stressors; ss && (i < sampler.n_stressors); ss = ss->next, i++)
+    {
+      (void)fprintf(csv, ",%s", stress_munge_underscore(ss->stressor->name));
+    }
+    
+    (void)fprintf(csv, "\n");
+    
+    for (n = 0; n < sampler.count; n++)
+    {
+      const size_t slot = (first + n) % STRESS_SAMPLES_MAX;
+      (void)fprintf(csv, "%f", sampler.times[slot]);
+      
+      for (i = 0; i < sampler.n_stressors; i++)
+      {
+        (void)fprintf(csv, ",%f", sampler.rates[(slot * sampler.n_stressors) + i]);
+      }
+      
+      (void)fprintf(csv, "\n");
+    }
+    
+    (void)fclose(csv);
+  }
+}
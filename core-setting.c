@@ -24,8 +24,29 @@
  */
 #include "stress-ng.h"
 
+#define SETTING_HASH_SIZE (1021)  /* setting name hash table size */
+#define SETTING_PROC_HASH_SIZE  (509) /* setting owner hash table size */
+#define SETTING_INDEX_END (UINT32_MAX)
+
+/*
+ *  Per owner (stressor) lookup limit. A lookup made on behalf of an
+ *  owner only considers settings that precede the first non-global
+ *  setting of another owner that follows the owner's own first setting.
+ */
+typedef struct stress_setting_proc
+{
+  struct stress_setting_proc *next; /* next in hash chain */
+  struct stress_setting_proc *open_next;  /* next in open list */
+  stress_pstressor_info_t proc;   /* owner of the settings */
+  uint32_t  end;      /* index of first hidden setting */
+} stress_setting_proc_t;
+
 static stress_setting_t *setting_head;  /* setting list head */
 static stress_setting_t *setting_tail;  /* setting list tail */
+static uint32_t setting_count;    /* number of settings */
+static stress_setting_t *setting_hash[SETTING_HASH_SIZE];
+static stress_setting_proc_t *setting_proc_hash[SETTING_PROC_HASH_SIZE];
+static stress_setting_proc_t *setting_proc_open;  /* owners with no end yet */
 
 #if defined(DEBUG_SETTINGS)
   #define DBG(...)  pr_inf(__VA_ARGS__)
@@ -40,6 +61,7 @@ static stress_setting_t *setting_tail;  /* setting list tail */
 void stress_settings_free(void)
 {
   stress_setting_t *setting = setting_head;
+  size_t i;
   
   while (setting)
   {
@@ -55,8 +77,122 @@ void stress_settings_free(void)
     setting = next;
   }
   
+  for (i = 0; i < SETTING_PROC_HASH_SIZE; i++)
+  {
+    stress_setting_proc_t *sp = setting_proc_hash[i];
+    
+    while (sp)
+    {
+      stress_setting_proc_t *next = sp->next;
+      
+      free(sp);
+      sp = next;
+    }
+  }
+  
   setting_head = NULL;
   setting_tail = NULL;
+  setting_count = 0;
+  setting_proc_open = NULL;
+  (void)memset(setting_hash, 0, sizeof(setting_hash));
+  (void)memset(setting_proc_hash, 0, sizeof(setting_proc_hash));
+}
+
+/*
+ *  stress_setting_proc_hash()
+ *  hash a setting owner pointer
+ */
+static inline size_t stress_setting_proc_hash(const stress_pstressor_info_t proc)
+{
+  return (size_t)(((uintptr_t)proc >> 4) % SETTING_PROC_HASH_SIZE);
+}
+
+/*
+ *  stress_setting_proc_find()
+ *  find the lookup limit of a setting owner, NULL if
+ *  the owner has no settings
+ */
+static stress_setting_proc_t *stress_setting_proc_find(const stress_pstressor_info_t proc)
+{
+  stress_setting_proc_t *sp;
+  
+  for (sp = setting_proc_hash[stress_setting_proc_hash(proc)]; sp; sp = sp->next)
+  {
+    if (sp->proc == proc)
+    {
+      return sp;
+    }
+  }
+  
+  return NULL;
+}
+
+/*
+ *  stress_setting_index()
+ *  add a new setting to the name hash table and update the
+ *  owner lookup limits, returns -1 if out of memory
+ */
+static int stress_setting_index(stress_setting_t *setting)
+{
+  const size_t h = stress_hash_sdbm(setting->name) % SETTING_HASH_SIZE;
+  stress_setting_proc_t *sp;
+  
+  setting->index = setting_count++;
+  
+  /*
+   *  Most recent first, so the first name match that is
+   *  within an owner's limit is the last one set
+   */
+  setting->hash_next = setting_hash[h];
+  setting_hash[h] = setting;
+  
+  /*
+   *  A non-global setting ends the visible range of all
+   *  the other owners that are still open
+   */
+  if (!setting->global)
+  {
+    stress_setting_proc_t *keep = NULL;
+    
+    for (sp = setting_proc_open; sp; sp = sp->open_next)
+    {
+      if (sp->proc == setting->proc)
+      {
+        keep = sp;
+      }
+      else
+      {
+        sp->end = setting->index;
+      }
+    }
+    
+    setting_proc_open = keep;
+    
+    if (keep)
+    {
+      keep->open_next = NULL;
+    }
+  }
+  
+  if (stress_setting_proc_find(setting->proc))
+  {
+    return 0;
+  }
+  
+  sp = calloc(1, sizeof(*sp));
+  
+  if (!sp)
+  {
+    return -1;
+  }
+  
+  sp->proc = setting->proc;
+  sp->end = SETTING_INDEX_END;
+  sp->next = setting_proc_hash[stress_setting_proc_hash(sp->proc)];
+  setting_proc_hash[stress_setting_proc_hash(sp->proc)] = sp;
+  sp->open_next = setting_proc_open;
+  setting_proc_open = sp;
+  return 0;
 }
 
 
@@ -204,6 +340,18 @@ static int stress_set_setting_generic(
       break;
   }
   
+  if (stress_setting_index(setting) < 0)
+  {
+    if (type_id == TYPE_ID_STR)
+    {
+      free(setting->u.str);
+    }
+    
+    free(setting->name);
+    free(setting);
+    goto err;
+  }
+  
   if (setting_tail)
   {
     setting_tail->next = setting;
@@ -247,28 +395,21 @@ int stress_set_setting_global(
 
 /*
  *  stress_get_setting()
- *  get an existing setting;
+ *  get an existing setting; the most recent setting of the given
+ *  name that is visible to the current stressor is used, lookups
+ *  are via the name and owner hash tables rather than a list walk
  */
 bool stress_get_setting(const char *name, void *value)
 {
+  const stress_setting_proc_t *sp = stress_setting_proc_find(g_stressor_current);
+  const uint32_t end = sp ? sp->end : SETTING_INDEX_END;
   stress_setting_t *setting;
   bool set = false;
-  bool found = false;
   DBG("%s: get %s\n", __func__, name);
   
-  for (setting = setting_head; setting; setting = setting->next)
+  for (setting = setting_hash[stress_hash_sdbm(name) % SETTING_HASH_SIZE]; setting; setting = setting->hash_next)
   {
-    if (setting->proc == g_stressor_current)
-    {
-      found = true;
-    }
-    
-    if (found && ((setting->proc != g_stressor_current) && (!setting->global)))
-    {
-      break;
-    }
-    
-    if (!strcmp(setting->name, name))
+    if ((setting->index < end) && !strcmp(setting->name, name))
     {
       switch (setting->type_id)
       {
@@ -386,6 +527,8 @@ bool stress_get_setting(const char *name, void *value)
           DBG("%s: UNDEF: %s -> ?\n", __func__, name);
           break;
       }
+      
+      break;
     }
   }
   
@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#define STRESS_SWEEP_MAX  (64)    /* most --scale-sweep passes */
+
+/*
+ *  A scale sweep runs each stressor on its own once for each
+ *  instance count, smallest to largest, with the instances
+ *  pinned by --placement (compact by default) so that pass N
+ *  always runs on the same N CPUs. The throughput of the passes
+ *  is fitted to the Universal Scalability Law
+ *
+ *    X(N) = X(1) * N / (1 + sigma * (N - 1) + kappa * N * (N - 1))
+ *
+ *  where sigma is the contention (serialisation) coefficient and
+ *  kappa the coherency (crosstalk) coefficient.
+ */
+typedef struct
+{
+  int32_t instances[STRESS_SWEEP_MAX];  /* instance count of each pass */
+  uint32_t passes;      /* number of passes */
+  stress_stressor_t *stressors;   /* stressors being swept */
+} stress_sweep_t;
+
+static stress_sweep_t sweep;
+
+/*
+ *  stress_sweep_cmp()
+ *  qsort comparison of instance counts
+ */
+static int stress_sweep_cmp(const void *p1, const void *p2)
+{
+  const int32_t i1 = *(const int32_t *)p1;
+  const int32_t i2 = *(const int32_t *)p2;
+  
+  return (i1 > i2) - (i1 < i2);
+}
+
+/*
+ *  stress_set_scale_sweep()
+ *  set the instance counts of the sweep passes, a comma
+ *  separated list or pow2 for powers of 2 up to the number
+ *  of online CPUs, or pow2:N for powers of 2 up to N; the
+ *  largest count is always included
+ */
+int stress_set_scale_sweep(const char *const opt)
+{
+  int32_t instances[STRESS_SWEEP_MAX];
+  uint32_t i, n = 0;
+  
+  if (!strncmp(opt, "pow2", 4))
+  {
+    int32_t max = stress_get_processors_online(), count;
+    
+    if (opt[4] == ':')
+    {
+      char *end;
+      const long val = strtol(opt + 5, &end, 10);
+      
+      if ((end == opt + 5) || *end || (val < 1) || (val > STRESS_PROCS_MAX))
+      {
+        goto err;
+      }
+      
+      max = (int32_t)val;
+    }
+    else if (opt[4])
+    {
+      goto err;
+    }
+    
+    for (count = 1; (count < max) && (n < STRESS_SWEEP_MAX - 1); count *= 2)
+    {
+      instances[n++] = count;
+    }
+    
+    instances[n++] = STRESS_MAXIMUM(max, 1);
+  }
+  else
+  {
+    const char *ptr = opt;
+    
+    while (*ptr)
+    {
+      char *end;
+      const long count = strtol(ptr, &end, 10);
+      
+      if ((end == ptr) || (count < 1) || (count > STRESS_PROCS_MAX) ||
+          (n >= STRESS_SWEEP_MAX) || ((*end != ',') && (*end != '\0')))
+      {
+        goto err;
+      }
+      
+      instances[n++] = (int32_t)count;
+      ptr = (*end == ',') ? end + 1 : end;
+    }
+  }
+  
+  if (!n)
+  {
+    goto err;
+  }
+  
+  /* run the passes in increasing order, without duplicates */
+  qsort(instances, n, sizeof(*instances), stress_sweep_cmp);
+  sweep.passes = 0;
+  
+  for (i = 0; i < n; i++)
+  {
+    if (!sweep.passes || (instances[i] != sweep.instances[sweep.passes - 1]))
+    {
+      sweep.instances[sweep.passes++] = instances[i];
+    }
+  }
+  
+  return 0;
+  
+err:
+  (void)fprintf(stderr, "scale-sweep '%s' not valid, use a comma separated "
+                "list of up to %d instance counts, pow2 or pow2:N\n",
+                opt, STRESS_SWEEP_MAX);
+  return -1;
+}
+
+/*
+ *  stress_sweep_enabled()
+ *  true if --scale-sweep is being used
+ */
+bool stress_sweep_enabled(void)
+{
+  return sweep.passes > 0;
+}
+
+/*
+ *  stress_sweep_passes()
+ *  number of passes of each stressor
+ */
+uint32_t stress_sweep_passes(void)
+{
+  return sweep.passes;
+}
+
+/*
+ *  stress_sweep_instances()
+ *  the instance count of a pass
+ */
+int32_t stress_sweep_instances(const uint32_t pass)
+{
+  return (pass < sweep.passes) ? sweep.instances[pass] : 0;
+}
+
+/*
+ *  stress_sweep_max_instances()
+ *  the largest instance count of the passes, the stressor
+ *  process and stats slots are sized for this
+ */
+int32_t stress_sweep_max_instances(void)
+{
+  return sweep.passes ? sweep.instances[sweep.passes - 1] : 0;
+}
+
+/*
+ *  stress_sweep_init()
+ *  allocate the per stressor pass results and pin the
+ *  instances compactly if no --placement is given, returns
+ *  -1 if out of memory
+ */
+int stress_sweep_init(stress_stressor_t *stressors_list)
+{
+  stress_stressor_t *ss;
+  int32_t policy = 0;
+  
+  if (!sweep.passes)
+  {
+    return 0;
+  }
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    uint32_t i;
+    
+    ss->sweep = calloc((size_t)sweep.passes, sizeof(*ss->sweep));
+    
+    if (!ss->sweep)
+    {
+      pr_err("cannot allocate %" PRIu32 " scale sweep passes\n", sweep.passes);
+      return -1;
+    }
+    
+    for (i = 0; i < sweep.passes; i++)
+    {
+      ss->sweep[i].instances = sweep.instances[i];
+    }
+  }
+  
+  sweep.stressors = stressors_list;
+  (void)stress_get_setting("placement", &policy);
+  
+  if (!policy)
+  {
+    (void)stress_set_placement("compact");
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_sweep_record()
+ *  record the bogo-op rate of one run of a pass
+ */
+void stress_sweep_record(stress_stressor_t *ss, const uint32_t pass, const double rate)
+{
+  if (ss->sweep && (pass < sweep.passes))
+  {
+    ss->sweep[pass].rate_sum += rate;
+    ss->sweep[pass].runs++;
+  }
+}
+
+/*
+ *  stress_sweep_rate()
+ *  the mean bogo-op rate of the runs of a pass
+ */
+static double stress_sweep_rate(const stress_sweep_pass_t *pass)
+{
+  return pass->runs ? pass->rate_sum / (double)pass->runs : 0.0;
+}
+
+/*
+ *  stress_sweep_usl()
+ *  least squares fit of the Universal Scalability Law to the
+ *  passes of a stressor. With the speedup C(N) = X(N) / X(1) the
+ *  law is linear in the coefficients,
+ *
+ *    N / C(N) - 1 = sigma * (N - 1) + kappa * N * (N - 1)
+ *
+ *  If there is no single instance pass then X(1) is taken to be
+ *  the per instance rate of the smallest pass. Coefficients that
+ *  fit as negative are clamped to zero and the other is refitted.
+ *  Returns false if there are less than two passes of more than
+ *  one instance to fit.
+ */
+static bool stress_sweep_usl(
+  const stress_sweep_pass_t *passes,
+  const uint32_t n,
+  const double x1,
+  double *sigma,
+  double *kappa)
+{
+  double saa = 0.0, sab = 0.0, sbb = 0.0, say = 0.0, sby = 0.0, det;
+  uint32_t i, points = 0;
+  
+  *sigma = 0.0;
+  *kappa = 0.0;
+  
+  for (i = 0; i < n; i++)
+  {
+    const double rate = stress_sweep_rate(&passes[i]);
+    const double count = (double)passes[i].instances;
+    double a, b, y;
+    
+    if ((passes[i].instances < 2) || (rate <= 0.0))
+    {
+      continue;
+    }
+    
+    a = count - 1.0;
+    b = count * (count - 1.0);
+    y = (count / (rate / x1)) - 1.0;
+    saa += a * a;
+    sab += a * b;
+    sbb += b * b;
+    say += a * y;
+    sby += b * y;
+    points++;
+  }
+  
+  det = (saa * sbb) - (sab * sab);
+  
+  if ((points < 2) || (det <= 0.0))
+  {
+    return false;
+  }
+  
+  *sigma = ((say * sbb) - (sby * sab)) / det;
+  *kappa = ((sby * saa) - (say * sab)) / det;
+  
+  if (*kappa < 0.0)
+  {
+    *kappa = 0.0;
+    *sigma = say / saa;
+  }
+  
+  if (*sigma < 0.0)
+  {
+    *sigma = 0.0;
+    *kappa = (sby > 0.0) ? sby / sbb : 0.0;
+  }
+  
+  return true;
+}
+
+/*
+ *  stress_sweep_usl_rate()
+ *  the bogo-op rate the fitted law predicts for count instances
+ */
+static double stress_sweep_usl_rate(
+  const double x1,
+  const double sigma,
+  const double kappa,
+  const double count)
+{
+  return x1 * count / (1.0 + (sigma * (count - 1.0)) + (kappa * count * (count - 1.0)));
+}
+
+/*
+ *  stress_sweep_report()
+ *  report the throughput, speedup and parallel efficiency of
+ *  each pass and the scalability law fit of each stressor
+ */
+void stress_sweep_report(FILE *yaml)
+{
+  stress_stressor_t *ss;
+  
+  if (!sweep.stressors)
+  {
+    return;
+  }
+  
+  pr_yaml(yaml, "scale-sweep:\n");
+  
+  for (ss = sweep.stressors; ss; ss = ss->next)
+  {
+    const char *munged = stress_munge_underscore(ss->stressor->name);
+    const stress_sweep_pass_t *first = NULL;
+    double x1, sigma, kappa;
+    uint32_t i;
+    bool fitted;
+    
+    for (i = 0; i < sweep.passes; i++)
+    {
+      if (ss->sweep[i].runs && (stress_sweep_rate(&ss->sweep[i]) > 0.0))
+      {
+        first = &ss->sweep[i];
+        break;
+      }
+    }
+    
+    if (!first)
+    {
+      pr_inf("scale-sweep: %s has no passes with bogo-ops\n", munged);
+      continue;
+    }
+    
+    /* rate of a single instance, measured or from the smallest pass */
+    x1 = stress_sweep_rate(first) / (double)first->instances;
+    fitted = stress_sweep_usl(ss->sweep, sweep.passes, x1, &sigma, &kappa);
+    pr_inf("scale-sweep: %s%s\n", munged, (first->instances > 1) ?
+           ", speedup relative to the smallest pass" : "");
+    pr_inf("scale-sweep: %9s %14s %9s %11s\n", "instances",
+           "bogo ops/s", "speedup", "efficiency");
+    pr_yaml(yaml, "    - stressor: %s\n", munged);
+    pr_yaml(yaml, "      single-instance-bogo-ops-per-second: %f\n", x1);
+    
+    if (fitted)
+    {
+      double r2, mean = 0.0, ss_res = 0.0, ss_tot = 0.0;
+      uint32_t n = 0;
+      
+      for (i = 0; i < sweep.passes; i++)
+      {
+        if (ss->sweep[i].runs)
+        {
+          mean += stress_sweep_rate(&ss->sweep[i]);
+          n++;
+        }
+      }
+      
+      mean /= (double)n;
+      
+      for (i = 0; i < sweep.passes; i++)
+      {
+        if (ss->sweep[i].runs)
+        {
+          const double rate = stress_sweep_rate(&ss->sweep[i]);
+          const double fit = stress_sweep_usl_rate(x1, sigma, kappa,
+                             (double)ss->sweep[i].instances);
+          
+          ss_res += (rate - fit) * (rate - fit);
+          ss_tot += (rate - mean) * (rate - mean);
+        }
+      }
+      
+      r2 = (ss_tot > 0.0) ? 1.0 - (ss_res / ss_tot) : 1.0;
+      pr_yaml(yaml, "      usl-contention: %f\n", sigma);
+      pr_yaml(yaml, "      usl-coherency: %f\n", kappa);
+      pr_yaml(yaml, "      usl-r-squared: %f\n", r2);
+      
+      if ((kappa > 0.0) && (sigma < 1.0))
+      {
+        const double peak = sqrt((1.0 - sigma) / kappa);
+        
+        pr_yaml(yaml, "      usl-peak-instances: %f\n", peak);
+        pr_yaml(yaml, "      usl-peak-bogo-ops-per-second: %f\n",
+                stress_sweep_usl_rate(x1, sigma, kappa, peak));
+      }
+    }
+    
+    pr_yaml(yaml, "      passes:\n");
+    
+    for (i = 0; i < sweep.passes; i++)
+    {
+      const stress_sweep_pass_t *pass = &ss->sweep[i];
+      const double rate = stress_sweep_rate(pass);
+      const double speedup = rate / x1;
+      
+      if (!pass->runs)
+      {
+        continue;
+      }
+      
+      pr_inf("scale-sweep: %9" PRId32 " %14.2f %9.2f %10.2f%%\n",
+             pass->instances, rate, speedup,
+             100.0 * speedup / (double)pass->instances);
+      pr_yaml(yaml, "        - instances: %" PRId32 "\n", pass->instances);
+      pr_yaml(yaml, "          runs: %" PRIu32 "\n", pass->runs);
+      pr_yaml(yaml, "          bogo-ops-per-second: %f\n", rate);
+      pr_yaml(yaml, "          speedup: %f\n", speedup);
+      pr_yaml(yaml, "          efficiency: %f\n", speedup / (double)pass->instances);
+    }
+    
+    if (fitted)
+    {
+      pr_inf("scale-sweep: %s USL contention (sigma) %.4f, coherency (kappa) %.6f\n",
+             munged, sigma, kappa);
+      
+      if ((kappa > 0.0) && (sigma < 1.0))
+      {
+        const double peak = sqrt((1.0 - sigma) / kappa);
+        
+        pr_inf("scale-sweep: %s USL predicts peak throughput of %.2f bogo "
+               "ops/s at %.1f instances\n", munged,
+               stress_sweep_usl_rate(x1, sigma, kappa, peak), peak);
+      }
+    }
+    else
+    {
+      pr_inf("scale-sweep: %s needs passes of at least two instance counts "
+             "above 1 for a USL fit\n", munged);
+    }
+    
+    pr_yaml(yaml, "\n");
+  }
+}
@@ -0,0 +1,597 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * This code is a complete clean re-write of the stress tool by
+ * Colin Ian King <colin.king@canonical.com> and attempts to be
+ * backwardly compatible with the stress tool by Amos Waterland
+ * <apw@rossby.metr.ou.edu> but has more stress tests and more
+ * functionality.
+ *
+ */
+#include "stress-ng.h"
+
+#if defined(HAVE_SYS_UN_H)
+#include <sys/un.h>
+#endif
+
+#define STRESS_TELEMETRY_BUF_SIZE (256 * KB)  /* pending output buffer */
+#define STRESS_TELEMETRY_FLUSH_NS (100000000ULL)  /* final flush wait */
+#define STRESS_TELEMETRY_FLUSH_TRIES  (10)    /* final flush attempts */
+
+#if defined(MSG_NOSIGNAL)
+#define STRESS_TELEMETRY_SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+#else
+#define STRESS_TELEMETRY_SEND_FLAGS (MSG_DONTWAIT)
+#endif
+
+/*
+ *  Telemetry is a stream of JSON records, one per line, written
+ *  by the parent while it waits for the stressors. Records are
+ *  formatted into a pending buffer and written out with
+ *  non-blocking writes, so a slow or stalled collector never
+ *  holds up the wait loop; if the buffer fills up then whole
+ *  records are dropped and counted rather than blocking.
+ */
+typedef struct
+{
+  stress_stressor_t *stressors; /* all the stressors being reported */
+  size_t n_stressors;   /* number of stressors */
+  int fd;       /* sink fd, -1 = disabled */
+  bool is_socket;     /* true if fd is a unix socket */
+  char *buf;      /* pending output */
+  size_t len;     /* bytes pending in buf */
+  size_t record;      /* start of record being formatted */
+  bool overflow;      /* record being formatted did not fit */
+  uint64_t dropped;   /* records dropped, buffer full */
+  double interval;    /* record interval, secs */
+  double time_start;    /* time telemetry started */
+  double time_next;   /* time next record is due */
+  double time_last;   /* time of the last record */
+  uint64_t *counters;   /* bogo-op counters at the last record */
+  stress_vmstat_snapshot_t snapshot;  /* system readings at the last record */
+} stress_telemetry_t;
+
+static stress_telemetry_t telemetry = { .fd = -1 };
+
+/*
+ *  stress_telemetry_enabled()
+ *  true if telemetry records are being streamed
+ */
+bool stress_telemetry_enabled(void)
+{
+  return telemetry.fd >= 0;
+}
+
+/*
+ *  stress_telemetry_open_socket()
+ *  connect to a unix stream socket, returns fd or -1 on error
+ */
+static int stress_telemetry_open_socket(const char *path)
+{
+#if defined(HAVE_SYS_UN_H) && \
+    defined(AF_UNIX)
+  struct sockaddr_un addr;
+  int fd;
+  
+  if (strlen(path) >= sizeof(addr.sun_path))
+  {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  
+  if (fd < 0)
+  {
+    return -1;
+  }
+  
+  (void)memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  (void)shim_strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+  
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+  {
+    const int err = errno;
+    
+    (void)close(fd);
+    errno = err;
+    return -1;
+  }
+  
+  (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+#else
+  (void)path;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/*
+ *  stress_telemetry_open()
+ *  open the telemetry sink, a unix socket if the name is
+ *  prefixed with unix: or is an existing socket, otherwise
+ *  a file. Returns -1 on error.
+ */
+static int stress_telemetry_open(const char *name)
+{
+  struct stat statbuf;
+  
+  if (!strncmp(name, "unix:", 5))
+  {
+    telemetry.is_socket = true;
+    return stress_telemetry_open_socket(name + 5);
+  }
+  
+  if ((stat(name, &statbuf) == 0) && S_ISSOCK(statbuf.st_mode))
+  {
+    telemetry.is_socket = true;
+    return stress_telemetry_open_socket(name);
+  }
+  
+  telemetry.is_socket = false;
+  return open(name, O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+}
+
+/*
+ *  stress_telemetry_flush()
+ *  write out as much pending output as the sink will take
+ *  without blocking
+ */
+static void stress_telemetry_flush(void)
+{
+  size_t done = 0;
+  
+  while (done < telemetry.len)
+  {
+    ssize_t ret;
+    
+    if (telemetry.is_socket)
+    {
+      ret = send(telemetry.fd, telemetry.buf + done,
+                 telemetry.len - done, STRESS_TELEMETRY_SEND_FLAGS);
+    }
+    else
+    {
+      ret = write(telemetry.fd, telemetry.buf + done,
+                  telemetry.len - done);
+    }
+    
+    if (ret < 0)
+    {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+      {
+        break;
+      }
+      
+      pr_inf("telemetry: write failed, errno=%d (%s), telemetry disabled\n",
+             errno, strerror(errno));
+      (void)close(telemetry.fd);
+      telemetry.fd = -1;
+      telemetry.len = 0;
+      return;
+    }
+    
+    if (ret == 0)
+    {
+      break;
+    }
+    
+    done += (size_t)ret;
+  }
+  
+  if (done)
+  {
+    (void)memmove(telemetry.buf, telemetry.buf + done, telemetry.len - done);
+    telemetry.len -= done;
+  }
+}
+
+/*
+ *  stress_telemetry_printf()
+ *  append formatted text to the record being formatted
+ */
+static void FORMAT(printf, 1, 2) stress_telemetry_printf(const char *fmt, ...)
+{
+  va_list ap;
+  int n;
+  const size_t room = STRESS_TELEMETRY_BUF_SIZE - telemetry.len;
+  
+  if (telemetry.overflow)
+  {
+    return;
+  }
+  
+  va_start(ap, fmt);
+  n = vsnprintf(telemetry.buf + telemetry.len, room, fmt, ap);
+  va_end(ap);
+  
+  if ((n < 0) || ((size_t)n >= room))
+  {
+    telemetry.overflow = true;
+    return;
+  }
+  
+  telemetry.len += (size_t)n;
+}
+
+/*
+ *  stress_telemetry_record_begin()
+ *  start a new record of the given type
+ */
+static void stress_telemetry_record_begin(const char *type, const double now)
+{
+  telemetry.record = telemetry.len;
+  telemetry.overflow = false;
+  stress_telemetry_printf("{\"type\":\"%s\",\"time\":%.6f", type,
+                          now - telemetry.time_start);
+}
+
+/*
+ *  stress_telemetry_record_end()
+ *  end the current record, drop it if it did not fit,
+ *  and write out what the sink will take
+ */
+static void stress_telemetry_record_end(void)
+{
+  stress_telemetry_printf("}\n");
+  
+  if (telemetry.overflow)
+  {
+    telemetry.len = telemetry.record;
+    telemetry.dropped++;
+  }
+  
+  stress_telemetry_flush();
+}
+
+/*
+ *  stress_telemetry_init()
+ *  open the --telemetry sink and write the start record,
+ *  returns -1 if the sink cannot be opened
+ */
+int stress_telemetry_init(stress_stressor_t *stressors_list)
+{
+  stress_stressor_t *ss;
+  char *name = NULL;
+  uint64_t interval_ns = STRESS_NANOSECOND;
+  bool first = true;
+  
+  (void)stress_get_setting("telemetry", &name);
+  
+  if (!name)
+  {
+    return 0;
+  }
+  
+  (void)stress_get_setting("sample-interval", &interval_ns);
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    telemetry.n_stressors++;
+  }
+  
+  telemetry.buf = malloc(STRESS_TELEMETRY_BUF_SIZE);
+  telemetry.counters = calloc(telemetry.n_stressors + 1, sizeof(*telemetry.counters));
+  
+  if (!telemetry.buf || !telemetry.counters)
+  {
+    pr_err("telemetry: cannot allocate buffers\n");
+    stress_telemetry_free();
+    return -1;
+  }
+  
+  telemetry.fd = stress_telemetry_open(name);
+  
+  if (telemetry.fd < 0)
+  {
+    pr_err("telemetry: cannot open %s, errno=%d (%s)\n",
+           name, errno, strerror(errno));
+    stress_telemetry_free();
+    return -1;
+  }
+  
+  telemetry.stressors = stressors_list;
+  telemetry.interval = (double)interval_ns / STRESS_NANOSECOND;
+  telemetry.time_start = stress_time_now();
+  telemetry.time_last = telemetry.time_start;
+  telemetry.time_next = telemetry.time_start + telemetry.interval;
+  stress_vmstat_snapshot(&telemetry.snapshot);
+  stress_telemetry_record_begin("start", telemetry.time_start);
+  stress_telemetry_printf(",\"version\":\"%s\",\"interval\":%.6f,\"stressors\":[",
+                          VERSION, telemetry.interval);
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    stress_telemetry_printf("%s{\"stressor\":\"%s\",\"instances\":%" PRId32 "}",
+                            first ? "" : ",",
+                            stress_munge_underscore(ss->stressor->name),
+                            ss->num_instances);
+    first = false;
+  }
+  
+  stress_telemetry_printf("]");
+  stress_telemetry_record_end();
+  return 0;
+}
+
+#define STRESS_TELEMETRY_DELTA(field)         \
+  ((cur->field > prev->field) ? (cur->field - prev->field) : 0)
+
+/*
+ *  stress_telemetry_vmstat()
+ *  add the vmstat readings since the last record
+ */
+static void stress_telemetry_vmstat(
+  const stress_vmstat_t *cur,
+  const stress_vmstat_t *prev,
+  const double scale)
+{
+  double ticks = (double)(STRESS_TELEMETRY_DELTA(user_time) +
+                          STRESS_TELEMETRY_DELTA(system_time) +
+                          STRESS_TELEMETRY_DELTA(idle_time) +
+                          STRESS_TELEMETRY_DELTA(wait_time) +
+                          STRESS_TELEMETRY_DELTA(stolen_time));
+  
+  ticks = (ticks > 0.0) ? 100.0 / ticks : 0.0;
+  stress_telemetry_printf(",\"vmstat\":{\"r\":%" PRIu64 ",\"b\":%" PRIu64
+                          ",\"swpd\":%" PRIu64 ",\"free\":%" PRIu64
+                          ",\"buff\":%" PRIu64 ",\"cache\":%" PRIu64,
+                          cur->procs_running, cur->procs_blocked,
+                          cur->swap_used, cur->memory_free,
+                          cur->memory_buff, cur->memory_cache);
+  stress_telemetry_printf(",\"si\":%.1f,\"so\":%.1f,\"bi\":%.1f,\"bo\":%.1f"
+                          ",\"in\":%.1f,\"cs\":%.1f",
+                          (double)STRESS_TELEMETRY_DELTA(swap_in) * scale,
+                          (double)STRESS_TELEMETRY_DELTA(swap_out) * scale,
+                          (double)STRESS_TELEMETRY_DELTA(block_in) * scale,
+                          (double)STRESS_TELEMETRY_DELTA(block_out) * scale,
+                          (double)STRESS_TELEMETRY_DELTA(interrupt) * scale,
+                          (double)STRESS_TELEMETRY_DELTA(context_switch) * scale);
+  stress_telemetry_printf(",\"us\":%.1f,\"sy\":%.1f,\"id\":%.1f,\"wa\":%.1f,\"st\":%.1f}",
+                          (double)STRESS_TELEMETRY_DELTA(user_time) * ticks,
+                          (double)STRESS_TELEMETRY_DELTA(system_time) * ticks,
+                          (double)STRESS_TELEMETRY_DELTA(idle_time) * ticks,
+                          (double)STRESS_TELEMETRY_DELTA(wait_time) * ticks,
+                          (double)STRESS_TELEMETRY_DELTA(stolen_time) * ticks);
+}
+
+/*
+ *  stress_telemetry_iostat()
+ *  add the iostat readings since the last record
+ */
+static void stress_telemetry_iostat(
+  const stress_iostat_t *cur,
+  const stress_iostat_t *prev,
+  const double scale)
+{
+  /* sectors are 512 bytes, so >> 1 to get stats in 1024 bytes */
+  stress_telemetry_printf(",\"iostat\":{\"inflight\":%" PRIu64
+                          ",\"rd-kb\":%.1f,\"wr-kb\":%.1f,\"dscd-kb\":%.1f"
+                          ",\"rd\":%.1f,\"wr\":%.1f,\"dscd\":%.1f}",
+                          cur->in_flight,
+                          (double)(STRESS_TELEMETRY_DELTA(read_sectors) >> 1) * scale,
+                          (double)(STRESS_TELEMETRY_DELTA(write_sectors) >> 1) * scale,
+                          (double)(STRESS_TELEMETRY_DELTA(discard_sectors) >> 1) * scale,
+                          (double)STRESS_TELEMETRY_DELTA(read_io) * scale,
+                          (double)STRESS_TELEMETRY_DELTA(write_io) * scale,
+                          (double)STRESS_TELEMETRY_DELTA(discard_io) * scale);
+}
+
+#undef STRESS_TELEMETRY_DELTA
+
+/*
+ *  stress_telemetry_system()
+ *  add the vmstat, iostat and thermal readings since the
+ *  last record to the current record, rates are per second
+ */
+static void stress_telemetry_system(const double dt)
+{
+  stress_vmstat_snapshot_t snapshot;
+  const double scale = (dt > 0.0) ? 1.0 / dt : 0.0;
+  
+  stress_vmstat_snapshot(&snapshot);
+  stress_telemetry_vmstat(&snapshot.vmstat, &telemetry.snapshot.vmstat, scale);
+  stress_telemetry_iostat(&snapshot.iostat, &telemetry.snapshot.iostat, scale);
+  stress_telemetry_printf(",\"therm\":{\"ghz\":%.2f,\"temp-max\":%.2f}",
+                          snapshot.cpu_ghz, snapshot.temp_max);
+  (void)memcpy(&telemetry.snapshot, &snapshot, sizeof(telemetry.snapshot));
+}
+
+/*
+ *  stress_telemetry_sample()
+ *  write a sample record of the bogo-op rates of all the
+ *  stressors and the system readings since the last record
+ */
+static void stress_telemetry_sample(const double now)
+{
+  stress_stressor_t *ss;
+  size_t i;
+  const double dt = now - telemetry.time_last;
+  
+  stress_telemetry_record_begin("sample", now);
+  stress_telemetry_printf(",\"stressors\":[");
+  
+  for (i = 0, ss = telemetry.stressors; ss && (i < telemetry.n_stressors); ss = ss->next, i++)
+  {
+    int32_t j;
+    uint64_t counter = 0, delta;
+    
+    for (j = 0; j < ss->num_instances; j++)
+    {
+      counter += ss->stats[j]->ci.counter;
+    }
+    
+    /* counters are zero'd at the start of each stressor run */
+    delta = (counter >= telemetry.counters[i]) ?
+            counter - telemetry.counters[i] : counter;
+    telemetry.counters[i] = counter;
+    stress_telemetry_printf("%s{\"stressor\":\"%s\",\"bogo-ops\":%" PRIu64
+                            ",\"bogo-ops-per-second\":%.3f}",
+                            i ? "," : "",
+                            stress_munge_underscore(ss->stressor->name),
+                            counter, (dt > 0.0) ? (double)delta / dt : 0.0);
+  }
+  
+  stress_telemetry_printf("]");
+  stress_telemetry_system(dt);
+  stress_telemetry_record_end();
+  telemetry.time_last = now;
+}
+
+/*
+ *  stress_telemetry_poll()
+ *  write a sample record if one is due, otherwise
+ *  try to write out any pending output
+ */
+void stress_telemetry_poll(void)
+{
+  double now;
+  
+  if (telemetry.fd < 0)
+  {
+    return;
+  }
+  
+  now = stress_time_now();
+  
+  if (now < telemetry.time_next)
+  {
+    if (telemetry.len)
+    {
+      stress_telemetry_flush();
+    }
+    
+    return;
+  }
+  
+  stress_telemetry_sample(now);
+  
+  /* Skip missed records rather than bunching them up */
+  do
+  {
+    telemetry.time_next += telemetry.interval;
+  }
+  while (telemetry.time_next <= now);
+}
+
+/*
+ *  stress_telemetry_finish()
+ *  write the end record with the run totals and the perf
+ *  counters of each stressor, these are only known once
+ *  the instances have exited. Pending output gets a short
+ *  while to drain before the sink is closed.
+ */
+void stress_telemetry_finish(const double duration)
+{
+  stress_stressor_t *ss;
+  int tries;
+  bool first = true;
+  
+  if (telemetry.fd < 0)
+  {
+    return;
+  }
+  
+  stress_telemetry_record_begin("end", stress_time_now());
+  stress_telemetry_printf(",\"duration\":%.6f,\"stressors\":[", duration);
+  
+  for (ss = telemetry.stressors; ss; ss = ss->next)
+  {
+    int32_t j;
+    uint64_t counter = 0;
+    
+    for (j = 0; j < ss->started_instances; j++)
+    {
+      counter += ss->stats[j]->ci.counter;
+    }
+    
+    stress_telemetry_printf("%s{\"stressor\":\"%s\",\"bogo-ops\":%" PRIu64,
+                            first ? "" : ",",
+                            stress_munge_underscore(ss->stressor->name),
+                            counter);
+    first = false;
+#if defined(STRESS_PERF_STATS) && \
+    defined(HAVE_LINUX_PERF_EVENT_H)
+    
+    if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+    {
+      char label[128];
+      uint64_t total;
+      int p;
+      bool first_perf = true;
+      
+      stress_telemetry_printf(",\"perf\":{");
+      
+      for (p = 0; stress_perf_stat_total(ss, p, label, sizeof(label), &total); p++)
+      {
+        if (total == STRESS_PERF_INVALID)
+        {
+          continue;
+        }
+        
+        stress_telemetry_printf("%s\"%s\":%" PRIu64, first_perf ? "" : ",",
+                                label, total);
+        first_perf = false;
+      }
+      
+      stress_telemetry_printf("}");
+    }
+    
+#endif
+    stress_telemetry_printf("}");
+  }
+  
+  stress_telemetry_printf("],\"dropped\":%" PRIu64, telemetry.dropped);
+  stress_telemetry_record_end();
+  
+  for (tries = 0; telemetry.len && (telemetry.fd >= 0) &&
+       (tries < STRESS_TELEMETRY_FLUSH_TRIES); tries++)
+  {
+    (void)shim_nanosleep_uint64(STRESS_TELEMETRY_FLUSH_NS);
+    stress_telemetry_flush();
+  }
+  
+  if (telemetry.dropped)
+  {
+    pr_inf("telemetry: %" PRIu64 " records dropped, sink too slow\n",
+           telemetry.dropped);
+  }
+  
+  if (telemetry.len)
+  {
+    pr_inf("telemetry: %zu bytes could not be written\n", telemetry.len);
+  }
+}
+
+/*
+ *  stress_telemetry_free()
+ *  close the sink and free the buffers
+ */
+void stress_telemetry_free(void)
+{
+  if (telemetry.fd >= 0)
+  {
+    (void)close(telemetry.fd);
+  }
+  
+  free(telemetry.buf);
+  free(telemetry.counters);
+  (void)memset(&telemetry, 0, sizeof(telemetry));
+  telemetry.fd = -1;
+}
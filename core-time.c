@@ -56,6 +56,36 @@ double stress_time_now(void)
   return stress_timeval_to_double(&now);
 }
 
+/*
+ *  stress_time_now_ns()
+ *  monotonic time in nanoseconds, for timing
+ *  short intervals such as per op latencies
+ */
+uint64_t stress_time_now_ns(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&  \
+    defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+  {
+    return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+  }
+  
+#endif
+  {
+    struct timeval now;
+    
+    if (gettimeofday(&now, NULL) < 0)
+    {
+      return 0;
+    }
+    
+    return ((uint64_t)now.tv_sec * STRESS_NANOSECOND) +
+           ((uint64_t)now.tv_usec * 1000);
+  }
+}
+
 /*
  *  stress_format_time()
  *  format a unit of time into human readable format
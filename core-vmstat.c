@@ -24,9 +24,165 @@
  */
 #include "stress-ng.h"
 
-static int32_t vmstat_delay = 0;
-static int32_t thermalstat_delay = 0;
-static int32_t iostat_delay = 0;
+#define STRESS_VMSTAT_SAMPLES_MAX (4096)  /* samples kept in the ring */
+#define STRESS_VMSTAT_MIN_NS    (10000000ULL) /* 10 milliseconds */
+#define STRESS_VMSTAT_MAX_NS    (3600ULL * STRESS_NANOSECOND)
+#define STRESS_VMSTAT_BUF_SIZE    (16384)   /* initial /proc read buffer size */
+#define STRESS_VMSTAT_BUF_MAX   (1024 * 1024) /* maximum /proc read buffer size */
+
+/* a vmstat and iostat sample in the shared ring */
+typedef struct
+{
+  double time;      /* time of the sample */
+  stress_vmstat_t vmstat;   /* raw vmstat counters */
+  stress_iostat_t iostat;   /* raw iostat counters */
+  stress_psi_t psi;   /* raw pressure stall totals */
+} stress_vmstat_sample_t;
+
+/*
+ *  The vmstat process writes the raw counters into a ring in
+ *  shared memory so that the parent can report them alongside
+ *  the bogo-op rate samples once the vmstat process has been
+ *  stopped. A sample is only published by bumping head after
+ *  it has been written, the oldest samples get overwritten on
+ *  long runs.
+ */
+typedef struct
+{
+  volatile uint64_t head;   /* samples written, next slot is head % max */
+  volatile uint64_t passes; /* sampling passes made */
+  volatile uint64_t cpu_ns; /* CPU time used by the vmstat process */
+  volatile double time_last;  /* time of the last sampling pass */
+  double time_start;    /* time sampling started */
+  double interval;    /* shortest vmstat or iostat interval */
+  bool vmstat;      /* vmstat counters are sampled */
+  bool iostat;      /* iostat counters are sampled */
+  stress_vmstat_sample_t samples[STRESS_VMSTAT_SAMPLES_MAX];
+} stress_vmstat_ring_t;
+
+static uint64_t vmstat_delay = 0;
+static uint64_t thermalstat_delay = 0;
+static uint64_t iostat_delay = 0;
+static stress_vmstat_ring_t *vmstat_ring = MAP_FAILED;
+
+#if defined(__linux__)
+/* files read on each sample, kept open and read with pread */
+typedef struct
+{
+  int stat_fd;      /* /proc/stat */
+  int meminfo_fd;     /* /proc/meminfo */
+  int vmstat_fd;      /* /proc/vmstat */
+  int iostat_fd;      /* /sys/block/$dev/stat */
+  int psi_cpu_fd;     /* /proc/pressure/cpu */
+  int psi_memory_fd;    /* /proc/pressure/memory */
+  int psi_io_fd;      /* /proc/pressure/io */
+  bool opened;      /* true once /proc files are opened */
+  bool iostat_opened;   /* true once iostat file is opened */
+  bool psi_opened;    /* true once pressure files are opened */
+  char *buf;      /* read buffer, grown as required */
+  size_t buf_size;    /* size of buf */
+} stress_vmstat_files_t;
+
+/* a field to parse, the name includes the separator */
+typedef struct
+{
+  const char *name;   /* field name at the start of a line */
+  const size_t len;   /* length of name */
+  uint64_t *value;    /* where to store the value */
+} stress_vmstat_field_t;
+
+#define STRESS_VMSTAT_FIELD(str, ptr) { str, sizeof(str) - 1, ptr }
+
+static stress_vmstat_files_t vmstat_files =
+{
+  -1, -1, -1, -1, -1, -1, -1, false, false, false, NULL, 0
+};
+
+/*
+ *  stress_vmstat_pread()
+ *  read a whole /proc or /sys file from the start into the
+ *  read buffer, the buffer is grown if the file does not fit,
+ *  returns the number of bytes read or -1 on failure
+ */
+static ssize_t stress_vmstat_pread(const int fd)
+{
+  ssize_t ret;
+  
+  if (fd < 0)
+  {
+    return -1;
+  }
+  
+  if (!vmstat_files.buf)
+  {
+    vmstat_files.buf = malloc(STRESS_VMSTAT_BUF_SIZE);
+    
+    if (!vmstat_files.buf)
+    {
+      return -1;
+    }
+    
+    vmstat_files.buf_size = STRESS_VMSTAT_BUF_SIZE;
+  }
+  
+  while ((ret = pread(fd, vmstat_files.buf, vmstat_files.buf_size - 1, 0)) ==
+         (ssize_t)vmstat_files.buf_size - 1)
+  {
+    char *buf;
+    
+    if (vmstat_files.buf_size >= STRESS_VMSTAT_BUF_MAX)
+    {
+      break;
+    }
+    
+    buf = realloc(vmstat_files.buf, vmstat_files.buf_size * 2);
+    
+    if (!buf)
+    {
+      break;
+    }
+    
+    vmstat_files.buf = buf;
+    vmstat_files.buf_size *= 2;
+  }
+  
+  if (ret < 0)
+  {
+    return -1;
+  }
+  
+  vmstat_files.buf[ret] = '\0';
+  return ret;
+}
+#endif
+
+/*
+ *  stress_vmstat_cpu_ns()
+ *  CPU time used by the calling process in nanoseconds
+ */
+static uint64_t stress_vmstat_cpu_ns(void)
+{
+  struct rusage usage;
+  
+#if defined(HAVE_CLOCK_GETTIME) &&  \
+    defined(CLOCK_PROCESS_CPUTIME_ID)
+  struct timespec ts;
+  
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0)
+  {
+    return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+  }
+  
+#endif
+  
+  if (shim_getrusage(RUSAGE_SELF, &usage) < 0)
+  {
+    return 0;
+  }
+  
+  return ((uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * STRESS_NANOSECOND) +
+         ((uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL);
+}
 
 #if defined(__FreeBSD__)
 static int freebsd_getsysctl(const char *name, void *ptr, size_t size)
@@ -63,16 +219,48 @@ static unsigned int freebsd_getsysctl_uint(const char *name)
 }
 #endif
 
+/*
+ *  stress_set_generic_stat()
+ *  set a statistics interval, units of ms or s,
+ *  no units are seconds
+ */
 static int stress_set_generic_stat(
   const char *const opt,
   const char *name,
-  int32_t *delay)
+  uint64_t *delay)
 {
-  *delay = stress_get_int32(opt);
+  char *end;
+  double val;
+  uint64_t scale;
+  
+  errno = 0;
+  val = strtod(opt, &end);
+  
+  if ((errno != 0) || (end == opt) || (val <= 0.0))
+  {
+    (void)fprintf(stderr, "Invalid %s interval '%s'\n", name, opt);
+    _exit(EXIT_FAILURE);
+  }
+  
+  if (!strcmp(end, "ms"))
+  {
+    scale = 1000000ULL;
+  }
+  else if (!*end || !strcmp(end, "s"))
+  {
+    scale = STRESS_NANOSECOND;
+  }
+  else
+  {
+    (void)fprintf(stderr, "Invalid %s interval units '%s', use ms or s\n", name, end);
+    _exit(EXIT_FAILURE);
+  }
+  
+  *delay = (uint64_t)(val * (double)scale);
   
-  if ((*delay < 1) || (*delay > 3600))
+  if ((*delay < STRESS_VMSTAT_MIN_NS) || (*delay > STRESS_VMSTAT_MAX_NS))
   {
-    (void)fprintf(stderr, "%s must in the range 1 to 3600.\n", name);
+    (void)fprintf(stderr, "%s must be in the range 10ms to 3600s.\n", name);
     _exit(EXIT_FAILURE);
   }
   
@@ -367,39 +555,54 @@ static char *stress_iostat_iostat_name(
 #if defined(__linux__)
 /*
  *  stress_read_iostat()
- *  read the stats from an iostat stat file, linux variant
+ *  read the stats from an iostat stat file, linux variant,
+ *  the file is kept open and re-read with pread
  */
 static void stress_read_iostat(const char *iostat_name, stress_iostat_t *iostat)
 {
-  FILE *fp;
-  fp = fopen(iostat_name, "r");
-  
-  if (fp)
-  {
-    int ret;
-    ret = fscanf(fp,
-                 "%" PRIu64 " %" PRIu64
-                 " %" PRIu64 " %" PRIu64
-                 " %" PRIu64 " %" PRIu64
-                 " %" PRIu64 " %" PRIu64
-                 " %" PRIu64 " %" PRIu64
-                 " %" PRIu64 " %" PRIu64
-                 " %" PRIu64 " %" PRIu64
-                 " %" PRIu64,
-                 &iostat->read_io, &iostat->read_merges,
-                 &iostat->read_sectors, &iostat->read_ticks,
-                 &iostat->write_io, &iostat->write_merges,
-                 &iostat->write_sectors, &iostat->write_ticks,
-                 &iostat->in_flight, &iostat->io_ticks,
-                 &iostat->time_in_queue,
-                 &iostat->discard_io, &iostat->discard_merges,
-                 &iostat->discard_sectors, &iostat->discard_ticks);
-    (void)fclose(fp);
+  uint64_t *const fields[] =
+  {
+    &iostat->read_io, &iostat->read_merges,
+    &iostat->read_sectors, &iostat->read_ticks,
+    &iostat->write_io, &iostat->write_merges,
+    &iostat->write_sectors, &iostat->write_ticks,
+    &iostat->in_flight, &iostat->io_ticks,
+    &iostat->time_in_queue,
+    &iostat->discard_io, &iostat->discard_merges,
+    &iostat->discard_sectors, &iostat->discard_ticks,
+  };
+  const char *ptr;
+  size_t i;
+  
+  if (!vmstat_files.iostat_opened)
+  {
+    vmstat_files.iostat_fd = open(iostat_name, O_RDONLY);
+    vmstat_files.iostat_opened = true;
+  }
+  
+  if (stress_vmstat_pread(vmstat_files.iostat_fd) <= 0)
+  {
+    return;
+  }
+  
+  for (ptr = vmstat_files.buf, i = 0; i < SIZEOF_ARRAY(fields); i++)
+  {
+    char *end;
     
-    if (ret != 15)
+    *fields[i] = (uint64_t)strtoull(ptr, &end, 10);
+    
+    if (end == ptr)
     {
-      (void)memset(iostat, 0, sizeof(*iostat));
+      break;
     }
+    
+    ptr = end;
+  }
+  
+  /* kernels before 4.18 do not have the discard fields */
+  if (i < 11)
+  {
+    (void)memset(iostat, 0, sizeof(*iostat));
   }
 }
 #else
@@ -413,20 +616,18 @@ static void stress_read_iostat(const char *iostat_name, stress_iostat_t *iostat)
 }
 #endif
 
+#define STRESS_IOSTAT_COPY(field) iostat->field = (iostat_current->field)
 #define STRESS_IOSTAT_DELTA(field)          \
-  iostat->field = ((iostat_current.field > iostat_prev.field) ? \
-                   (iostat_current.field - iostat_prev.field) : 0)
+  iostat->field = ((iostat_current->field > iostat_prev.field) ? \
+                   (iostat_current->field - iostat_prev.field) : 0)
 
 /*
  *  stress_get_iostat()
- *  read and compute delta since last read of iostats
+ *  compute delta of the iostats since the last call
  */
-static void stress_get_iostat(const char *iostat_name, stress_iostat_t *iostat)
+static void stress_get_iostat(const stress_iostat_t *iostat_current, stress_iostat_t *iostat)
 {
   static stress_iostat_t iostat_prev;
-  stress_iostat_t iostat_current;
-  (void)memset(&iostat_current, 0, sizeof(iostat_current));
-  stress_read_iostat(iostat_name, &iostat_current);
   STRESS_IOSTAT_DELTA(read_io);
   STRESS_IOSTAT_DELTA(read_merges);
   STRESS_IOSTAT_DELTA(read_sectors);
@@ -435,339 +636,162 @@ static void stress_get_iostat(const char *iostat_name, stress_iostat_t *iostat)
   STRESS_IOSTAT_DELTA(write_merges);
   STRESS_IOSTAT_DELTA(write_sectors);
   STRESS_IOSTAT_DELTA(write_ticks);
-  STRESS_IOSTAT_DELTA(in_flight);
+  STRESS_IOSTAT_COPY(in_flight);
   STRESS_IOSTAT_DELTA(io_ticks);
   STRESS_IOSTAT_DELTA(time_in_queue);
   STRESS_IOSTAT_DELTA(discard_io);
   STRESS_IOSTAT_DELTA(discard_merges);
   STRESS_IOSTAT_DELTA(discard_sectors);
   STRESS_IOSTAT_DELTA(discard_ticks);
-  (void)memcpy(&iostat_prev, &iostat_current, sizeof(iostat_prev));
+  (void)memcpy(&iostat_prev, iostat_current, sizeof(iostat_prev));
 }
 #endif
 
 #if defined(__linux__)
 /*
- *  stress_next_field()
- *  skip to next field, returns false if end of
- *  string and/or no next field.
+ *  stress_vmstat_parse()
+ *  scan the lines of buf for the given fields, stops
+ *  as soon as all the fields have been found
  */
-static bool stress_next_field(char **str)
+static void stress_vmstat_parse(
+  const char *buf,
+  const size_t len,
+  const stress_vmstat_field_t *fields,
+  const size_t n_fields)
 {
-  char *ptr = *str;
+  const char *ptr = buf, *const end = buf + len;
+  size_t found = 0;
   
-  while (*ptr && *ptr != ' ')
+  while ((ptr < end) && (found < n_fields))
   {
-    ptr++;
+    const char *eol = memchr(ptr, '\n', (size_t)(end - ptr));
+    size_t i;
+    
+    if (!eol)
+    {
+      eol = end;
+    }
+    
+    for (i = 0; i < n_fields; i++)
+    {
+      if (((size_t)(eol - ptr) > fields[i].len) &&
+          !memcmp(ptr, fields[i].name, fields[i].len))
+      {
+        *fields[i].value = (uint64_t)strtoull(ptr + fields[i].len, NULL, 10);
+        found++;
+        break;
+      }
+    }
+    
+    ptr = eol + 1;
   }
+}
+
+/*
+ *  stress_vmstat_parse_cpu()
+ *  parse the times of all the CPUs from the cpu line
+ *  at the start of /proc/stat
+ */
+static void stress_vmstat_parse_cpu(const char *buf, stress_vmstat_t *vmstat)
+{
+  uint64_t t[10];
+  const char *ptr;
+  size_t i;
   
-  if (!*ptr)
+  if (strncmp(buf, "cpu ", 4))
   {
-    return false;
+    return;
   }
   
-  while (*ptr == ' ')
-  {
-    ptr++;
-  }
+  (void)memset(t, 0, sizeof(t));
   
-  if (!*ptr)
+  for (ptr = buf + 4, i = 0; i < SIZEOF_ARRAY(t); i++)
   {
-    return false;
+    char *end;
+    
+    t[i] = (uint64_t)strtoull(ptr, &end, 10);
+    
+    if (end == ptr)
+    {
+      break;
+    }
+    
+    ptr = end;
   }
   
-  *str = ptr;
-  return true;
+  /* user and nice time */
+  vmstat->user_time = t[0] + t[1];
+  /* system time, irq and soft irq times are accounted as system time */
+  vmstat->system_time = t[2] + t[5] + t[6];
+  /* idle time */
+  vmstat->idle_time = t[3];
+  /* iowait time */
+  vmstat->wait_time = t[4];
+  /* stolen time, guest and guest nice times are added to stolen stats */
+  vmstat->stolen_time = t[7] + t[8] + t[9];
 }
 
 /*
  *  stress_read_vmstat()
- *  read vmstat statistics
+ *  read vmstat statistics, the /proc files are kept open and
+ *  re-read with pread and only the fields used are parsed
  */
 static void stress_read_vmstat(stress_vmstat_t *vmstat)
 {
-  FILE *fp;
-  char buffer[1024];
-  fp = fopen("/proc/stat", "r");
+  const stress_vmstat_field_t stat_fields[] =
+  {
+    STRESS_VMSTAT_FIELD("intr ", &vmstat->interrupt),
+    STRESS_VMSTAT_FIELD("ctxt ", &vmstat->context_switch),
+    STRESS_VMSTAT_FIELD("procs_running ", &vmstat->procs_running),
+    STRESS_VMSTAT_FIELD("procs_blocked ", &vmstat->procs_blocked),
+  };
+  const stress_vmstat_field_t meminfo_fields[] =
+  {
+    STRESS_VMSTAT_FIELD("MemFree:", &vmstat->memory_free),
+    STRESS_VMSTAT_FIELD("Buffers:", &vmstat->memory_buff),
+    STRESS_VMSTAT_FIELD("Cached:", &vmstat->memory_cache),
+    STRESS_VMSTAT_FIELD("SwapTotal:", &vmstat->swap_total),
+    STRESS_VMSTAT_FIELD("SwapFree:", &vmstat->swap_free),
+  };
+  const stress_vmstat_field_t vmstat_fields[] =
+  {
+    STRESS_VMSTAT_FIELD("pgpgin ", &vmstat->block_in),
+    STRESS_VMSTAT_FIELD("pgpgout ", &vmstat->block_out),
+    STRESS_VMSTAT_FIELD("pswpin ", &vmstat->swap_in),
+    STRESS_VMSTAT_FIELD("pswpout ", &vmstat->swap_out),
+  };
+  ssize_t len;
   
-  if (fp)
+  if (!vmstat_files.opened)
   {
-    while (fgets(buffer, sizeof(buffer), fp))
-    {
-      char *ptr = buffer;
-      
-      if (!strncmp(buffer, "cpu ", 4))
-      {
-        continue;
-      }
-      
-      if (!strncmp(buffer, "cpu", 3))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* user time */
-        vmstat->user_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* user time nice */
-        vmstat->user_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* system time */
-        vmstat->system_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* idle time */
-        vmstat->idle_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* iowait time */
-        vmstat->wait_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* irq time, account in system time */
-        vmstat->system_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* soft time, account in system time */
-        vmstat->system_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* stolen time */
-        vmstat->stolen_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* guest time, add to stolen stats */
-        vmstat->stolen_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* guest_nice time, add to stolen stats */
-        vmstat->stolen_time += (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-      }
-      
-      if (!strncmp(buffer, "intr", 4))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* interrupts */
-        vmstat->interrupt = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "ctxt", 4))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* context switches */
-        vmstat->context_switch = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "procs_running", 13))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* processes running */
-        vmstat->procs_running = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "procs_blocked", 13))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* procesess blocked */
-        vmstat->procs_blocked = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "swap", 4))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* swap in */
-        vmstat->swap_in = (uint64_t)atoll(ptr);
-        
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        /* swap out */
-        vmstat->swap_out = (uint64_t)atoll(ptr);
-      }
-    }
-    
-    (void)fclose(fp);
+    vmstat_files.stat_fd = open("/proc/stat", O_RDONLY);
+    vmstat_files.meminfo_fd = open("/proc/meminfo", O_RDONLY);
+    vmstat_files.vmstat_fd = open("/proc/vmstat", O_RDONLY);
+    vmstat_files.opened = true;
   }
   
-  fp = fopen("/proc/meminfo", "r");
+  len = stress_vmstat_pread(vmstat_files.stat_fd);
   
-  if (fp)
+  if (len > 0)
   {
-    while (fgets(buffer, sizeof(buffer), fp))
-    {
-      char *ptr = buffer;
-      
-      if (!strncmp(buffer, "MemFree", 7))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->memory_free = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "Buffers", 7))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->memory_buff = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "Cached", 6))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->memory_cache = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "SwapTotal", 9))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->swap_total = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "SwapUsed", 8))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->swap_used = (uint64_t)atoll(ptr);
-      }
-    }
-    
-    (void)fclose(fp);
+    stress_vmstat_parse_cpu(vmstat_files.buf, vmstat);
+    stress_vmstat_parse(vmstat_files.buf, (size_t)len, stat_fields, SIZEOF_ARRAY(stat_fields));
   }
   
-  fp = fopen("/proc/vmstat", "r");
+  len = stress_vmstat_pread(vmstat_files.meminfo_fd);
   
-  if (fp)
+  if (len > 0)
   {
-    while (fgets(buffer, sizeof(buffer), fp))
-    {
-      char *ptr = buffer;
-      
-      if (!strncmp(buffer, "pgpgin", 6))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->block_in = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "pgpgout", 7))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->block_out = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "pswpin", 6))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->swap_in = (uint64_t)atoll(ptr);
-      }
-      
-      if (!strncmp(buffer, "pswpout", 7))
-      {
-        if (!stress_next_field(&ptr))
-        {
-          continue;
-        }
-        
-        vmstat->swap_out = (uint64_t)atoll(ptr);
-      }
-    }
-    
-    (void)fclose(fp);
+    stress_vmstat_parse(vmstat_files.buf, (size_t)len, meminfo_fields, SIZEOF_ARRAY(meminfo_fields));
+    vmstat->swap_used = (vmstat->swap_total > vmstat->swap_free) ?
+                        vmstat->swap_total - vmstat->swap_free : 0;
+  }
+  
+  len = stress_vmstat_pread(vmstat_files.vmstat_fd);
+  
+  if (len > 0)
+  {
+    stress_vmstat_parse(vmstat_files.buf, (size_t)len, vmstat_fields, SIZEOF_ARRAY(vmstat_fields));
   }
 }
 #elif defined(__FreeBSD__)
@@ -800,22 +824,140 @@ static void stress_read_vmstat(stress_vmstat_t *vmstat)
 }
 #endif
 
-#define STRESS_VMSTAT_COPY(field) vmstat->field = (vmstat_current.field)
+#if defined(__linux__)
+/*
+ *  stress_vmstat_psi_parse()
+ *  parse the some and full stall totals of a pressure file
+ */
+static void stress_vmstat_psi_parse(const int fd, uint64_t *some, uint64_t *full)
+{
+  const char *ptr;
+  
+  if (stress_vmstat_pread(fd) <= 0)
+  {
+    return;
+  }
+  
+  for (ptr = vmstat_files.buf; ptr && *ptr; )
+  {
+    const char *total = strstr(ptr, "total=");
+    
+    if (!total)
+    {
+      break;
+    }
+    
+    if (!strncmp(ptr, "some ", 5))
+    {
+      *some = (uint64_t)strtoull(total + 6, NULL, 10);
+    }
+    else if (!strncmp(ptr, "full ", 5))
+    {
+      *full = (uint64_t)strtoull(total + 6, NULL, 10);
+    }
+    
+    ptr = strchr(total, '\n');
+    
+    if (ptr)
+    {
+      ptr++;
+    }
+  }
+}
+
+/*
+ *  stress_vmstat_psi()
+ *  read the system wide pressure stall totals, available
+ *  is false if the kernel does not support PSI
+ */
+void stress_vmstat_psi(stress_psi_t *psi)
+{
+  (void)memset(psi, 0, sizeof(*psi));
+  
+  if (!vmstat_files.psi_opened)
+  {
+    vmstat_files.psi_cpu_fd = open("/proc/pressure/cpu", O_RDONLY);
+    vmstat_files.psi_memory_fd = open("/proc/pressure/memory", O_RDONLY);
+    vmstat_files.psi_io_fd = open("/proc/pressure/io", O_RDONLY);
+    vmstat_files.psi_opened = true;
+  }
+  
+  if (vmstat_files.psi_cpu_fd < 0)
+  {
+    return;
+  }
+  
+  psi->available = true;
+  stress_vmstat_psi_parse(vmstat_files.psi_cpu_fd, &psi->cpu_some, &psi->cpu_full);
+  stress_vmstat_psi_parse(vmstat_files.psi_memory_fd, &psi->memory_some, &psi->memory_full);
+  stress_vmstat_psi_parse(vmstat_files.psi_io_fd, &psi->io_some, &psi->io_full);
+}
+
+/*
+ *  stress_vmstat_schedstat()
+ *  read the time the calling thread has spent running on
+ *  a CPU and runnable waiting for a CPU, returns -1 if
+ *  schedstats are not available
+ */
+int stress_vmstat_schedstat(uint64_t *run_ns, uint64_t *delay_ns)
+{
+  char buf[128];
+  
+  if ((system_read("/proc/thread-self/schedstat", buf, sizeof(buf) - 1) <= 0) &&
+      (system_read("/proc/self/schedstat", buf, sizeof(buf) - 1) <= 0))
+  {
+    return -1;
+  }
+  
+  if (sscanf(buf, "%" SCNu64 " %" SCNu64, run_ns, delay_ns) != 2)
+  {
+    return -1;
+  }
+  
+  return 0;
+}
+#else
+void stress_vmstat_psi(stress_psi_t *psi)
+{
+  (void)memset(psi, 0, sizeof(*psi));
+}
+
+int stress_vmstat_schedstat(uint64_t *run_ns, uint64_t *delay_ns)
+{
+  *run_ns = 0;
+  *delay_ns = 0;
+  return -1;
+}
+#endif
+
+/*
+ *  stress_vmstat_cpu_ticks()
+ *  get the busy and total CPU time ticks of all the CPUs,
+ *  total is zero if these cannot be determined
+ */
+void stress_vmstat_cpu_ticks(uint64_t *busy, uint64_t *total)
+{
+  stress_vmstat_t vmstat;
+  
+  (void)memset(&vmstat, 0, sizeof(vmstat));
+  stress_read_vmstat(&vmstat);
+  *busy = vmstat.user_time + vmstat.system_time;
+  *total = *busy + vmstat.idle_time + vmstat.wait_time + vmstat.stolen_time;
+}
+
+#define STRESS_VMSTAT_COPY(field) vmstat->field = (vmstat_current->field)
 #define STRESS_VMSTAT_DELTA(field)          \
-  vmstat->field = ((vmstat_current.field > vmstat_prev.field) ? \
-                   (vmstat_current.field - vmstat_prev.field) : 0)
+  vmstat->field = ((vmstat_current->field > vmstat_prev.field) ? \
+                   (vmstat_current->field - vmstat_prev.field) : 0)
 
 /*
  *  stress_get_vmstat()
- *  collect vmstat data, zero for initial read
+ *  compute vmstat data since the last call, zero for initial call
  */
-static void stress_get_vmstat(stress_vmstat_t *vmstat)
+static void stress_get_vmstat(const stress_vmstat_t *vmstat_current, stress_vmstat_t *vmstat)
 {
   static stress_vmstat_t vmstat_prev;
-  stress_vmstat_t vmstat_current;
-  (void)memset(&vmstat_current, 0, sizeof(vmstat_current));
   (void)memset(vmstat, 0, sizeof(*vmstat));
-  stress_read_vmstat(&vmstat_current);
   STRESS_VMSTAT_COPY(procs_running);
   STRESS_VMSTAT_COPY(procs_blocked);
   STRESS_VMSTAT_COPY(swap_total);
@@ -834,7 +976,7 @@ static void stress_get_vmstat(stress_vmstat_t *vmstat)
   STRESS_VMSTAT_DELTA(idle_time);
   STRESS_VMSTAT_DELTA(wait_time);
   STRESS_VMSTAT_DELTA(stolen_time);
-  (void)memcpy(&vmstat_prev, &vmstat_current, sizeof(vmstat_prev));
+  (void)memcpy(&vmstat_prev, vmstat_current, sizeof(vmstat_prev));
 }
 
 #if defined(__linux__)
@@ -942,20 +1084,245 @@ static double stress_get_cpu_ghz_average(void)
 }
 #endif
 
+/*
+ *  stress_vmstat_snapshot()
+ *  read the raw vmstat and iostat counters, the average CPU
+ *  frequency and the hottest thermal zone temperature, readings
+ *  that are not available are left as zero
+ */
+void stress_vmstat_snapshot(stress_vmstat_snapshot_t *snapshot)
+{
+#if defined(HAVE_SYS_SYSMACROS_H) &&  \
+    defined(__linux__)
+  static char iostat_name[PATH_MAX];
+  static bool iostat_checked;
+#endif
+#if defined(__linux__)
+  static stress_tz_info_t *tz_info_list;
+  static bool tz_checked;
+  stress_tz_info_t *tz_info;
+#endif
+  
+  (void)memset(snapshot, 0, sizeof(*snapshot));
+  stress_read_vmstat(&snapshot->vmstat);
+#if defined(HAVE_SYS_SYSMACROS_H) &&  \
+    defined(__linux__)
+  
+  if (!iostat_checked)
+  {
+    (void)stress_iostat_iostat_name(iostat_name, sizeof(iostat_name));
+    iostat_checked = true;
+  }
+  
+  if (*iostat_name)
+  {
+    stress_read_iostat(iostat_name, &snapshot->iostat);
+  }
+  
+#endif
+  snapshot->cpu_ghz = stress_get_cpu_ghz_average();
+#if defined(__linux__)
+  
+  if (!tz_checked)
+  {
+    (void)stress_tz_init(&tz_info_list);
+    tz_checked = true;
+  }
+  
+  for (tz_info = tz_info_list; tz_info; tz_info = tz_info->next)
+  {
+    const double temp = stress_get_tz_info(tz_info);
+    
+    if (temp > snapshot->temp_max)
+    {
+      snapshot->temp_max = temp;
+    }
+  }
+  
+#endif
+}
+
+/*
+ *  stress_vmstat_next()
+ *  advance the time the next reading is due, missed
+ *  readings are skipped rather than bunched up
+ */
+static inline void stress_vmstat_next(double *next, const double interval, const double now)
+{
+  do
+  {
+    *next += interval;
+  }
+  while (*next <= now);
+}
+
+/*
+ *  stress_vmstat_show()
+ *  show vmstat readings since the last time they were shown
+ */
+static void stress_vmstat_show(const stress_vmstat_t *vmstat_current, const double dt)
+{
+  static uint32_t vmstat_count = 0;
+  stress_vmstat_t vmstat;
+  double scale, ticks;
+  
+  stress_get_vmstat(vmstat_current, &vmstat);
+  scale = (dt > 0.0) ? 1.0 / dt : 0.0;
+  ticks = (double)(vmstat.user_time + vmstat.system_time + vmstat.idle_time +
+                   vmstat.wait_time + vmstat.stolen_time);
+  ticks = (ticks > 0.0) ? 100.0 / ticks : 0.0;
+  
+  if ((vmstat_count++ % 25) == 0)
+    pr_inf("vmstat %2s %2s %9s %9s %9s %9s "
+           "%4s %4s %6s %6s %4s %4s %2s %2s "
+           "%2s %2s %2s\n",
+           "r", "b", "swpd", "free", "buff",
+           "cache", "si", "so", "bi", "bo",
+           "in", "cs", "us", "sy", "id",
+           "wa", "st");
+  
+  pr_inf("vmstat %2" PRIu64 " %2" PRIu64 /* procs */
+         " %9" PRIu64 " %9" PRIu64  /* vm used */
+         " %9" PRIu64 " %9" PRIu64  /* memory_buff */
+         " %4.0f %4.0f"     /* si, so*/
+         " %6.0f %6.0f"     /* bi, bo*/
+         " %4.0f %4.0f"     /* int, cs*/
+         " %2.0f %2.0f"       /* us, sy */
+         " %2.0f %2.0f"       /* id, wa */
+         " %2.0f\n",      /* st */
+         vmstat.procs_running,
+         vmstat.procs_blocked,
+         vmstat.swap_used,
+         vmstat.memory_free,
+         vmstat.memory_buff,
+         vmstat.memory_cache,
+         (double)vmstat.swap_in * scale,
+         (double)vmstat.swap_out * scale,
+         (double)vmstat.block_in * scale,
+         (double)vmstat.block_out * scale,
+         (double)vmstat.interrupt * scale,
+         (double)vmstat.context_switch * scale,
+         (double)vmstat.user_time * ticks,
+         (double)vmstat.system_time * ticks,
+         (double)vmstat.idle_time * ticks,
+         (double)vmstat.wait_time * ticks,
+         (double)vmstat.stolen_time * ticks);
+}
+
+/*
+ *  stress_thermalstat_show()
+ *  show CPU frequency, load average and thermal zone readings
+ */
+static void stress_thermalstat_show(stress_tz_info_t *tz_info_list, const size_t tz_num)
+{
+  double min1, min5, min15, ghz;
+  char therms[1 + (tz_num * 7)];
+  char cpuspeed[6];
+#if defined(__linux__)
+  stress_tz_info_t *tz_info;
+  char *ptr;
+#endif
+  static uint32_t thermalstat_count = 0;
+  
+  (void)tz_info_list;
+  (void)memset(therms, 0, sizeof(therms));
+#if defined(__linux__)
+  
+  for (ptr = therms, tz_info = tz_info_list; tz_info; tz_info = tz_info->next)
+  {
+    (void)snprintf(ptr, 8, " %6.6s", tz_info->type);
+    ptr += 7;
+  }
+  
+#endif
+  
+  if ((thermalstat_count++ % 25) == 0)
+  {
+    pr_inf("therm:   GHz  LdA1  LdA5 LdA15 %s\n", therms);
+  }
+  
+#if defined(__linux__)
+  
+  for (ptr = therms, tz_info = tz_info_list; tz_info; tz_info = tz_info->next)
+  {
+    (void)snprintf(ptr, 8, " %6.2f", stress_get_tz_info(tz_info));
+    ptr += 7;
+  }
+  
+#endif
+  ghz = stress_get_cpu_ghz_average();
+  
+  if (ghz > 0.0)
+  {
+    (void)snprintf(cpuspeed, sizeof(cpuspeed), "%5.2f", ghz);
+  }
+  else
+  {
+    (void)shim_strlcpy(cpuspeed, "n/a", sizeof(cpuspeed));
+  }
+  
+  if (stress_get_load_avg(&min1, &min5, &min15) < 0)
+  {
+    pr_inf("therm: %5s %5.5s %5.5s %5.5s %s\n",
+           cpuspeed, "n/a", "n/a", "n/a", therms);
+  }
+  else
+  {
+    pr_inf("therm: %5s %5.2f %5.2f %5.2f %s\n",
+           cpuspeed, min1, min5, min15, therms);
+  }
+}
+
+#if defined(HAVE_SYS_SYSMACROS_H) &&  \
+    defined(__linux__)
+/*
+ *  stress_iostat_show()
+ *  show iostat readings since the last time they were shown
+ */
+static void stress_iostat_show(const stress_iostat_t *iostat_current, const double dt)
+{
+  static uint32_t iostat_count = 0;
+  const double scale = (dt > 0.0) ? 1.0 / dt : 0.0;
+  stress_iostat_t iostat;
+  
+  stress_get_iostat(iostat_current, &iostat);
+  
+  if ((iostat_count++ % 25) == 0)
+  {
+    pr_inf("iostat: Inflght  Rd K/s   Wr K/s Dscd K/s     Rd/s     Wr/s   Dscd/s\n");
+  }
+  
+  /* sectors are 512 bytes, so >> 1 to get stats in 1024 bytes */
+  pr_inf("iostat %7" PRIu64 " %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f\n",
+         iostat.in_flight,
+         (double)(iostat.read_sectors >> 1) * scale,
+         (double)(iostat.write_sectors >> 1) * scale,
+         (double)(iostat.discard_sectors >> 1) * scale,
+         (double)iostat.read_io * scale,
+         (double)iostat.write_io * scale,
+         (double)iostat.discard_io * scale);
+}
+#endif
+
 /*
  *  stress_vmstat_start()
- *  start vmstat statistics (1 per second)
+ *  start vmstat, thermalstat and iostat statistics, the vmstat
+ *  and iostat counters are also recorded in the sample ring
  */
 void stress_vmstat_start(void)
 {
-  stress_vmstat_t vmstat;
+  stress_vmstat_sample_t sample_local, *sample;
   size_t tz_num = 0;
   stress_tz_info_t *tz_info, *tz_info_list;
-  int32_t vmstat_sleep, thermalstat_sleep, iostat_sleep;
+  const double vmstat_interval = (double)vmstat_delay / STRESS_NANOSECOND;
+  const double thermalstat_interval = (double)thermalstat_delay / STRESS_NANOSECOND;
+  const double iostat_interval = (double)iostat_delay / STRESS_NANOSECOND;
+  double vmstat_next, thermalstat_next, iostat_next;
+  double vmstat_last, iostat_last, now;
+  bool iostat_enabled = false;
 #if defined(HAVE_SYS_SYSMACROS_H) &&  \
     defined(__linux__)
   char iostat_name[PATH_MAX];
-  stress_iostat_t iostat;
 #endif
   
   if ((vmstat_delay == 0) &&
@@ -965,10 +1332,27 @@ void stress_vmstat_start(void)
     return;
   }
   
+  if (vmstat_delay || iostat_delay)
+  {
+    vmstat_ring = (stress_vmstat_ring_t *)mmap(NULL, sizeof(*vmstat_ring),
+                  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    
+    if (vmstat_ring == MAP_FAILED)
+    {
+      pr_inf("vmstat: cannot allocate sample ring, samples will not be recorded\n");
+    }
+    else
+    {
+      vmstat_ring->time_start = stress_time_now();
+      vmstat_ring->time_last = vmstat_ring->time_start;
+      vmstat_ring->interval = (vmstat_delay && iostat_delay) ?
+                              STRESS_MINIMUM(vmstat_interval, iostat_interval) :
+                              (vmstat_delay ? vmstat_interval : iostat_interval);
+      vmstat_ring->vmstat = (vmstat_delay > 0);
+    }
+  }
+  
   tz_info_list = NULL;
-  vmstat_sleep = vmstat_delay;
-  thermalstat_sleep = thermalstat_delay;
-  iostat_sleep = iostat_delay;
   vmstat_pid = fork();
   
   if ((vmstat_pid < 0) || (vmstat_pid > 0))
@@ -976,11 +1360,6 @@ void stress_vmstat_start(void)
     return;
   }
   
-  if (vmstat_delay)
-  {
-    stress_get_vmstat(&vmstat);
-  }
-  
   if (thermalstat_delay)
   {
     stress_tz_init(&tz_info_list);
@@ -994,203 +1373,353 @@ void stress_vmstat_start(void)
 #if defined(HAVE_SYS_SYSMACROS_H) &&  \
     defined(__linux__)
   
-  if (stress_iostat_iostat_name(iostat_name, sizeof(iostat_name)) == NULL)
+  if (iostat_delay && stress_iostat_iostat_name(iostat_name, sizeof(iostat_name)))
   {
-    iostat_sleep = 0;
+    iostat_enabled = true;
   }
   
-  if (iostat_delay)
+#endif
+  
+  if (vmstat_ring != MAP_FAILED)
   {
-    stress_get_iostat(iostat_name, &iostat);
+    vmstat_ring->iostat = iostat_enabled;
   }
   
-#endif
+  /* initial readings, deltas are from these */
+  (void)memset(&sample_local, 0, sizeof(sample_local));
   
-  while (keep_stressing_flag())
+  if (vmstat_delay)
   {
-    int32_t sleep_delay = INT_MAX;
-    long clk_tick;
-    
-    if (vmstat_delay > 0)
-    {
-      sleep_delay = STRESS_MINIMUM(vmstat_delay, sleep_delay);
-    }
-    
-    if (thermalstat_delay > 0)
-    {
-      sleep_delay = STRESS_MINIMUM(thermalstat_delay, sleep_delay);
-    }
+    stress_vmstat_t vmstat;
     
+    stress_read_vmstat(&sample_local.vmstat);
+    stress_get_vmstat(&sample_local.vmstat, &vmstat);
+  }
+  
 #if defined(HAVE_SYS_SYSMACROS_H) &&  \
     defined(__linux__)
+  
+  if (iostat_enabled)
+  {
+    stress_iostat_t iostat;
     
-    if (iostat_delay > 0)
-    {
-      sleep_delay = STRESS_MINIMUM(iostat_delay, sleep_delay);
-    }
-    
+    stress_read_iostat(iostat_name, &sample_local.iostat);
+    stress_get_iostat(&sample_local.iostat, &iostat);
+  }
+  
 #endif
-    (void)sleep((unsigned int)sleep_delay);
-    /* This may change each time we get stats */
-    clk_tick = sysconf(_SC_CLK_TCK) * sysconf(_SC_NPROCESSORS_ONLN);
-    vmstat_sleep -= sleep_delay;
-    thermalstat_sleep -= sleep_delay;
-    iostat_sleep -= sleep_delay;
+  now = stress_time_now();
+  vmstat_last = iostat_last = now;
+  vmstat_next = now + vmstat_interval;
+  thermalstat_next = now + thermalstat_interval;
+  iostat_next = now + iostat_interval;
+  
+  while (keep_stressing_flag())
+  {
+    double next = 0.0;
+    bool vmstat_due, thermalstat_due, iostat_due;
     
-    if ((vmstat_delay > 0) && (vmstat_sleep <= 0))
+    if (vmstat_delay)
     {
-      vmstat_sleep = vmstat_delay;
+      next = vmstat_next;
     }
     
-    if ((thermalstat_delay > 0) && (thermalstat_sleep <= 0))
+    if (thermalstat_delay)
     {
-      thermalstat_sleep = thermalstat_delay;
+      next = (next > 0.0) ? STRESS_MINIMUM(next, thermalstat_next) : thermalstat_next;
     }
     
-    if ((iostat_delay > 0) && (iostat_sleep <= 0))
+    if (iostat_delay)
     {
-      iostat_sleep = iostat_delay;
+      next = (next > 0.0) ? STRESS_MINIMUM(next, iostat_next) : iostat_next;
     }
     
-    if (vmstat_sleep == vmstat_delay)
+    now = stress_time_now();
+    
+    if (next > now)
     {
-      double clk_tick_vmstat_delay = (double)clk_tick * (double)vmstat_delay;
-      static uint32_t vmstat_count = 0;
-      
-      if ((vmstat_count++ % 25) == 0)
-        pr_inf("vmstat %2s %2s %9s %9s %9s %9s "
-               "%4s %4s %6s %6s %4s %4s %2s %2s "
-               "%2s %2s %2s\n",
-               "r", "b", "swpd", "free", "buff",
-               "cache", "si", "so", "bi", "bo",
-               "in", "cs", "us", "sy", "id",
-               "wa", "st");
-               
-      stress_get_vmstat(&vmstat);
-      pr_inf("vmstat %2" PRIu64 " %2" PRIu64 /* procs */
-             " %9" PRIu64 " %9" PRIu64  /* vm used */
-             " %9" PRIu64 " %9" PRIu64  /* memory_buff */
-             " %4" PRIu64 " %4" PRIu64  /* si, so*/
-             " %6" PRIu64 " %6" PRIu64  /* bi, bo*/
-             " %4" PRIu64 " %4" PRIu64  /* int, cs*/
-             " %2.0f %2.0f"       /* us, sy */
-             " %2.0f %2.0f"       /* id, wa */
-             " %2.0f\n",      /* st */
-             vmstat.procs_running,
-             vmstat.procs_blocked,
-             vmstat.swap_total - vmstat.swap_used,
-             vmstat.memory_free,
-             vmstat.memory_buff,
-             vmstat.memory_cache,
-             vmstat.swap_in / (uint64_t)vmstat_delay,
-             vmstat.swap_out / (uint64_t)vmstat_delay,
-             vmstat.block_in / (uint64_t)vmstat_delay,
-             vmstat.block_out / (uint64_t)vmstat_delay,
-             vmstat.interrupt / (uint64_t)vmstat_delay,
-             vmstat.context_switch / (uint64_t)vmstat_delay,
-             100.0 * (double)vmstat.user_time / clk_tick_vmstat_delay,
-             100.0 * (double)vmstat.system_time / clk_tick_vmstat_delay,
-             100.0 * (double)vmstat.idle_time / clk_tick_vmstat_delay,
-             100.0 * (double)vmstat.wait_time / clk_tick_vmstat_delay,
-             100.0 * (double)vmstat.stolen_time / clk_tick_vmstat_delay);
+      (void)shim_nanosleep_uint64((uint64_t)((next - now) * STRESS_NANOSECOND));
     }
     
-    if (thermalstat_delay == thermalstat_sleep)
+    now = stress_time_now();
+    vmstat_due = vmstat_delay && (now >= vmstat_next);
+    thermalstat_due = thermalstat_delay && (now >= thermalstat_next);
+    iostat_due = iostat_delay && (now >= iostat_next);
+    
+    /*
+     *  The ring samples all the counters being collected so
+     *  that each sample is complete
+     */
+    if (vmstat_due || iostat_due)
     {
-      double min1, min5, min15, ghz;
-      char therms[1 + (tz_num * 7)];
-      char cpuspeed[6];
-#if defined(__linux__)
-      char *ptr;
-#endif
-      static uint32_t thermalstat_count = 0;
-      (void)memset(therms, 0, sizeof(therms));
-#if defined(__linux__)
+      sample = (vmstat_ring != MAP_FAILED) ?
+               &vmstat_ring->samples[vmstat_ring->head % STRESS_VMSTAT_SAMPLES_MAX] :
+               &sample_local;
+      (void)memset(sample, 0, sizeof(*sample));
+      sample->time = now;
       
-      for (ptr = therms, tz_info = tz_info_list; tz_info; tz_info = tz_info->next)
+      if (vmstat_delay)
       {
-        (void)snprintf(ptr, 8, " %6.6s", tz_info->type);
-        ptr += 7;
+        stress_read_vmstat(&sample->vmstat);
+        stress_vmstat_psi(&sample->psi);
       }
       
-#endif
-      
-      if ((thermalstat_count++ % 25) == 0)
-      {
-        pr_inf("therm:   GHz  LdA1  LdA5 LdA15 %s\n", therms);
-      }
-      
-#if defined(__linux__)
+#if defined(HAVE_SYS_SYSMACROS_H) &&  \
+    defined(__linux__)
       
-      for (ptr = therms, tz_info = tz_info_list; tz_info; tz_info = tz_info->next)
+      if (iostat_enabled)
       {
-        (void)snprintf(ptr, 8, " %6.2f", stress_get_tz_info(tz_info));
-        ptr += 7;
+        stress_read_iostat(iostat_name, &sample->iostat);
       }
       
 #endif
-      ghz = stress_get_cpu_ghz_average();
       
-      if (ghz > 0.0)
-      {
-        (void)snprintf(cpuspeed, sizeof(cpuspeed), "%5.2f", ghz);
-      }
-      else
+      if (vmstat_ring != MAP_FAILED)
       {
-        (void)shim_strlcpy(cpuspeed, "n/a", sizeof(cpuspeed));
+        /* publish the sample once it is complete */
+        shim_mb();
+        vmstat_ring->head++;
       }
       
-      if (stress_get_load_avg(&min1, &min5, &min15) < 0)
+      if (vmstat_due)
       {
-        pr_inf("therm: %5s %5.5s %5.5s %5.5s %s\n",
-               cpuspeed, "n/a", "n/a", "n/a", therms);
+        stress_vmstat_show(&sample->vmstat, now - vmstat_last);
+        vmstat_last = now;
+        stress_vmstat_next(&vmstat_next, vmstat_interval, now);
       }
-      else
+      
+      if (iostat_due)
       {
-        pr_inf("therm: %5s %5.2f %5.2f %5.2f %s\n",
-               cpuspeed, min1, min5, min15, therms);
-      }
-    }
-    
 #if defined(HAVE_SYS_SYSMACROS_H) &&  \
     defined(__linux__)
+        
+        if (iostat_enabled)
+        {
+          stress_iostat_show(&sample->iostat, now - iostat_last);
+        }
+        
+#endif
+        iostat_last = now;
+        stress_vmstat_next(&iostat_next, iostat_interval, now);
+      }
+    }
     
-    if (iostat_delay == iostat_sleep)
+    if (thermalstat_due)
     {
-      double clk_scale = (iostat_delay > 0) ? 1.0 / iostat_delay : 0.0;
-      static uint32_t iostat_count = 0;
-      
-      if ((iostat_count++ % 25) == 0)
-      {
-        pr_inf("iostat: Inflght  Rd K/s   Wr K/s Dscd K/s     Rd/s     Wr/s   Dscd/s\n");
-      }
-      
-      stress_get_iostat(iostat_name, &iostat);
-      /* sectors are 512 bytes, so >> 1 to get stats in 1024 bytes */
-      pr_inf("iostat %7.0f %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f\n",
-             (double)iostat.in_flight * clk_scale,
-             (double)(iostat.read_sectors >> 1) * clk_scale,
-             (double)(iostat.write_sectors >> 1) * clk_scale,
-             (double)(iostat.discard_sectors >> 1) * clk_scale,
-             (double)iostat.read_io * clk_scale,
-             (double)iostat.write_io * clk_scale,
-             (double)iostat.discard_io * clk_scale);
+      stress_thermalstat_show(tz_info_list, tz_num);
+      stress_vmstat_next(&thermalstat_next, thermalstat_interval, now);
     }
     
-#endif
+    if (vmstat_ring != MAP_FAILED)
+    {
+      vmstat_ring->cpu_ns = stress_vmstat_cpu_ns();
+      vmstat_ring->time_last = stress_time_now();
+      vmstat_ring->passes++;
+    }
   }
+  
+  _exit(EXIT_SUCCESS);
 }
 
 /*
  *  stress_vmstat_stop()
- *  stop vmstat statistics
+ *  stop vmstat statistics and report the CPU overhead of
+ *  the vmstat process
  */
 void stress_vmstat_stop(void)
 {
+  double elapsed;
+  
   if (vmstat_pid > 0)
   {
     int status;
     (void)kill(vmstat_pid, SIGKILL);
     (void)waitpid(vmstat_pid, &status, 0);
+    vmstat_pid = 0;
+  }
+  
+  if ((vmstat_ring == MAP_FAILED) || !vmstat_ring->passes)
+  {
+    return;
+  }
+  
+  elapsed = vmstat_ring->time_last - vmstat_ring->time_start;
+  
+  if (elapsed > 0.0)
+  {
+    pr_inf("vmstat: sampler used %.3f%% of a CPU, %.1f us per sampling pass, "
+           "%" PRIu64 " samples\n",
+           100.0 * (double)vmstat_ring->cpu_ns / (elapsed * STRESS_NANOSECOND),
+           (double)vmstat_ring->cpu_ns / ((double)vmstat_ring->passes * 1000.0),
+           vmstat_ring->head);
+  }
+}
+
+#define STRESS_VMSTAT_SAMPLE_DELTA(field)       \
+  ((double)((cur->field > prev->field) ? (cur->field - prev->field) : 0))
+
+/*
+ *  stress_vmstat_dump_sample()
+ *  dump the rates between two samples in the ring
+ */
+static void stress_vmstat_dump_sample(
+  FILE *yaml,
+  const stress_vmstat_sample_t *cur,
+  const stress_vmstat_sample_t *prev)
+{
+  const double dt = cur->time - prev->time;
+  const double scale = (dt > 0.0) ? 1.0 / dt : 0.0;
+  
+  pr_yaml(yaml, "        - time: %f\n", cur->time - g_shared->time_epoch);
+  
+  if (vmstat_ring->vmstat)
+  {
+    double ticks = STRESS_VMSTAT_SAMPLE_DELTA(vmstat.user_time) +
+                   STRESS_VMSTAT_SAMPLE_DELTA(vmstat.system_time) +
+                   STRESS_VMSTAT_SAMPLE_DELTA(vmstat.idle_time) +
+                   STRESS_VMSTAT_SAMPLE_DELTA(vmstat.wait_time) +
+                   STRESS_VMSTAT_SAMPLE_DELTA(vmstat.stolen_time);
+    
+    ticks = (ticks > 0.0) ? 100.0 / ticks : 0.0;
+    pr_yaml(yaml, "          r: %" PRIu64 "\n", cur->vmstat.procs_running);
+    pr_yaml(yaml, "          b: %" PRIu64 "\n", cur->vmstat.procs_blocked);
+    pr_yaml(yaml, "          swpd: %" PRIu64 "\n", cur->vmstat.swap_used);
+    pr_yaml(yaml, "          free: %" PRIu64 "\n", cur->vmstat.memory_free);
+    pr_yaml(yaml, "          buff: %" PRIu64 "\n", cur->vmstat.memory_buff);
+    pr_yaml(yaml, "          cache: %" PRIu64 "\n", cur->vmstat.memory_cache);
+    pr_yaml(yaml, "          si: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.swap_in) * scale);
+    pr_yaml(yaml, "          so: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.swap_out) * scale);
+    pr_yaml(yaml, "          bi: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.block_in) * scale);
+    pr_yaml(yaml, "          bo: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.block_out) * scale);
+    pr_yaml(yaml, "          in: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.interrupt) * scale);
+    pr_yaml(yaml, "          cs: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.context_switch) * scale);
+    pr_yaml(yaml, "          us: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.user_time) * ticks);
+    pr_yaml(yaml, "          sy: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.system_time) * ticks);
+    pr_yaml(yaml, "          id: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.idle_time) * ticks);
+    pr_yaml(yaml, "          wa: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.wait_time) * ticks);
+    pr_yaml(yaml, "          st: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(vmstat.stolen_time) * ticks);
+  }
+  
+  if (cur->psi.available && prev->psi.available)
+  {
+    /* stall totals are in usecs */
+    const double pc = (dt > 0.0) ? 100.0 / (dt * 1000000.0) : 0.0;
+    
+    pr_yaml(yaml, "          psi-cpu-some: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(psi.cpu_some) * pc);
+    pr_yaml(yaml, "          psi-cpu-full: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(psi.cpu_full) * pc);
+    pr_yaml(yaml, "          psi-memory-some: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(psi.memory_some) * pc);
+    pr_yaml(yaml, "          psi-memory-full: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(psi.memory_full) * pc);
+    pr_yaml(yaml, "          psi-io-some: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(psi.io_some) * pc);
+    pr_yaml(yaml, "          psi-io-full: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(psi.io_full) * pc);
+  }
+  
+  if (vmstat_ring->iostat)
+  {
+    /* sectors are 512 bytes, so / 2 to get stats in 1024 bytes */
+    pr_yaml(yaml, "          inflight: %" PRIu64 "\n", cur->iostat.in_flight);
+    pr_yaml(yaml, "          rd-kb: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(iostat.read_sectors) * scale / 2.0);
+    pr_yaml(yaml, "          wr-kb: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(iostat.write_sectors) * scale / 2.0);
+    pr_yaml(yaml, "          dscd-kb: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(iostat.discard_sectors) * scale / 2.0);
+    pr_yaml(yaml, "          rd: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(iostat.read_io) * scale);
+    pr_yaml(yaml, "          wr: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(iostat.write_io) * scale);
+    pr_yaml(yaml, "          dscd: %f\n", STRESS_VMSTAT_SAMPLE_DELTA(iostat.discard_io) * scale);
+  }
+}
+
+#undef STRESS_VMSTAT_SAMPLE_DELTA
+
+/*
+ *  stress_vmstat_dump()
+ *  dump the vmstat and iostat time series and the start and
+ *  finish of each stressor, times are on the same time base
+ *  as the bogo-op rate samples
+ */
+void stress_vmstat_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+  stress_stressor_t *ss;
+  uint64_t head, count, i;
+  double elapsed;
+  
+  if ((vmstat_ring == MAP_FAILED) || (vmstat_ring->head < 2))
+  {
+    return;
+  }
+  
+  head = vmstat_ring->head;
+  count = STRESS_MINIMUM(head, (uint64_t)STRESS_VMSTAT_SAMPLES_MAX);
+  elapsed = vmstat_ring->time_last - vmstat_ring->time_start;
+  
+  pr_yaml(yaml, "vmstat-samples:\n");
+  pr_yaml(yaml, "      interval: %f\n", vmstat_ring->interval);
+  pr_yaml(yaml, "      samples: %" PRIu64 "\n", count - 1);
+  pr_yaml(yaml, "      dropped: %" PRIu64 "\n", head - count);
+  
+  if ((elapsed > 0.0) && vmstat_ring->passes)
+  {
+    pr_yaml(yaml, "      sampler-cpu-percent: %f\n",
+            100.0 * (double)vmstat_ring->cpu_ns / (elapsed * STRESS_NANOSECOND));
+    pr_yaml(yaml, "      sampler-usecs-per-pass: %f\n",
+            (double)vmstat_ring->cpu_ns / ((double)vmstat_ring->passes * 1000.0));
+  }
+  
+  pr_yaml(yaml, "      time-series:\n");
+  
+  for (i = head - count + 1; i < head; i++)
+  {
+    stress_vmstat_dump_sample(yaml,
+                              &vmstat_ring->samples[i % STRESS_VMSTAT_SAMPLES_MAX],
+                              &vmstat_ring->samples[(i - 1) % STRESS_VMSTAT_SAMPLES_MAX]);
+  }
+  
+  pr_yaml(yaml, "      phases:\n");
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    double start = 0.0, finish = 0.0;
+    int32_t j;
+    
+    for (j = 0; j < ss->num_instances; j++)
+    {
+      const stress_stats_t *stats = ss->stats[j];
+      
+      if (!stats || (stats->start <= 0.0))
+      {
+        continue;
+      }
+      
+      if ((start <= 0.0) || (stats->start < start))
+      {
+        start = stats->start;
+      }
+      
+      if (stats->finish > finish)
+      {
+        finish = stats->finish;
+      }
+    }
+    
+    if (start <= 0.0)
+    {
+      continue;
+    }
+    
+    pr_yaml(yaml, "        - stressor: %s\n", stress_munge_underscore(ss->stressor->name));
+    pr_yaml(yaml, "          start: %f\n", start - g_shared->time_epoch);
+    pr_yaml(yaml, "          finish: %f\n", finish - g_shared->time_epoch);
+  }
+  
+  pr_yaml(yaml, "\n");
+}
+
+/*
+ *  stress_vmstat_free()
+ *  free the vmstat sample ring
+ */
+void stress_vmstat_free(void)
+{
+  if (vmstat_ring != MAP_FAILED)
+  {
+    (void)munmap((void *)vmstat_ring, sizeof(*vmstat_ring));
+    vmstat_ring = MAP_FAILED;
   }
 }
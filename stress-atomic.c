@@ -24,6 +24,8 @@
  */
 #include "stress-ng.h"
 
+#define STRESS_ATOMIC_BATCH (64) /* bogo ops per counter update */
+
 #if defined(HAVE_ATOMIC_ADD_FETCH)
   #define HAVE_ATOMIC_OPS
   #define SHIM_ATOMIC_ADD_FETCH(ptr, val, memorder) do { __atomic_add_fetch(ptr, val, memorder); } while (0)
@@ -251,11 +253,18 @@ static int stress_atomic(const stress_args_t *args)
   
   do
   {
-    stress_atomic_uint64();
-    stress_atomic_uint32();
-    stress_atomic_uint16();
-    stress_atomic_uint8();
-    inc_counter(args);
+    const uint64_t n = batch_counter(args, STRESS_ATOMIC_BATCH);
+    uint64_t i;
+    
+    for (i = 0; i < n; i++)
+    {
+      stress_atomic_uint64();
+      stress_atomic_uint32();
+      stress_atomic_uint16();
+      stress_atomic_uint8();
+    }
+    
+    add_counter(args, n);
   }
   while (keep_stressing(args));
   
@@ -171,5 +171,6 @@ stressor_info_t stress_bsearch_info =
   .stressor = stress_bsearch,
   .class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
   .opt_set_funcs = opt_set_funcs,
-  .help = help
+  .help = help,
+  .thread_safe = true
 };
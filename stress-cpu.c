@@ -30,6 +30,7 @@
 #define PI    (3.14159265358979323846264338327950288419716939937511L)
 
 #define STATS_MAX   (250)
+#define STRESS_CPU_BATCH  (16)  /* bogo ops per counter update */
 #define FFT_SIZE    (4096)
 #define STRESS_CPU_DITHER_X (1024)
 #define STRESS_CPU_DITHER_Y (768)
@@ -3368,8 +3369,25 @@ static int HOT OPTIMIZE3 stress_cpu(const stress_args_t *args)
   {
     do
     {
-      (void)func(args->name);
-      inc_counter(args);
+      const uint64_t n = batch_counter(args, STRESS_CPU_BATCH);
+      uint64_t i;
+      
+      /*
+       *  Some methods are slow, so check for termination
+       *  after each one rather than at the end of the batch
+       */
+      for (i = 0; i < n; )
+      {
+        (void)func(args->name);
+        i++;
+        
+        if (!keep_stressing_flag())
+        {
+          break;
+        }
+      }
+      
+      add_counter(args, i);
     }
     while (keep_stressing(args));
     
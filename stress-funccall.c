@@ -1114,5 +1114,6 @@ stressor_info_t stress_funccall_info =
   .set_default = stress_funccall_set_default,
   .class = CLASS_CPU,
   .opt_set_funcs = opt_set_funcs,
-  .help = help
+  .help = help,
+  .thread_safe = true
 };
@@ -337,5 +337,6 @@ stressor_info_t stress_funcret_info =
   .set_default = stress_funcret_set_default,
   .class = CLASS_CPU,
   .opt_set_funcs = opt_set_funcs,
-  .help = help
+  .help = help,
+  .thread_safe = true
 };
@@ -115,6 +115,7 @@ again:
     {
       /* Small timeout to force rapid timer wakeups */
       const struct timespec t = { .tv_sec = 0, .tv_nsec = 5000 };
+      uint64_t t_lat;
       int ret;
       
       /* Break early before potential long wait */
@@ -123,6 +124,7 @@ again:
         break;
       }
       
+      t_lat = stress_latency_begin(args);
       ret = shim_futex_wait(futex, 0, &t);
       
       /* timeout, re-do, stress on stupid fast polling */
@@ -148,6 +150,7 @@ again:
                   args->name, errno, strerror(errno));
         }
         
+        stress_latency_end(args, t_lat);
         inc_counter(args);
       }
     }
@@ -634,7 +634,7 @@ static int stress_hdd(const stress_args_t *args)
 {
   uint8_t *buf = NULL;
   void *alloc_buf;
-  uint64_t i, min_size, size_remainder;
+  uint64_t i, min_size, size_remainder, t_lat;
   int rc = EXIT_FAILURE;
   ssize_t ret;
   char filename[PATH_MAX];
@@ -907,6 +907,7 @@ rnd_wr_retry:
           buf[j] = data_value(offset, j, args);
         }
         
+        t_lat = stress_latency_begin(args);
         ret = stress_hdd_write(fd, buf, offset,
                                hdd_write_size, hdd_flags);
                                
@@ -933,6 +934,7 @@ rnd_wr_retry:
           continue;
         }
         
+        stress_latency_end(args, t_lat);
         inc_counter(args);
       }
       
@@ -958,6 +960,7 @@ seq_wr_retry:
           buf[j] = data_value(i, j, args);
         }
         
+        t_lat = stress_latency_begin(args);
         ret = stress_hdd_write(fd, buf, (off_t)i,
                                hdd_write_size, hdd_flags);
                                
@@ -984,6 +987,7 @@ seq_wr_retry:
           continue;
         }
         
+        stress_latency_end(args, t_lat);
         inc_counter(args);
       }
     }
@@ -1016,6 +1020,7 @@ seq_rd_retry:
           goto yielded;
         }
         
+        t_lat = stress_latency_begin(args);
         ret = stress_hdd_read(fd, buf, (off_t)i,
                               hdd_write_size, hdd_flags);
                               
@@ -1042,6 +1047,8 @@ seq_rd_retry:
           continue;
         }
         
+        stress_latency_end(args, t_lat);
+        
         if (ret != (ssize_t)hdd_write_size)
         {
           misreads++;
@@ -1121,6 +1128,7 @@ rnd_rd_retry:
           goto yielded;
         }
         
+        t_lat = stress_latency_begin(args);
         ret = stress_hdd_read(fd, buf, (off_t)offset,
                               hdd_write_size, hdd_flags);
                               
@@ -1147,6 +1155,8 @@ rnd_rd_retry:
           continue;
         }
         
+        stress_latency_end(args, t_lat);
+        
         if (ret != (ssize_t)hdd_write_size)
         {
           misreads++;
@@ -146,5 +146,6 @@ stressor_info_t stress_lsearch_info =
   .stressor = stress_lsearch,
   .class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
   .opt_set_funcs = opt_set_funcs,
-  .help = help
+  .help = help,
+  .thread_safe = true
 };
@@ -235,16 +235,16 @@ static void OPTIMIZE3 stress_memrate_init_data(
 static inline void *stress_memrate_mmap(const stress_args_t *args, uint64_t sz)
 {
   void *ptr;
-  ptr = mmap(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
+  ptr = stress_numa_mmap(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
 #if defined(MAP_POPULATE)
-             MAP_POPULATE |
+                         MAP_POPULATE |
 #endif
 #if defined(HAVE_MADVISE)
-             MAP_PRIVATE |
+                         MAP_PRIVATE |
 #else
-             MAP_SHARED |
+                         MAP_SHARED |
 #endif
-             MAP_ANONYMOUS, -1, 0);
+                         MAP_ANONYMOUS, -1, 0);
              
   /* Coverity Scan believes NULL can be returned, doh */
   if (!ptr || (ptr == MAP_FAILED))
@@ -307,7 +307,7 @@ static int stress_memrate_child(const stress_args_t *args, void *ctxt)
   }
   while (keep_stressing(args));
   
-  (void)munmap(buffer, context->memrate_bytes);
+  (void)stress_numa_munmap(args, buffer, context->memrate_bytes);
   return EXIT_SUCCESS;
 }
 
@@ -563,7 +563,7 @@ static int stress_memthrash_child(const stress_args_t *args, void *ctxt)
   (void)memset(pthreads, 0, sizeof(pthreads));
   (void)memset(pthreads_ret, 0, sizeof(pthreads_ret));
 mmap_retry:
-  mem = mmap(NULL, MEM_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+  mem = stress_numa_mmap(NULL, MEM_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
   
   if (mem == MAP_FAILED)
   {
@@ -633,7 +633,7 @@ reap:
   }
   
 reap_mem:
-  (void)munmap(mem, MEM_SIZE);
+  (void)stress_numa_munmap(args, mem, MEM_SIZE);
   return EXIT_SUCCESS;
 }
 
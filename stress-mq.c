@@ -492,7 +492,7 @@ again:
       int ret;
       unsigned int prio = stress_mwc8() % PRIOS_MAX;
       const uint64_t timed = (msg.value & 1);
-      uint64_t i = 0;
+      uint64_t i = 0, t_lat;
       
       if ((attr_count++ & 31) == 0)
       {
@@ -527,6 +527,8 @@ again:
       /*
        * toggle between timedsend and send
        */
+      t_lat = stress_latency_begin(args);
+      
       if (do_timed && (timed))
       {
         ret = mq_timedsend(mq, (char *)&msg, sizeof(msg), prio, &abs_timeout);
@@ -547,6 +549,8 @@ again:
         break;
       }
       
+      stress_latency_end(args, t_lat);
+      
       if (!(i & 1023))
       {
         if (do_timed && (timed))
@@ -406,7 +406,9 @@ again:
     
     do
     {
+      uint64_t t_lat;
       msg.mtype = (msg_types) ? (stress_mwc8() % msg_types) + 1 : 1;
+      t_lat = stress_latency_begin(args);
       
       if (msgsnd(msgq_id, &msg, sizeof(msg.value), 0) < 0)
       {
@@ -417,6 +419,7 @@ again:
         break;
       }
       
+      stress_latency_end(args, t_lat);
       msg.value++;
       inc_counter(args);
       
@@ -59,15 +59,19 @@ static const stress_opt_flag_t opt_flags[] =
 {
   { OPT_abort,    OPT_FLAGS_ABORT },
   { OPT_aggressive, OPT_FLAGS_AGGRESSIVE_MASK },
+  { OPT_cgroup_per_stressor, OPT_FLAGS_CGROUP },
   { OPT_cpu_online_all, OPT_FLAGS_CPU_ONLINE_ALL },
   { OPT_dry_run,    OPT_FLAGS_DRY_RUN },
+  { OPT_fanout,   OPT_FLAGS_FANOUT },
   { OPT_ftrace,   OPT_FLAGS_FTRACE },
   { OPT_ignite_cpu, OPT_FLAGS_IGNITE_CPU },
   { OPT_keep_name,  OPT_FLAGS_KEEP_NAME },
+  { OPT_latency,    OPT_FLAGS_LATENCY },
   { OPT_log_brief,  OPT_FLAGS_LOG_BRIEF },
   { OPT_maximize,   OPT_FLAGS_MAXIMIZE },
   { OPT_metrics,    OPT_FLAGS_METRICS },
   { OPT_metrics_brief,  OPT_FLAGS_METRICS_BRIEF | OPT_FLAGS_METRICS },
+  { OPT_metrics_instances, OPT_FLAGS_METRICS_INSTANCES | OPT_FLAGS_METRICS },
   { OPT_minimize,   OPT_FLAGS_MINIMIZE },
   { OPT_no_oom_adjust,  OPT_FLAGS_NO_OOM_ADJUST },
   { OPT_no_rand_seed, OPT_FLAGS_NO_RAND_SEED },
@@ -78,6 +82,7 @@ static const stress_opt_flag_t opt_flags[] =
     defined(HAVE_LINUX_PERF_EVENT_H)
   { OPT_perf_stats, OPT_FLAGS_PERF_STATS },
 #endif
+  { OPT_repeat_reject,  OPT_FLAGS_REPEAT_REJECT },
   { OPT_skip_silent,  OPT_FLAGS_SKIP_SILENT },
   { OPT_smart,    OPT_FLAGS_SMART },
   { OPT_sock_nodelay, OPT_FLAGS_SOCKET_NODELAY },
@@ -270,6 +275,10 @@ static const struct option long_options[] =
   { "cache-no-affinity", 0, 0,  OPT_cache_no_affinity },
   { "cap",  1,  0,  OPT_cap },
   { "cap-ops",  1,  0,  OPT_cap_ops },
+  { "cgroup-cpu-max", 1,  0,  OPT_cgroup_cpu_max },
+  { "cgroup-io-max",  1,  0,  OPT_cgroup_io_max },
+  { "cgroup-memory-max",  1,  0,  OPT_cgroup_memory_max },
+  { "cgroup-per-stressor",0,  0,  OPT_cgroup_per_stressor },
   { "chattr", 1,  0,  OPT_chattr },
   { "chattr-ops", 1,  0,  OPT_chattr_ops },
   { "chdir",  1,  0,  OPT_chdir },
@@ -289,8 +298,11 @@ static const struct option long_options[] =
   { "clone-max",  1,  0,  OPT_clone_max },
   { "close",  1,  0,  OPT_close },
   { "close-ops",  1,  0,  OPT_close_ops },
+  { "compare",  1,  0,  OPT_compare },
+  { "compare-threshold", 1, 0, OPT_compare_threshold },
   { "context",  1,  0,  OPT_context },
   { "context-ops", 1,  0,  OPT_context_ops },
+  { "converge", 1,  0,  OPT_converge },
   { "copy-file",  1,  0,  OPT_copy_file },
   { "copy-file-ops", 1, 0,  OPT_copy_file_ops },
   { "copy-file-bytes", 1, 0,  OPT_copy_file_bytes },
@@ -384,6 +396,7 @@ static const struct option long_options[] =
   { "flock-ops",  1,  0,  OPT_flock_ops },
   { "fanotify", 1,  0,  OPT_fanotify },
   { "fanotify-ops", 1, 0,  OPT_fanotify_ops },
+  { "fanout", 0,  0,  OPT_fanout },
   { "fork", 1,  0,  OPT_fork },
   { "fork-ops", 1,  0,  OPT_fork_ops },
   { "fork-max", 1,  0,  OPT_fork_max },
@@ -439,6 +452,7 @@ static const struct option long_options[] =
   { "inode-flags-ops", 1,  0,  OPT_inode_flags_ops },
   { "inotify",  1,  0,  OPT_inotify },
   { "inotify-ops", 1,  0,  OPT_inotify_ops },
+  { "instance-mode",1,  0,  OPT_instance_mode },
   { "io",   1,  0,  OPT_io },
   { "io-ops", 1,  0,  OPT_io_ops },
   { "iomix",  1,  0,  OPT_iomix },
@@ -482,6 +496,7 @@ static const struct option long_options[] =
   { "l1cache-ways", 1, 0,  OPT_l1cache_ways},
   { "landlock", 1,  0,  OPT_landlock },
   { "landlock-ops", 1, 0,  OPT_landlock_ops },
+  { "latency",  0,  0,  OPT_latency },
   { "lease",  1,  0,  OPT_lease },
   { "lease-ops",  1,  0,  OPT_lease_ops },
   { "lease-breakers", 1, 0,  OPT_lease_breakers },
@@ -558,6 +573,7 @@ static const struct option long_options[] =
   { "mergesort-size", 1, 0,  OPT_mergesort_integers },
   { "metrics",  0,  0,  OPT_metrics },
   { "metrics-brief", 0,  0,  OPT_metrics_brief },
+  { "metrics-instances",0, 0,  OPT_metrics_instances },
   { "mincore",  1,  0,  OPT_mincore },
   { "mincore-ops", 1,  0,  OPT_mincore_ops },
   { "mincore-random", 0, 0,  OPT_mincore_rand },
@@ -627,7 +643,9 @@ static const struct option long_options[] =
   { "null-ops", 1,  0,  OPT_null_ops },
   { "numa", 1,  0,  OPT_numa },
   { "numa-ops", 1,  0,  OPT_numa_ops },
+  { "numa-policy",  1,  0,  OPT_numa_policy },
   { "oomable",  0,  0,  OPT_oomable },
+  { "ops-rate", 1,  0,  OPT_ops_rate },
   { "oom-pipe", 1,  0,  OPT_oom_pipe },
   { "oom-pipe-ops", 1, 0,  OPT_oom_pipe_ops },
   { "opcode", 1,  0,  OPT_opcode },
@@ -644,6 +662,7 @@ static const struct option long_options[] =
 #if defined(STRESS_PERF_STATS) &&   \
     defined(HAVE_LINUX_PERF_EVENT_H)
   { "perf", 0,  0,  OPT_perf_stats },
+  { "perf-sample",  1,  0,  OPT_perf_sample },
 #endif
   { "personality", 1,  0,  OPT_personality },
   { "personality-ops", 1,  0,  OPT_personality_ops },
@@ -664,6 +683,7 @@ static const struct option long_options[] =
   { "pipeherd-yield", 0,  0,  OPT_pipeherd_yield },
   { "pkey", 1,  0,  OPT_pkey },
   { "pkey-ops", 1,  0,  OPT_pkey_ops },
+  { "placement",  1,  0,  OPT_placement },
   { "poll", 1,  0,  OPT_poll },
   { "poll-ops", 1,  0,  OPT_poll_ops },
   { "poll-fds", 1,  0,  OPT_poll_fds },
@@ -718,6 +738,8 @@ static const struct option long_options[] =
   { "remap-ops",  1,  0,  OPT_remap_ops },
   { "rename", 1,  0,  OPT_rename },
   { "rename-ops", 1,  0,  OPT_rename_ops },
+  { "repeat", 1,  0,  OPT_repeat },
+  { "repeat-reject",0,  0,  OPT_repeat_reject },
   { "resched",  1,  0,  OPT_resched },
   { "resched-ops", 1,  0,  OPT_resched_ops },
   { "resources",  1,  0,  OPT_resources },
@@ -734,6 +756,9 @@ static const struct option long_options[] =
   { "rseq-ops", 1,  0,  OPT_rseq_ops },
   { "rtc",  1,  0,  OPT_rtc },
   { "rtc-ops",  1,  0,  OPT_rtc_ops },
+  { "sample-csv", 1,  0,  OPT_sample_csv },
+  { "sample-interval",1,  0,  OPT_sample_interval },
+  { "scale-sweep",1,  0,  OPT_scale_sweep },
   { "sched",  1,  0,  OPT_sched },
   { "sched-prio", 1,  0,  OPT_sched_prio },
   { "schedpolicy", 1,  0,  OPT_schedpolicy },
@@ -884,9 +909,12 @@ static const struct option long_options[] =
 #if defined(HAVE_SYSLOG_H)
   { "syslog", 0,  0,  OPT_syslog },
 #endif
+  { "target-load",1,  0,  OPT_target_load },
+  { "target-throughput",1,  0,  OPT_target_throughput },
   { "taskset",  1,  0,  OPT_taskset },
   { "tee",  1,  0,  OPT_tee },
   { "tee-ops",  1,  0,  OPT_tee_ops },
+  { "telemetry",  1,  0,  OPT_telemetry },
   { "temp-path",  1,  0,  OPT_temp_path },
   { "timeout",  1,  0,  OPT_timeout },
   { "timer",  1,  0,  OPT_timer },
@@ -986,6 +1014,7 @@ static const struct option long_options[] =
   { "vmstat", 1,  0,  OPT_vmstat },
   { "wait", 1,  0,  OPT_wait },
   { "wait-ops", 1,  0,  OPT_wait_ops },
+  { "warmup", 1,  0,  OPT_warmup },
   { "watchdog", 1,  0,  OPT_watchdog },
   { "watchdog-ops", 1, 0,  OPT_watchdog_ops },
   { "wcs",  1,  0,  OPT_wcs},
@@ -1024,34 +1053,54 @@ static const stress_help_t help_generic[] =
   { NULL,   "aggressive",   "enable all aggressive options" },
   { "a N",  "all N",    "start N workers of each stress test" },
   { "b N",  "backoff N",    "wait of N microseconds before work starts" },
+  { NULL,   "cgroup-cpu-max Q[/P]", "limit each stressor cgroup to Q of every P usecs" },
+  { NULL,   "cgroup-io-max L", "limit each stressor cgroup to io.max limits L" },
+  { NULL,   "cgroup-memory-max N", "limit each stressor cgroup to N bytes of memory" },
+  { NULL,   "cgroup-per-stressor",  "run each stressor in its own cgroup v2 cgroup" },
   { NULL,   "class name",   "specify a class of stressors, use with --sequential" },
+  { NULL,   "compare file",   "compare metrics against a baseline YAML file" },
+  { NULL,   "compare-threshold P", "flag regressions of more than P% (default 5%)" },
+  { NULL,   "converge P",   "stop when bogo-op rates vary by less than P%" },
   { "n",    "dry-run",    "do not run" },
+  { NULL,   "fanout",   "fork instances in parallel and start them together" },
   { NULL,   "ftrace",   "enable kernel function call tracing" },
   { "h",    "help",     "show help" },
   { NULL,   "ignite-cpu",   "alter kernel controls to make CPU run hot" },
+  { NULL,   "instance-mode M",  "run instances as fork'd processes or pthreads" },
   { NULL,   "ionice-class C", "specify ionice class (idle, besteffort, realtime)" },
   { NULL,   "ionice-level L", "specify ionice level (0 max, 7 min)" },
   { "j",    "job jobfile",    "run the named jobfile" },
   { "k",    "keep-name",    "keep stress worker names to be 'stress-ng'" },
+  { NULL,   "latency",    "record per operation latency histograms" },
   { NULL,   "log-brief",    "less verbose log messages" },
   { NULL,   "log-file filename",  "log messages to a log file" },
   { NULL,   "maximize",   "enable maximum stress options" },
   { NULL,   "max-fd",   "set maximum file descriptor limit" },
   { "M",    "metrics",    "print pseudo metrics of activity" },
   { NULL,   "metrics-brief",  "enable metrics and only show non-zero results" },
+  { NULL,   "metrics-instances",  "enable metrics and report every instance and its CPUs" },
   { NULL,   "minimize",   "enable minimal stress options" },
   { NULL,   "no-madvise",   "don't use random madvise options for each mmap" },
   { NULL,   "no-rand-seed",   "seed random numbers with the same constant" },
+  { NULL,   "numa-policy P",  "NUMA policy for stats and buffers, P = local, interleave or node=N" },
   { NULL,   "oomable",    "Do not respawn a stressor if it gets OOM'd" },
+  { NULL,   "ops-rate N",   "issue N bogo ops per second per instance, open loop" },
   { NULL,   "page-in",    "touch allocated pages that are not in core" },
   { NULL,   "parallel N",   "synonym for 'all N'" },
   { NULL,   "pathological",   "enable stressors that are known to hang a machine" },
 #if defined(STRESS_PERF_STATS) && \
     defined(HAVE_LINUX_PERF_EVENT_H)
   { NULL,   "perf",     "display perf statistics" },
+  { NULL,   "perf-sample N",  "sample and report the N hottest symbols per stressor" },
 #endif
+  { NULL,   "placement P",    "pin instances by CPU topology, P = spread, compact, per-llc, per-core or per-numa" },
   { "q",    "quiet",    "quiet output" },
   { "r",    "random N",   "start N random workers" },
+  { NULL,   "repeat N",   "repeat the run N times and summarise bogo-op rates" },
+  { NULL,   "repeat-reject",  "reject outlier runs from the --repeat summary" },
+  { NULL,   "sample-csv file",  "write bogo-op rate samples to a CSV file" },
+  { NULL,   "sample-interval T",  "sample bogo-op rates every T ns, us, ms or s" },
+  { NULL,   "scale-sweep L",  "run each stressor with the instance counts in list L or pow2[:N]" },
   { NULL,   "sched type",   "set scheduler type" },
   { NULL,   "sched-prio N",   "set scheduler priority level N" },
   { NULL,   "sched-period N", "set period for SCHED_DEADLINE to N nanosecs (Linux only)" },
@@ -1066,7 +1115,10 @@ static const stress_help_t help_generic[] =
 #if defined(HAVE_SYSLOG_H)
   { NULL,   "syslog",   "log messages to the syslog" },
 #endif
+  { NULL,   "target-load P",  "throttle stressors to hold system CPU load at P%" },
+  { NULL,   "target-throughput N",  "throttle stressors to hold N bogo ops per second" },
   { NULL,   "taskset",    "use specific CPUs (set CPU affinity)" },
+  { NULL,   "telemetry dest", "stream JSON-lines telemetry to a file or unix socket" },
   { NULL,   "temp-path path", "specify path for temporary directories and files" },
   { NULL,   "thrash",   "force all pages in causing swap thrashing" },
   { "t N",  "timeout T",    "timeout after T seconds" },
@@ -1079,6 +1131,7 @@ static const stress_help_t help_generic[] =
   { "v",    "verbose",    "verbose output" },
   { NULL,   "verify",   "verify results (not available on all tests)" },
   { "V",    "version",    "show version" },
+  { NULL,   "warmup T",   "exclude the first T seconds from the metrics" },
   { "Y",    "yaml file",    "output results to YAML formatted file" },
   { "x",    "exclude",    "list of stressors to exclude (not run)" },
   { NULL,   NULL,     NULL }
@@ -1623,6 +1676,9 @@ static char *stress_exit_status_to_string(const int status)
     case EXIT_METRICS_UNTRUSTWORTHY:
       return "metrics may be untrustyworthy";
       
+    case EXIT_METRICS_REGRESSION:
+      return "metrics regressed from baseline";
+      
     default:
       return "unknown";
   }
@@ -1788,6 +1844,406 @@ static void stress_clean_dir(
   }
 }
 
+/*
+ *  stress_wait_exited()
+ *  handle the exit status of a reaped stressor instance
+ */
+static void MLOCKED_TEXT stress_wait_exited(
+  stress_stressor_t *ss,
+  const int32_t j,
+  const pid_t ret,
+  const int status,
+  bool *success,
+  bool *resource_success,
+  bool *metrics_success)
+{
+  bool do_abort = false;
+  const char *stressor_name = stress_munge_underscore(ss->stressor->name);
+  int wexit_status = WEXITSTATUS(status);
+  char name[64];
+  
+  /* write out what the instance logged before it exited */
+  pr_ring_drain();
+  (void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
+                 stress_munge_underscore(stressor_name));
+  
+  if (WIFSIGNALED(status))
+  {
+#if defined(WTERMSIG)
+#if NEED_GLIBC(2,1,0)
+    const char *signame = strsignal(WTERMSIG(status));
+    pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d (%s)\n",
+           ret, stressor_name,
+           WTERMSIG(status), signame);
+#else
+    pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d\n",
+           ret, stressor_name,
+           WTERMSIG(status));
+#endif
+#else
+    pr_dbg("process [%d] (stress-ng-%s) terminated on signal\n",
+           ret, stressor_name);
+#endif
+    
+    /*
+     *  If the stressor got killed by OOM or SIGKILL
+     *  then somebody outside of our control nuked it
+     *  so don't necessarily flag that up as a direct
+     *  failure.
+     */
+    if (stress_process_oomed(ret))
+    {
+      pr_dbg("process [%d] (stress-ng-%s) was killed by the OOM killer\n",
+             ret, stressor_name);
+    }
+    else if (WTERMSIG(status) == SIGKILL)
+    {
+      pr_dbg("process [%d] (stress-ng-%s) was possibly killed by the OOM killer\n",
+             ret, stressor_name);
+    }
+    else
+    {
+      *success = false;
+    }
+  }
+  
+  switch (wexit_status)
+  {
+    case EXIT_SUCCESS:
+      break;
+    
+    case EXIT_NO_RESOURCE:
+      pr_err_skip("process [%d] (stress-ng-%s) aborted early, out of system resources\n",
+                  ret, stressor_name);
+      *resource_success = false;
+      do_abort = true;
+      break;
+    
+    case EXIT_NOT_IMPLEMENTED:
+      do_abort = true;
+      break;
+    
+    case EXIT_BY_SYS_EXIT:
+      pr_dbg("process [%d] (stress-ng-%s) aborted via exit() which was not expected\n",
+             ret, stressor_name);
+      do_abort = true;
+      break;
+    
+    case EXIT_METRICS_UNTRUSTWORTHY:
+      *metrics_success = false;
+      break;
+    
+    case EXIT_FAILURE:
+      /*
+       *  Stressors should really return EXIT_NOT_SUCCESS
+       *  as EXIT_FAILURE should indicate a core stress-ng
+       *  problem.
+       */
+      wexit_status = EXIT_NOT_SUCCESS;
+      CASE_FALLTHROUGH;
+    
+    default:
+      pr_err("process %d (stress-ng-%s) terminated with an error, exit status=%d (%s)\n",
+             ret, stressor_name, wexit_status,
+             stress_exit_status_to_string(wexit_status));
+      *success = false;
+      do_abort = true;
+      break;
+  }
+  
+  if ((g_opt_flags & OPT_FLAGS_ABORT) && do_abort)
+  {
+    keep_stressing_set_flag(false);
+    wait_flag = false;
+    stress_kill_stressors(SIGALRM);
+  }
+  
+  ss->stats[j]->exited = stress_time_now();
+  stress_stressor_finished(&ss->pids[j]);
+  pr_dbg("process [%d] terminated\n", ret);
+  stress_clean_dir(name, ret, (uint32_t)j);
+}
+
+/*
+ *  stress_wait_pid()
+ *  reap stressor instance j, returns true if it has been
+ *  reaped or does not need reaping, false if it is still
+ *  running and options has WNOHANG
+ */
+static bool MLOCKED_TEXT stress_wait_pid(
+  stress_stressor_t *ss,
+  const int32_t j,
+  const int options,
+  bool *success,
+  bool *resource_success,
+  bool *metrics_success)
+{
+  const pid_t pid = ss->pids[j];
+  int status;
+  pid_t ret;
+  
+  if (!pid)
+  {
+    return true;
+  }
+  
+  ret = shim_waitpid(pid, &status, options);
+  
+  if (ret > 0)
+  {
+    stress_wait_exited(ss, j, ret, status, success,
+                       resource_success, metrics_success);
+    return true;
+  }
+  
+  if (ret == 0)
+  {
+    return false;
+  }
+  
+  /* This child did not exist, mark it done anyhow */
+  if (errno == ECHILD)
+  {
+    stress_stressor_finished(&ss->pids[j]);
+  }
+  
+  return errno != EINTR;
+}
+
+/*
+ *  stress_wait_timeout_ms()
+ *  run the samplers and get the milliseconds until they
+ *  are next due, -1 if there are no samplers to run
+ */
+static inline int stress_wait_timeout_ms(void)
+{
+  const double delay = stress_sample_tick();
+  
+  return (delay < 0.0) ? -1 : (int)ceil(delay * 1000.0);
+}
+
+#if defined(HAVE_SYS_EPOLL_H) && \
+    defined(__linux__)
+
+typedef struct
+{
+  stress_stressor_t *ss;    /* stressor of the instance */
+  int32_t j;      /* instance number */
+  int pidfd;      /* pidfd of the instance process */
+} stress_wait_entry_t;
+
+/*
+ *  stress_wait_epoll()
+ *  reap the stressor instances in the order they exit by
+ *  waiting for their pidfds to become readable with epoll,
+ *  returns -1 if pidfds or epoll cannot be used, instances
+ *  that have not been reaped are then left to the caller
+ */
+static int MLOCKED_TEXT stress_wait_epoll(
+  stress_stressor_t *stressors_list,
+  bool *success,
+  bool *resource_success,
+  bool *metrics_success)
+{
+  stress_stressor_t *ss;
+  stress_wait_entry_t *entries;
+  size_t i, n = 0, remaining = 0;
+  int epfd, ret = -1;
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    n += (size_t)ss->started_instances;
+  }
+  
+  if (!n)
+  {
+    return 0;
+  }
+  
+  entries = calloc(n, sizeof(*entries));
+  
+  if (!entries)
+  {
+    return -1;
+  }
+  
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  
+  if (epfd < 0)
+  {
+    free(entries);
+    return -1;
+  }
+  
+  n = 0;
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    int32_t j;
+    
+    for (j = 0; j < ss->started_instances; j++)
+    {
+      stress_wait_entry_t *entry = &entries[n];
+      struct epoll_event ev;
+      
+      if (!ss->pids[j])
+      {
+        continue;
+      }
+      
+      entry->ss = ss;
+      entry->j = j;
+      entry->pidfd = shim_pidfd_open(ss->pids[j], 0);
+      
+      if (entry->pidfd < 0)
+      {
+        /* already reaped, e.g. by the --aggressive affinity loop */
+        if (errno == ESRCH)
+        {
+          stress_stressor_finished(&ss->pids[j]);
+          continue;
+        }
+        
+        goto err;
+      }
+      
+      n++;
+      (void)memset(&ev, 0, sizeof(ev));
+      ev.events = EPOLLIN;
+      ev.data.u64 = (uint64_t)(n - 1);
+      
+      if (epoll_ctl(epfd, EPOLL_CTL_ADD, entry->pidfd, &ev) < 0)
+      {
+        goto err;
+      }
+    }
+  }
+  
+  for (remaining = n; remaining; )
+  {
+    struct epoll_event events[64];
+    int k, nfds;
+    
+    nfds = epoll_wait(epfd, events, (int)SIZEOF_ARRAY(events),
+                      stress_wait_timeout_ms());
+    
+    if ((nfds < 0) && (errno != EINTR))
+    {
+      pr_dbg("epoll_wait failed, errno=%d (%s), waiting on each process\n",
+             errno, strerror(errno));
+      goto err;
+    }
+    
+    for (k = 0; k < nfds; k++)
+    {
+      stress_wait_entry_t *entry = &entries[events[k].data.u64];
+      
+      /* the process has exited, so this does not block */
+      if (stress_wait_pid(entry->ss, entry->j, 0, success,
+                          resource_success, metrics_success))
+      {
+        (void)close(entry->pidfd);
+        entry->pidfd = -1;
+        remaining--;
+      }
+    }
+  }
+  
+  ret = 0;
+err:
+  
+  for (i = 0; i < n; i++)
+  {
+    if (entries[i].pidfd >= 0)
+    {
+      (void)close(entries[i].pidfd);
+    }
+  }
+  
+  (void)close(epfd);
+  free(entries);
+  return ret;
+}
+#endif
+
+/*
+ *  stress_wait_sigchld_handler()
+ *  SIGCHLD just interrupts the sleep in stress_wait_sigchld
+ */
+static void MLOCKED_TEXT stress_wait_sigchld_handler(int signum)
+{
+  (void)signum;
+}
+
+/*
+ *  stress_wait_sigchld()
+ *  reap the stressor instances as SIGCHLD signals they
+ *  have exited, for systems without pidfds
+ */
+static void MLOCKED_TEXT stress_wait_sigchld(
+  stress_stressor_t *stressors_list,
+  bool *success,
+  bool *resource_success,
+  bool *metrics_success)
+{
+#if defined(SIGCHLD)
+  struct sigaction old_action;
+  const bool handler = (stress_sighandler("stress-ng", SIGCHLD,
+                                          stress_wait_sigchld_handler, &old_action) == 0);
+#endif
+  
+  for (;;)
+  {
+    stress_stressor_t *ss;
+    bool running = false;
+    int timeout_ms;
+    
+    for (ss = stressors_list; ss; ss = ss->next)
+    {
+      int32_t j;
+      
+      for (j = 0; j < ss->started_instances; j++)
+      {
+        if (!stress_wait_pid(ss, j, WNOHANG, success,
+                             resource_success, metrics_success))
+        {
+          running = true;
+        }
+      }
+    }
+    
+    if (!running)
+    {
+      break;
+    }
+    
+    /* a SIGCHLD just before the sleep is caught by the next poll */
+    timeout_ms = stress_wait_timeout_ms();
+    timeout_ms = (timeout_ms < 0) ? 100 : timeout_ms;
+#if defined(HAVE_NANOSLEEP)
+    {
+      struct timespec ts;
+      
+      /* not shim_nanosleep_uint64, SIGCHLD must end the sleep */
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+      (void)nanosleep(&ts, NULL);
+    }
+#else
+    (void)shim_usleep((uint64_t)timeout_ms * 1000);
+#endif
+  }
+  
+#if defined(SIGCHLD)
+  
+  if (handler)
+  {
+    (void)stress_sigrestore("stress-ng", SIGCHLD, &old_action);
+  }
+  
+#endif
+}
+
 /*
  *  stress_wait_stressors()
  *  wait for stressor child processes
@@ -1812,9 +2268,10 @@ static void MLOCKED_TEXT stress_wait_stressors(
    *  On systems that support changing CPU affinity
    *  we keep on moving processes between processors
    *  to impact on memory locality (e.g. NUMA) to
-   *  try to thrash the system when in aggressive mode
+   *  try to thrash the system when in aggressive mode,
+   *  unless the instances have been placed by --placement
    */
-  if (g_opt_flags & OPT_FLAGS_AGGRESSIVE)
+  if ((g_opt_flags & OPT_FLAGS_AGGRESSIVE) && !stress_placement_enabled())
   {
     cpu_set_t proc_mask;
     unsigned long int cpu = 0;
@@ -1843,6 +2300,7 @@ static void MLOCKED_TEXT stress_wait_stressors(
       }
       
       (void)shim_usleep(usec_sleep);
+      (void)stress_sample_tick();
       
       for (ss = stressors_list; ss; ss = ss->next)
       {
@@ -1894,143 +2352,23 @@ static void MLOCKED_TEXT stress_wait_stressors(
   
 do_wait:
 #endif
-
-  for (ss = stressors_list; ss; ss = ss->next)
+  /*
+   *  Reap the stressors in the order they exit, running the
+   *  samplers, duty cycle controller and load profiles while
+   *  waiting
+   */
+#if defined(HAVE_SYS_EPOLL_H) && \
+    defined(__linux__)
+  
+  if (stress_wait_epoll(stressors_list, success, resource_success, metrics_success) < 0)
   {
-    int32_t j;
-    
-    for (j = 0; j < ss->started_instances; j++)
-    {
-      pid_t pid;
-redo:
-      pid = ss->pids[j];
-      
-      if (pid)
-      {
-        int status, ret;
-        bool do_abort = false;
-        const char *stressor_name = stress_munge_underscore(ss->stressor->name);
-        char name[64];
-        (void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
-                       stress_munge_underscore(stressor_name));
-        ret = shim_waitpid(pid, &status, 0);
-        
-        if (ret > 0)
-        {
-          int wexit_status = WEXITSTATUS(status);
-          
-          if (WIFSIGNALED(status))
-          {
-#if defined(WTERMSIG)
-#if NEED_GLIBC(2,1,0)
-            const char *signame = strsignal(WTERMSIG(status));
-            pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d (%s)\n",
-                   ret, stressor_name,
-                   WTERMSIG(status), signame);
-#else
-            pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d\n",
-                   ret, stressor_name,
-                   WTERMSIG(status));
-#endif
+    stress_wait_sigchld(stressors_list, success, resource_success, metrics_success);
+  }
+  
 #else
-            pr_dbg("process [%d] (stress-ng-%s) terminated on signal\n",
-                   ret, stressor_name);
+  stress_wait_sigchld(stressors_list, success, resource_success, metrics_success);
 #endif
-                   
-            /*
-             *  If the stressor got killed by OOM or SIGKILL
-             *  then somebody outside of our control nuked it
-             *  so don't necessarily flag that up as a direct
-             *  failure.
-             */
-            if (stress_process_oomed(ret))
-            {
-              pr_dbg("process [%d] (stress-ng-%s) was killed by the OOM killer\n",
-                     ret, stressor_name);
-            }
-            else if (WTERMSIG(status) == SIGKILL)
-            {
-              pr_dbg("process [%d] (stress-ng-%s) was possibly killed by the OOM killer\n",
-                     ret, stressor_name);
-            }
-            else
-            {
-              *success = false;
-            }
-          }
-          
-          switch (wexit_status)
-          {
-            case EXIT_SUCCESS:
-              break;
-              
-            case EXIT_NO_RESOURCE:
-              pr_err_skip("process [%d] (stress-ng-%s) aborted early, out of system resources\n",
-                          ret, stressor_name);
-              *resource_success = false;
-              do_abort = true;
-              break;
-              
-            case EXIT_NOT_IMPLEMENTED:
-              do_abort = true;
-              break;
-              
-            case EXIT_BY_SYS_EXIT:
-              pr_dbg("process [%d] (stress-ng-%s) aborted via exit() which was not expected\n",
-                     ret, stressor_name);
-              do_abort = true;
-              break;
-              
-            case EXIT_METRICS_UNTRUSTWORTHY:
-              *metrics_success = false;
-              break;
-              
-            case EXIT_FAILURE:
-              /*
-               *  Stressors should really return EXIT_NOT_SUCCESS
-               *  as EXIT_FAILURE should indicate a core stress-ng
-               *  problem.
-               */
-              wexit_status = EXIT_NOT_SUCCESS;
-              CASE_FALLTHROUGH;
-              
-            default:
-              pr_err("process %d (stress-ng-%s) terminated with an error, exit status=%d (%s)\n",
-                     ret, stressor_name, wexit_status,
-                     stress_exit_status_to_string(wexit_status));
-              *success = false;
-              do_abort = true;
-              break;
-          }
-          
-          if ((g_opt_flags & OPT_FLAGS_ABORT) && do_abort)
-          {
-            keep_stressing_set_flag(false);
-            wait_flag = false;
-            stress_kill_stressors(SIGALRM);
-          }
-          
-          stress_stressor_finished(&ss->pids[j]);
-          pr_dbg("process [%d] terminated\n", ret);
-          stress_clean_dir(name, pid, (uint32_t)j);
-        }
-        else if (ret == -1)
-        {
-          /* Somebody interrupted the wait */
-          if (errno == EINTR)
-          {
-            goto redo;
-          }
-          
-          /* This child did not exist, mark it done anyhow */
-          if (errno == ECHILD)
-          {
-            stress_stressor_finished(&ss->pids[j]);
-          }
-        }
-      }
-    }
-  }
+  stress_sample_final();
   
   if (g_opt_flags & OPT_FLAGS_IGNITE_CPU)
   {
@@ -2057,6 +2395,7 @@ static void MLOCKED_TEXT stress_handle_terminate(int signum)
       (void)fprintf(stderr, "%s: info:  [%d] terminated with unexpected signal %s\n",
                     g_app_name, (int)getpid(), stress_strsignal(signum));
       (void)fflush(stderr);
+      stress_cgroup_cleanup();
       _exit(EXIT_SIGNALED);
       
     default:
@@ -2111,6 +2450,8 @@ static void stress_stressors_free(void)
     stress_stressor_t *next = ss->next;
     free(ss->pids);
     free(ss->stats);
+    free(ss->repeat_rates);
+    free(ss->sweep);
     free(ss);
     ss = next;
   }
@@ -2130,36 +2471,917 @@ static int32_t stress_get_total_num_instances(stress_stressor_t *stressors_list)
   
   for (ss = stressors_list; ss; ss = ss->next)
   {
-    total_num_instances += ss->num_instances;
+    total_num_instances += ss->num_instances;
+  }
+  
+  return total_num_instances;
+}
+
+/*
+ *  stress_child_atexit(void)
+ *  handle unexpected exit() call in child stressor
+ */
+static void NORETURN stress_child_atexit(void)
+{
+  _exit(EXIT_BY_SYS_EXIT);
+}
+
+/*
+ *  stress_rusage_add()
+ *  add the resource usage of a getrusage call to ru
+ */
+static void stress_rusage_add(stress_rusage_stats_t *ru, const struct rusage *usage)
+{
+  ru->minflt += (uint64_t)usage->ru_minflt;
+  ru->majflt += (uint64_t)usage->ru_majflt;
+  ru->nvcsw += (uint64_t)usage->ru_nvcsw;
+  ru->nivcsw += (uint64_t)usage->ru_nivcsw;
+  ru->inblock += (uint64_t)usage->ru_inblock;
+  ru->oublock += (uint64_t)usage->ru_oublock;
+  ru->maxrss = STRESS_MAXIMUM(ru->maxrss, (uint64_t)usage->ru_maxrss);
+}
+
+/*
+ *  stress_rusage_get()
+ *  get the resource usage of the calling instance, pthread
+ *  instances share a process so just the calling thread is
+ *  accounted, forked instances include all their threads and
+ *  the child processes they have reaped, returns -1 on failure
+ */
+static int stress_rusage_get(const bool pthread_mode, stress_rusage_stats_t *ru)
+{
+  struct rusage usage;
+  
+  (void)memset(ru, 0, sizeof(*ru));
+  
+  if (pthread_mode)
+  {
+#if defined(RUSAGE_THREAD)
+    
+    if (shim_getrusage(RUSAGE_THREAD, &usage) < 0)
+    {
+      return -1;
+    }
+    
+    stress_rusage_add(ru, &usage);
+    return 0;
+#else
+    return -1;
+#endif
+  }
+  
+  if (shim_getrusage(RUSAGE_SELF, &usage) < 0)
+  {
+    return -1;
+  }
+  
+  stress_rusage_add(ru, &usage);
+  
+  if (shim_getrusage(RUSAGE_CHILDREN, &usage) == 0)
+  {
+    stress_rusage_add(ru, &usage);
+  }
+  
+  return 0;
+}
+
+/*
+ *  stress_rusage_delta()
+ *  account the resource usage of the calling instance since
+ *  the start snapshot, the RSS is the peak and not a delta
+ */
+static void stress_rusage_delta(
+  const bool pthread_mode,
+  const stress_rusage_stats_t *start,
+  stress_rusage_stats_t *ru)
+{
+  stress_rusage_stats_t end;
+  
+  if (!start->valid || (stress_rusage_get(pthread_mode, &end) < 0))
+  {
+    return;
+  }
+  
+  ru->minflt = end.minflt - start->minflt;
+  ru->majflt = end.majflt - start->majflt;
+  ru->nvcsw = end.nvcsw - start->nvcsw;
+  ru->nivcsw = end.nivcsw - start->nivcsw;
+  ru->inblock = end.inblock - start->inblock;
+  ru->oublock = end.oublock - start->oublock;
+  ru->maxrss = end.maxrss;
+  ru->valid = true;
+}
+
+/*
+ *  stress_run_instance()
+ *  run one instance of the current stressor, this is
+ *  used by forked and by pthread instances
+ */
+static int stress_run_instance(
+  const char *name,
+  stress_stats_t *stats,
+  const uint32_t instance,
+  const useconds_t backoff)
+{
+  int rc = EXIT_SUCCESS;
+  stress_checksum_t *checksum = stats->checksum;
+  stress_pace_t pace;
+  uint64_t ops_rate = 0;
+  uint64_t run_ns = 0, delay_ns = 0;
+  int schedstat;
+  const bool pthread_mode = g_stressor_current->pthread_mode;
+  stress_rusage_stats_t rusage;
+  
+  (void)stress_get_setting("ops-rate", &ops_rate);
+  pr_ring_attach((size_t)(stats - g_shared->stats));
+  stats->start = stats->finish = stress_time_now();
+  schedstat = stress_vmstat_schedstat(&run_ns, &delay_ns);
+  stress_fairness_start(stats);
+  rusage.valid = (stress_rusage_get(pthread_mode, &rusage) == 0);
+#if defined(STRESS_PERF_STATS) && \
+    defined(HAVE_LINUX_PERF_EVENT_H)
+  
+  if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+  {
+    (void)stress_perf_open(&stats->sp);
+  }
+  
+#endif
+  (void)shim_usleep(backoff);
+#if defined(STRESS_PERF_STATS) && \
+    defined(HAVE_LINUX_PERF_EVENT_H)
+  
+  if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+  {
+    (void)stress_perf_enable(&stats->sp);
+  }
+  
+#endif
+  
+  if (keep_stressing_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN))
+  {
+    const stress_args_t args =
+    {
+      .counter = &stats->ci.counter,
+      .counter_ready = &stats->ci.counter_ready,
+      .name = name,
+      .max_ops = g_stressor_current->bogo_ops,
+      .instance = instance,
+      .num_instances = (uint32_t)g_stressor_current->num_instances,
+      .pid = getpid(),
+      .ppid = getppid(),
+      .page_size = stress_get_pagesize(),
+      .mapped = &g_shared->mapped,
+      .misc_stats = stats->misc_stats,
+      .latency = (g_opt_flags & OPT_FLAGS_LATENCY) ?
+      &stats->latency : NULL,
+      .pace = ops_rate ? &pace : NULL,
+      .numa = stress_numa_available() ? &stats->numa : NULL,
+      .duty = stress_profile_duty(g_stressor_current, stats)
+    };
+    (void)memset(checksum, 0, sizeof(*checksum));
+    
+    if (ops_rate)
+    {
+      pace.interval_ns = STRESS_NANOSECOND / ops_rate;
+      pace.start_ns = stress_time_now_ns();
+      pace.ops = 0;
+    }
+    
+    rc = g_stressor_current->stressor->info->stressor(&args);
+    pr_fail_check(&rc);
+    
+    if (rc == EXIT_SUCCESS)
+    {
+      stats->run_ok = true;
+      checksum->data.run_ok = true;
+    }
+    
+    stress_set_proc_state(name, STRESS_STATE_STOP);
+    
+    /*
+     *  Bogo ops counter should be OK for reading,
+     *  if not then flag up that the counter may
+     *  be untrustyworthy
+     */
+    if (!stats->ci.counter_ready)
+    {
+      pr_inf("%s: NOTE: bogo-ops counter in non-ready state, metrics are untrustworthy (process may have been terminated prematurely)\n",
+             name);
+      rc = EXIT_METRICS_UNTRUSTWORTHY;
+    }
+    
+    checksum->data.counter = *args.counter;
+    stress_hash_checksum(checksum);
+  }
+  
+#if defined(STRESS_PERF_STATS) && \
+    defined(HAVE_LINUX_PERF_EVENT_H)
+  
+  if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+  {
+    (void)stress_perf_disable(&stats->sp);
+    (void)stress_perf_close(&stats->sp);
+  }
+  
+#endif
+#if defined(STRESS_THERMAL_ZONES)
+  
+  if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
+  {
+    (void)stress_tz_get_temperatures(&g_shared->tz_info, &stats->tz);
+  }
+  
+#endif
+  
+  /* time this instance was runnable but waiting for a CPU */
+  if (schedstat == 0)
+  {
+    uint64_t run_end_ns, delay_end_ns;
+    
+    if (stress_vmstat_schedstat(&run_end_ns, &delay_end_ns) == 0)
+    {
+      stats->run_time_ns = run_end_ns - run_ns;
+      stats->run_delay_ns = delay_end_ns - delay_ns;
+    }
+  }
+  
+  stress_rusage_delta(pthread_mode, &rusage, &stats->rusage);
+  stress_fairness_finish(stats);
+  stats->finish = stress_time_now();
+  
+  return rc;
+}
+
+/*
+ *  stress_get_instance_mode()
+ *  parse the --instance-mode option
+ */
+static int32_t stress_get_instance_mode(const char *const str)
+{
+  if (!strcmp("fork", str))
+  {
+    return STRESS_INSTANCE_MODE_FORK;
+  }
+  
+  if (!strcmp("pthread", str))
+  {
+#if !defined(STRESS_INSTANCE_PTHREAD)
+    (void)fprintf(stderr, "instance-mode pthread is not supported on this "
+                  "system, using fork instead\n");
+    return STRESS_INSTANCE_MODE_FORK;
+#else
+    return STRESS_INSTANCE_MODE_PTHREAD;
+#endif
+  }
+  
+  (void)fprintf(stderr, "Invalid instance-mode option: %s\n", str);
+  (void)fprintf(stderr, "Available options are: fork pthread\n");
+  exit(EXIT_FAILURE);
+}
+
+/*
+ *  stress_instance_pthread()
+ *  true if the instances of a stressor are to be
+ *  run as pthreads rather than forked processes
+ */
+static bool stress_instance_pthread(const stress_stressor_t *ss)
+{
+#if defined(STRESS_INSTANCE_PTHREAD)
+  int32_t instance_mode = STRESS_INSTANCE_MODE_FORK;
+  
+  (void)stress_get_setting("instance-mode", &instance_mode);
+  
+  return (instance_mode == STRESS_INSTANCE_MODE_PTHREAD) &&
+         ss->stressor->info->thread_safe;
+#else
+  (void)ss;
+  
+  return false;
+#endif
+}
+
+#if defined(STRESS_INSTANCE_PTHREAD)
+/*
+ *  per pthread instance information
+ */
+typedef struct
+{
+  pthread_t pthread;    /* pthread of instance */
+  const char *name;   /* stressor process name */
+  stress_stats_t *stats;    /* instance stats */
+  uint32_t instance;    /* instance number */
+  int32_t slot;     /* placement slot of instance */
+  int ret;      /* pthread_create return */
+  int rc;       /* instance exit status */
+} stress_pthread_instance_t;
+
+/*
+ *  stress_pthread_times()
+ *  fill in the user and system times of the calling thread
+ */
+static void stress_pthread_times(struct tms *tms)
+{
+#if defined(HAVE_GETRUSAGE) &&  \
+    defined(RUSAGE_THREAD)
+  struct rusage usage;
+  const double ticks = (double)stress_get_ticks_per_second();
+  
+  (void)memset(tms, 0, sizeof(*tms));
+  
+  if (shim_getrusage(RUSAGE_THREAD, &usage) < 0)
+  {
+    pr_dbg("getrusage failed: errno=%d (%s)\n",
+           errno, strerror(errno));
+    return;
+  }
+  
+  tms->tms_utime = (clock_t)(stress_timeval_to_double(&usage.ru_utime) * ticks);
+  tms->tms_stime = (clock_t)(stress_timeval_to_double(&usage.ru_stime) * ticks);
+#else
+  /* No per thread times, account it all to instance 0 */
+  (void)memset(tms, 0, sizeof(*tms));
+#endif
+}
+
+/*
+ *  stress_run_pthread()
+ *  pthread wrapper to run one stressor instance
+ */
+static void *stress_run_pthread(void *arg)
+{
+  static void *nowt = NULL;
+  stress_pthread_instance_t *pi = (stress_pthread_instance_t *)arg;
+  
+  pi->stats->spawned = stress_time_now();
+  stress_placement_apply(pi->slot);
+  stress_mwc_reseed();
+  pr_dbg("%s: started [%d] (instance %" PRIu32 ", pthread)\n",
+         pi->name, (int)getpid(), pi->instance);
+  pi->rc = stress_run_instance(pi->name, pi->stats, pi->instance, 0);
+  stress_pthread_times(&pi->stats->tms);
+  pr_dbg("%s: exited [%d] (instance %" PRIu32 ", pthread)\n",
+         pi->name, (int)getpid(), pi->instance);
+         
+  return &nowt;
+}
+
+/*
+ *  stress_run_pthreads()
+ *  run all the instances of the current stressor as
+ *  pthreads in the calling process, slot is the placement
+ *  slot of the first instance. Returns the first
+ *  non-successful instance exit status
+ */
+static int stress_run_pthreads(const char *name, const int32_t slot)
+{
+  stress_pthread_instance_t *pis;
+  const int32_t n = g_stressor_current->num_instances;
+  int32_t j;
+  int rc = EXIT_SUCCESS;
+  
+  pis = calloc((size_t)n, sizeof(*pis));
+  
+  if (!pis)
+  {
+    pr_err("%s: cannot allocate %" PRId32 " pthread instances\n", name, n);
+    return EXIT_NO_RESOURCE;
+  }
+  
+  for (j = 0; j < n; j++)
+  {
+    pis[j].name = name;
+    pis[j].stats = g_stressor_current->stats[j];
+    pis[j].instance = (uint32_t)j;
+    pis[j].slot = (slot < 0) ? slot : slot + j;
+    pis[j].rc = EXIT_SUCCESS;
+    pis[j].ret = pthread_create(&pis[j].pthread, NULL,
+                                stress_run_pthread, &pis[j]);
+                                
+    if (pis[j].ret)
+    {
+      pr_err("%s: pthread_create failed for instance %" PRId32 ", errno=%d (%s)\n",
+             name, j, pis[j].ret, strerror(pis[j].ret));
+      pis[j].rc = EXIT_NO_RESOURCE;
+    }
+  }
+  
+  for (j = 0; j < n; j++)
+  {
+    if (!pis[j].ret)
+    {
+      (void)pthread_join(pis[j].pthread, NULL);
+    }
+    
+    if ((rc == EXIT_SUCCESS) && (pis[j].rc != EXIT_SUCCESS))
+    {
+      rc = pis[j].rc;
+    }
+  }
+  
+#if !defined(HAVE_GETRUSAGE) ||  \
+    !defined(RUSAGE_THREAD)
+  
+  if (times(&g_stressor_current->stats[0]->tms) == (clock_t) -1)
+  {
+    pr_dbg("times failed: errno=%d (%s)\n",
+           errno, strerror(errno));
+  }
+  
+#endif
+  free(pis);
+  
+  return rc;
+}
+#endif
+
+void stress_misc_stats_set(
+  stress_misc_stats_t *misc_stats,
+  const int idx,
+  const char *description,
+  const double value)
+{
+  if ((idx < 0) || (idx >= STRESS_MISC_STATS_MAX))
+  {
+    return;
+  }
+  
+  (void)shim_strlcpy(misc_stats[idx].description, description,
+                     sizeof(misc_stats[idx].description));
+  misc_stats[idx].value = value;
+}
+
+/*
+ *  stress_startup_cmp()
+ *  qsort comparison of instance spawn times
+ */
+static int stress_startup_cmp(const void *p1, const void *p2)
+{
+  const double t1 = *(const double *)p1;
+  const double t2 = *(const double *)p2;
+  
+  return (t1 > t2) - (t1 < t2);
+}
+
+/*
+ *  stress_startup_times()
+ *  determine the spawn latency distribution, from fork, of the instances
+ *  of each stressor and how long it took for all the instances
+ *  to be running
+ */
+static void stress_startup_times(
+  stress_stressor_t *stressors_list,
+  const double time_start)
+{
+  stress_stressor_t *ss;
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    int32_t j;
+    size_t n = 0;
+    double first_fork = 0.0, last_start = 0.0;
+    double first_exit = 0.0, last_exit = 0.0;
+    double *spawned;
+    
+    (void)memset(&ss->startup, 0, sizeof(ss->startup));
+    
+    if (ss->started_instances < 1)
+    {
+      continue;
+    }
+    
+    spawned = calloc((size_t)ss->started_instances, sizeof(*spawned));
+    
+    for (j = 0; j < ss->started_instances; j++)
+    {
+      const stress_stats_t *stats = ss->stats[j];
+      const double forked = (stats->forked > 0.0) ? stats->forked : time_start;
+      
+      first_fork = (first_fork > 0.0) ? STRESS_MINIMUM(first_fork, forked) : forked;
+      
+      if (stats->start > last_start)
+      {
+        last_start = stats->start;
+      }
+      
+      if (spawned && (stats->spawned > 0.0))
+      {
+        spawned[n++] = stats->spawned - forked;
+      }
+      
+      if (stats->exited > 0.0)
+      {
+        first_exit = (first_exit > 0.0) ? STRESS_MINIMUM(first_exit, stats->exited) : stats->exited;
+        last_exit = STRESS_MAXIMUM(last_exit, stats->exited);
+      }
+    }
+    
+    ss->startup.all_running = (last_start > first_fork) ? last_start - first_fork : 0.0;
+    ss->startup.exit_skew = last_exit - first_exit;
+    
+    if (n > 0)
+    {
+      qsort(spawned, n, sizeof(*spawned), stress_startup_cmp);
+      ss->startup.spawn_min = spawned[0];
+      ss->startup.spawn_p50 = spawned[(n * 50) / 100];
+      ss->startup.spawn_p90 = spawned[(n * 90) / 100];
+      ss->startup.spawn_max = spawned[n - 1];
+    }
+    
+    free(spawned);
+    pr_dbg("%s: %" PRId32 " instance%s all running after %.4f secs (%s instance mode%s)\n",
+           stress_munge_underscore(ss->stressor->name),
+           ss->started_instances,
+           ss->started_instances == 1 ? "" : "s",
+           ss->startup.all_running,
+           ss->pthread_mode ? "pthread" : "fork",
+           (g_opt_flags & OPT_FLAGS_FANOUT) ? ", fanout" : "");
+  }
+}
+
+/*
+ *  stress_stats_init()
+ *  reset instance stats before the instance is started
+ */
+static void stress_stats_init(stress_stats_t *stats, stress_checksum_t *checksum)
+{
+  size_t i;
+  
+  stats->ci.counter_ready = true;
+  stats->ci.counter = 0;
+  stats->checksum = checksum;
+  stats->forked = 0.0;
+  stats->spawned = 0.0;
+  stats->warmup_time = 0.0;
+  stats->warmup_counter = 0;
+  stats->pid = 0;
+  (void)memset(&stats->latency, 0, sizeof(stats->latency));
+  (void)memset(&stats->numa, 0, sizeof(stats->numa));
+  stats->run_time_ns = 0;
+  stats->run_delay_ns = 0;
+  stats->exited = 0.0;
+  (void)memset(&stats->rusage, 0, sizeof(stats->rusage));
+  (void)memset(&stats->cpus, 0, sizeof(stats->cpus));
+  
+  for (i = 0; i < SIZEOF_ARRAY(stats->misc_stats); i++)
+  {
+    stress_misc_stats_set(stats->misc_stats, i, "", -1);
+  }
+}
+
+/*
+ *  stress_fanout_wait()
+ *  wait until the parent releases the fanout start barrier
+ */
+static void stress_fanout_wait(void)
+{
+  volatile uint32_t *barrier = &g_shared->fanout.barrier;
+  
+  while (keep_stressing_flag() && (*barrier == 0))
+  {
+    struct timespec timeout;
+    
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = 100000000;
+    
+    if ((shim_futex_wait((const void *)barrier, 0, &timeout) < 0) &&
+        (errno == ENOSYS))
+    {
+      (void)shim_usleep(1000);
+    }
+  }
+}
+
+/*
+ *  stress_fanout_release()
+ *  release all the instances waiting on the fanout start barrier
+ */
+static void stress_fanout_release(void)
+{
+  g_shared->fanout.barrier = 1;
+  shim_mb();
+  (void)shim_futex_wake(&g_shared->fanout.barrier, INT_MAX);
+}
+
+/*
+ *  stress_run_child()
+ *  run instance j of the current stressor in a child process,
+ *  slot is the order the instance is started in for --placement
+ */
+static void NORETURN stress_run_child(
+  const int32_t j,
+  const int32_t slot,
+  stress_stats_t *stats,
+  const bool pthread_mode,
+  const useconds_t backoff)
+{
+  int rc = EXIT_SUCCESS;
+  char name[64];
+  int32_t ionice_class = UNDEFINED;
+  int32_t ionice_level = UNDEFINED;
+  const bool fanout = !!(g_opt_flags & OPT_FLAGS_FANOUT);
+  
+  stats->spawned = stress_time_now();
+  (void)stress_get_setting("ionice-class", &ionice_class);
+  (void)stress_get_setting("ionice-level", &ionice_level);
+  (void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
+                 stress_munge_underscore(g_stressor_current->stressor->name));
+  stress_set_proc_state(name, STRESS_STATE_START);
+  stress_placement_apply(slot);
+  stress_numa_stats_local(stats, sizeof(*stats));
+  stress_cgroup_enter(g_stressor_current);
+  (void)sched_settings_apply(true);
+  (void)atexit(stress_child_atexit);
+  (void)setpgid(0, g_pgrp);
+  
+  if (stress_set_handler(name, true) < 0)
+  {
+    rc = EXIT_FAILURE;
+    goto child_exit;
+  }
+  
+  /*
+   *  fanout instances are orphaned when their leader exits,
+   *  so the parent death signal and timeout have to wait
+   *  until the instances are released
+   */
+  if (!fanout)
+  {
+    stress_parent_died_alarm();
+  }
+  
+  stress_process_dumpable(false);
+  stress_set_timer_slack();
+  
+  if (g_opt_timeout && !fanout)
+  {
+    (void)alarm((unsigned int)g_opt_timeout);
+  }
+  
+  stress_set_proc_state(name, STRESS_STATE_INIT);
+  stress_mwc_reseed();
+  stress_set_oom_adjustment(name, false);
+  stress_set_max_limits();
+  stress_set_iopriority(ionice_class, ionice_level);
+  //stress_set_proc_name(name);
+  (void)umask(0077);
+  
+  if (fanout)
+  {
+    stress_fanout_wait();
+    stress_parent_died_alarm();
+    
+    if (g_opt_timeout)
+    {
+      (void)alarm((unsigned int)g_opt_timeout);
+    }
+  }
+  
+#if defined(STRESS_INSTANCE_PTHREAD)
+  
+  if (pthread_mode)
+  {
+    rc = stress_run_pthreads(name, slot);
+    (void)alarm(0);
+    goto child_exit;
+  }
+  
+#else
+  (void)pthread_mode;
+#endif
+  pr_dbg("%s: started [%d] (instance %" PRIu32 ")\n",
+         name, (int)getpid(), j);
+  rc = stress_run_instance(name, stats, (uint32_t)j, backoff);
+  /*
+   *  We're done, cancel SIGALRM
+   */
+  (void)alarm(0);
+  
+  if (times(&stats->tms) == (clock_t) -1)
+  {
+    pr_dbg("times failed: errno=%d (%s)\n",
+           errno, strerror(errno));
+  }
+  
+  pr_dbg("%s: exited [%d] (instance %" PRIu32 ")\n",
+         name, (int)getpid(), j);
+child_exit:
+  stress_stressors_free();
+  stress_cache_free();
+  stress_settings_free();
+  stress_temp_path_free();
+  (void)stress_ftrace_free();
+  
+  if ((rc != 0) && (g_opt_flags & OPT_FLAGS_ABORT))
+  {
+    keep_stressing_set_flag(false);
+    wait_flag = false;
+    (void)kill(getppid(), SIGALRM);
+  }
+  
+  stress_set_proc_state(name, STRESS_STATE_EXIT);
+  
+  if (terminate_signum)
+  {
+    rc = EXIT_SIGNALED;
+  }
+  
+  _exit(rc);
+}
+
+#if defined(HAVE_PRCTL) &&  \
+    defined(PR_SET_CHILD_SUBREAPER)
+/*
+ *  stress_run_leader()
+ *  fanout leader, fork all the instances of the current
+ *  stressor, save their pids in the shared stats and exit;
+ *  slot is the placement slot of the first instance
+ */
+static void NORETURN stress_run_leader(const bool pthread_mode, const int32_t slot)
+{
+  int32_t j, k;
+  const int32_t n = g_stressor_current->num_instances;
+  
+  (void)setpgid(0, g_pgrp);
+  
+  for (j = 0; j < n; j++)
+  {
+    stress_stats_t *stats = g_stressor_current->stats[j];
+    pid_t pid;
+    
+    /* pthread instances are all run by the last instance */
+    if (pthread_mode && (j < n - 1))
+    {
+      continue;
+    }
+    
+again:
+
+    if (!keep_stressing_flag())
+    {
+      break;
+    }
+    
+    /* the pthread container forks all the instances at once */
+    for (k = pthread_mode ? 0 : j; k <= j; k++)
+    {
+      g_stressor_current->stats[k]->forked = stress_time_now();
+    }
+    
+    pid = fork();
+    
+    if (pid < 0)
+    {
+      if (errno == EAGAIN)
+      {
+        (void)shim_usleep(100000);
+        goto again;
+      }
+      
+      pr_err("Cannot fork: errno=%d (%s)\n",
+             errno, strerror(errno));
+      _exit(EXIT_NO_RESOURCE);
+    }
+    else if (pid == 0)
+    {
+      stress_run_child(j, pthread_mode ? slot : slot + j, stats, pthread_mode, 0);
+    }
+    
+    stats->pid = pid;
+  }
+  
+  _exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_run_fanout()
+ *  start the stressors with a fork tree; the parent forks a
+ *  leader per stressor and the leaders fork the instances in
+ *  parallel and then exit. The parent is a child sub-reaper
+ *  so it adopts the orphaned instances. The instances wait on
+ *  a start barrier so they all start stressing at the same
+ *  time. Returns the number of instances started or -1 if
+ *  a fork tree cannot be used.
+ */
+static int32_t stress_run_fanout(
+  stress_stressor_t *stressors_list,
+  stress_checksum_t **checksum)
+{
+  stress_stressor_t *ss;
+  int32_t started_instances = 0;
+  int32_t slot = 0;
+  
+  if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0)
+  {
+    pr_inf("cannot become a child sub-reaper, errno=%d (%s), "
+           "disabling --fanout\n", errno, strerror(errno));
+    g_opt_flags &= ~OPT_FLAGS_FANOUT;
+    return -1;
+  }
+  
+  g_shared->fanout.barrier = 0;
+  shim_mb();
+  
+  for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next)
+  {
+    int32_t j;
+    pid_t pid;
+    const bool pthread_mode = stress_instance_pthread(g_stressor_current);
+    
+    g_stressor_current->pthread_mode = pthread_mode;
+    
+    for (j = 0; j < g_stressor_current->num_instances; j++, (*checksum)++)
+    {
+      stress_stats_init(g_stressor_current->stats[j], *checksum);
+    }
+    
+again:
+
+    if (!keep_stressing_flag())
+    {
+      break;
+    }
+    
+    pid = fork();
+    
+    if (pid < 0)
+    {
+      if (errno == EAGAIN)
+      {
+        (void)shim_usleep(100000);
+        goto again;
+      }
+      
+      pr_err("Cannot fork: errno=%d (%s)\n",
+             errno, strerror(errno));
+      break;
+    }
+    else if (pid == 0)
+    {
+      stress_run_leader(pthread_mode, slot);
+    }
+    
+    /* Stash the leader pid until the leader is reaped */
+    g_stressor_current->pids[0] = pid;
+    slot += g_stressor_current->num_instances;
+  }
+  
+  /*
+   *  Once the leaders have exited all the instances are
+   *  forked, then adopt the instances forked by the leaders
+   */
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    int32_t j;
+    
+    if (ss->pids[0] > 0)
+    {
+      int status;
+      
+      (void)shim_waitpid(ss->pids[0], &status, 0);
+      ss->pids[0] = 0;
+    }
+    
+    for (j = 0; j < ss->num_instances; j++)
+    {
+      const pid_t pid = ss->stats[j]->pid;
+      
+      if (pid > 0)
+      {
+        ss->pids[j] = pid;
+        ss->started_instances = ss->pthread_mode ? ss->num_instances : j + 1;
+        stress_ftrace_add_pid(pid);
+        stress_perf_sample_attach(ss, j, pid);
+      }
+    }
+    
+    started_instances += ss->started_instances;
+  }
+  
+  (void)prctl(PR_SET_CHILD_SUBREAPER, 0);
+  stress_fanout_release();
+  
+  if (!keep_stressing_flag())
+  {
+    pr_dbg("abort signal during startup, cleaning up\n");
+    stress_kill_stressors(SIGALRM);
   }
   
-  return total_num_instances;
-}
-
-/*
- *  stress_child_atexit(void)
- *  handle unexpected exit() call in child stressor
- */
-static void NORETURN stress_child_atexit(void)
-{
-  _exit(EXIT_BY_SYS_EXIT);
+  return started_instances;
 }
-
-void stress_misc_stats_set(
-  stress_misc_stats_t *misc_stats,
-  const int idx,
-  const char *description,
-  const double value)
+#else
+static int32_t stress_run_fanout(
+  stress_stressor_t *stressors_list,
+  stress_checksum_t **checksum)
 {
-  if ((idx < 0) || (idx >= STRESS_MISC_STATS_MAX))
-  {
-    return;
-  }
+  (void)stressors_list;
+  (void)checksum;
   
-  (void)shim_strlcpy(misc_stats[idx].description, description,
-                     sizeof(misc_stats[idx].description));
-  misc_stats[idx].value = value;
+  pr_inf("--fanout is not supported on this system, disabling it\n");
+  g_opt_flags &= ~OPT_FLAGS_FANOUT;
+  return -1;
 }
+#endif
 
 /*
  *  stress_run ()
@@ -2175,29 +3397,42 @@ static void MLOCKED_TEXT stress_run(
 {
   double time_start, time_finish;
   int32_t started_instances = 0;
+  int64_t backoff = DEFAULT_BACKOFF;
   wait_flag = true;
+  stress_cgroup_reset(stressors_list);
   time_start = stress_time_now();
   pr_dbg("starting stressors\n");
+  stress_profile_start(stressors_list);
+  (void)stress_get_setting("backoff", &backoff);
+  
+  if (g_opt_flags & OPT_FLAGS_FANOUT)
+  {
+    started_instances = stress_run_fanout(stressors_list, checksum);
+    
+    if (started_instances >= 0)
+    {
+      goto started;
+    }
+    
+    started_instances = 0;
+  }
   
   /*
    *  Work through the list of stressors to run
    */
   for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next)
   {
-    int32_t j;
+    int32_t j, k;
+    const bool pthread_mode = stress_instance_pthread(g_stressor_current);
+    
+    g_stressor_current->pthread_mode = pthread_mode;
     
     /*
      *  Each stressor has 1 or more instances to run
      */
     for (j = 0; j < g_stressor_current->num_instances; j++, (*checksum)++)
     {
-      int rc = EXIT_SUCCESS;
-      size_t i;
       pid_t pid;
-      char name[64];
-      int64_t backoff = DEFAULT_BACKOFF;
-      int32_t ionice_class = UNDEFINED;
-      int32_t ionice_level = UNDEFINED;
       stress_stats_t *stats = g_stressor_current->stats[j];
       
       if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
@@ -2205,16 +3440,15 @@ static void MLOCKED_TEXT stress_run(
         goto abort;
       }
       
-      (void)stress_get_setting("backoff", &backoff);
-      (void)stress_get_setting("ionice-class", &ionice_class);
-      (void)stress_get_setting("ionice-level", &ionice_level);
-      stats->counter_ready = true;
-      stats->counter = 0;
-      stats->checksum = *checksum;
+      stress_stats_init(stats, *checksum);
       
-      for (i = 0; i < SIZEOF_ARRAY(stats->misc_stats); i++)
+      /*
+       *  pthread instances are all run by one process,
+       *  fork it once all the instance stats are set up
+       */
+      if (pthread_mode && (j < g_stressor_current->num_instances - 1))
       {
-        stress_misc_stats_set(stats->misc_stats, i, "", -1);
+        continue;
       }
       
 again:
@@ -2224,6 +3458,12 @@ again:
         break;
       }
       
+      /* the pthread container forks all the instances at once */
+      for (k = pthread_mode ? 0 : j; k <= j; k++)
+      {
+        g_stressor_current->stats[k]->forked = stress_time_now();
+      }
+      
       pid = fork();
       
       switch (pid)
@@ -2242,164 +3482,27 @@ again:
           
         case 0:
           /* Child */
-          (void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
-                         stress_munge_underscore(g_stressor_current->stressor->name));
-          stress_set_proc_state(name, STRESS_STATE_START);
-          (void)sched_settings_apply(true);
-          (void)atexit(stress_child_atexit);
-          (void)setpgid(0, g_pgrp);
-          
-          if (stress_set_handler(name, true) < 0)
-          {
-            rc = EXIT_FAILURE;
-            goto child_exit;
-          }
-          
-          stress_parent_died_alarm();
-          stress_process_dumpable(false);
-          stress_set_timer_slack();
-          
-          if (g_opt_timeout)
-          {
-            (void)alarm((unsigned int)g_opt_timeout);
-          }
-          
-          stress_set_proc_state(name, STRESS_STATE_INIT);
-          stress_mwc_reseed();
-          stress_set_oom_adjustment(name, false);
-          stress_set_max_limits();
-          stress_set_iopriority(ionice_class, ionice_level);
-          //stress_set_proc_name(name);
-          (void)umask(0077);
-          pr_dbg("%s: started [%d] (instance %" PRIu32 ")\n",
-                 name, (int)getpid(), j);
-          stats->start = stats->finish = stress_time_now();
-#if defined(STRESS_PERF_STATS) && \
-    defined(HAVE_LINUX_PERF_EVENT_H)
-          
-          if (g_opt_flags & OPT_FLAGS_PERF_STATS)
-          {
-            (void)stress_perf_open(&stats->sp);
-          }
-          
-#endif
-          (void)shim_usleep((useconds_t)(backoff * started_instances));
-#if defined(STRESS_PERF_STATS) && \
-    defined(HAVE_LINUX_PERF_EVENT_H)
-          
-          if (g_opt_flags & OPT_FLAGS_PERF_STATS)
-          {
-            (void)stress_perf_enable(&stats->sp);
-          }
+          stress_run_child(j, started_instances, stats, pthread_mode,
+                           (useconds_t)(backoff * started_instances));
           
-#endif
-          
-          if (keep_stressing_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN))
+        default:
+          if (pid > -1)
           {
-            const stress_args_t args =
-            {
-              .counter = &stats->counter,
-              .counter_ready = &stats->counter_ready,
-              .name = name,
-              .max_ops = g_stressor_current->bogo_ops,
-              .instance = (uint32_t)j,
-              .num_instances = (uint32_t)g_stressor_current->num_instances,
-              .pid = getpid(),
-              .ppid = getppid(),
-              .page_size = stress_get_pagesize(),
-              .mapped = &g_shared->mapped,
-              .misc_stats = stats->misc_stats
-            };
-            (void)memset(*checksum, 0, sizeof(**checksum));
-            rc = g_stressor_current->stressor->info->stressor(&args);
-            pr_fail_check(&rc);
+            (void)setpgid(pid, g_pgrp);
+            g_stressor_current->pids[j] = pid;
+            stress_perf_sample_attach(g_stressor_current, j, pid);
             
-            if (rc == EXIT_SUCCESS)
+            if (pthread_mode)
             {
-              stats->run_ok = true;
-              (*checksum)->data.run_ok = true;
+              g_stressor_current->started_instances = g_stressor_current->num_instances;
+              started_instances += g_stressor_current->num_instances;
             }
-            
-            /*
-             *  We're done, cancel SIGALRM
-             */
-            (void)alarm(0);
-            stress_set_proc_state(name, STRESS_STATE_STOP);
-            
-            /*
-             *  Bogo ops counter should be OK for reading,
-             *  if not then flag up that the counter may
-             *  be untrustyworthy
-             */
-            if (!stats->counter_ready)
+            else
             {
-              pr_inf("%s: NOTE: bogo-ops counter in non-ready state, metrics are untrustworthy (process may have been terminated prematurely)\n",
-                     name);
-              rc = EXIT_METRICS_UNTRUSTWORTHY;
+              g_stressor_current->started_instances++;
+              started_instances++;
             }
             
-            (*checksum)->data.counter = *args.counter;
-            stress_hash_checksum(*checksum);
-          }
-          
-#if defined(STRESS_PERF_STATS) && \
-    defined(HAVE_LINUX_PERF_EVENT_H)
-          
-          if (g_opt_flags & OPT_FLAGS_PERF_STATS)
-          {
-            (void)stress_perf_disable(&stats->sp);
-            (void)stress_perf_close(&stats->sp);
-          }
-          
-#endif
-#if defined(STRESS_THERMAL_ZONES)
-          
-          if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
-          {
-            (void)stress_tz_get_temperatures(&g_shared->tz_info, &stats->tz);
-          }
-          
-#endif
-          stats->finish = stress_time_now();
-          
-          if (times(&stats->tms) == (clock_t) -1)
-          {
-            pr_dbg("times failed: errno=%d (%s)\n",
-                   errno, strerror(errno));
-          }
-          
-          pr_dbg("%s: exited [%d] (instance %" PRIu32 ")\n",
-                 name, (int)getpid(), j);
-child_exit:
-          stress_stressors_free();
-          stress_cache_free();
-          stress_settings_free();
-          stress_temp_path_free();
-          (void)stress_ftrace_free();
-          
-          if ((rc != 0) && (g_opt_flags & OPT_FLAGS_ABORT))
-          {
-            keep_stressing_set_flag(false);
-            wait_flag = false;
-            (void)kill(getppid(), SIGALRM);
-          }
-          
-          stress_set_proc_state(name, STRESS_STATE_EXIT);
-          
-          if (terminate_signum)
-          {
-            rc = EXIT_SIGNALED;
-          }
-          
-          _exit(rc);
-          
-        default:
-          if (pid > -1)
-          {
-            (void)setpgid(pid, g_pgrp);
-            g_stressor_current->pids[j] = pid;
-            g_stressor_current->started_instances++;
-            started_instances++;
             stress_ftrace_add_pid(pid);
           }
           
@@ -2416,6 +3519,7 @@ child_exit:
     }
   }
   
+started:
   (void)stress_set_handler("stress-ng", false);
   
   if (g_opt_timeout)
@@ -2427,9 +3531,13 @@ abort:
   pr_dbg("%d stressor%s started\n", started_instances,
          started_instances == 1 ? "" : "s");
 wait_for_stressors:
+  stress_converge_begin(stressors_list);
   stress_wait_stressors(stressors_list, success, resource_success, metrics_success);
+  pr_ring_drain();
+  stress_perf_sample_detach();
   time_finish = stress_time_now();
   *duration += time_finish - time_start;
+  stress_startup_times(stressors_list, time_start);
 }
 
 /*
@@ -2512,15 +3620,15 @@ static void stress_metrics_check(bool *success)
       }
       
       (void)memset(&stats_checksum, 0, sizeof(stats_checksum));
-      stats_checksum.data.counter = stats->counter;
+      stats_checksum.data.counter = stats->ci.counter;
       stats_checksum.data.run_ok = stats->run_ok;
       stress_hash_checksum(&stats_checksum);
       
-      if (stats->counter != checksum->data.counter)
+      if (stats->ci.counter != checksum->data.counter)
       {
         pr_fail("%s instance %d corrupted bogo-ops counter, %" PRIu64 " vs %" PRIu64 "\n",
                 ss->stressor->name, j,
-                stats->counter, checksum->data.counter);
+                stats->ci.counter, checksum->data.counter);
         ok = false;
       }
       
@@ -2586,6 +3694,203 @@ static char *stess_description_yamlify(const char *description)
   return yamlified;
 }
 
+/*
+ *  stress_metrics_latency()
+ *  merge latency histograms of all instances of a stressor,
+ *  returns false if there are no latencies recorded
+ */
+static bool stress_metrics_latency(
+  const stress_stressor_t *ss,
+  stress_latency_t *latency)
+{
+  int32_t j;
+  
+  (void)memset(latency, 0, sizeof(*latency));
+  
+  if (!(g_opt_flags & OPT_FLAGS_LATENCY))
+  {
+    return false;
+  }
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    stress_latency_merge(latency, &ss->stats[j]->latency);
+  }
+  
+  return latency->count > 0;
+}
+
+/*
+ *  stress_metrics_numa()
+ *  sum the sampled buffer page residency of all instances of
+ *  a stressor, returns false if no pages were sampled
+ */
+static bool stress_metrics_numa(
+  const stress_stressor_t *ss,
+  stress_numa_residency_t *numa)
+{
+  int32_t j;
+  
+  (void)memset(numa, 0, sizeof(*numa));
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    numa->local += ss->stats[j]->numa.local;
+    numa->remote += ss->stats[j]->numa.remote;
+  }
+  
+  return (numa->local + numa->remote) > 0;
+}
+
+/*
+ *  stress_metrics_schedstat()
+ *  sum the time all instances of a stressor spent running
+ *  and runnable waiting for a CPU, returns false if the
+ *  schedstats are not available
+ */
+static bool stress_metrics_schedstat(
+  const stress_stressor_t *ss,
+  uint64_t *run_ns,
+  uint64_t *delay_ns)
+{
+  int32_t j;
+  
+  *run_ns = 0;
+  *delay_ns = 0;
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    *run_ns += ss->stats[j]->run_time_ns;
+    *delay_ns += ss->stats[j]->run_delay_ns;
+  }
+  
+  return (*run_ns + *delay_ns) > 0;
+}
+
+/*
+ *  stress_metrics_rusage()
+ *  sum the resource usage of all instances of a stressor, the
+ *  RSS is the largest peak of the instances, returns false if
+ *  no instance has resource usage
+ */
+static bool stress_metrics_rusage(const stress_stressor_t *ss, stress_rusage_stats_t *ru)
+{
+  int32_t j;
+  
+  (void)memset(ru, 0, sizeof(*ru));
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    const stress_rusage_stats_t *const r = &ss->stats[j]->rusage;
+    
+    if (!r->valid)
+    {
+      continue;
+    }
+    
+    ru->minflt += r->minflt;
+    ru->majflt += r->majflt;
+    ru->nvcsw += r->nvcsw;
+    ru->nivcsw += r->nivcsw;
+    ru->inblock += r->inblock;
+    ru->oublock += r->oublock;
+    ru->maxrss = STRESS_MAXIMUM(ru->maxrss, r->maxrss);
+    ru->valid = true;
+  }
+  
+  return ru->valid;
+}
+
+/*
+ *  stress_stressor_totals()
+ *  sum the bogo ops and user and system time ticks of all the
+ *  instances of a stressor and get their average wall clock
+ *  time, any --warmup period is excluded. Instances that
+ *  finished during warm-up are left out, returns the number
+ *  of instances measured
+ */
+static int32_t stress_stressor_totals(
+  const stress_stressor_t *ss,
+  uint64_t *c_total,
+  uint64_t *u_total,
+  uint64_t *s_total,
+  double *r_total,
+  bool *run_ok)
+{
+  int32_t j, n = 0;
+  
+  *c_total = 0;
+  *u_total = 0;
+  *s_total = 0;
+  *r_total = 0.0;
+  *run_ok = false;
+  
+  for (j = 0; j < ss->started_instances; j++)
+  {
+    const stress_stats_t *const stats = ss->stats[j];
+    const uint64_t u = (uint64_t)(stats->tms.tms_utime + stats->tms.tms_cutime);
+    const uint64_t s = (uint64_t)(stats->tms.tms_stime + stats->tms.tms_cstime);
+    
+    *run_ok |= stats->run_ok;
+    
+    if (stress_converge_in_warmup(stats))
+    {
+      continue;
+    }
+    
+    n++;
+    
+    /*
+     *  Exclude warm-up, the CPU time used during warm-up is
+     *  not known so scale it by the measured fraction of the
+     *  instance run time
+     */
+    if ((stats->warmup_time > 0.0) && (stats->finish > stats->start))
+    {
+      const double run = stats->finish - stats->start;
+      const double measured = (stats->finish > stats->warmup_time) ?
+                              stats->finish - stats->warmup_time : 0.0;
+                              
+      *c_total += stats->ci.counter - stats->warmup_counter;
+      *u_total += (uint64_t)((double)u * measured / run);
+      *s_total += (uint64_t)((double)s * measured / run);
+      *r_total += measured;
+    }
+    else
+    {
+      *c_total += stats->ci.counter;
+      *u_total += u;
+      *s_total += s;
+      *r_total += stats->finish - stats->start;
+    }
+  }
+  
+  /* Real time in terms of average wall clock time of all procs */
+  *r_total = n ? *r_total / (double)n : 0.0;
+  
+  return n;
+}
+
+/*
+ *  stress_repeat_record_rates()
+ *  record the real time bogo-op rate of each stressor at
+ *  the end of a --repeat run
+ */
+static void stress_repeat_record_rates(stress_stressor_t *stressors_list)
+{
+  stress_stressor_t *ss;
+  
+  for (ss = stressors_list; ss; ss = ss->next)
+  {
+    uint64_t c_total, u_total, s_total;
+    double r_total;
+    bool run_ok;
+    
+    (void)stress_stressor_totals(ss, &c_total, &u_total, &s_total, &r_total, &run_ok);
+    stress_repeat_record(ss, (r_total > 0.0) ? (double)c_total / r_total : 0.0);
+  }
+}
+
 /*
  *  stress_metrics_dump()
  *  output metrics
@@ -2595,6 +3900,9 @@ static void stress_metrics_dump(
   const int32_t ticks_per_sec)
 {
   stress_stressor_t *ss;
+  uint64_t ops_rate = 0;
+  
+  (void)stress_get_setting("ops-rate", &ops_rate);
   
   if (g_opt_flags & OPT_FLAGS_METRICS_BRIEF)
   {
@@ -2619,31 +3927,28 @@ static void stress_metrics_dump(
   
   for (ss = stressors_head; ss; ss = ss->next)
   {
-    uint64_t c_total = 0, u_total = 0, s_total = 0;
-    double   r_total = 0.0;
-    int32_t  j;
+    uint64_t c_total, u_total, s_total;
+    double   r_total;
+    int32_t  j = 0;
     size_t i;
     const char *munged = stress_munge_underscore(ss->stressor->name);
     double u_time, s_time, t_time, bogo_rate_r_time, bogo_rate, cpu_usage;
-    bool run_ok = false;
+    bool run_ok;
+    stress_repeat_summary_t repeat;
     bool lock = false;
+    bool has_latency, has_numa, has_schedstat, has_cgroup, has_rusage, has_fairness;
+    uint64_t run_ns, delay_ns;
+    stress_cgroup_stats_t cgroup;
+    stress_rusage_stats_t rusage;
+    stress_fairness_t fairness;
+    double per_op;
+    stress_latency_t latency;
+    stress_numa_residency_t numa;
+    double rate_mean, rate_ci;
+    int32_t measured;
     
-    for (j = 0; j < ss->started_instances; j++)
-    {
-      const stress_stats_t *const stats = ss->stats[j];
-      run_ok  |= stats->run_ok;
-      c_total += stats->counter;
-      u_total += (uint64_t)(stats->tms.tms_utime +
-                            stats->tms.tms_cutime);
-      s_total += (uint64_t)(stats->tms.tms_stime +
-                            stats->tms.tms_cstime);
-      r_total += stats->finish - stats->start;
-    }
+    measured = stress_stressor_totals(ss, &c_total, &u_total, &s_total, &r_total, &run_ok);
     
-    /* Real time in terms of average wall clock time of all procs */
-    r_total = ss->started_instances ?
-              r_total / (double)ss->started_instances : 0.0;
-              
     if ((g_opt_flags & OPT_FLAGS_METRICS_BRIEF) &&
         (c_total == 0) && (!run_ok))
     {
@@ -2660,7 +3965,14 @@ static void stress_metrics_dump(
       bogo_rate = (us_total > 0) ? (double)c_total / ((double)us_total / (double)ticks_per_sec) : 0.0;
     }
     cpu_usage = (r_total > 0) ? 100.0 * t_time / r_total : 0.0;
-    cpu_usage = ss->started_instances ? cpu_usage / ss->started_instances : 0.0;
+    cpu_usage = measured ? cpu_usage / measured : 0.0;
+    has_latency = stress_metrics_latency(ss, &latency);
+    has_numa = stress_metrics_numa(ss, &numa);
+    has_schedstat = stress_metrics_schedstat(ss, &run_ns, &delay_ns);
+    has_cgroup = stress_cgroup_stats(ss, &cgroup);
+    has_rusage = stress_metrics_rusage(ss, &rusage);
+    has_fairness = stress_fairness_stats(ss, &fairness);
+    per_op = (c_total > 0) ? 1.0 / (double)c_total : 0.0;
     pr_lock(&lock);
     
     if (g_opt_flags & OPT_FLAGS_METRICS_BRIEF)
@@ -2674,38 +3986,181 @@ static void stress_metrics_dump(
              bogo_rate_r_time, /* bogo ops on wall clock time */
              bogo_rate); /* bogo ops per second */
     }
-    else
+    else
+    {
+      /* extended metrics */
+      pr_inf("%-13s %9" PRIu64 " %9.2f %9.2f %9.2f %12.2f %14.2f %12.2f\n",
+             munged,   /* stress test name */
+             c_total,  /* op count */
+             r_total,  /* average real (wall) clock time */
+             u_time,   /* actual user time */
+             s_time,   /* actual system time */
+             bogo_rate_r_time, /* bogo ops on wall clock time */
+             bogo_rate,  /* bogo ops per second */
+             cpu_usage); /* % cpu usage */
+    }
+    
+    if (measured < ss->started_instances)
+    {
+      pr_inf("%-13s %" PRId32 " of %" PRId32 " instances finished during the warm-up "
+             "and are excluded from the metrics\n", munged,
+             ss->started_instances - measured, ss->started_instances);
+    }
+    
+    for (i = 0; i < SIZEOF_ARRAY(ss->stats[j]->misc_stats); i++)
+    {
+      const char *description = ss->stats[0]->misc_stats[i].description;
+      
+      if (*description)
+      {
+        double metric, total = 0.0;
+        
+        for (j = 0; j < ss->started_instances; j++)
+        {
+          const stress_stats_t *const stats = ss->stats[j];
+          total += stats->misc_stats[i].value;
+        }
+        
+        metric = ss->started_instances ? total / ss->started_instances : 0.0;
+        pr_inf("%-13s %9.2f %s (average per stressor)\n",
+               munged, metric, description);
+      };
+    }
+    
+    if (!(g_opt_flags & OPT_FLAGS_METRICS_BRIEF))
+    {
+      pr_inf("%-13s %9.4f secs until %" PRId32 " instance%s running (%s instance mode%s)\n",
+             munged, ss->startup.all_running, ss->started_instances,
+             ss->started_instances == 1 ? "" : "s",
+             ss->pthread_mode ? "pthread" : "fork",
+             (g_opt_flags & OPT_FLAGS_FANOUT) ? ", fanout" : "");
+      pr_inf("%-13s spawn latency (secs) min %.4f, p50 %.4f, p90 %.4f, max %.4f\n",
+             munged, ss->startup.spawn_min, ss->startup.spawn_p50,
+             ss->startup.spawn_p90, ss->startup.spawn_max);
+      pr_inf("%-13s %9.4f secs from the first to the last instance exiting\n",
+             munged, ss->startup.exit_skew);
+    }
+    
+    if (stress_repeat_summary(ss, &repeat))
+    {
+      pr_inf("%-13s %" PRIu32 " runs: mean %.2f, stddev %.2f, min %.2f, "
+             "max %.2f bogo ops/s, 95%% CI +/- %.2f (%" PRIu32
+             " outlier%s rejected)\n", munged, repeat.runs, repeat.mean,
+             repeat.stddev, repeat.min, repeat.max, repeat.ci,
+             repeat.rejected, repeat.rejected == 1 ? "" : "s");
+    }
+    
+    if (stress_converge_ci(ss, &rate_mean, &rate_ci))
+    {
+      pr_inf("%-13s %.2f bogo ops/s +/- %.2f (95%% CI over %" PRIu64
+             " windows)%s\n", munged, rate_mean, rate_ci, ss->window.n,
+             ss->window.converged > 0.0 ? ", converged" : "");
+    }
+    
+    if (has_fairness &&
+        (!(g_opt_flags & OPT_FLAGS_METRICS_BRIEF) ||
+         (g_opt_flags & OPT_FLAGS_METRICS_INSTANCES)))
+    {
+      pr_inf("%-13s instance bogo ops/s min %.2f, max %.2f, stddev %.2f "
+             "(%.2f%% of mean), Jain's fairness index %.4f\n", munged,
+             fairness.min, fairness.max, fairness.stddev,
+             (fairness.mean > 0.0) ? 100.0 * fairness.stddev / fairness.mean : 0.0,
+             fairness.jain);
+    }
+    
+    stress_fairness_report(ss);
+    
+    if (has_latency && ops_rate)
+    {
+      pr_inf("%-13s latency measured from intended op start times at %"
+             PRIu64 " ops/s per instance\n", munged, ops_rate);
+    }
+    
+    if (has_latency)
+    {
+      pr_inf("%-13s latency (ns) p50 %" PRIu64 ", p90 %" PRIu64
+             ", p99 %" PRIu64 ", p99.9 %" PRIu64 ", max %" PRIu64
+             " (%" PRIu64 " samples)\n",
+             munged,
+             stress_latency_percentile(&latency, 50.0),
+             stress_latency_percentile(&latency, 90.0),
+             stress_latency_percentile(&latency, 99.0),
+             stress_latency_percentile(&latency, 99.9),
+             latency.max, latency.count);
+    }
+    
+    if (has_numa)
+    {
+      const double pages = (double)(numa.local + numa.remote);
+      
+      pr_inf("%-13s buffer pages %.2f%% on local NUMA node, %.2f%% remote (%"
+             PRIu64 " pages sampled)\n", munged,
+             100.0 * (double)numa.local / pages,
+             100.0 * (double)numa.remote / pages,
+             numa.local + numa.remote);
+    }
+    
+    if (has_schedstat && !(g_opt_flags & OPT_FLAGS_METRICS_BRIEF))
     {
-      /* extended metrics */
-      pr_inf("%-13s %9" PRIu64 " %9.2f %9.2f %9.2f %12.2f %14.2f %12.2f\n",
-             munged,   /* stress test name */
-             c_total,  /* op count */
-             r_total,  /* average real (wall) clock time */
-             u_time,   /* actual user time */
-             s_time,   /* actual system time */
-             bogo_rate_r_time, /* bogo ops on wall clock time */
-             bogo_rate,  /* bogo ops per second */
-             cpu_usage); /* % cpu usage */
+      const double wall = r_total * (double)ss->started_instances;
+      
+      pr_inf("%-13s %9.2f secs runnable waiting for a CPU (%.2f%% of "
+             "run time), %.2f secs on a CPU\n", munged,
+             (double)delay_ns / STRESS_NANOSECOND,
+             (wall > 0.0) ? 100.0 * ((double)delay_ns / STRESS_NANOSECOND) / wall : 0.0,
+             (double)run_ns / STRESS_NANOSECOND);
     }
     
-    for (i = 0; i < SIZEOF_ARRAY(ss->stats[j]->misc_stats); i++)
+    if (has_rusage && !(g_opt_flags & OPT_FLAGS_METRICS_BRIEF))
     {
-      const char *description = ss->stats[0]->misc_stats[i].description;
+      pr_inf("%-13s %.4f faults/op (%" PRIu64 " minor, %" PRIu64 " major), %.4f "
+             "ctxsw/op (%" PRIu64 " voluntary, %" PRIu64 " involuntary)\n", munged,
+             (double)(rusage.minflt + rusage.majflt) * per_op,
+             rusage.minflt, rusage.majflt,
+             (double)(rusage.nvcsw + rusage.nivcsw) * per_op,
+             rusage.nvcsw, rusage.nivcsw);
+      pr_inf("%-13s max RSS %.2f MB, %.4f block I/O ops/op (%" PRIu64 " in, %"
+             PRIu64 " out)\n", munged, (double)rusage.maxrss / 1024.0,
+             (double)(rusage.inblock + rusage.oublock) * per_op,
+             rusage.inblock, rusage.oublock);
+    }
+    
+    if (has_cgroup)
+    {
+      pr_inf("%-13s cgroup cpu %.2f secs (%.2f usr, %.2f sys), throttled %"
+             PRIu64 " times for %.2f secs\n", munged,
+             (double)cgroup.cpu_usage_usec / 1000000.0,
+             (double)cgroup.cpu_user_usec / 1000000.0,
+             (double)cgroup.cpu_system_usec / 1000000.0,
+             cgroup.cpu_nr_throttled,
+             (double)cgroup.cpu_throttled_usec / 1000000.0);
       
-      if (*description)
+      if (cgroup.memory)
       {
-        double metric, total = 0.0;
+        char peak[32];
         
-        for (j = 0; j < ss->started_instances; j++)
+        if (cgroup.memory_peak_ok)
         {
-          const stress_stats_t *const stats = ss->stats[j];
-          total += stats->misc_stats[i].value;
+          (void)snprintf(peak, sizeof(peak), "%.2f MB",
+                         (double)cgroup.memory_peak / (double)MB);
+        }
+        else
+        {
+          (void)shim_strlcpy(peak, "n/a", sizeof(peak));
         }
         
-        metric = ss->started_instances ? total / ss->started_instances : 0.0;
-        pr_inf("%-13s %9.2f %s (average per stressor)\n",
-               munged, metric, description);
-      };
+        pr_inf("%-13s cgroup memory peak %s, %" PRIu64 " page faults (%"
+               PRIu64 " major)\n", munged, peak,
+               cgroup.memory_pgfault, cgroup.memory_pgmajfault);
+      }
+      
+      if (cgroup.io)
+      {
+        pr_inf("%-13s cgroup io %.2f MB read (%" PRIu64 " ops), %.2f MB "
+               "written (%" PRIu64 " ops)\n", munged,
+               (double)cgroup.io_rbytes / (double)MB, cgroup.io_rios,
+               (double)cgroup.io_wbytes / (double)MB, cgroup.io_wios);
+      }
     }
     
     pr_unlock(&lock);
@@ -2718,6 +4173,12 @@ static void stress_metrics_dump(
     pr_yaml(yaml, "      system-time: %f\n", s_time);
     pr_yaml(yaml, "      cpu-usage-per-instance: %f\n", cpu_usage);
     
+    if (measured < ss->started_instances)
+    {
+      pr_yaml(yaml, "      warmup-excluded-instances: %" PRId32 "\n",
+              ss->started_instances - measured);
+    }
+    
     for (i = 0; i < SIZEOF_ARRAY(ss->stats[j]->misc_stats); i++)
     {
       const char *description = ss->stats[0]->misc_stats[i].description;
@@ -2737,10 +4198,174 @@ static void stress_metrics_dump(
       };
     }
     
+    if (stress_repeat_summary(ss, &repeat))
+    {
+      pr_yaml(yaml, "      repeat-runs: %" PRIu32 "\n", repeat.runs);
+      pr_yaml(yaml, "      repeat-rejected: %" PRIu32 "\n", repeat.rejected);
+      pr_yaml(yaml, "      repeat-bogo-ops-per-second-mean: %f\n", repeat.mean);
+      pr_yaml(yaml, "      repeat-bogo-ops-per-second-stddev: %f\n", repeat.stddev);
+      pr_yaml(yaml, "      repeat-bogo-ops-per-second-min: %f\n", repeat.min);
+      pr_yaml(yaml, "      repeat-bogo-ops-per-second-max: %f\n", repeat.max);
+      pr_yaml(yaml, "      repeat-bogo-ops-per-second-ci95: %f\n", repeat.ci);
+    }
+    
+    if (stress_converge_ci(ss, &rate_mean, &rate_ci))
+    {
+      pr_yaml(yaml, "      rate-windows: %" PRIu64 "\n", ss->window.n);
+      pr_yaml(yaml, "      rate-window-mean: %f\n", rate_mean);
+      pr_yaml(yaml, "      rate-window-ci95: %f\n", rate_ci);
+      pr_yaml(yaml, "      rate-converged: %s\n",
+              ss->window.converged > 0.0 ? "true" : "false");
+    }
+    
+    pr_yaml(yaml, "      instance-mode: %s\n", ss->pthread_mode ? "pthread" : "fork");
+    pr_yaml(yaml, "      fanout: %s\n", (g_opt_flags & OPT_FLAGS_FANOUT) ? "true" : "false");
+    pr_yaml(yaml, "      startup-time: %f\n", ss->startup.all_running);
+    pr_yaml(yaml, "      spawn-latency-min: %f\n", ss->startup.spawn_min);
+    pr_yaml(yaml, "      spawn-latency-p50: %f\n", ss->startup.spawn_p50);
+    pr_yaml(yaml, "      spawn-latency-p90: %f\n", ss->startup.spawn_p90);
+    pr_yaml(yaml, "      spawn-latency-max: %f\n", ss->startup.spawn_max);
+    pr_yaml(yaml, "      exit-skew: %f\n", ss->startup.exit_skew);
+    
+    if (has_fairness)
+    {
+      pr_yaml(yaml, "      instance-bogo-ops-per-second-min: %f\n", fairness.min);
+      pr_yaml(yaml, "      instance-bogo-ops-per-second-max: %f\n", fairness.max);
+      pr_yaml(yaml, "      instance-bogo-ops-per-second-mean: %f\n", fairness.mean);
+      pr_yaml(yaml, "      instance-bogo-ops-per-second-stddev: %f\n", fairness.stddev);
+      pr_yaml(yaml, "      fairness-index: %f\n", fairness.jain);
+    }
+    
+    if (has_latency)
+    {
+      pr_yaml(yaml, "      ops-rate: %" PRIu64 "\n", ops_rate);
+      pr_yaml(yaml, "      latency-samples: %" PRIu64 "\n", latency.count);
+      pr_yaml(yaml, "      latency-p50-ns: %" PRIu64 "\n",
+              stress_latency_percentile(&latency, 50.0));
+      pr_yaml(yaml, "      latency-p90-ns: %" PRIu64 "\n",
+              stress_latency_percentile(&latency, 90.0));
+      pr_yaml(yaml, "      latency-p99-ns: %" PRIu64 "\n",
+              stress_latency_percentile(&latency, 99.0));
+      pr_yaml(yaml, "      latency-p999-ns: %" PRIu64 "\n",
+              stress_latency_percentile(&latency, 99.9));
+      pr_yaml(yaml, "      latency-max-ns: %" PRIu64 "\n", latency.max);
+    }
+    
+    if (has_numa)
+    {
+      const double pages = (double)(numa.local + numa.remote);
+      
+      pr_yaml(yaml, "      numa-pages-sampled: %" PRIu64 "\n", numa.local + numa.remote);
+      pr_yaml(yaml, "      numa-local-percent: %f\n", 100.0 * (double)numa.local / pages);
+      pr_yaml(yaml, "      numa-remote-percent: %f\n", 100.0 * (double)numa.remote / pages);
+    }
+    
+    if (has_schedstat)
+    {
+      const double wall = r_total * (double)ss->started_instances;
+      
+      pr_yaml(yaml, "      run-time-on-cpu: %f\n", (double)run_ns / STRESS_NANOSECOND);
+      pr_yaml(yaml, "      run-queue-delay: %f\n", (double)delay_ns / STRESS_NANOSECOND);
+      pr_yaml(yaml, "      run-queue-delay-percent: %f\n",
+              (wall > 0.0) ? 100.0 * ((double)delay_ns / STRESS_NANOSECOND) / wall : 0.0);
+    }
+    
+    if (has_rusage)
+    {
+      pr_yaml(yaml, "      minor-faults: %" PRIu64 "\n", rusage.minflt);
+      pr_yaml(yaml, "      major-faults: %" PRIu64 "\n", rusage.majflt);
+      pr_yaml(yaml, "      faults-per-op: %f\n",
+              (double)(rusage.minflt + rusage.majflt) * per_op);
+      pr_yaml(yaml, "      voluntary-ctxsw: %" PRIu64 "\n", rusage.nvcsw);
+      pr_yaml(yaml, "      involuntary-ctxsw: %" PRIu64 "\n", rusage.nivcsw);
+      pr_yaml(yaml, "      ctxsw-per-op: %f\n",
+              (double)(rusage.nvcsw + rusage.nivcsw) * per_op);
+      pr_yaml(yaml, "      max-rss-kb: %" PRIu64 "\n", rusage.maxrss);
+      pr_yaml(yaml, "      block-in-ops: %" PRIu64 "\n", rusage.inblock);
+      pr_yaml(yaml, "      block-out-ops: %" PRIu64 "\n", rusage.oublock);
+      pr_yaml(yaml, "      block-io-ops-per-op: %f\n",
+              (double)(rusage.inblock + rusage.oublock) * per_op);
+    }
+    
+    if (has_cgroup)
+    {
+      pr_yaml(yaml, "      cgroup-cpu-usage-usec: %" PRIu64 "\n", cgroup.cpu_usage_usec);
+      pr_yaml(yaml, "      cgroup-cpu-user-usec: %" PRIu64 "\n", cgroup.cpu_user_usec);
+      pr_yaml(yaml, "      cgroup-cpu-system-usec: %" PRIu64 "\n", cgroup.cpu_system_usec);
+      pr_yaml(yaml, "      cgroup-cpu-nr-throttled: %" PRIu64 "\n", cgroup.cpu_nr_throttled);
+      pr_yaml(yaml, "      cgroup-cpu-throttled-usec: %" PRIu64 "\n", cgroup.cpu_throttled_usec);
+      
+      if (cgroup.memory_peak_ok)
+      {
+        pr_yaml(yaml, "      cgroup-memory-peak: %" PRIu64 "\n", cgroup.memory_peak);
+      }
+      
+      if (cgroup.memory)
+      {
+        pr_yaml(yaml, "      cgroup-memory-anon: %" PRIu64 "\n", cgroup.memory_anon);
+        pr_yaml(yaml, "      cgroup-memory-file: %" PRIu64 "\n", cgroup.memory_file);
+        pr_yaml(yaml, "      cgroup-memory-pgfault: %" PRIu64 "\n", cgroup.memory_pgfault);
+        pr_yaml(yaml, "      cgroup-memory-pgmajfault: %" PRIu64 "\n", cgroup.memory_pgmajfault);
+      }
+      
+      if (cgroup.io)
+      {
+        pr_yaml(yaml, "      cgroup-io-rbytes: %" PRIu64 "\n", cgroup.io_rbytes);
+        pr_yaml(yaml, "      cgroup-io-wbytes: %" PRIu64 "\n", cgroup.io_wbytes);
+        pr_yaml(yaml, "      cgroup-io-rios: %" PRIu64 "\n", cgroup.io_rios);
+        pr_yaml(yaml, "      cgroup-io-wios: %" PRIu64 "\n", cgroup.io_wios);
+      }
+    }
+    
+    stress_fairness_dump(yaml, ss);
     pr_yaml(yaml, "\n");
   }
 }
 
+/*
+ *  stress_psi_dump()
+ *  output the system wide pressure stall percentages over the run,
+ *  these are only logged with the full --metrics
+ */
+static void stress_psi_dump(
+  FILE *yaml,
+  const stress_psi_t *start,
+  const stress_psi_t *finish,
+  const double duration)
+{
+  /* stall totals are in usecs */
+  const double scale = (duration > 0.0) ? 100.0 / (duration * 1000000.0) : 0.0;
+  double cpu_some, cpu_full, memory_some, memory_full, io_some, io_full;
+  
+  if (!start->available || !finish->available)
+  {
+    return;
+  }
+  
+  cpu_some = (double)(finish->cpu_some - start->cpu_some) * scale;
+  cpu_full = (double)(finish->cpu_full - start->cpu_full) * scale;
+  memory_some = (double)(finish->memory_some - start->memory_some) * scale;
+  memory_full = (double)(finish->memory_full - start->memory_full) * scale;
+  io_some = (double)(finish->io_some - start->io_some) * scale;
+  io_full = (double)(finish->io_full - start->io_full) * scale;
+  
+  if (!(g_opt_flags & OPT_FLAGS_METRICS_BRIEF))
+  {
+    pr_inf("pressure stall (%% of run time): cpu some %.2f%% full %.2f%%, "
+           "memory some %.2f%% full %.2f%%, io some %.2f%% full %.2f%%\n",
+           cpu_some, cpu_full, memory_some, memory_full, io_some, io_full);
+  }
+  
+  pr_yaml(yaml, "pressure-stall:\n");
+  pr_yaml(yaml, "      cpu-some-percent: %f\n", cpu_some);
+  pr_yaml(yaml, "      cpu-full-percent: %f\n", cpu_full);
+  pr_yaml(yaml, "      memory-some-percent: %f\n", memory_some);
+  pr_yaml(yaml, "      memory-full-percent: %f\n", memory_full);
+  pr_yaml(yaml, "      io-some-percent: %f\n", io_some);
+  pr_yaml(yaml, "      io-full-percent: %f\n", io_full);
+  pr_yaml(yaml, "\n");
+}
+
 /*
  *  stress_times_dump()
  *  output the run times
@@ -2949,6 +4574,8 @@ static inline void stress_shared_map(const int32_t num_procs)
     exit(EXIT_FAILURE);
   }
   
+  /* Place the stats before they are first touched */
+  stress_numa_shared(g_shared, sz);
   /* Paraniod */
   (void)memset(g_shared, 0, sz);
   g_shared->length = sz;
@@ -3517,6 +5144,42 @@ next_opt:
         stress_set_setting("cache-ways", TYPE_ID_UINT32, &u32);
         break;
         
+      case OPT_compare:
+        g_opt_flags |= OPT_FLAGS_METRICS;
+        stress_set_setting_global("compare", TYPE_ID_STR, (void *)optarg);
+        break;
+        
+      case OPT_compare_threshold:
+        (void)stress_set_compare_threshold(optarg);
+        break;
+        
+      case OPT_cgroup_cpu_max:
+        if (stress_set_cgroup_cpu_max(optarg) < 0)
+        {
+          exit(EXIT_FAILURE);
+        }
+      
+        g_opt_flags |= OPT_FLAGS_CGROUP;
+        break;
+      
+      case OPT_cgroup_io_max:
+        if (stress_set_cgroup_io_max(optarg) < 0)
+        {
+          exit(EXIT_FAILURE);
+        }
+      
+        g_opt_flags |= OPT_FLAGS_CGROUP;
+        break;
+      
+      case OPT_cgroup_memory_max:
+        if (stress_set_cgroup_memory_max(optarg) < 0)
+        {
+          exit(EXIT_FAILURE);
+        }
+      
+        g_opt_flags |= OPT_FLAGS_CGROUP;
+        break;
+      
       case OPT_class:
         ret = stress_get_class(optarg, &u32);
         
@@ -3544,6 +5207,11 @@ next_opt:
         stress_usage();
         break;
         
+      case OPT_instance_mode:
+        i32 = stress_get_instance_mode(optarg);
+        stress_set_setting_global("instance-mode", TYPE_ID_INT32, &i32);
+        break;
+        
       case OPT_ionice_class:
         i32 = stress_get_opt_ionice_class(optarg);
         stress_set_setting("ionice-class", TYPE_ID_INT32, &i32);
@@ -3574,6 +5242,26 @@ next_opt:
         g_opt_flags &= ~OPT_FLAGS_MMAP_MADVISE;
         break;
         
+      case OPT_numa_policy:
+        if (stress_set_numa_policy(optarg) < 0)
+        {
+          exit(EXIT_FAILURE);
+        }
+        
+        break;
+        
+      case OPT_perf_sample:
+        (void)stress_set_perf_sample(optarg);
+        break;
+        
+      case OPT_placement:
+        if (stress_set_placement(optarg) < 0)
+        {
+          exit(EXIT_FAILURE);
+        }
+        
+        break;
+        
       case OPT_query:
         if (!jobmode)
         {
@@ -3586,6 +5274,14 @@ next_opt:
         g_opt_flags &= ~(PR_ALL);
         break;
         
+      case OPT_repeat:
+        (void)stress_set_repeat(optarg);
+        break;
+        
+      case OPT_ops_rate:
+        (void)stress_set_ops_rate(optarg);
+        break;
+        
       case OPT_random:
         g_opt_flags |= OPT_FLAGS_RANDOM;
         i32 = stress_get_int32(optarg);
@@ -3594,6 +5290,22 @@ next_opt:
         stress_set_setting("random", TYPE_ID_INT32, &i32);
         break;
         
+      case OPT_sample_csv:
+        stress_set_setting_global("sample-csv", TYPE_ID_STR, (void *)optarg);
+        break;
+        
+      case OPT_sample_interval:
+        (void)stress_set_sample_interval(optarg);
+        break;
+      
+      case OPT_scale_sweep:
+        if (stress_set_scale_sweep(optarg) < 0)
+        {
+          exit(EXIT_FAILURE);
+        }
+      
+        break;
+        
       case OPT_sched:
         i32 = stress_get_opt_sched(optarg);
         stress_set_setting_global("sched", TYPE_ID_INT32, &i32);
@@ -3641,6 +5353,14 @@ next_opt:
         stress_show_stressor_names();
         exit(EXIT_SUCCESS);
         
+      case OPT_target_load:
+        (void)stress_set_target_load(optarg);
+        break;
+        
+      case OPT_target_throughput:
+        (void)stress_set_target_throughput(optarg);
+        break;
+        
       case OPT_taskset:
         if (stress_set_cpu_affinity(optarg) < 0)
         {
@@ -3649,6 +5369,10 @@ next_opt:
         
         break;
         
+      case OPT_telemetry:
+        stress_set_setting_global("telemetry", TYPE_ID_STR, (void *)optarg);
+        break;
+        
       case OPT_temp_path:
         if (stress_set_temp_path(optarg) < 0)
         {
@@ -3661,6 +5385,14 @@ next_opt:
         g_opt_timeout = stress_get_uint64_time(optarg);
         break;
         
+      case OPT_warmup:
+        (void)stress_set_warmup(optarg);
+        break;
+        
+      case OPT_converge:
+        (void)stress_set_converge(optarg);
+        break;
+        
       case OPT_timer_slack:
         (void)stress_set_timer_slack_ns(optarg);
         break;
@@ -3807,6 +5539,11 @@ static void stress_setup_sequential(const uint32_t class)
       ss->num_instances = g_opt_sequential;
     }
     
+    if (stress_sweep_enabled())
+    {
+      ss->num_instances = stress_sweep_max_instances();
+    }
+    
     stress_alloc_proc_resources(&ss->pids, &ss->stats, ss->num_instances);
   }
 }
@@ -3827,6 +5564,11 @@ static void stress_setup_parallel(const uint32_t class)
       ss->num_instances = g_opt_parallel;
     }
     
+    if (stress_sweep_enabled())
+    {
+      ss->num_instances = stress_sweep_max_instances();
+    }
+    
     /*
      * Share bogo ops between processes equally, rounding up
      * if nonzero bogo_ops
@@ -3841,6 +5583,29 @@ static void stress_setup_parallel(const uint32_t class)
   }
 }
 
+/*
+ *  stress_repeat_reset()
+ *  reset the instance bookkeeping of all the stressors
+ *  before the next --repeat run
+ */
+static void stress_repeat_reset(const uint32_t run, const uint32_t repeat)
+{
+  stress_stressor_t *ss;
+  
+  if (repeat < 2)
+  {
+    return;
+  }
+  
+  pr_inf("run %" PRIu32 " of %" PRIu32 "\n", run + 1, repeat);
+  
+  for (ss = stressors_head; ss; ss = ss->next)
+  {
+    ss->started_instances = 0;
+    (void)memset(ss->pids, 0, sizeof(*ss->pids) * (size_t)ss->num_instances);
+  }
+}
+
 /*
  *  stress_run_sequential()
  *  run stressors sequentially
@@ -3851,19 +5616,28 @@ static inline void stress_run_sequential(
   bool *resource_success,
   bool *metrics_success)
 {
-  stress_stressor_t *ss;
-  stress_checksum_t *checksum = g_shared->checksums;
+  const uint32_t repeat = stress_repeat_count();
+  uint32_t run;
   
-  /*
-   *  Step through each stressor one by one
-   */
-  for (ss = stressors_head; ss && keep_stressing_flag(); ss = ss->next)
+  for (run = 0; (run < repeat) && keep_stressing_flag(); run++)
   {
-    stress_stressor_t *next = ss->next;
-    ss->next = NULL;
-    stress_run(ss, duration, success, resource_success,
-               metrics_success, &checksum);
-    ss->next = next;
+    stress_stressor_t *ss;
+    stress_checksum_t *checksum = g_shared->checksums;
+    
+    stress_repeat_reset(run, repeat);
+    
+    /*
+     *  Step through each stressor one by one
+     */
+    for (ss = stressors_head; ss && keep_stressing_flag(); ss = ss->next)
+    {
+      stress_stressor_t *next = ss->next;
+      ss->next = NULL;
+      stress_run(ss, duration, success, resource_success,
+                 metrics_success, &checksum);
+      stress_repeat_record_rates(ss);
+      ss->next = next;
+    }
   }
 }
 
@@ -3877,12 +5651,83 @@ static inline void stress_run_parallel(
   bool *resource_success,
   bool *metrics_success)
 {
-  stress_checksum_t *checksum = g_shared->checksums;
-  /*
-   *  Run all stressors in parallel
-   */
-  stress_run(stressors_head, duration, success, resource_success,
-             metrics_success, &checksum);
+  const uint32_t repeat = stress_repeat_count();
+  uint32_t run;
+  
+  for (run = 0; (run < repeat) && keep_stressing_flag(); run++)
+  {
+    stress_checksum_t *checksum = g_shared->checksums;
+    
+    stress_repeat_reset(run, repeat);
+    
+    /*
+     *  Run all stressors in parallel
+     */
+    stress_run(stressors_head, duration, success, resource_success,
+               metrics_success, &checksum);
+    stress_repeat_record_rates(stressors_head);
+  }
+}
+
+/*
+ *  stress_run_sweep()
+ *  run each stressor on its own once for each of the
+ *  --scale-sweep instance counts, or --repeat times for
+ *  each count
+ */
+static void stress_run_sweep(
+  double *duration,
+  bool *success,
+  bool *resource_success,
+  bool *metrics_success)
+{
+  const uint32_t repeat = stress_repeat_count();
+  const uint32_t passes = stress_sweep_passes();
+  stress_stressor_t *ss;
+  
+  for (ss = stressors_head; ss && keep_stressing_flag(); ss = ss->next)
+  {
+    stress_stressor_t *next = ss->next;
+    const int32_t max_instances = ss->num_instances;
+    uint32_t pass;
+    
+    ss->next = NULL;
+    
+    for (pass = 0; (pass < passes) && keep_stressing_flag(); pass++)
+    {
+      uint32_t run;
+      
+      ss->num_instances = stress_sweep_instances(pass);
+      
+      for (run = 0; (run < repeat) && keep_stressing_flag(); run++)
+      {
+        stress_checksum_t *checksum = g_shared->checksums;
+        uint64_t c_total, u_total, s_total;
+        double r_total;
+        bool run_ok;
+        char runs[48] = "";
+        
+        if (repeat > 1)
+        {
+          (void)snprintf(runs, sizeof(runs), ", run %" PRIu32 " of %" PRIu32,
+                         run + 1, repeat);
+        }
+        
+        pr_inf("scale-sweep: %s pass %" PRIu32 " of %" PRIu32 ", %" PRId32
+               " instance%s%s\n", stress_munge_underscore(ss->stressor->name),
+               pass + 1, passes, ss->num_instances,
+               ss->num_instances == 1 ? "" : "s", runs);
+        ss->started_instances = 0;
+        (void)memset(ss->pids, 0, sizeof(*ss->pids) * (size_t)max_instances);
+        stress_run(ss, duration, success, resource_success,
+                   metrics_success, &checksum);
+        (void)stress_stressor_totals(ss, &c_total, &u_total, &s_total, &r_total, &run_ok);
+        stress_sweep_record(ss, pass, (r_total > 0.0) ? (double)c_total / r_total : 0.0);
+      }
+    }
+    
+    ss->next = next;
+  }
 }
 
 /*
@@ -3905,11 +5750,13 @@ int main(int argc, char **argv, char **envp)
   bool success = true;
   bool resource_success = true;
   bool metrics_success = true;
+  bool compare_regressed = false;
   FILE *yaml;       /* YAML output file */
   char *yaml_filename = NULL;   /* YAML file name */
   char *log_filename;     /* log filename */
   char *job_filename = NULL;    /* job filename */
   int32_t ticks_per_sec;      /* clock ticks per second (jiffies) */
+  stress_psi_t psi_start, psi_finish; /* pressure stalls over the run */
   int32_t ionice_class = UNDEFINED; /* ionice class */
   int32_t ionice_level = UNDEFINED; /* ionice level */
   size_t i;
@@ -4173,6 +6020,12 @@ int main(int argc, char **argv, char **envp)
     exit(EXIT_FAILURE);
   }
   
+  if (stress_numa_policy_init() < 0)
+  {
+    stress_stressors_free();
+    exit(EXIT_FAILURE);
+  }
+  
   /*
    *  Allocate shared memory segment for shared data
    *  across all the child stressors
@@ -4192,6 +6045,10 @@ int main(int argc, char **argv, char **envp)
    *  Assign procs with shared stats memory
    */
   stress_setup_stats_buffers();
+  /*
+   *  Per instance log rings, before the instances are forked
+   */
+  pr_ring_init(stress_get_total_num_instances(stressors_head));
   /*
    *  Allocate shared cache memory
    */
@@ -4226,10 +6083,39 @@ int main(int argc, char **argv, char **envp)
     stress_thrash_start();
   }
   
+  g_shared->time_epoch = stress_time_now();
   stress_vmstat_start();
   stress_smart_start();
   
-  if (g_opt_flags & OPT_FLAGS_SEQUENTIAL)
+  stress_compare_init();
+  stress_fairness_init(stressors_head);
+  
+  if ((stress_converge_init() < 0) ||
+      (stress_repeat_init(stressors_head) < 0) ||
+      (stress_sample_init(stressors_head) < 0) ||
+      (stress_duty_init(stressors_head) < 0) ||
+      (stress_profile_init(stressors_head) < 0) ||
+      (stress_telemetry_init(stressors_head) < 0) ||
+      (stress_perf_sample_init(stressors_head) < 0) ||
+      (stress_sweep_init(stressors_head) < 0) ||
+      (stress_placement_init() < 0) ||
+      (stress_cgroup_init(stressors_head) < 0))
+  {
+    stress_stressors_deinit();
+    stress_stressors_free();
+    stress_cache_free();
+    stress_shared_unmap();
+    exit(EXIT_FAILURE);
+  }
+  
+  stress_vmstat_psi(&psi_start);
+  
+  if (stress_sweep_enabled())
+  {
+    stress_run_sweep(&duration,
+                     &success, &resource_success, &metrics_success);
+  }
+  else if (g_opt_flags & OPT_FLAGS_SEQUENTIAL)
   {
     stress_run_sequential(&duration,
                           &success, &resource_success, &metrics_success);
@@ -4246,6 +6132,9 @@ int main(int argc, char **argv, char **envp)
     stress_thrash_stop();
   }
   
+  stress_vmstat_psi(&psi_finish);
+  stress_vmstat_stop();
+  stress_cgroup_harvest();
   pr_inf("%s run completed in %.2fs%s\n",
          success ? "successful" : "unsuccessful",
          duration, stress_duration_to_str(duration));
@@ -4255,7 +6144,8 @@ int main(int argc, char **argv, char **envp)
    */
   if (yaml_filename)
   {
-    yaml = fopen(yaml_filename, "w");
+    /* opened for update so --compare can read it back */
+    yaml = fopen(yaml_filename, "w+");
     
     if (!yaml)
     {
@@ -4265,6 +6155,11 @@ int main(int argc, char **argv, char **envp)
     pr_yaml(yaml, "---\n");
     pr_yaml_runinfo(yaml);
   }
+  else if (stress_compare_enabled())
+  {
+    /* unnamed YAML just for the --compare */
+    yaml = tmpfile();
+  }
   
   /*
    *  Dump metrics
@@ -4272,9 +6167,18 @@ int main(int argc, char **argv, char **envp)
   if (g_opt_flags & OPT_FLAGS_METRICS)
   {
     stress_metrics_dump(yaml, ticks_per_sec);
+    stress_psi_dump(yaml, &psi_start, &psi_finish, duration);
   }
   
   stress_metrics_check(&success);
+  /*
+   *  Dump bogo-op rate samples
+   */
+  stress_sample_dump(yaml);
+  stress_vmstat_dump(yaml, stressors_head);
+  stress_duty_report(yaml);
+  stress_profile_report(yaml);
+  stress_sweep_report(yaml);
 #if defined(STRESS_PERF_STATS) && \
     defined(HAVE_LINUX_PERF_EVENT_H)
   
@@ -4287,6 +6191,7 @@ int main(int argc, char **argv, char **envp)
   }
   
 #endif
+  stress_perf_sample_dump(yaml);
 #if defined(STRESS_THERMAL_ZONES)
   
   /*
@@ -4303,13 +6208,25 @@ int main(int argc, char **argv, char **envp)
    *  Dump run times
    */
   stress_times_dump(yaml, ticks_per_sec, duration);
+  /*
+   *  Check for regressions against a baseline
+   */
+  compare_regressed = stress_compare(yaml);
+  stress_telemetry_finish(duration);
   stress_smart_stop();
-  stress_vmstat_stop();
   stress_ftrace_stop();
   stress_ftrace_free();
   /*
    *  Tidy up
    */
+  stress_sample_free();
+  stress_vmstat_free();
+  stress_telemetry_free();
+  stress_perf_sample_free();
+  stress_profile_free();
+  stress_placement_free();
+  stress_cgroup_free();
+  pr_ring_free();
   stress_stressors_deinit();
   stress_stressors_free();
   stress_cache_free();
@@ -4346,5 +6263,10 @@ int main(int argc, char **argv, char **envp)
     exit(EXIT_METRICS_UNTRUSTWORTHY);
   }
   
+  if (compare_regressed)
+  {
+    exit(EXIT_METRICS_REGRESSION);
+  }
+  
   exit(EXIT_SUCCESS);
 }
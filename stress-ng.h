@@ -851,6 +851,7 @@
 #define EXIT_SIGNALED     (5)
 #define EXIT_BY_SYS_EXIT    (6)
 #define EXIT_METRICS_UNTRUSTWORTHY  (7)
+#define EXIT_METRICS_REGRESSION   (8)
 
 /*
  *  Stressor run states
@@ -966,6 +967,13 @@
 #define OPT_FLAGS_SKIP_SILENT  STRESS_BIT_ULL(39) /* --skip-silent */
 #define OPT_FLAGS_SMART    STRESS_BIT_ULL(40) /* --smart */
 #define OPT_FLAGS_NO_OOM_ADJUST  STRESS_BIT_ULL(41) /* --no-oom-adjust */
+#define OPT_FLAGS_LATENCY  STRESS_BIT_ULL(42) /* --latency */
+#define OPT_FLAGS_FANOUT  STRESS_BIT_ULL(43) /* --fanout */
+#define OPT_FLAGS_DUTY    STRESS_BIT_ULL(44) /* --target-load/throughput */
+#define OPT_FLAGS_REPEAT_REJECT STRESS_BIT_ULL(45) /* --repeat-reject */
+#define OPT_FLAGS_CGROUP  STRESS_BIT_ULL(46) /* --cgroup-per-stressor */
+#define OPT_FLAGS_PROFILE STRESS_BIT_ULL(47) /* job file load profiles */
+#define OPT_FLAGS_METRICS_INSTANCES STRESS_BIT_ULL(48) /* --metrics-instances */
 
 #define OPT_FLAGS_MINMAX_MASK   \
   (OPT_FLAGS_MINIMIZE | OPT_FLAGS_MAXIMIZE)
@@ -1051,6 +1059,8 @@ typedef struct
 typedef struct stress_setting
 {
   struct stress_setting *next;  /* next setting in list */
+  struct stress_setting *hash_next; /* next setting in hash chain */
+  uint32_t  index;    /* position in setting list */
   stress_pstressor_info_t proc;
   char *name;     /* name of setting */
   stress_type_id_t type_id; /* setting type */
@@ -1121,6 +1131,40 @@ typedef struct
   double value;
 } stress_misc_stats_t;
 
+/*
+ *  Per instance latency histogram, log-linear (HDR style) buckets
+ *  of nanosecond latencies. Values below STRESS_LATENCY_SUB_BUCKETS
+ *  are recorded exactly, larger values are split into
+ *  STRESS_LATENCY_SUB_BUCKETS linear buckets per power of 2,
+ *  giving a worst case error of 1/16th (6.25%) of the value.
+ */
+#define STRESS_LATENCY_SUB_BITS   (4)
+#define STRESS_LATENCY_SUB_BUCKETS  (1U << STRESS_LATENCY_SUB_BITS)
+#define STRESS_LATENCY_GROUPS   (40)
+#define STRESS_LATENCY_BUCKETS    (STRESS_LATENCY_GROUPS * STRESS_LATENCY_SUB_BUCKETS)
+
+typedef struct
+{
+  uint64_t count;     /* number of latencies recorded */
+  uint64_t max;     /* largest latency recorded, ns */
+  uint64_t buckets[STRESS_LATENCY_BUCKETS]; /* histogram counts */
+} stress_latency_t;
+
+/* --ops-rate open loop pacing state, per instance */
+typedef struct
+{
+  uint64_t start_ns;    /* intended start time of first op */
+  uint64_t interval_ns;   /* time between intended op starts */
+  uint64_t ops;     /* ops counted so far */
+} stress_pace_t;
+
+/* --numa-policy buffer page residency, per instance */
+typedef struct
+{
+  uint64_t local;     /* sampled pages on the instance's node */
+  uint64_t remote;    /* sampled pages on other nodes */
+} stress_numa_residency_t;
+
 /* stressor args */
 typedef struct
 {
@@ -1135,6 +1179,10 @@ typedef struct
   size_t page_size;   /* page size */
   stress_mapped_t *mapped;  /* mmap'd pages, addr of g_shared mapped */
   stress_misc_stats_t *misc_stats;/* misc per stressor stats */
+  stress_latency_t *latency;  /* latency histogram, NULL = disabled */
+  stress_pace_t *pace;    /* ops-rate pacing, NULL = disabled */
+  stress_numa_residency_t *numa;  /* buffer residency, NULL = no NUMA */
+  volatile double *duty;    /* load profile duty cycle, NULL = no profile */
 } stress_args_t;
 
 typedef struct
@@ -1143,6 +1191,16 @@ typedef struct
   int (*opt_set_func)(const char *opt); /* function to set it */
 } stress_opt_set_func_t;
 
+/* --instance-mode settings */
+#define STRESS_INSTANCE_MODE_FORK (0) /* one process per instance */
+#define STRESS_INSTANCE_MODE_PTHREAD  (1) /* one pthread per instance */
+
+/* pthread instances need per thread mwc state */
+#if defined(HAVE_LIB_PTHREAD) &&  \
+    defined(HAVE_THREAD_LOCAL)
+#define STRESS_INSTANCE_PTHREAD   (1)
+#endif
+
 /* stressor information */
 typedef struct
 {
@@ -1155,6 +1213,7 @@ typedef struct
   const stress_class_t class; /* stressor class */
   const stress_opt_set_func_t *opt_set_funcs; /* option functions */
   const stress_help_t *help;  /* stressor help options */
+  const bool thread_safe;   /* true = instances can run as pthreads */
 } stressor_info_t;
 
 /* pthread wrapped stress_args_t */
@@ -1222,6 +1281,27 @@ typedef struct
   uint64_t  discard_ticks;  /* total wait time for discard requests */
 } stress_iostat_t;
 
+/* pressure stall information, from /proc/pressure */
+typedef struct
+{
+  uint64_t  cpu_some; /* usecs some tasks stalled on CPU */
+  uint64_t  cpu_full; /* usecs all tasks stalled on CPU */
+  uint64_t  memory_some;  /* usecs some tasks stalled on memory */
+  uint64_t  memory_full;  /* usecs all tasks stalled on memory */
+  uint64_t  io_some;  /* usecs some tasks stalled on I/O */
+  uint64_t  io_full;  /* usecs all tasks stalled on I/O */
+  bool    available;  /* true if PSI is supported */
+} stress_psi_t;
+
+/* system wide readings for the telemetry */
+typedef struct
+{
+  stress_vmstat_t vmstat;   /* raw vmstat counters */
+  stress_iostat_t iostat;   /* raw iostat counters */
+  double cpu_ghz;     /* average CPU frequency, GHz */
+  double temp_max;    /* hottest thermal zone, degrees C */
+} stress_vmstat_snapshot_t;
+
 /* gcc 4.7 and later support vector ops */
 #if defined(__GNUC__) &&  \
   NEED_GNUC(4, 7, 0)
@@ -1269,6 +1349,13 @@ typedef struct
   #define NOINLINE
 #endif
 
+/* thread local storage */
+#if defined(HAVE_THREAD_LOCAL)
+  #define THREAD_LOCAL  __thread
+#else
+  #define THREAD_LOCAL
+#endif
+
 /* -O3 attribute support */
 #if defined(__GNUC__) &&  \
   !defined(__clang__) &&  \
@@ -1446,6 +1533,11 @@ extern void pr_runinfo(void);
 extern void pr_openlog(const char *filename);
 extern void pr_closelog(void);
 extern void pr_fail_check(int *rc);
+extern void pr_ring_init(const int32_t instances);
+extern WARN_UNUSED bool pr_ring_enabled(void);
+extern void pr_ring_attach(const size_t n);
+extern void pr_ring_drain(void);
+extern void pr_ring_free(void);
 
 extern void pr_dbg(const char *fmt, ...)  FORMAT(printf, 1, 2);
 extern void pr_dbg_skip(const char *fmt, ...)  FORMAT(printf, 1, 2);
@@ -2043,6 +2135,11 @@ static inline void ALWAYS_INLINE inc_counter(const stress_args_t *args)
   shim_mb();
   *args->counter_ready = true;
   shim_mb();
+  
+  if (args->pace)
+  {
+    args->pace->ops++;
+  }
 }
 
 static inline uint64_t ALWAYS_INLINE get_counter(const stress_args_t *args)
@@ -2058,8 +2155,14 @@ static inline void ALWAYS_INLINE set_counter(const stress_args_t *args, const ui
   shim_mb();
   *args->counter_ready = true;
   shim_mb();
+  
+  if (args->pace)
+  {
+    args->pace->ops = val;
+  }
 }
 
+/* add a batch of bogo ops to the stressor bogo ops counter */
 static inline void ALWAYS_INLINE add_counter(const stress_args_t *args, const uint64_t inc)
 {
   *args->counter_ready = false;
@@ -2068,6 +2171,11 @@ static inline void ALWAYS_INLINE add_counter(const stress_args_t *args, const ui
   shim_mb();
   *args->counter_ready = true;
   shim_mb();
+  
+  if (args->pace)
+  {
+    args->pace->ops += inc;
+  }
 }
 
 /* pthread porting shims, spinlock or fallback to mutex */
@@ -2367,6 +2475,7 @@ typedef struct
 {
   uint64_t counter;   /* perf counter */
   int  fd;      /* perf per counter fd */
+  int  leader;      /* index of group leader, -1 = not grouped */
 } stress_perf_stat_t;
 
 /* per stressor perf info */
@@ -2403,11 +2512,65 @@ typedef struct
 } stress_tz_t;
 #endif
 
-/* Per stressor statistics and accounting info */
+#define STRESS_COUNTER_INFO_SIZE  (64)  /* cache line size */
+
+/*
+ *  Per instance bogo ops counter, this is updated by the stressor
+ *  in its hot loop so it is kept on its own cache line away from
+ *  the rest of the stats that are read by the parent
+ */
 typedef struct
 {
   uint64_t counter;   /* number of bogo ops */
   bool counter_ready;   /* counter can be read */
+  uint8_t padding[STRESS_COUNTER_INFO_SIZE - sizeof(uint64_t) - sizeof(bool)];
+} ALIGN64 stress_counter_info_t;
+
+/* Resource usage deltas of an instance, from getrusage */
+typedef struct
+{
+  uint64_t minflt;    /* minor page faults */
+  uint64_t majflt;    /* major page faults */
+  uint64_t nvcsw;     /* voluntary context switches */
+  uint64_t nivcsw;    /* involuntary context switches */
+  uint64_t inblock;   /* block input operations */
+  uint64_t oublock;   /* block output operations */
+  uint64_t maxrss;    /* peak resident set size, KB */
+  bool valid;     /* true if getrusage succeeded */
+} stress_rusage_stats_t;
+
+#define STRESS_CPU_HISTORY_MAX  (16)
+
+/* CPUs an instance was seen on, sampled by --metrics-instances */
+typedef struct
+{
+  pid_t tid;      /* instance thread id */
+  int32_t cpu_start;    /* CPU the instance started on */
+  int32_t cpu_finish;   /* CPU the instance finished on */
+  uint32_t samples;   /* number of CPU samples */
+  uint32_t changes;   /* CPU changes seen by the samples */
+  uint32_t n_history;   /* entries in history */
+  struct
+  {
+    int32_t cpu;    /* CPU the instance was on */
+    uint32_t samples; /* consecutive samples on the CPU */
+  } history[STRESS_CPU_HISTORY_MAX];
+} stress_cpu_history_t;
+
+/* Spread of the per instance bogo-op rates of a stressor */
+typedef struct
+{
+  double min;     /* slowest instance, bogo ops/s */
+  double max;     /* fastest instance, bogo ops/s */
+  double mean;      /* mean instance bogo ops/s */
+  double stddev;      /* standard deviation of bogo ops/s */
+  double jain;      /* Jain's fairness index, 1.0 = fair */
+} stress_fairness_t;
+
+/* Per stressor statistics and accounting info */
+typedef struct
+{
+  stress_counter_info_t ci; /* bogo ops counter */
   struct tms tms;     /* run time stats of process */
   double start;     /* wall clock start time */
   double finish;      /* wall clock stop time */
@@ -2420,6 +2583,19 @@ typedef struct
   bool run_ok;      /* true if stressor exited OK */
   stress_checksum_t *checksum;  /* pointer to checksum data */
   stress_misc_stats_t misc_stats[STRESS_MISC_STATS_MAX];
+  stress_latency_t latency; /* per op latency histogram */
+  stress_numa_residency_t numa; /* buffer page residency */
+  double forked;      /* time instance was forked */
+  double spawned;     /* time instance was spawned */
+  double warmup_time;   /* time warm-up ended, 0.0 = no warm-up */
+  uint64_t warmup_counter;  /* bogo ops at end of warm-up */
+  pid_t pid;      /* instance pid, set by fanout leaders */
+  uint64_t run_time_ns;   /* time running on a CPU, from schedstat */
+  uint64_t run_delay_ns;    /* time runnable waiting for a CPU */
+  volatile double duty;   /* load profile run fraction, 0.0 = parked */
+  double exited;      /* time the parent reaped the instance */
+  stress_rusage_stats_t rusage;   /* resource usage of the instance */
+  stress_cpu_history_t cpus;  /* CPU placement history */
 } stress_stats_t;
 
 #define STRESS_WARN_HASH_MAX    (128)
@@ -2478,6 +2654,15 @@ typedef struct
   uint32_t softlockup_count;      /* Atomic counter of softlock children */
 #endif
   uint8_t  str_shared[STR_SHARED_SIZE];   /* str copying buffer */
+  struct
+  {
+    uint32_t barrier;       /* 0 = hold, 1 = start stressing */
+  } fanout;         /* --fanout start barrier */
+  struct
+  {
+    volatile double cycle;      /* run fraction, 0.0..1.0 */
+  } duty;           /* --target-load duty cycle */
+  double time_epoch;        /* time base of the sample time series */
   stress_checksum_t *checksums;     /* per stressor counter checksum */
   size_t  checksums_length;     /* size of checksums mapping */
   stress_stats_t stats[0];      /* Shared statistics */
@@ -2900,6 +3085,11 @@ typedef enum
   OPT_cap,
   OPT_cap_ops,
   
+  OPT_cgroup_cpu_max,
+  OPT_cgroup_io_max,
+  OPT_cgroup_memory_max,
+  OPT_cgroup_per_stressor,
+  
   OPT_chattr,
   OPT_chattr_ops,
   
@@ -2926,9 +3116,14 @@ typedef enum
   OPT_close,
   OPT_close_ops,
   
+  OPT_compare,
+  OPT_compare_threshold,
+  
   OPT_context,
   OPT_context_ops,
   
+  OPT_converge,
+  
   OPT_copy_file,
   OPT_copy_file_ops,
   OPT_copy_file_bytes,
@@ -3024,6 +3219,8 @@ typedef enum
   OPT_fanotify,
   OPT_fanotify_ops,
   
+  OPT_fanout,
+  
   OPT_fault,
   OPT_fault_ops,
   
@@ -3123,6 +3320,8 @@ typedef enum
   OPT_inotify,
   OPT_inotify_ops,
   
+  OPT_instance_mode,
+  
   OPT_iomix,
   OPT_iomix_bytes,
   OPT_iomix_ops,
@@ -3179,6 +3378,8 @@ typedef enum
   OPT_landlock,
   OPT_landlock_ops,
   
+  OPT_latency,
+  
   OPT_lease,
   OPT_lease_ops,
   OPT_lease_breakers,
@@ -3279,6 +3480,7 @@ typedef enum
   OPT_mergesort_integers,
   
   OPT_metrics_brief,
+  OPT_metrics_instances,
   
   OPT_mincore,
   OPT_mincore_ops,
@@ -3374,12 +3576,15 @@ typedef enum
   
   OPT_numa,
   OPT_numa_ops,
+  OPT_numa_policy,
   
   OPT_oomable,
   
   OPT_oom_pipe,
   OPT_oom_pipe_ops,
   
+  OPT_ops_rate,
+  
   OPT_opcode,
   OPT_opcode_ops,
   OPT_opcode_method,
@@ -3394,6 +3599,7 @@ typedef enum
   OPT_pci_ops,
   
   OPT_perf_stats,
+  OPT_perf_sample,
   
   OPT_personality,
   OPT_personality_ops,
@@ -3418,6 +3624,8 @@ typedef enum
   OPT_pkey,
   OPT_pkey_ops,
   
+  OPT_placement,
+  
   OPT_poll_ops,
   OPT_poll_fds,
   
@@ -3488,6 +3696,9 @@ typedef enum
   
   OPT_rename_ops,
   
+  OPT_repeat,
+  OPT_repeat_reject,
+  
   OPT_resched,
   OPT_resched_ops,
   
@@ -3511,6 +3722,11 @@ typedef enum
   OPT_rtc,
   OPT_rtc_ops,
   
+  OPT_sample_csv,
+  OPT_sample_interval,
+  
+  OPT_scale_sweep,
+  
   OPT_sched,
   OPT_sched_prio,
   
@@ -3719,8 +3935,13 @@ typedef enum
   OPT_tee,
   OPT_tee_ops,
   
+  OPT_target_load,
+  OPT_target_throughput,
+  
   OPT_taskset,
   
+  OPT_telemetry,
+  
   OPT_temp_path,
   
   OPT_thermalstat,
@@ -3844,6 +4065,8 @@ typedef enum
   OPT_wait,
   OPT_wait_ops,
   
+  OPT_warmup,
+  
   OPT_watchdog,
   OPT_watchdog_ops,
   
@@ -3887,6 +4110,73 @@ typedef struct
   const char *name;   /* name of stress test */
 } stress_t;
 
+/* Per stressor instance startup times, secs from fork of the stressor */
+typedef struct
+{
+  double all_running;   /* time until all instances were running */
+  double spawn_min;   /* fastest instance spawn */
+  double spawn_p50;   /* median instance spawn */
+  double spawn_p90;   /* 90th percentile instance spawn */
+  double spawn_max;   /* slowest instance spawn */
+  double exit_skew;   /* time from first to last instance reaped */
+} stress_startup_t;
+
+#define STRESS_WINDOW_RECENT  (10)  /* windows used for --converge */
+
+/* Per stressor bogo-op rate measurement windows */
+typedef struct
+{
+  uint64_t counter;   /* bogo ops total at last window */
+  uint64_t n;     /* windows measured after warm-up */
+  double mean;      /* running mean of window rates */
+  double m2;      /* running sum of squared differences */
+  double recent[STRESS_WINDOW_RECENT];  /* ring of recent window rates */
+  uint32_t recent_n;    /* number of rates in the ring */
+  double converged;   /* time converged, 0.0 = not converged */
+} stress_window_t;
+
+/* --repeat bogo-op rate summary */
+typedef struct
+{
+  uint32_t runs;      /* runs included in the summary */
+  uint32_t rejected;    /* outlier runs rejected */
+  double mean;      /* mean bogo ops/s */
+  double stddev;      /* sample standard deviation */
+  double min;     /* slowest run */
+  double max;     /* fastest run */
+  double ci;      /* half width of 95% confidence interval */
+} stress_repeat_summary_t;
+
+/* --scale-sweep results of one pass of a stressor */
+typedef struct
+{
+  int32_t instances;    /* instances run in the pass */
+  uint32_t runs;      /* runs of the pass, > 1 with --repeat */
+  double rate_sum;    /* sum of the bogo ops/s (real time) of the runs */
+} stress_sweep_pass_t;
+
+/* --cgroup-per-stressor accounting */
+typedef struct
+{
+  uint64_t cpu_usage_usec;  /* cpu.stat usage_usec */
+  uint64_t cpu_user_usec;   /* cpu.stat user_usec */
+  uint64_t cpu_system_usec; /* cpu.stat system_usec */
+  uint64_t cpu_nr_throttled;  /* cpu.stat nr_throttled */
+  uint64_t cpu_throttled_usec;  /* cpu.stat throttled_usec */
+  uint64_t memory_peak;   /* memory.peak, bytes */
+  uint64_t memory_anon;   /* memory.stat anon, bytes */
+  uint64_t memory_file;   /* memory.stat file, bytes */
+  uint64_t memory_pgfault;  /* memory.stat pgfault */
+  uint64_t memory_pgmajfault; /* memory.stat pgmajfault */
+  uint64_t io_rbytes;   /* io.stat rbytes, all devices */
+  uint64_t io_wbytes;   /* io.stat wbytes, all devices */
+  uint64_t io_rios;   /* io.stat rios, all devices */
+  uint64_t io_wios;   /* io.stat wios, all devices */
+  bool memory;      /* memory.stat available */
+  bool memory_peak_ok;    /* memory.peak available */
+  bool io;      /* io.stat available */
+} stress_cgroup_stats_t;
+
 /* Per stressor information */
 typedef struct stress_stressor_info
 {
@@ -3898,6 +4188,12 @@ typedef struct stress_stressor_info
   int32_t started_instances;  /* count of started instances */
   int32_t num_instances;    /* number of instances per stressor */
   uint64_t bogo_ops;    /* number of bogo ops */
+  stress_startup_t startup;  /* instance startup times */
+  stress_window_t window;   /* --warmup/--converge rate windows */
+  uint32_t repeat_n;    /* number of --repeat rates recorded */
+  double *repeat_rates;   /* bogo ops/s (real time) of each run */
+  stress_sweep_pass_t *sweep; /* --scale-sweep results of each pass */
+  bool pthread_mode;    /* true = instances run as pthreads */
 } stress_stressor_t;
 
 /* Pointer to current running stressor proc info */
@@ -3927,6 +4223,7 @@ typedef struct stress_cpu_cache
   uint32_t           ways;  /* cache ways */
   stress_cache_type_t type; /* cache type */
   uint16_t           level; /* cache level, L1, L2 etc */
+  int32_t            shared_cpu;  /* lowest CPU sharing the cache, -1 = unknown */
 } stress_cpu_cache_t;
 
 typedef struct stress_cpu
@@ -3966,16 +4263,63 @@ static inline void OPTIMIZE3 keep_stressing_set_flag(const bool setting)
   g_keep_stressing_flag = setting;
 }
 
+extern void stress_duty_pause(const stress_args_t *args);
+extern void stress_pace_wait(const stress_args_t *args);
+
 /*
  *  keep_stressing()
- *      returns true if we can keep on running a stressor
+ *      returns true if we can keep on running a stressor,
+ *  pauses if a --target-load duty cycle or a load profile
+ *  is in effect and waits for the next op start time if
+ *  --ops-rate is used
  */
 static inline bool OPTIMIZE3 keep_stressing(const stress_args_t *args)
 {
+  if (UNLIKELY(g_opt_flags & (OPT_FLAGS_DUTY | OPT_FLAGS_PROFILE)))
+  {
+    stress_duty_pause(args);
+  }
+  
+  if (UNLIKELY(args->pace != NULL))
+  {
+    stress_pace_wait(args);
+  }
+  
   return (LIKELY(g_keep_stressing_flag) &&
           LIKELY(!args->max_ops || (get_counter(args) < args->max_ops)));
 }
 
+/*
+ *  batch_counter()
+ *  number of bogo ops (up to batch) that can be performed before
+ *  the counter has to be updated with add_counter(), this never
+ *  allows the counter to go beyond max_ops. With --ops-rate each
+ *  op is paced by keep_stressing() and with --target-load or
+ *  --target-throughput the controller needs a steady counter, so
+ *  ops are not batched
+ */
+static inline uint64_t ALWAYS_INLINE batch_counter(const stress_args_t *args, const uint64_t batch)
+{
+  if (args->pace || (g_opt_flags & OPT_FLAGS_DUTY))
+  {
+    return (args->max_ops && (*args->counter >= args->max_ops)) ? 0 : 1;
+  }
+  
+  if (args->max_ops)
+  {
+    const uint64_t counter = *args->counter;
+    
+    if (counter >= args->max_ops)
+    {
+      return 0;
+    }
+    
+    return (args->max_ops - counter) < batch ? args->max_ops - counter : batch;
+  }
+  
+  return batch;
+}
+
 /*
  *  stressor option value handling
  */
@@ -4140,8 +4484,79 @@ extern void stress_mwc_reseed(void);
 /* Time handling */
 extern WARN_UNUSED double stress_timeval_to_double(const struct timeval *tv);
 extern WARN_UNUSED double stress_time_now(void);
+extern WARN_UNUSED uint64_t stress_time_now_ns(void);
 extern const char *stress_duration_to_str(const double duration);
 
+/* Latency histograms */
+extern void stress_latency_record(stress_latency_t *latency, const uint64_t ns);
+extern void stress_latency_merge(stress_latency_t *dst,
+                                 const stress_latency_t *src);
+extern WARN_UNUSED uint64_t stress_latency_percentile(
+  const stress_latency_t *latency, const double percentile);
+
+extern int stress_set_ops_rate(const char *const opt);
+
+/*
+ *  stress_latency_begin()
+ *  start timing an operation, returns 0 if latency
+ *  recording is disabled. With --ops-rate the intended
+ *  start time of the op is used rather than the actual
+ *  start time so that latency is not hidden by ops being
+ *  issued late (coordinated omission)
+ */
+static inline uint64_t ALWAYS_INLINE stress_latency_begin(const stress_args_t *args)
+{
+  if (!args->latency)
+  {
+    return 0;
+  }
+  
+  if (args->pace)
+  {
+    const uint64_t intended = args->pace->start_ns +
+                              (args->pace->ops * args->pace->interval_ns);
+    const uint64_t now = stress_time_now_ns();
+    
+    /* stressors that count the op before starting it are early */
+    return intended < now ? intended : now;
+  }
+  
+  return stress_time_now_ns();
+}
+
+/*
+ *  stress_latency_begin_sample()
+ *  start timing one of several latency samples taken
+ *  in a bogo op, only the first sample is timed from
+ *  the op's intended start, later samples start afresh
+ */
+static inline uint64_t ALWAYS_INLINE stress_latency_begin_sample(
+  const stress_args_t *args,
+  const bool first)
+{
+  if (!args->latency)
+  {
+    return 0;
+  }
+  
+  return first ? stress_latency_begin(args) : stress_time_now_ns();
+}
+
+/*
+ *  stress_latency_end()
+ *  stop timing an operation started with stress_latency_begin
+ *  and add the elapsed time to the instance latency histogram
+ */
+static inline void ALWAYS_INLINE stress_latency_end(
+  const stress_args_t *args,
+  const uint64_t t_begin)
+{
+  if (args->latency)
+  {
+    stress_latency_record(args->latency, stress_time_now_ns() - t_begin);
+  }
+}
+
 /* Perf statistics */
 #if defined(STRESS_PERF_STATS)
 extern int stress_perf_open(stress_perf_t *sp);
@@ -4149,6 +4564,9 @@ extern int stress_perf_enable(stress_perf_t *sp);
 extern int stress_perf_disable(stress_perf_t *sp);
 extern int stress_perf_close(stress_perf_t *sp);
 extern bool stress_perf_stat_succeeded(const stress_perf_t *sp);
+extern WARN_UNUSED bool stress_perf_stat_total(const stress_stressor_t *ss,
+                                               const int p, char *label, const size_t label_len,
+                                               uint64_t *total);
 extern void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *procs_head,
                                   const double duration);
 extern void stress_perf_init(void);
@@ -4257,7 +4675,13 @@ extern WARN_UNUSED size_t stress_get_file_limit(void);
 extern WARN_UNUSED size_t stress_get_max_file_limit(void);
 extern WARN_UNUSED int stress_get_bad_fd(void);
 extern void stress_vmstat_start(void);
+extern void stress_vmstat_cpu_ticks(uint64_t *busy, uint64_t *total);
+extern void stress_vmstat_snapshot(stress_vmstat_snapshot_t *snapshot);
 extern void stress_vmstat_stop(void);
+extern void stress_vmstat_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern void stress_vmstat_free(void);
+extern void stress_vmstat_psi(stress_psi_t *psi);
+extern int stress_vmstat_schedstat(uint64_t *run_ns, uint64_t *delay_ns);
 extern WARN_UNUSED int stress_sigaltstack(void *stack, const size_t size);
 extern WARN_UNUSED int stress_sighandler(const char *name, const int signum,
                                          void (*handler)(int), struct sigaction *orig_action);
@@ -4318,6 +4742,133 @@ extern WARN_UNUSED size_t stress_hostname_length(void);
 extern WARN_UNUSED int32_t stress_set_vmstat(const char *const str);
 extern WARN_UNUSED int32_t stress_set_thermalstat(const char *const str);
 extern WARN_UNUSED int32_t stress_set_iostat(const char *const str);
+extern int stress_set_sample_interval(const char *const opt);
+extern WARN_UNUSED int stress_sample_init(stress_stressor_t *stressors_list);
+extern void stress_sample_free(void);
+extern WARN_UNUSED bool stress_sample_enabled(void);
+extern void stress_sample_poll(void);
+extern double stress_sample_tick(void);
+extern void stress_sample_final(void);
+extern void stress_sample_dump(FILE *yaml);
+
+/* Warm-up and convergence measurement windows */
+extern int stress_set_warmup(const char *const opt);
+extern int stress_set_converge(const char *const opt);
+extern WARN_UNUSED int stress_converge_init(void);
+extern WARN_UNUSED bool stress_converge_enabled(void);
+extern WARN_UNUSED bool stress_converge_in_warmup(const stress_stats_t *stats);
+extern void stress_converge_begin(stress_stressor_t *stressors_list);
+extern void stress_converge_poll(void);
+extern WARN_UNUSED bool stress_converge_ci(const stress_stressor_t *ss,
+                                           double *mean, double *ci);
+
+/* Perf sampling */
+extern int stress_set_perf_sample(const char *const opt);
+extern WARN_UNUSED int stress_perf_sample_init(stress_stressor_t *stressors_list);
+extern WARN_UNUSED bool stress_perf_sample_enabled(void);
+extern void stress_perf_sample_attach(const stress_stressor_t *ss,
+                                      const int32_t instance, const pid_t pid);
+extern void stress_perf_sample_poll(void);
+extern void stress_perf_sample_detach(void);
+extern void stress_perf_sample_dump(FILE *yaml);
+extern void stress_perf_sample_free(void);
+
+/* NUMA memory policy */
+extern int stress_set_numa_policy(const char *const opt);
+extern WARN_UNUSED int stress_numa_policy_init(void);
+extern WARN_UNUSED bool stress_numa_policy_enabled(void);
+extern WARN_UNUSED bool stress_numa_available(void);
+extern void *stress_numa_mmap(void *addr, const size_t length, const int prot,
+                              const int flags, const int fd, const off_t offset);
+extern void stress_numa_residency(const stress_args_t *args, void *addr,
+                                  const size_t length);
+extern int stress_numa_munmap(const stress_args_t *args, void *addr,
+                              const size_t length);
+extern void stress_numa_shared(void *addr, const size_t length);
+extern void stress_numa_stats_local(void *addr, const size_t length);
+
+/* Instance placement */
+extern int stress_set_placement(const char *const opt);
+extern WARN_UNUSED int stress_placement_init(void);
+extern WARN_UNUSED bool stress_placement_enabled(void);
+extern void stress_placement_apply(const int32_t slot);
+extern void stress_placement_free(void);
+
+/* Instance fairness */
+extern void stress_fairness_init(stress_stressor_t *stressors_list);
+extern WARN_UNUSED bool stress_fairness_enabled(void);
+extern void stress_fairness_start(stress_stats_t *stats);
+extern void stress_fairness_finish(stress_stats_t *stats);
+extern void stress_fairness_poll(void);
+extern WARN_UNUSED bool stress_fairness_stats(const stress_stressor_t *ss,
+                                              stress_fairness_t *fairness);
+extern void stress_fairness_report(const stress_stressor_t *ss);
+extern void stress_fairness_dump(FILE *yaml, const stress_stressor_t *ss);
+
+/* Scalability sweep */
+extern int stress_set_scale_sweep(const char *const opt);
+extern WARN_UNUSED bool stress_sweep_enabled(void);
+extern WARN_UNUSED uint32_t stress_sweep_passes(void);
+extern WARN_UNUSED int32_t stress_sweep_instances(const uint32_t pass);
+extern WARN_UNUSED int32_t stress_sweep_max_instances(void);
+extern WARN_UNUSED int stress_sweep_init(stress_stressor_t *stressors_list);
+extern void stress_sweep_record(stress_stressor_t *ss, const uint32_t pass,
+                                const double rate);
+extern void stress_sweep_report(FILE *yaml);
+
+/* Per stressor cgroups */
+extern int stress_set_cgroup_cpu_max(const char *const opt);
+extern int stress_set_cgroup_memory_max(const char *const opt);
+extern int stress_set_cgroup_io_max(const char *const opt);
+extern WARN_UNUSED int stress_cgroup_init(stress_stressor_t *stressors_list);
+extern void stress_cgroup_reset(const stress_stressor_t *stressors_list);
+extern void stress_cgroup_enter(const stress_stressor_t *ss);
+extern void stress_cgroup_harvest(void);
+extern WARN_UNUSED bool stress_cgroup_stats(const stress_stressor_t *ss,
+                                            stress_cgroup_stats_t *stats);
+extern void stress_cgroup_cleanup(void);
+extern void stress_cgroup_free(void);
+
+/* Telemetry */
+extern WARN_UNUSED int stress_telemetry_init(stress_stressor_t *stressors_list);
+extern WARN_UNUSED bool stress_telemetry_enabled(void);
+extern void stress_telemetry_poll(void);
+extern void stress_telemetry_finish(const double duration);
+extern void stress_telemetry_free(void);
+
+/* Baseline comparison */
+extern int stress_set_compare_threshold(const char *const opt);
+extern void stress_compare_init(void);
+extern WARN_UNUSED bool stress_compare_enabled(void);
+extern WARN_UNUSED bool stress_compare(FILE *yaml);
+
+/* Repeated runs */
+extern int stress_set_repeat(const char *const opt);
+extern WARN_UNUSED uint32_t stress_repeat_count(void);
+extern WARN_UNUSED int stress_repeat_init(stress_stressor_t *stressors_list);
+extern void stress_repeat_record(stress_stressor_t *ss, const double rate);
+extern WARN_UNUSED double stress_student_t95(const uint64_t df);
+extern WARN_UNUSED bool stress_repeat_summary(const stress_stressor_t *ss,
+                                              stress_repeat_summary_t *summary);
+
+/* Duty cycle controller */
+extern int stress_set_target_load(const char *const opt);
+extern int stress_set_target_throughput(const char *const opt);
+extern WARN_UNUSED int stress_duty_init(stress_stressor_t *stressors_list);
+extern WARN_UNUSED bool stress_duty_enabled(void);
+extern void stress_duty_poll(void);
+extern void stress_duty_report(FILE *yaml);
+
+/* Job file load profiles */
+extern int stress_profile_parse(const int argc, char **argv);
+extern WARN_UNUSED int stress_profile_init(stress_stressor_t *stressors_list);
+extern WARN_UNUSED bool stress_profile_enabled(void);
+extern volatile double *stress_profile_duty(const stress_stressor_t *ss,
+                                            stress_stats_t *stats);
+extern void stress_profile_start(stress_stressor_t *stressors_list);
+extern void stress_profile_poll(void);
+extern void stress_profile_report(FILE *yaml);
+extern void stress_profile_free(void);
 extern void stress_misc_stats_set(stress_misc_stats_t *misc_stats,
                                   const int idx, const char *description, const double value);
 extern WARN_UNUSED int stress_tty_width(void);
@@ -308,7 +308,9 @@ again:
     do
     {
       ssize_t ret;
+      uint64_t t_lat;
       pipe_memset(buf, (char)val++, pipe_data_size);
+      t_lat = stress_latency_begin(args);
       ret = write(pipefds[1], buf, pipe_data_size);
       
       if (ret <= 0)
@@ -328,6 +330,7 @@ again:
         continue;
       }
       
+      stress_latency_end(args, t_lat);
       inc_counter(args);
     }
     while (keep_stressing(args));
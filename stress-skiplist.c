@@ -310,5 +310,6 @@ stressor_info_t stress_skiplist_info =
   .stressor = stress_skiplist,
   .class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
   .opt_set_funcs = opt_set_funcs,
-  .help = help
+  .help = help,
+  .thread_safe = true
 };
@@ -1171,6 +1171,7 @@ static int stress_sock_server(
         case SOCKET_OPT_SEND:
           for (i = 16; i < MMAP_IO_SIZE; i += 16)
           {
+            const uint64_t t_lat = stress_latency_begin_sample(args, i == 16);
             ssize_t ret = send(sfd, buf, i, sendflag);
             
             if (ret < 0)
@@ -1183,6 +1184,7 @@ static int stress_sock_server(
             }
             else
             {
+              stress_latency_end(args, t_lat);
               msgs++;
             }
           }
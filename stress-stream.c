@@ -376,16 +376,16 @@ static void stress_stream_init_data(
 static inline void *stress_stream_mmap(const stress_args_t *args, uint64_t sz)
 {
   void *ptr;
-  ptr = mmap(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
+  ptr = stress_numa_mmap(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
 #if defined(MAP_POPULATE)
-             MAP_POPULATE |
+                         MAP_POPULATE |
 #endif
 #if defined(HAVE_MADVISE)
-             MAP_PRIVATE |
+                         MAP_PRIVATE |
 #else
-             MAP_SHARED |
+                         MAP_SHARED |
 #endif
-             MAP_ANONYMOUS, -1, 0);
+                         MAP_ANONYMOUS, -1, 0);
              
   /* Coverity Scan believes NULL can be returned, doh */
   if (!ptr || (ptr == MAP_FAILED))
@@ -689,7 +689,7 @@ static int stress_stream(const stress_args_t *args)
   
   if (idx3)
   {
-    (void)munmap((void *)idx3, sz_idx);
+    (void)stress_numa_munmap(args, (void *)idx3, sz_idx);
   }
   
 err_idx3:
@@ -697,7 +697,7 @@ err_idx3:
   
   if (idx2)
   {
-    (void)munmap((void *)idx2, sz_idx);
+    (void)stress_numa_munmap(args, (void *)idx2, sz_idx);
   }
   
 err_idx2:
@@ -705,18 +705,18 @@ err_idx2:
   
   if (idx1)
   {
-    (void)munmap((void *)idx1, sz_idx);
+    (void)stress_numa_munmap(args, (void *)idx1, sz_idx);
   }
   
 err_idx1:
   stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-  (void)munmap((void *)c, sz);
+  (void)stress_numa_munmap(args, (void *)c, sz);
 err_c:
   stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-  (void)munmap((void *)b, sz);
+  (void)stress_numa_munmap(args, (void *)b, sz);
 err_b:
   stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-  (void)munmap((void *)a, sz);
+  (void)stress_numa_munmap(args, (void *)a, sz);
 err_a:
   stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
   return rc;
@@ -186,6 +186,7 @@ again:
     do
     {
       ssize_t ret;
+      const uint64_t t_lat = stress_latency_begin(args);
       inc_counter(args);
       ret = write(pipefds[1], buf, sizeof(buf));
       
@@ -206,6 +207,8 @@ again:
         continue;
       }
       
+      stress_latency_end(args, t_lat);
+      
       if (switch_freq)
       {
         /*
@@ -24,6 +24,8 @@
  */
 #include "stress-ng.h"
 
+#define STRESS_TSC_BATCH  (16)  /* bogo ops per counter update */
+
 static const stress_help_t help[] =
 {
   { NULL, "tsc N",  "start N workers reading the time stamp counter" },
@@ -235,11 +237,18 @@ static int stress_tsc(const stress_args_t *args)
   {
     do
     {
-      TSCx32();
-      TSCx32();
-      TSCx32();
-      TSCx32();
-      inc_counter(args);
+      const uint64_t n = batch_counter(args, STRESS_TSC_BATCH);
+      uint64_t i;
+      
+      for (i = 0; i < n; i++)
+      {
+        TSCx32();
+        TSCx32();
+        TSCx32();
+        TSCx32();
+      }
+      
+      add_counter(args, n);
     }
     while (keep_stressing(args));
   }
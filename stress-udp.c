@@ -267,8 +267,11 @@ again:
         
         for (i = 16; i < sizeof(buf); i += 16, j++)
         {
+          ssize_t ret;
+          uint64_t t_lat;
           (void)memset(buf, 'A' + (j % 26), sizeof(buf));
-          ssize_t ret = sendto(fd, buf, i, 0, addr, len);
+          t_lat = stress_latency_begin_sample(args, i == 16);
+          ret = sendto(fd, buf, i, 0, addr, len);
           
           if (ret < 0)
           {
@@ -281,6 +284,8 @@ again:
                     args->name, errno, strerror(errno));
             break;
           }
+          
+          stress_latency_end(args, t_lat);
         }
         
 #if defined(SIOCOUTQ)
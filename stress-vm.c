@@ -2529,6 +2529,7 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
   size_t vm_bytes = DEFAULT_VM_BYTES;
   const size_t page_size = args->page_size;
   bool vm_keep = false;
+  bool numa_sampled = false;
   stress_vm_context_t *context = (stress_vm_context_t *)ctxt;
   const stress_vm_func func = context->vm_method->func;
   (void)stress_get_setting("vm-hang", &vm_hang);
@@ -2574,10 +2575,10 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
         return EXIT_SUCCESS;
       }
       
-      buf = (uint8_t *)mmap(NULL, buf_sz,
-                            PROT_READ | PROT_WRITE,
-                            MAP_PRIVATE | MAP_ANONYMOUS |
-                            vm_flags, -1, 0);
+      buf = (uint8_t *)stress_numa_mmap(NULL, buf_sz,
+                                        PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS |
+                                        vm_flags, -1, 0);
                             
       if (buf == MAP_FAILED)
       {
@@ -2618,14 +2619,27 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
     if (!vm_keep)
     {
       (void)stress_madvise_random(buf, buf_sz);
-      (void)munmap(buf, buf_sz);
+      
+      /*
+       *  Sampling residency is expensive, so only sample
+       *  the first and the last mapping of the run
+       */
+      if (!numa_sampled || !keep_stressing_vm(args))
+      {
+        (void)stress_numa_munmap(args, buf, buf_sz);
+        numa_sampled = true;
+      }
+      else
+      {
+        (void)munmap(buf, buf_sz);
+      }
     }
   }
   while (keep_stressing_vm(args));
   
   if (vm_keep && buf != NULL)
   {
-    (void)munmap((void *)buf, buf_sz);
+    (void)stress_numa_munmap(args, (void *)buf, buf_sz);
   }
   
   return EXIT_SUCCESS;